@@ -1155,6 +1155,8 @@ function doWrappOO(funcFullName_dw, params_dw, metaComment_dw) {
 	doWrapp_dw = 1;
 
 	#doWrapp_dw = doWrapp_dw && !match(funcFullName_dw, /Lua_callRules/) && !match(funcFullName_dw, /Lua_callUI/);
+	# bulk accessors fill several arrays at once, which the OO wrappers can not express
+	doWrapp_dw = doWrapp_dw && !match(funcFullName_dw, /^Bulk_/);
 
 	return doWrapp_dw;
 }
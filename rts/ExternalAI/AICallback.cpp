@@ -805,19 +805,44 @@ static int FilterUnitsVector(const std::vector<CUnit*>& units, int* unitIds, int
 }
 
 
-static int myAllyTeamId = -1;
+// quadfield queries must not use the shared QuadFieldQuery vectors or
+// tempNum's since AI's can run on their own threads (AsyncSkirmishAI)
+static const std::vector<CUnit*>& GetUnitsExact(const float3& pos, float radius)
+{
+	static thread_local std::vector<int> quads;
+	static thread_local std::vector<CUnit*> units;
+
+	quads.clear();
+	units.clear();
+	quadField.GetUnitsExact(pos, radius, quads, units);
+	return units;
+}
+
+static const std::vector<CFeature*>& GetFeaturesExact(const float3& pos, float radius)
+{
+	static thread_local std::vector<int> quads;
+	static thread_local std::vector<CFeature*> features;
+
+	quads.clear();
+	features.clear();
+	quadField.GetFeaturesExact(pos, radius, quads, features);
+	return features;
+}
+
+
+static thread_local int myAllyTeamId = -1;
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsEnemy(const CUnit* unit) {
 	return (!teamHandler.Ally(unit->allyteam, myAllyTeamId) && !unit->IsNeutral());
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsFriendly(const CUnit* unit) {
 	return (teamHandler.Ally(unit->allyteam, myAllyTeamId) && !unit->IsNeutral());
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsInSensor(const CUnit* unit, const unsigned short losFlags) {
 	// Skip in-sensor-range test if the unit is allied with our team.
 	// This prevents errors where an allied unit is starting to build,
@@ -826,22 +851,22 @@ static inline bool unit_IsInSensor(const CUnit* unit, const unsigned short losFl
 	return (teamHandler.Ally(myAllyTeamId, unit->allyteam) || ((unit->losStatus[myAllyTeamId] & losFlags) != 0));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsInLos(const CUnit* unit) {
 	return unit_IsInSensor(unit, LOS_INLOS);
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsEnemyAndInLos(const CUnit* unit) {
 	return (unit_IsEnemy(unit) && unit_IsInLos(unit));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsEnemyAndInLosOrRadar(const CUnit* unit) {
 	return (unit_IsEnemy(unit) && ((unit->losStatus[myAllyTeamId] & (LOS_INLOS | LOS_INRADAR)) != 0));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsNeutralAndInLosOrRadar(const CUnit* unit) {
 	return (unit->IsNeutral() && (unit_IsInSensor(unit, LOS_INLOS | LOS_INRADAR)));
 }
@@ -864,10 +889,8 @@ int CAICallback::GetEnemyUnits(int* unitIds, const float3& pos, float radius,
 		int unitIds_max)
 {
 	verify();
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius);
 	myAllyTeamId = teamHandler.AllyTeam(team);
-	return FilterUnitsVector(*qfQuery.units, unitIds, unitIds_max, &unit_IsEnemyAndInLos);
+	return FilterUnitsVector(GetUnitsExact(pos, radius), unitIds, unitIds_max, &unit_IsEnemyAndInLos);
 }
 
 
@@ -882,10 +905,8 @@ int CAICallback::GetFriendlyUnits(int* unitIds, const float3& pos, float radius,
 		int unitIds_max)
 {
 	verify();
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius);
 	myAllyTeamId = teamHandler.AllyTeam(team);
-	return FilterUnitsVector(*qfQuery.units, unitIds, unitIds_max, &unit_IsFriendly);
+	return FilterUnitsVector(GetUnitsExact(pos, radius), unitIds, unitIds_max, &unit_IsFriendly);
 }
 
 
@@ -899,10 +920,8 @@ int CAICallback::GetNeutralUnits(int* unitIds, int unitIds_max)
 int CAICallback::GetNeutralUnits(int* unitIds, const float3& pos, float radius, int unitIds_max)
 {
 	verify();
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius);
 	myAllyTeamId = teamHandler.AllyTeam(team);
-	return FilterUnitsVector(*qfQuery.units, unitIds, unitIds_max, &unit_IsNeutralAndInLosOrRadar);
+	return FilterUnitsVector(GetUnitsExact(pos, radius), unitIds, unitIds_max, &unit_IsNeutralAndInLosOrRadar);
 }
 
 
@@ -1224,11 +1243,9 @@ int CAICallback::GetFeatures(int* featureIds, int maxFeatureIDs, const float3& p
 	int numFeatureIDs = 0;
 
 	verify();
-	QuadFieldQuery qfQuery;
-	quadField.GetFeaturesExact(qfQuery, pos, radius);
 	const int allyteam = teamHandler.AllyTeam(team);
 
-	for (const CFeature* f: *qfQuery.features) {
+	for (const CFeature* f: GetFeaturesExact(pos, radius)) {
 		if (numFeatureIDs >= maxFeatureIDs)
 			break;
 
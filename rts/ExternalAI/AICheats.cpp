@@ -148,9 +148,21 @@ static inline bool unit_IsNeutral(CUnit* unit) {
 	return unit->IsNeutral();
 }
 
-static int myAllyTeamId = -1;
+// see AICallback.cpp
+static const std::vector<CUnit*>& GetUnitsExact(const float3& pos, float radius)
+{
+	static thread_local std::vector<int> quads;
+	static thread_local std::vector<CUnit*> units;
+
+	quads.clear();
+	units.clear();
+	quadField.GetUnitsExact(pos, radius, quads, units);
+	return units;
+}
+
+static thread_local int myAllyTeamId = -1;
 
-/// You have to set myAllyTeamId before callign this function. NOT thread safe!
+/// You have to set myAllyTeamId before callign this function.
 static inline bool unit_IsEnemy(CUnit* unit) {
 	return (!teamHandler.Ally(unit->allyteam, myAllyTeamId) && !unit_IsNeutral(unit));
 }
@@ -164,10 +176,8 @@ int CAICheats::GetEnemyUnits(int* unitIds, int unitIds_max)
 
 int CAICheats::GetEnemyUnits(int* unitIds, const float3& pos, float radius, int unitIds_max)
 {
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius);
 	myAllyTeamId = teamHandler.AllyTeam(ai->GetTeamId());
-	return FilterUnitsVector(*qfQuery.units, unitIds, unitIds_max, &unit_IsEnemy);
+	return FilterUnitsVector(GetUnitsExact(pos, radius), unitIds, unitIds_max, &unit_IsEnemy);
 }
 
 int CAICheats::GetNeutralUnits(int* unitIds, int unitIds_max)
@@ -177,9 +187,7 @@ int CAICheats::GetNeutralUnits(int* unitIds, int unitIds_max)
 
 int CAICheats::GetNeutralUnits(int* unitIds, const float3& pos, float radius, int unitIds_max)
 {
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius);
-	return FilterUnitsVector(*qfQuery.units, unitIds, unitIds_max, &unit_IsNeutral);
+	return FilterUnitsVector(GetUnitsExact(pos, radius), unitIds, unitIds_max, &unit_IsNeutral);
 }
 
 int CAICheats::GetFeatures(int* features, int max) const {
@@ -19,17 +19,30 @@
 #include "Sim/Units/CommandAI/Command.h"
 #include "Sim/Weapons/WeaponDef.h"
 #include "Net/Protocol/NetProtocol.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/Log/ILog.h"
 #include "System/TimeProfiler.h"
 #include "System/SafeUtil.h"
 
 
+CONFIG(bool, AsyncSkirmishAI)
+	.defaultValue(false)
+	.description("Run each native skirmish AI on its own thread. Events are handed over in one batch per sim-frame, the sim only waits for an AI before it advances to the next frame. Experimental.");
+CONFIG(int, AsyncSkirmishAIStallWarning)
+	.defaultValue(100)
+	.minimumValue(0)
+	.description("Log a warning (at most once per game-second) when the sim was blocked longer than this many milliseconds by an asynchronous skirmish AI.");
+
+
 CR_BIND(CEngineOutHandler, )
 CR_REG_METADATA(CEngineOutHandler, (
 	CR_IGNORED(hostSkirmishAIs),
 	CR_IGNORED(teamSkirmishAIs),
 	CR_IGNORED(activeSkirmishAIs),
 
+	CR_IGNORED(asyncStallWarnTime),
+	CR_IGNORED(asyncSkirmishAIs),
+
 	CR_POSTLOAD(PostLoad)
 ))
 
@@ -76,6 +89,15 @@ void CEngineOutHandler::Destroy() {
 }
 
 
+void CEngineOutHandler::Init()
+{
+	activeSkirmishAIs.reserve(16);
+
+	asyncStallWarnTime = configHandler->GetInt("AsyncSkirmishAIStallWarning");
+	asyncSkirmishAIs = configHandler->GetBool("AsyncSkirmishAI");
+}
+
+
 // This macro should be inserted at the start of each method sending AI events
 #define AI_SCOPED_TIMER()           \
 	if (activeSkirmishAIs.empty())  \
@@ -130,6 +152,22 @@ void CEngineOutHandler::Update() {
 	DO_FOR_SKIRMISH_AIS(Update(gs->frameNum))
 }
 
+void CEngineOutHandler::DispatchEventBatches() {
+	if (!asyncSkirmishAIs)
+		return;
+
+	AI_SCOPED_TIMER();
+	DO_FOR_SKIRMISH_AIS(DispatchEventBatch(gs->frameNum))
+}
+
+void CEngineOutHandler::WaitForEventBatches() {
+	if (!asyncSkirmishAIs)
+		return;
+
+	AI_SCOPED_TIMER();
+	DO_FOR_SKIRMISH_AIS(WaitForEventBatch())
+}
+
 
 
 // Do only if the unit is not allied, in which case we know
@@ -546,6 +584,10 @@ void CEngineOutHandler::CreateSkirmishAI(const uint8_t skirmishAIId) {
 	if (skirmishAIHandler.HasLocalKillFlag(skirmishAIId))
 		return;
 
+	// Init is always handled synchronously, all later events are queued
+	if (asyncSkirmishAIs)
+		aiInst.StartWorkerThread(asyncStallWarnTime);
+
 	if (!gs->PreSimFrame())
 		aiInst.Update(gs->frameNum);
 
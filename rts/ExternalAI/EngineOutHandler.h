@@ -31,7 +31,7 @@ public:
 	static void Create();
 	static void Destroy();
 
-	void Init() { activeSkirmishAIs.reserve(16); }
+	void Init();
 	void Kill() {
 		PreDestroy();
 
@@ -49,6 +49,11 @@ public:
 
 	void Update();
 
+	/// hands the events queued during a sim-frame to asynchronous AI's
+	void DispatchEventBatches();
+	/// blocks until every asynchronous AI has handled its last batch
+	void WaitForEventBatches();
+
 	/** Group should return false if it doenst want the unit for some reason. */
 	bool UnitAddedToGroup(const CUnit& unit, const CGroup& group);
 	/** No way to refuse giving up a unit. */
@@ -105,6 +110,9 @@ public:
 	void Load(std::istream* s, const uint8_t skirmishAIId);
 	void Save(std::ostream* s, const uint8_t skirmishAIId);
 
+	const std::vector<uint8_t>& GetActiveSkirmishAIs() const { return activeSkirmishAIs; }
+	CSkirmishAIWrapper& GetSkirmishAI(const uint8_t skirmishAIId) { return hostSkirmishAIs[skirmishAIId]; }
+
 private:
 	/// Contains all local Skirmish AIs, indexed by their ID
 	std::array<CSkirmishAIWrapper, MAX_AIS > hostSkirmishAIs;
@@ -116,6 +124,10 @@ private:
 	std::array<std::vector<uint8_t>, MAX_TEAMS> teamSkirmishAIs;
 
 	std::vector<uint8_t> activeSkirmishAIs;
+
+	/// see AsyncSkirmishAI config
+	float asyncStallWarnTime = 0.0f;
+	bool asyncSkirmishAIs = false;
 };
 
 #define eoh CEngineOutHandler::GetInstance()
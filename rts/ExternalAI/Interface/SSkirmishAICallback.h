@@ -2269,6 +2269,21 @@ struct SSkirmishAICallback {
 
 	bool              (CALLING_CONV *Debug_GraphDrawer_isEnabled)(int skirmishAIId);
 
+	/**
+	 * Fills caller-provided arrays (one per field, structure-of-arrays) with
+	 * the state of a list of units in a single call, instead of one call per
+	 * unit and field. Visibility is checked once per unit, values are the same
+	 * as those returned by Unit_getDef, Unit_getTeam, Unit_getAllyTeam,
+	 * Unit_getHealth, Unit_getMaxHealth, Unit_getPos and Unit_getVel.
+	 * Any of the output arrays may be NULL, otherwise it has to hold
+	 * unitIds_size entries (3 floats per entry for the *_AposF3 ones).
+	 * Not wrapped by the OO AI wrappers.
+	 *
+	 * @return number of units which are in LOS or radar of this AI
+	 *         (or exist at all, if cheats are enabled)
+	 */
+	int               (CALLING_CONV *Bulk_getUnitStates)(int skirmishAIId, int* unitIds, int unitIds_size, int* defIds, int* teamIds, int* allyTeamIds, float* healths, float* maxHealths, float* positions_AposF3, float* velocities_AposF3);
+
 };
 
 #if	defined(__cplusplus)
@@ -46,6 +46,7 @@
 #include "System/SafeCStrings.h"
 #include "System/SpringMath.h"
 #include "System/FileSystem/ArchiveScanner.h"
+#include "System/Threading/SpringThreading.h"
 #include "System/Log/ILog.h"
 
 
@@ -638,15 +639,33 @@ EXPORT(int) skirmishAiCallback_Engine_executeCommand(
 	return ret;
 }
 
+static bool isUnitOrderCommand(int commandTopic, const void* commandData) {
+	if ((commandTopic < COMMAND_UNIT_BUILD || commandTopic > COMMAND_UNIT_CUSTOM) && commandTopic != COMMAND_UNIT_RECLAIM_FEATURE)
+		return false;
+
+	// group orders are handled by the (unsynced) group-handler
+	return (static_cast<const SStopUnitCommand*>(commandData)->unitId >= 0);
+}
+
 EXPORT(int) skirmishAiCallback_Engine_handleCommand(
 	int skirmishAIId,
-	int /*toId*/,
+	int toId,
 	int commandId,
 	int commandTopic,
 	void* commandData
 ) {
 	int ret = 0;
 
+	// unit orders only read state and are sent over the network, so an
+	// asynchronous AI can give them from its own thread; everything else
+	// (cheats, Lua, pathing, drawing, ...) has to run on the sim thread
+	if (!isUnitOrderCommand(commandTopic, commandData)) {
+		const auto simThreadFunc = [&]() { ret = skirmishAiCallback_Engine_handleCommand(skirmishAIId, toId, commandId, commandTopic, commandData); };
+
+		if (CSkirmishAIWrapper::RunOnSimThread(simThreadFunc))
+			return ret;
+	}
+
 	CAICallback* clb = GetCallBack(skirmishAIId);
 	// if this is not NULL, cheating is enabled
 	CAICheats* clbCheat = nullptr;
@@ -1401,7 +1420,7 @@ EXPORT(char*) skirmishAiCallback_DataDirs_allocatePath(
 	bool dir,
 	bool common
 ) {
-	static char path[2048];
+	static thread_local char path[2048];
 
 	if (!skirmishAiCallback_DataDirs_locatePath(skirmishAIId, &path[0], sizeof(path), relPath, writeable, create, dir, common))
 		path[0] = 0;
@@ -1413,7 +1432,7 @@ EXPORT(char*) skirmishAiCallback_DataDirs_allocatePath(
 EXPORT(const char*) skirmishAiCallback_DataDirs_getWriteableDir(int skirmishAIId) {
 	CheckSkirmishAIId(skirmishAIId, __func__);
 
-	static std::vector<std::string> writeableDataDirs;
+	static thread_local std::vector<std::string> writeableDataDirs;
 
 	// fill up writeableDataDirs until teamId index is in there
 	// if it is not yet
@@ -2033,6 +2052,9 @@ EXPORT(int) skirmishAiCallback_Map_getResourceMapRaw(
 }
 
 static inline const CResourceMapAnalyzer* getResourceMapAnalyzer(int resourceId) {
+	// analyzers are initialized lazily, possibly by several asynchronous AI's at once
+	static spring::mutex mutex;
+	std::lock_guard<spring::mutex> lock(mutex);
 	return resourceHandler->GetResourceMapAnalyzer(resourceId);
 }
 
@@ -2202,7 +2224,16 @@ EXPORT(int) skirmishAiCallback_Map_getSpeedModMap(
 
 
 EXPORT(bool) skirmishAiCallback_Map_isPossibleToBuildAt(int skirmishAIId, int unitDefId, float* pos_posF3, int facing) {
-	return GetCallBack(skirmishAIId)->CanBuildAt(getUnitDefById(skirmishAIId, unitDefId), pos_posF3, facing);
+	bool ret = false;
+
+	// build-square tests use QuadFieldQuery's, tempNum's and lazily loaded
+	// models, none of which is safe from an asynchronous AI's own thread
+	const auto simThreadFunc = [&]() { ret = GetCallBack(skirmishAIId)->CanBuildAt(getUnitDefById(skirmishAIId, unitDefId), pos_posF3, facing); };
+
+	if (!CSkirmishAIWrapper::RunOnSimThread(simThreadFunc))
+		simThreadFunc();
+
+	return ret;
 }
 
 EXPORT(void) skirmishAiCallback_Map_findClosestBuildSite(
@@ -2215,7 +2246,14 @@ EXPORT(void) skirmishAiCallback_Map_findClosestBuildSite(
 	float* return_posF3_out
 ) {
 	const UnitDef* unitDef = getUnitDefById(skirmishAIId, unitDefId);
-	const float3 buildPos = GetCallBack(skirmishAIId)->ClosestBuildSite(unitDef, pos_posF3, searchRadius, minDist, facing);
+
+	float3 buildPos;
+
+	// see isPossibleToBuildAt
+	const auto simThreadFunc = [&]() { buildPos = GetCallBack(skirmishAIId)->ClosestBuildSite(unitDef, pos_posF3, searchRadius, minDist, facing); };
+
+	if (!CSkirmishAIWrapper::RunOnSimThread(simThreadFunc))
+		simThreadFunc();
 
 	buildPos.copyInto(return_posF3_out);
 }
@@ -4210,9 +4248,15 @@ EXPORT(int) skirmishAiCallback_getFeatures(int skirmishAIId, int* featureIds, in
 EXPORT(int) skirmishAiCallback_getFeaturesIn(int skirmishAIId, float* pos_posF3, float radius, int* featureIds, int featureIdsMaxSize) {
 	if (skirmishAiCallback_Cheats_isEnabled(skirmishAIId)) {
 		// cheating
-		QuadFieldQuery qfQuery;
-		quadField.GetFeaturesExact(qfQuery, pos_posF3, radius);
-		const int featureIdsRealSize = qfQuery.features->size();
+		// not a QuadFieldQuery, AI's can run on their own threads
+		static thread_local std::vector<int> quads;
+		static thread_local std::vector<CFeature*> features;
+
+		quads.clear();
+		features.clear();
+		quadField.GetFeaturesExact(pos_posF3, radius, quads, features);
+
+		const int featureIdsRealSize = features.size();
 
 		int featureIdsSize = featureIdsRealSize;
 
@@ -4221,7 +4265,7 @@ EXPORT(int) skirmishAiCallback_getFeaturesIn(int skirmishAIId, float* pos_posF3,
 
 			size_t f = 0;
 
-			for (const CFeature* feature: *qfQuery.features) {
+			for (const CFeature* feature: features) {
 
 				assert(feature != nullptr);
 				featureIds[f++] = feature->id;
@@ -4903,6 +4947,113 @@ EXPORT(bool) skirmishAiCallback_Debug_GraphDrawer_isEnabled(int skirmishAIId) {
 	return GetCallBack(skirmishAIId)->IsDebugDrawerEnabled();
 }
 
+EXPORT(int) skirmishAiCallback_Bulk_getUnitStates(
+	int skirmishAIId,
+	int* unitIds,
+	int unitIds_size,
+	int* defIds,
+	int* teamIds,
+	int* allyTeamIds,
+	float* healths,
+	float* maxHealths,
+	float* positions_AposF3,
+	float* velocities_AposF3
+) {
+	// resolved once per batch instead of once per unit and field
+	const bool cheatsEnabled = skirmishAiCallback_Cheats_isEnabled(skirmishAIId);
+	const int aiAllyTeam = teamHandler.AllyTeam(AI_TEAM_IDS[skirmishAIId]);
+
+	constexpr unsigned short prevLosMask = (LOS_PREVLOS | LOS_CONTRADAR);
+
+	int numVisibleUnits = 0;
+
+	for (int i = 0; i < unitIds_size; i++) {
+		const CUnit* unit = getUnit(unitIds[i]);
+		const UnitDef* unitDef = nullptr;
+
+		float3 pos;
+		float3 vel;
+
+		// defaults are what the per-field calls return for unknown units
+		float health = cheatsEnabled? 0.0f: -1.0f;
+		float maxHealth = health;
+
+		int team = cheatsEnabled? 0: -1;
+		int allyTeam = team;
+
+		if (unit != nullptr) {
+			if (cheatsEnabled) {
+				unitDef = unit->unitDef;
+
+				pos = unit->midPos;
+				vel = unit->speed;
+
+				health = unit->health;
+				maxHealth = unit->maxHealth;
+
+				team = unit->team;
+				allyTeam = unit->allyteam;
+
+				numVisibleUnits += 1;
+			} else {
+				const unsigned short losStatus = unit->losStatus[aiAllyTeam];
+
+				const bool allied = teamHandler.Ally(unit->allyteam, aiAllyTeam);
+				const bool inLos = (allied || (losStatus & LOS_INLOS) != 0);
+				const bool inRadar = (inLos || (losStatus & LOS_INRADAR) != 0);
+
+				if (inRadar) {
+					pos = unit->GetErrorPos(aiAllyTeam);
+					vel = unit->speed;
+
+					numVisibleUnits += 1;
+				}
+
+				if (inLos) {
+					team = unit->team;
+					allyTeam = unit->allyteam;
+				}
+
+				if (allied) {
+					unitDef = unit->unitDef;
+
+					health = unit->health;
+					maxHealth = unit->maxHealth;
+				} else {
+					const UnitDef* decoyDef = unit->unitDef->decoyDef;
+
+					if (inLos || (losStatus & prevLosMask) == prevLosMask)
+						unitDef = (decoyDef != nullptr)? decoyDef: unit->unitDef;
+
+					if (inLos) {
+						const float healthScale = (decoyDef != nullptr)? (decoyDef->health / unit->unitDef->health): 1.0f;
+
+						health = unit->health * healthScale;
+						maxHealth = unit->maxHealth * healthScale;
+					}
+				}
+			}
+		}
+
+		if (defIds != nullptr)
+			defIds[i] = (unitDef != nullptr)? unitDef->id: -1;
+		if (teamIds != nullptr)
+			teamIds[i] = team;
+		if (allyTeamIds != nullptr)
+			allyTeamIds[i] = allyTeam;
+		if (healths != nullptr)
+			healths[i] = health;
+		if (maxHealths != nullptr)
+			maxHealths[i] = maxHealth;
+		if (positions_AposF3 != nullptr)
+			pos.copyInto(&positions_AposF3[i * 3]);
+		if (velocities_AposF3 != nullptr)
+			vel.copyInto(&velocities_AposF3[i * 3]);
+	}
+
+	return numVisibleUnits;
+}
+
 EXPORT(int) skirmishAiCallback_getGroups(int skirmishAIId, int* groupIds, int maxGroups) {
 	const CGroupHandler& gh = uiGroupHandlers[ AI_TEAM_IDS[skirmishAIId] ];
 	const std::vector<CGroup>& gs = gh.GetGroups();
@@ -5629,6 +5780,7 @@ static void skirmishAiCallback_init(SSkirmishAICallback* callback) {
 	callback->Unit_Weapon_isShieldEnabled = &skirmishAiCallback_Unit_Weapon_isShieldEnabled;
 	callback->Unit_Weapon_getShieldPower = &skirmishAiCallback_Unit_Weapon_getShieldPower;
 	callback->Debug_GraphDrawer_isEnabled = &skirmishAiCallback_Debug_GraphDrawer_isEnabled;
+	callback->Bulk_getUnitStates = &skirmishAiCallback_Bulk_getUnitStates;
 }
 
 SSkirmishAICallback* skirmishAiCallback_GetInstance(CSkirmishAIWrapper* ai)
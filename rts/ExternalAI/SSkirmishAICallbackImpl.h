@@ -1303,6 +1303,8 @@ EXPORT(float            ) skirmishAiCallback_Unit_Weapon_getShieldPower(int skir
 
 EXPORT(bool             ) skirmishAiCallback_Debug_GraphDrawer_isEnabled(int skirmishAIId);
 
+EXPORT(int              ) skirmishAiCallback_Bulk_getUnitStates(int skirmishAIId, int* unitIds, int unitIds_size, int* defIds, int* teamIds, int* allyTeamIds, float* healths, float* maxHealths, float* positions_AposF3, float* velocities_AposF3);
+
 #if	defined(__cplusplus)
 } // extern "C"
 #endif
@@ -29,7 +29,6 @@ CR_REG_METADATA(CSkirmishAIHandler, (
 	CR_MEMBER(skirmishAIDataMap),
 	CR_MEMBER(luaAIShortNames),
 
-	CR_IGNORED(currentAIId),
 	CR_IGNORED(numSkirmishAIs),
 
 	CR_MEMBER(gameInitialized)
@@ -38,6 +37,9 @@ CR_REG_METADATA(CSkirmishAIHandler, (
 
 CSkirmishAIHandler skirmishAIHandler;
 
+// per-thread since asynchronous AI's (see AsyncSkirmishAI) run concurrently
+static thread_local uint8_t currentAIId = MAX_AIS;
+
 
 void CSkirmishAIHandler::ResetState()
 {
@@ -50,7 +52,6 @@ void CSkirmishAIHandler::ResetState()
 	luaAIShortNames.clear();
 
 	numSkirmishAIs = 0;
-	currentAIId = MAX_AIS;
 
 	gameInitialized = false;
 }
@@ -266,6 +267,10 @@ bool CSkirmishAIHandler::IsLocalSkirmishAI(const SkirmishAIData& aiData) {
 }
 
 
+uint8_t CSkirmishAIHandler::GetCurrentAIID() const { return currentAIId; }
+void CSkirmishAIHandler::SetCurrentAIID(uint8_t id) { currentAIId = id; }
+
+
 void CSkirmishAIHandler::CompleteWithDefaultOptionValues(const size_t skirmishAIId)
 {
 	if (!gameInitialized)
@@ -168,8 +168,9 @@ public:
 
 	const spring::unordered_set<std::string>& GetLuaAIImplShortNames() const { return luaAIShortNames; }
 
-	uint8_t GetCurrentAIID() { return currentAIId; }
-	void SetCurrentAIID(uint8_t id) { currentAIId = id; }
+	/// local AI ID executing on the calling thread, MAX_AIS if none (e.g. LuaUI)
+	uint8_t GetCurrentAIID() const;
+	void SetCurrentAIID(uint8_t id);
 
 private:
 	static bool IsLocalSkirmishAI(const SkirmishAIData& aiData);
@@ -196,8 +197,6 @@ private:
 	spring::unordered_map<uint8_t, const SkirmishAIData*> skirmishAIDataMap;
 	spring::unordered_set<std::string> luaAIShortNames;
 
-	// the current local AI ID that is executing, MAX_AIS if none (e.g. LuaUI)
-	uint8_t currentAIId = MAX_AIS;
 	uint8_t numSkirmishAIs = 0;
 
 	bool gameInitialized = false;
@@ -15,6 +15,8 @@
 
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitHandler.h"
+#include "Sim/Units/CommandAI/Command.h"
+#include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/TeamHandler.h"
 
 #include "System/FileSystem/DataDirsAccess.h"
@@ -22,7 +24,9 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/Log/ILog.h"
 #include "System/Platform/SharedLib.h"
+#include "System/Platform/Threading.h"
 #include "System/TimeProfiler.h"
+#include "System/SpringMath.h"
 #include "System/StringUtil.h"
 
 #include <string>
@@ -52,10 +56,32 @@ CR_REG_METADATA(CSkirmishAIWrapper, (
 	CR_MEMBER(cheatEvents),
 	CR_MEMBER(blockEvents),
 
+	// worker threads are restarted by EngineOutHandler
+	CR_IGNORED(eventQueue),
+	CR_IGNORED(eventBatch),
+	CR_IGNORED(simThreadFunc),
+	CR_IGNORED(workerThread),
+	CR_IGNORED(workerMutex),
+	CR_IGNORED(workerCond),
+	CR_IGNORED(asyncStats),
+	CR_IGNORED(stallWarnTime),
+	CR_IGNORED(batchFrame),
+	CR_IGNORED(stallWarnFrame),
+	CR_IGNORED(batchPending),
+	CR_IGNORED(asyncMode),
+	CR_IGNORED(quitWorker),
+	CR_IGNORED(simThreadFuncDone),
+	CR_IGNORED(inSimThreadFunc),
+
 	CR_SERIALIZER(Serialize),
 	CR_POSTLOAD(PostLoad)
 ))
 
+
+// AI whose worker is the calling thread, if any
+static thread_local CSkirmishAIWrapper* workerAI = nullptr;
+
+
 void CSkirmishAIWrapper::PreInit(int aiID)
 {
 	const SkirmishAIData* aiData = skirmishAIHandler.GetSkirmishAI(aiID);
@@ -95,6 +121,7 @@ void CSkirmishAIWrapper::PreInit(int aiID)
 }
 
 void CSkirmishAIWrapper::PreDestroy() {
+	WaitForEventBatch();
 	skirmishAiCallback_BlockOrders(this);
 }
 
@@ -157,6 +184,8 @@ void CSkirmishAIWrapper::Init() {
 void CSkirmishAIWrapper::Kill()
 {
 	assert(Active());
+	StopWorkerThread();
+
 	// send release event
 	Release(skirmishAIHandler.GetLocalKillFlag(skirmishAIId));
 
@@ -285,6 +314,7 @@ void CSkirmishAIWrapper::Load(std::istream* loadStream)
 	}
 
 	assert(Active());
+	WaitForEventBatch();
 	HandleEvent(EVENT_LOAD, &evtData);
 
 	FileSystem::DeleteFile(tmpFile);
@@ -296,6 +326,7 @@ void CSkirmishAIWrapper::Save(std::ostream* saveStream)
 	const SSaveEvent evtData = {tmpFile.c_str()};
 
 	assert(Active());
+	WaitForEventBatch();
 	HandleEvent(EVENT_SAVE, &evtData);
 
 	if (!FileSystem::FileExists(tmpFile))
@@ -315,21 +346,35 @@ void CSkirmishAIWrapper::Save(std::ostream* saveStream)
 
 
 void CSkirmishAIWrapper::UnitIdle(int unitId) {
+	if (QueueEvent([=]() { UnitIdle(unitId); }))
+		return;
+
 	const SUnitIdleEvent evtData = {unitId};
 	HandleEvent(EVENT_UNIT_IDLE, &evtData);
 }
 
 void CSkirmishAIWrapper::UnitCreated(int unitId, int builderId) {
+	if (QueueEvent([=]() { UnitCreated(unitId, builderId); }))
+		return;
+
 	const SUnitCreatedEvent evtData = {unitId, builderId};
 	HandleEvent(EVENT_UNIT_CREATED, &evtData);
 }
 
 void CSkirmishAIWrapper::UnitFinished(int unitId) {
+	if (QueueEvent([=]() { UnitFinished(unitId); }))
+		return;
+
 	const SUnitFinishedEvent evtData = {unitId};
 	HandleEvent(EVENT_UNIT_FINISHED, &evtData);
 }
 
 void CSkirmishAIWrapper::UnitDestroyed(int unitId, int attackerUnitId) {
+	if (QueueEvent([=]() { UnitDestroyed(unitId, attackerUnitId); })) {
+		FlushEventQueue();
+		return;
+	}
+
 	const SUnitDestroyedEvent evtData = {unitId, attackerUnitId};
 	HandleEvent(EVENT_UNIT_DESTROYED, &evtData);
 }
@@ -342,6 +387,9 @@ void CSkirmishAIWrapper::UnitDamaged(
 	int weaponDefId,
 	bool paralyzer
 ) {
+	if (QueueEvent([=]() { UnitDamaged(unitId, attackerUnitId, damage, dir, weaponDefId, paralyzer); }))
+		return;
+
 	float3 cpyDir = dir;
 	const SUnitDamagedEvent evtData = {unitId, attackerUnitId, damage, &cpyDir[0], weaponDefId, paralyzer};
 
@@ -349,52 +397,84 @@ void CSkirmishAIWrapper::UnitDamaged(
 }
 
 void CSkirmishAIWrapper::UnitMoveFailed(int unitId) {
+	if (QueueEvent([=]() { UnitMoveFailed(unitId); }))
+		return;
+
 	const SUnitMoveFailedEvent evtData = {unitId};
 	HandleEvent(EVENT_UNIT_MOVE_FAILED, &evtData);
 }
 
 void CSkirmishAIWrapper::UnitGiven(int unitId, int oldTeam, int newTeam) {
+	if (QueueEvent([=]() { UnitGiven(unitId, oldTeam, newTeam); }))
+		return;
+
 	const SUnitGivenEvent evtData = {unitId, oldTeam, newTeam};
 	HandleEvent(EVENT_UNIT_GIVEN, &evtData);
 }
 
 void CSkirmishAIWrapper::UnitCaptured(int unitId, int oldTeam, int newTeam) {
+	if (QueueEvent([=]() { UnitCaptured(unitId, oldTeam, newTeam); }))
+		return;
+
 	const SUnitCapturedEvent evtData = {unitId, oldTeam, newTeam};
 	HandleEvent(EVENT_UNIT_CAPTURED, &evtData);
 }
 
 
 void CSkirmishAIWrapper::EnemyCreated(int unitId) {
+	if (QueueEvent([=]() { EnemyCreated(unitId); }))
+		return;
+
 	const SEnemyCreatedEvent evtData = {unitId};
 	HandleEvent(EVENT_ENEMY_CREATED, &evtData);
 }
 
 void CSkirmishAIWrapper::EnemyFinished(int unitId) {
+	if (QueueEvent([=]() { EnemyFinished(unitId); }))
+		return;
+
 	const SEnemyFinishedEvent evtData = {unitId};
 	HandleEvent(EVENT_ENEMY_FINISHED, &evtData);
 }
 
 void CSkirmishAIWrapper::EnemyEnterLOS(int unitId) {
+	if (QueueEvent([=]() { EnemyEnterLOS(unitId); }))
+		return;
+
 	const SEnemyEnterLOSEvent evtData = {unitId};
 	HandleEvent(EVENT_ENEMY_ENTER_LOS, &evtData);
 }
 
 void CSkirmishAIWrapper::EnemyLeaveLOS(int unitId) {
+	if (QueueEvent([=]() { EnemyLeaveLOS(unitId); }))
+		return;
+
 	const SEnemyLeaveLOSEvent evtData = {unitId};
 	HandleEvent(EVENT_ENEMY_LEAVE_LOS, &evtData);
 }
 
 void CSkirmishAIWrapper::EnemyEnterRadar(int unitId) {
+	if (QueueEvent([=]() { EnemyEnterRadar(unitId); }))
+		return;
+
 	const SEnemyEnterRadarEvent evtData = {unitId};
 	HandleEvent(EVENT_ENEMY_ENTER_RADAR, &evtData);
 }
 
 void CSkirmishAIWrapper::EnemyLeaveRadar(int unitId) {
+	if (QueueEvent([=]() { EnemyLeaveRadar(unitId); }))
+		return;
+
 	const SEnemyLeaveRadarEvent evtData = {unitId};
 	HandleEvent(EVENT_ENEMY_LEAVE_RADAR, &evtData);
 }
 
 void CSkirmishAIWrapper::EnemyDestroyed(int enemyUnitId, int attackerUnitId) {
+	if (QueueEvent([=]() { EnemyDestroyed(enemyUnitId, attackerUnitId); })) {
+		FlushEventQueue();
+		return;
+	}
+
 	const SEnemyDestroyedEvent evtData = {enemyUnitId, attackerUnitId};
 	HandleEvent(EVENT_ENEMY_DESTROYED, &evtData);
 }
@@ -407,6 +487,9 @@ void CSkirmishAIWrapper::EnemyDamaged(
 	int weaponDefId,
 	bool paralyzer
 ) {
+	if (QueueEvent([=]() { EnemyDamaged(enemyUnitId, attackerUnitId, damage, dir, weaponDefId, paralyzer); }))
+		return;
+
 	float3 cpyDir = dir;
 	const SEnemyDamagedEvent evtData = {enemyUnitId, attackerUnitId, damage, &cpyDir[0], weaponDefId, paralyzer};
 
@@ -414,21 +497,33 @@ void CSkirmishAIWrapper::EnemyDamaged(
 }
 
 void CSkirmishAIWrapper::Update(int frame) {
+	if (QueueEvent([=]() { Update(frame); }))
+		return;
+
 	const SUpdateEvent evtData = {frame};
 	HandleEvent(EVENT_UPDATE, &evtData);
 }
 
 void CSkirmishAIWrapper::SendChatMessage(const char* msg, int fromPlayerId) {
+	if (QueueEvent([=, str = std::string(msg)]() { SendChatMessage(str.c_str(), fromPlayerId); }))
+		return;
+
 	const SMessageEvent evtData = {fromPlayerId, msg};
 	HandleEvent(EVENT_MESSAGE, &evtData);
 }
 
 void CSkirmishAIWrapper::SendLuaMessage(const char* inData, const char** outData) {
+	// not queued, caller expects a response
+	WaitForEventBatch();
+
 	const SLuaMessageEvent evtData = {inData /*outData*/};
 	HandleEvent(EVENT_LUA_MESSAGE, &evtData);
 }
 
 void CSkirmishAIWrapper::WeaponFired(int unitId, int weaponDefId) {
+	if (QueueEvent([=]() { WeaponFired(unitId, weaponDefId); }))
+		return;
+
 	const SWeaponFiredEvent evtData = {unitId, weaponDefId};
 	HandleEvent(EVENT_WEAPON_FIRED, &evtData);
 }
@@ -438,6 +533,9 @@ void CSkirmishAIWrapper::PlayerCommandGiven(
 	const Command& c,
 	int playerId
 ) {
+	if (QueueEvent([=]() { PlayerCommandGiven(playerSelectedUnits, c, playerId); }))
+		return;
+
 	std::vector<int> unitIds = playerSelectedUnits;
 
 	const int cCommandId = extractAICommandTopic(&c, unitHandler.MaxUnits());
@@ -447,6 +545,9 @@ void CSkirmishAIWrapper::PlayerCommandGiven(
 }
 
 void CSkirmishAIWrapper::CommandFinished(int unitId, int commandId, int commandTopicId) {
+	if (QueueEvent([=]() { CommandFinished(unitId, commandId, commandTopicId); }))
+		return;
+
 	const SCommandFinishedEvent evtData = {unitId, commandId, commandTopicId};
 	HandleEvent(EVENT_COMMAND_FINISHED, &evtData);
 }
@@ -457,6 +558,9 @@ void CSkirmishAIWrapper::SeismicPing(
 	const float3& pos,
 	float strength
 ) {
+	if (QueueEvent([=]() { SeismicPing(allyTeam, unitId, pos, strength); }))
+		return;
+
 	/*const*/ float3 cpyPos = pos;
 	const SSeismicPingEvent evtData = {&cpyPos[0], strength};
 
@@ -465,12 +569,222 @@ void CSkirmishAIWrapper::SeismicPing(
 
 
 int CSkirmishAIWrapper::HandleEvent(int topic, const void* data) const {
-	ScopedTimer timer(GetTimerNameHash());
+	if (blockEvents && (topic != EVENT_RELEASE)) {
+		// to prevent log error spam, signal: OK
+		return 0;
+	}
 
-	if (!blockEvents || (topic == EVENT_RELEASE))
+	// the profiler's regular timers are not thread-safe
+	if (IsWorkerThread()) {
+		ScopedMtTimer timer(GetTimerNameHash());
 		return library->HandleEvent(skirmishAIId, topic, data);
+	}
+
+	ScopedTimer timer(GetTimerNameHash());
+	return library->HandleEvent(skirmishAIId, topic, data);
+}
+
+
+
+bool CSkirmishAIWrapper::QueueEvent(std::function<void()>&& event) {
+	// events are replayed by calling the same method on the worker
+	if (!asyncMode || IsWorkerThread())
+		return false;
+
+	eventQueue.emplace_back(std::move(event));
+	return true;
+}
+
+bool CSkirmishAIWrapper::IsWorkerThread() const { return (workerAI == this); }
+
+void CSkirmishAIWrapper::FlushEventQueue()
+{
+	// the worker is blocked in RunOnSimThread in the middle of its batch
+	if (inSimThreadFunc)
+		return;
+
+	DispatchEventBatch(gs->frameNum);
+	WaitForEventBatch();
+}
+
+
+void CSkirmishAIWrapper::StartWorkerThread(float _stallWarnTime)
+{
+	assert(!asyncMode);
+	LOG_L(L_INFO, "[AIWrapper::%s][AI=%d team=%d] running asynchronously", __func__, skirmishAIId, teamId);
+
+	eventQueue.clear();
+	eventBatch.clear();
+
+	asyncStats = {};
+	stallWarnTime = _stallWarnTime;
+
+	batchFrame = -1;
+	stallWarnFrame = -1;
+
+	asyncMode = true;
+	quitWorker = false;
+
+	workerThread = spring::thread(&CSkirmishAIWrapper::WorkerThreadFunc, this);
+}
+
+void CSkirmishAIWrapper::StopWorkerThread()
+{
+	if (!asyncMode)
+		return;
+
+	WaitForEventBatch();
+
+	{
+		std::lock_guard<spring::mutex> lock(workerMutex);
+		quitWorker = true;
+		workerCond.notify_all();
+	}
+
+	workerThread.join();
+
+	// events queued since the last dispatch are dropped, same as
+	// for a synchronous AI that is killed in the middle of a frame
+	eventQueue.clear();
+	asyncMode = false;
+}
+
+
+void CSkirmishAIWrapper::DispatchEventBatch(int frameNum)
+{
+	if (!asyncMode)
+		return;
+
+	// at most one batch can be in flight, this bounds the AI's lag
+	WaitForEventBatch();
+
+	if (eventQueue.empty())
+		return;
+
+	std::lock_guard<spring::mutex> lock(workerMutex);
+
+	eventBatch.swap(eventQueue);
+	batchFrame = frameNum;
+	batchPending = true;
+
+	workerCond.notify_all();
+}
+
+void CSkirmishAIWrapper::WaitForEventBatch()
+{
+	// the worker is blocked in RunOnSimThread while we are executing its
+	// function, and a nested wait (e.g. via a Lua message) would deadlock
+	if (inSimThreadFunc)
+		return;
+	// only the sim thread sets this, no need to lock if it is already clear
+	if (!batchPending)
+		return;
+
+	const spring_time waitStartTime = spring_gettime();
+
+	std::unique_lock<spring::mutex> lock(workerMutex);
+
+	while (true) {
+		workerCond.wait(lock, [&]() { return (!batchPending || simThreadFunc != nullptr); });
+
+		if (simThreadFunc == nullptr)
+			break;
+
+		const std::function<void()>* func = simThreadFunc;
+
+		simThreadFunc = nullptr;
+		inSimThreadFunc = true;
+		lock.unlock();
+
+		skirmishAIHandler.SetCurrentAIID(skirmishAIId);
+		(*func)();
+		skirmishAIHandler.SetCurrentAIID(MAX_AIS);
+
+		lock.lock();
+		inSimThreadFunc = false;
+		simThreadFuncDone = true;
+
+		asyncStats.numSimThreadCalls += 1;
+		workerCond.notify_all();
+	}
+
+	const float stallTime = (spring_gettime() - waitStartTime).toMilliSecsf();
+
+	asyncStats.sumStallTime += stallTime;
+	asyncStats.maxStallTime = std::max(asyncStats.maxStallTime, stallTime);
+	asyncStats.numStalls += 1;
+
+	// warn at most once per game-second
+	if (stallTime <= stallWarnTime || batchFrame < (stallWarnFrame + GAME_SPEED))
+		return;
+
+	stallWarnFrame = batchFrame;
+
+	LOG_L(L_WARNING, "[AIWrapper::%s][AI=%d team=%d] sim blocked for %.1fms by event batch of frame %d (%u events, %.1fms)", __func__, skirmishAIId, teamId, stallTime, batchFrame, asyncStats.lastBatchSize, asyncStats.lastBatchTime);
+}
+
+bool CSkirmishAIWrapper::RunOnSimThread(const std::function<void()>& func)
+{
+	CSkirmishAIWrapper* ai = workerAI;
+
+	if (ai == nullptr)
+		return false;
+
+	std::unique_lock<spring::mutex> lock(ai->workerMutex);
+
+	ai->simThreadFunc = &func;
+	ai->simThreadFuncDone = false;
+	ai->workerCond.notify_all();
+	ai->workerCond.wait(lock, [&]() { return ai->simThreadFuncDone; });
+	return true;
+}
+
+CSkirmishAIWrapper::AsyncStats CSkirmishAIWrapper::GetAsyncStats()
+{
+	std::lock_guard<spring::mutex> lock(workerMutex);
+	return asyncStats;
+}
+
+
+void CSkirmishAIWrapper::WorkerThreadFunc()
+{
+	Threading::SetThreadName(IntToString(skirmishAIId, "skirmishai%i"));
+
+	workerAI = this;
+
+	std::unique_lock<spring::mutex> lock(workerMutex);
+
+	while (true) {
+		workerCond.wait(lock, [&]() { return (quitWorker || batchPending); });
+
+		if (!batchPending)
+			break;
+
+		lock.unlock();
+
+		const spring_time batchStartTime = spring_gettime();
+
+		for (const auto& event: eventBatch) {
+			event();
+		}
+
+		const float batchTime = (spring_gettime() - batchStartTime).toMilliSecsf();
+
+		lock.lock();
+
+		asyncStats.lastBatchTime = batchTime;
+		asyncStats.avgBatchTime = mix(asyncStats.avgBatchTime, batchTime, 0.05f);
+		asyncStats.maxBatchTime = std::max(asyncStats.maxBatchTime, batchTime);
+		asyncStats.lastBatchSize = eventBatch.size();
+		asyncStats.maxBatchSize = std::max(asyncStats.maxBatchSize, asyncStats.lastBatchSize);
+		asyncStats.numBatches += 1;
+
+		eventBatch.clear();
+		batchPending = false;
+
+		workerCond.notify_all();
+	}
 
-	// to prevent log error spam, signal: OK
-	return 0;
+	workerAI = nullptr;
 }
 
@@ -3,7 +3,12 @@
 #ifndef SKIRMISH_AI_WRAPPER_H
 #define SKIRMISH_AI_WRAPPER_H
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "SkirmishAIKey.h"
+#include "System/Threading/SpringThreading.h"
 
 class CSkirmishAILibrary;
 struct SSkirmishAICallback;
@@ -21,6 +26,26 @@ class CSkirmishAIWrapper {
 private:
 	CR_DECLARE_STRUCT(CSkirmishAIWrapper)
 
+public:
+	struct AsyncStats {
+		// milliseconds spent handling each event batch on the AI thread
+		float lastBatchTime = 0.0f;
+		float avgBatchTime = 0.0f;
+		float maxBatchTime = 0.0f;
+		// milliseconds the sim thread was blocked waiting for a batch
+		float sumStallTime = 0.0f;
+		float maxStallTime = 0.0f;
+
+		// number of queued events per batch
+		unsigned int lastBatchSize = 0;
+		unsigned int maxBatchSize = 0;
+
+		unsigned int numBatches = 0;
+		unsigned int numStalls = 0;
+		// non-order commands forwarded to the sim thread
+		unsigned int numSimThreadCalls = 0;
+	};
+
 public:
 	/// used only by creg
 	CSkirmishAIWrapper() = default;
@@ -87,6 +112,31 @@ public:
 	void CommandFinished(int unitId, int commandId, int commandTopicId);
 	void SeismicPing(int allyTeam, int unitId, const float3& pos, float strength);
 
+	/**
+	 * Asynchronous mode (AsyncSkirmishAI): events are queued during a frame
+	 * and handed as one batch to the AI's own thread when the frame is done.
+	 * The sim waits for the batch before it processes the next net-packet,
+	 * so the AI never sees a changing world and never lags more than one
+	 * frame behind; synchronous calls (Load, Save, ...) wait for it as well.
+	 * Destroy events flush the queue and are handled before the sim goes on,
+	 * as in synchronous mode, since the unit can be deleted (and its id even
+	 * be reused) before the end of the frame.
+	 */
+	void StartWorkerThread(float stallWarnTime);
+	void StopWorkerThread();
+
+	void DispatchEventBatch(int frameNum);
+	void WaitForEventBatch();
+
+	/**
+	 * Runs func on the sim thread during its next WaitForEventBatch if the
+	 * caller is an AI thread, blocking it until then.
+	 * @return false if the caller is not an AI thread
+	 */
+	static bool RunOnSimThread(const std::function<void()>& func);
+
+	AsyncStats GetAsyncStats();
+
 	int GetSkirmishAIID() const { return skirmishAIId; }
 	int GetTeamId() const { return teamId; }
 
@@ -105,6 +155,7 @@ public:
 	bool CheatEventsEnabled() const { return cheatEvents; }
 
 	bool Active() const { return (skirmishAIId != -1); }
+	bool Async() const { return asyncMode; }
 
 private:
 	bool InitLibrary(bool postLoad);
@@ -113,6 +164,14 @@ private:
 	void SendInitEvent();
 	void SendUnitEvents();
 
+	/// @return false if the event should be handled right away
+	bool QueueEvent(std::function<void()>&& event);
+	/// hands all queued events to the AI thread and waits for them
+	void FlushEventQueue();
+	bool IsWorkerThread() const;
+
+	void WorkerThreadFunc();
+
 	/**
 	 * CAUTION: takes C AI Interface events, not engine C++ ones!
 	 */
@@ -141,6 +200,31 @@ private:
 	bool libraryInit = false; // CSkirmishAILibrary::Init retval
 	bool cheatEvents = false;
 	bool blockEvents = false;
+
+	// asynchronous mode; the queue is only touched by the sim
+	// thread, the batch only by the AI thread while it is pending
+	std::vector<std::function<void()>> eventQueue;
+	std::vector<std::function<void()>> eventBatch;
+
+	const std::function<void()>* simThreadFunc = nullptr;
+
+	spring::thread workerThread;
+	spring::mutex workerMutex;
+	spring::condition_variable_any workerCond;
+
+	AsyncStats asyncStats;
+
+	float stallWarnTime = 0.0f;
+
+	int batchFrame = -1;
+	int stallWarnFrame = -1;
+
+	std::atomic<bool> batchPending = {false};
+
+	bool asyncMode = false;
+	bool quitWorker = false;
+	bool simThreadFuncDone = false;
+	bool inSimThreadFunc = false;
 };
 
 #endif // SKIRMISH_AI_WRAPPER_H
@@ -16,7 +16,9 @@ CONFIG(std::string, HostIPDefault).defaultValue("localhost").dedicatedValue("").
 CONFIG(int, HostPortDefault).defaultValue(8452).minimumValue(0).maximumValue(65535).description("Default Port to use for hosting if not specified in script.txt");
 
 ClientSetup::ClientSetup()
-	: hostIP(configHandler->GetString("HostIPDefault"))
+	: demoKeyframe(-1)
+	, demoSkipFrame(0)
+	, hostIP(configHandler->GetString("HostIPDefault"))
 	, hostPort(configHandler->GetInt("HostPortDefault"))
 	, isHost(false)
 {
@@ -70,4 +72,7 @@ void ClientSetup::LoadFromStartScript(const std::string& setup)
 
 	file.GetDef(saveFile, "", "GAME\\SaveFile");
 	file.GetDef(demoFile, "", "GAME\\DemoFile");
+
+	file.GetDef(demoKeyframe,  "-1", "GAME\\DemoKeyframe");
+	file.GetDef(demoSkipFrame, "0",  "GAME\\DemoSkipFrame");
 }
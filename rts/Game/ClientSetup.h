@@ -19,6 +19,11 @@ public:
 	std::string saveFile;
 	std::string demoFile;
 
+	//! if both demoFile and saveFile are given, the sim-frame at which saveFile was written
+	int demoKeyframe;
+	//! frame to fast-forward to after resuming a demo from its keyframe
+	int demoSkipFrame;
+
 	//! if this client is not the server player, the IP address we connect to
 	//! if this client is the server player, the IP address that other players connect to
 	std::string hostIP;
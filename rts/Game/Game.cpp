@@ -112,10 +112,15 @@
 #include "System/SafeUtil.h"
 #include "System/SpringExitCode.h"
 #include "System/SpringMath.h"
+#include "System/SpringFormat.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/LoadSave/LoadSaveHandler.h"
+#include "System/LoadSave/CregLoadSaveHandler.h"
+#include "System/LoadSave/DemoIndex.h"
+#include "System/LoadSave/DemoReader.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
+#include "System/MemoryStats.h"
 #include "System/Platform/Misc.h"
 #include "System/Platform/Watchdog.h"
 #include "System/Sound/ISound.h"
@@ -127,6 +132,7 @@
 #undef CreateDirectory
 
 CONFIG(bool, GameEndOnConnectionLoss).defaultValue(true);
+CONFIG(int, DemoKeyframeInterval).defaultValue(0).minimumValue(0).description("If > 0, save a keyframe every N minutes of game-time while watching a demo, which makes /skip (including backwards) reload from the nearest one instead of re-simulating.");
 // CONFIG(bool, LuaCollectGarbageOnSimFrame).defaultValue(true);
 
 CONFIG(bool, WindowedEdgeMove).defaultValue(true).description("Sets whether moving the mouse cursor to the screen edge will move the camera across the map.");
@@ -165,6 +171,8 @@ CR_REG_METADATA(CGame, (
 	CR_MEMBER(totalGameTime),
 
 	CR_IGNORED(chatSound),
+	CR_IGNORED(demoKeyframeRate),
+	CR_IGNORED(gameStateRequestFrame),
 	CR_MEMBER(hideInterface),
 
 	// FIXME: atomic type deduction
@@ -243,6 +251,7 @@ CGame::CGame(const std::string& mapFileName, const std::string& modFileName, ILo
 	showSpeed = configHandler->GetBool("ShowSpeed");
 
 	speedControl = configHandler->GetInt("SpeedControl");
+	demoKeyframeRate = configHandler->GetInt("DemoKeyframeInterval") * 60 * GAME_SPEED;
 
 	playerRoster.SetSortTypeByCode((PlayerRoster::SortType)configHandler->GetInt("ShowPlayerInfo"));
 
@@ -340,6 +349,21 @@ void CGame::AddTimedJobs()
 
 		jobDispatcher.AddTimedJob(j);
 	}
+
+	{
+		JobDispatcher::Job j;
+
+		j.f = []() -> bool {
+			memoryStats.Update(gs->frameNum);
+			return true;
+		};
+
+		j.freq = 1.0f;
+		j.time = (1000.0f / j.freq) * (1 - j.startDirect);
+		j.name = "MemoryStats::Update";
+
+		jobDispatcher.AddTimedJob(j);
+	}
 }
 
 void CGame::Load(const std::string& mapFileName)
@@ -428,9 +452,15 @@ void CGame::Load(const std::string& mapFileName)
 		LOG("[Game::%s][6] globalQuit=%d forcedQuit=%d", __func__, globalQuit.load(), forcedQuit);
 
 		if (!globalQuit && saveFileHandler != nullptr) {
+			// the save might come from another client (NETMSG_GAMESTATE)
+			const int myPlayerNum = gu->myPlayerNum;
+
 			loadscreen->SetLoadMessage("Loading Saved Game");
 			saveFileHandler->LoadGame();
 			LoadLua(false, true);
+
+			if (gu->myPlayerNum != myPlayerNum)
+				gu->SetMyPlayer(myPlayerNum);
 		}
 
 		{
@@ -547,6 +577,8 @@ void CGame::PreLoadSimulation(LuaParser* defsParser)
 {
 	ENTER_SYNCED_CODE();
 
+	memoryStats.Init();
+
 	loadscreen->SetLoadMessage("Creating Smooth Height Mesh");
 	smoothGround.Init(float3::maxxpos, float3::maxzpos, SQUARE_SIZE * 2, SQUARE_SIZE * 40);
 
@@ -944,6 +976,7 @@ void CGame::KillSimulation()
 	CUnitScriptEngine::KillStatic();
 	CWeaponLoader::KillStatic();
 	CommonDefHandler::KillStatic();
+	memoryStats.Kill();
 }
 
 
@@ -1523,6 +1556,7 @@ void CGame::SimFrame() {
 			eventHandler.GameFrame(gs->frameNum);
 		}
 
+		quadField.Update();
 		helper->Update();
 		mapDamage->Update();
 		pathManager->Update();
@@ -1545,6 +1579,9 @@ void CGame::SimFrame() {
 		playerHandler.GameFrame(gs->frameNum);
 	}
 
+	// asynchronous AI's work on this frame's events until the next packet
+	eoh->DispatchEventBatches();
+
 	lastSimFrameTime = spring_gettime();
 	gu->avgSimFrameTime = mix(gu->avgSimFrameTime, (lastSimFrameTime - lastFrameTime).toMilliSecsf(), 0.05f);
 	gu->avgSimFrameTime = std::max(gu->avgSimFrameTime, 0.001f);
@@ -1874,6 +1911,106 @@ void CGame::Save(std::string&& fileName, std::string&& saveArgs)
 	globalSaveFileData.args = std::move(saveArgs);
 }
 
+void CGame::SaveDemoKeyframe()
+{
+	if (demoKeyframeRate <= 0 || !gameSetup->hostDemo)
+		return;
+	if (gs->frameNum <= 0 || (gs->frameNum % demoKeyframeRate) != 0)
+		return;
+
+	const std::string& demoName = gameSetup->demoName;
+	const std::string& saveName = spring::format("Saves/%s_%d.ssf", FileSystem::GetBasename(demoName).c_str(), gs->frameNum);
+
+	// the demo is hosted by our own server; its reader is gone once the demo ended
+	if (gameServer == nullptr || gameServer->GetDemoReader() == nullptr)
+		return;
+
+	const DemoFileHeader& demoHeader = gameServer->GetDemoReader()->GetFileHeader();
+
+	CDemoIndex demoIndex;
+
+	// keyframes accumulate, but never in a stale side-car left by another
+	// game; its savegames are useless from now on and get deleted with it
+	if (!demoIndex.Load(demoName) || !demoIndex.MatchesDemo(demoHeader)) {
+		demoIndex.RemoveKeyframes();
+		demoIndex.Init(demoName, demoHeader);
+	}
+
+	if (!ILoadSaveHandler::CreateSave(saveName, "-y"))
+		return;
+
+	demoIndex.AddKeyframe(gs->frameNum, saveName);
+	demoIndex.Save();
+}
+
+void CGame::SendGameStateSnapshot()
+{
+	if (gs->frameNum != gameStateRequestFrame)
+		return;
+
+	gameStateRequestFrame = -1;
+
+	// must match the state right after this frame, so the save can not be
+	// deferred like globalSaveFileData nor be written to disk asynchronously
+	CCregLoadSaveHandler saveHandler;
+	std::vector<std::uint8_t> saveData;
+	std::vector<std::uint8_t> chunk;
+
+	saveHandler.SaveInfo(gameSetup->mapName, gameSetup->modName);
+
+	if (!saveHandler.SaveGameToBuffer(saveData))
+		return;
+
+	constexpr size_t chunkSize = 60000;
+
+	for (size_t offset = 0; offset < saveData.size(); offset += chunkSize) {
+		chunk.assign(saveData.begin() + offset, saveData.begin() + std::min(offset + chunkSize, saveData.size()));
+		clientNet->Send(CBaseNetProtocol::Get().SendGameState(gu->myPlayerNum, gs->frameNum, saveData.size(), offset, chunk));
+	}
+
+	LOG("[Game::%s] uploaded game-state snapshot of frame %d (%u KB)", __func__, gs->frameNum, unsigned(saveData.size() >> 10));
+}
+
+void CGame::ReloadDemoFromKeyframe(int keyframeNum, int targetFrameNum)
+{
+	const std::string& demoName = gameSetup->demoName;
+
+	std::string saveName;
+	std::string playerName = gu->GetMyPlayer()->name;
+
+	if (keyframeNum >= 0) {
+		CDemoIndex demoIndex;
+
+		const CDemoIndex::Keyframe* keyframe = nullptr;
+
+		const CDemoReader* demoReader = (gameServer != nullptr)? gameServer->GetDemoReader().get(): nullptr;
+
+		if (demoReader != nullptr && demoIndex.Load(demoName) && demoIndex.MatchesDemo(demoReader->GetFileHeader()))
+			keyframe = demoIndex.FindKeyframe(keyframeNum);
+
+		if (keyframe != nullptr && keyframe->frameNum == keyframeNum) {
+			saveName = keyframe->saveFile;
+		} else {
+			LOG_L(L_WARNING, "[Game::%s] keyframe %d of demo \"%s\" not found, replaying from the start", __func__, keyframeNum, demoName.c_str());
+			keyframeNum = -1;
+		}
+	}
+
+	// SpringApp::LoadDemoFile appends this again
+	if (playerName.size() > 7 && playerName.compare(playerName.size() - 7, 7, " (spec)") == 0)
+		playerName.resize(playerName.size() - 7);
+
+	const std::string script = spring::format(
+		"[GAME]\n{\n\tDemoFile=%s;\n\tSaveFile=%s;\n\tDemoKeyframe=%d;\n\tDemoSkipFrame=%d;\n\tMyPlayerName=%s;\n\tIsHost=1;\n}\n",
+		demoName.c_str(), saveName.c_str(), keyframeNum, targetFrameNum, playerName.c_str()
+	);
+
+	LOG("[Game::%s] reloading demo \"%s\" from frame %d to skip to frame %d", __func__, demoName.c_str(), std::max(keyframeNum, 0), targetFrameNum);
+
+	gameSetup->reloadScript = script;
+	gu->globalReload = true;
+}
+
 
 
 
@@ -94,6 +94,13 @@ public:
 	void Reload();
 	void Save(std::string&& fileName, std::string&& saveArgs);
 
+	/// writes a creg keyframe every DemoKeyframeInterval minutes while watching a demo
+	void SaveDemoKeyframe();
+	/// restarts demo playback from keyframeNum (or from the start if -1), then skips ahead
+	void ReloadDemoFromKeyframe(int keyframeNum, int targetFrameNum);
+	/// uploads the game state to the server if it asked for a snapshot of this frame
+	void SendGameStateSnapshot();
+
 	void ResizeEvent() override;
 
 	void SetDrawMode(Game::DrawMode mode) { gameDrawMode = mode; }
@@ -162,6 +169,9 @@ public:
 	float totalGameTime = 0.0f;
 
 	int chatSound = -1;
+	int demoKeyframeRate = 0;
+	/// frame after which to upload a snapshot (NETMSG_GAMESTATE_REQUEST), -1 if none
+	int gameStateRequestFrame = -1;
 
 	bool windowedEdgeMove = false;
 	bool fullscreenEdgeMove = false;
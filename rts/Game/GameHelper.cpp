@@ -33,11 +33,15 @@
 #include "Sim/Units/UnitDef.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitHandler.h"
+#include "Sim/Units/UnitLoader.h"
 #include "Sim/Weapons/WeaponDefHandler.h"
 #include "Sim/Weapons/Weapon.h"
 #include "System/EventHandler.h"
+#include "System/Log/ILog.h"
 #include "System/SpringMath.h"
 #include "System/Sound/ISoundChannels.h"
+#include "System/Sync/HsiehHash.h"
+#include "System/TimeProfiler.h"
 
 
 static CGameHelper gGameHelper;
@@ -50,6 +54,12 @@ void CGameHelper::Init()
 		wdVec.clear();
 		wdVec.reserve(32);
 	}
+
+	ClearTargetCandidateSets();
+
+	targetCandidateScratch.clear();
+	targetCandidateDepth = 0;
+	useTargetCandidateSets = true;
 }
 
 void CGameHelper::Update()
@@ -632,6 +642,59 @@ namespace {
 
 
 
+const std::vector<CUnit*>& CGameHelper::GetWeaponTargetCandidates(int allyTeam, const float3& scanPos, float scanRadius)
+{
+	QuadFieldQuery qfQuery;
+	quadField.GetQuads(qfQuery, scanPos, scanRadius);
+
+	const std::vector<int>& quads = *qfQuery.quads;
+
+	const unsigned int quadsHash = HsiehHash(quads.data(), quads.size() * sizeof(int), allyTeam);
+	const unsigned int quadsVers = quadField.GetUnitQuadsVersion();
+
+	TargetCandidateSet& tcs = targetCandidateSets[quadsHash & (targetCandidateSets.size() - 1)];
+
+	// identical quad-sets yield identical candidate lists (in the same
+	// order) as long as no unit has entered or left any quad since the
+	// set was gathered, which is typical for blobs of same-range units
+	if (useTargetCandidateSets && tcs.frame == gs->frameNum && tcs.allyTeam == allyTeam && tcs.quadsVersion == quadsVers && tcs.quads == quads)
+		return tcs.units;
+
+	tcs.frame = gs->frameNum;
+	tcs.allyTeam = allyTeam;
+	tcs.quadsVersion = quadsVers;
+	tcs.quads.assign(quads.begin(), quads.end());
+	tcs.units.clear();
+
+	const int tempNum = gs->GetTempNum();
+
+	for (int t = 0; t < teamHandler.ActiveAllyTeams(); ++t) {
+		if (teamHandler.Ally(allyTeam, t))
+			continue;
+
+		for (const int qi: quads) {
+			for (CUnit* unit: quadField.GetQuad(qi).teamUnits[t]) {
+				if (unit->tempNum == tempNum)
+					continue;
+
+				unit->tempNum = tempNum;
+				tcs.units.push_back(unit);
+			}
+		}
+	}
+
+	return tcs.units;
+}
+
+void CGameHelper::ClearTargetCandidateSets()
+{
+	for (TargetCandidateSet& tcs: targetCandidateSets) {
+		tcs.quads.clear();
+		tcs.units.clear();
+		tcs.frame = -1;
+	}
+}
+
 size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets)
 {
 	const CUnit*  weaponOwner = weapon->owner;
@@ -661,93 +724,210 @@ size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* av
 
 	const bool paralyzer = (weaponDmg->paralyzeDamageTime != 0);
 
-	// copy on purpose since the below calls lua
-	QuadFieldQuery qfQuery;
-	quadField.GetQuads(qfQuery, ownerPos, scanRadius);
+	// shared with every other weapon (of the same allyteam) this frame whose
+	// scan-radius covers the same quads; gathered up-front and not by walking
+	// the quads directly since the below calls lua
+	const std::vector<CUnit*>& candidates = helper->GetWeaponTargetCandidates(weaponOwner->allyteam, ownerPos, scanRadius);
+	const size_t numCandidates = candidates.size();
+
+	// the cached set can be regathered (and its storage reallocated) by a
+	// nested call from AllowWeaponTarget, so the loop below runs over its
+	// own copy; this has one level per nesting depth and keeps its buffers
+	if (helper->targetCandidateDepth == helper->targetCandidateScratch.size())
+		helper->targetCandidateScratch.emplace_back();
+
+	TargetCandidateScratch& scratch = helper->targetCandidateScratch[helper->targetCandidateDepth++];
+
+	scratch.units.clear();
+	scratch.categories.resize(numCandidates);
+	scratch.losStates.resize(numCandidates);
+	scratch.keepFlags.resize(numCandidates);
+
+	for (size_t i = 0; i < numCandidates; i++) {
+		scratch.categories[i] = candidates[i]->category;
+		scratch.losStates[i] = candidates[i]->losStatus[weaponOwner->allyteam];
+	}
+
+	// branch-free pre-pass over the flat arrays; drops candidates that
+	// TestTarget (which every override ANDs with) would reject for their
+	// category or for being neither in LOS nor in radar, so the order of
+	// the surviving ones and thus of RNG draws and callins is unchanged
+	// (the flags are sampled before the first callin, as is the set)
+	{
+		const unsigned int onlyTargetCategory = weapon->onlyTargetCategory;
+		const unsigned char* losStates = scratch.losStates.data();
+		const unsigned int* categories = scratch.categories.data();
+		unsigned char* keepFlags = scratch.keepFlags.data();
+
+		for (size_t i = 0; i < numCandidates; i++) {
+			keepFlags[i] = ((categories[i] & onlyTargetCategory) != 0) & ((losStates[i] & (LOS_INLOS | LOS_INRADAR)) != 0);
+		}
+	}
+
+	for (size_t i = 0; i < numCandidates; i++) {
+		if (scratch.keepFlags[i] == 0)
+			continue;
+
+		scratch.units.push_back(candidates[i]);
+	}
 
 	targets.clear();
 	targets.reserve(32);
 
-	const int tempNum = gs->GetTempNum();
+	for (CUnit* targetUnit: scratch.units) {
+		if (!weapon->TestTarget(testPos, SWeaponTarget(targetUnit)))
+			continue;
 
-	for (int t = 0; t < teamHandler.ActiveAllyTeams(); ++t) {
-		if (teamHandler.Ally(weaponOwner->allyteam, t))
+		const unsigned short targetLOSState = targetUnit->losStatus[weaponOwner->allyteam];
+
+		float targetPriority = tgtPriorityMults[(targetUnit == avoidUnit) * 1];
+		float3 targetPos;
+
+		if (targetLOSState & LOS_INLOS) {
+			targetPos = targetUnit->aimPos;
+		} else if (targetLOSState & LOS_INRADAR) {
+			targetPos = weapon->GetUnitPositionWithError(targetUnit);
+			targetPriority *= tgtPriorityMults[1];
+		} else {
 			continue;
+		}
 
-		for (const int qi: *qfQuery.quads) {
-			const std::vector<CUnit*>& allyTeamUnits = quadField.GetQuad(qi).teamUnits[t];
+		const float modRange = weapon->GetRange2D(rangeBoost, (targetPos.y - aimPosHeight) * heightMod);
+		const float sqDist2D = ownerPos.SqDistance2D(targetPos);
 
-			for (CUnit* targetUnit: allyTeamUnits) {
-				if (targetUnit->tempNum == tempNum)
-					continue;
+		if (sqDist2D > Square(modRange))
+			continue;
 
-				targetUnit->tempNum = tempNum;
+		const float dist2D = math::sqrt(sqDist2D);
+		const float rangeMul = (dist2D * weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
+		const float damageMul = weaponDmg->Get(targetUnit->armorType) * targetUnit->curArmorMultiple;
 
-				if (!weapon->TestTarget(testPos, SWeaponTarget(targetUnit)))
-					continue;
+		targetPriority *= rangeMul;
+		targetPriority *= tgtPriorityMults[(dist2D > baseRange) * 6];
 
-				const unsigned short targetLOSState = targetUnit->losStatus[weaponOwner->allyteam];
+		if (targetLOSState & LOS_INLOS) {
+			targetPriority *= (secDamage + targetUnit->health);
 
-				float targetPriority = tgtPriorityMults[(targetUnit == avoidUnit) * 1];
-				float3 targetPos;
+			if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
+				targetPriority *= tgtPriorityMults[5];
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPos = targetUnit->aimPos;
-				} else if (targetLOSState & LOS_INRADAR) {
-					targetPos = weapon->GetUnitPositionWithError(targetUnit);
-					targetPriority *= tgtPriorityMults[1];
-				} else {
-					continue;
-				}
+			if (weapon->hasTargetWeight)
+				targetPriority *= weapon->TargetWeight(targetUnit);
 
-				const float modRange = weapon->GetRange2D(rangeBoost, (targetPos.y - aimPosHeight) * heightMod);
-				const float sqDist2D = ownerPos.SqDistance2D(targetPos);
+		} else {
+			targetPriority *= (secDamage + 10000.0f);
+		}
 
-				if (sqDist2D > Square(modRange))
-					continue;
+		if (targetLOSState & LOS_PREVLOS) {
+			targetPriority /= (damageMul * targetUnit->power * (0.7f + gsRNG.NextFloat() * 0.6f));
+			targetPriority *= tgtPriorityMults[((targetUnit->category & weapon->badTargetCategory) != 0) * 2];
+			targetPriority *= tgtPriorityMults[(targetUnit->IsCrashing()) * 3];
+			targetPriority *= tgtPriorityMults[(targetUnit == lastAttacker) * 4];
+		}
+
+		if (!eventHandler.AllowWeaponTarget(weaponOwner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority))
+			continue;
 
-				const float dist2D = math::sqrt(sqDist2D);
-				const float rangeMul = (dist2D * weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
-				const float damageMul = weaponDmg->Get(targetUnit->armorType) * targetUnit->curArmorMultiple;
+		targets.emplace_back(targetPriority, targetUnit);
+	}
 
-				targetPriority *= rangeMul;
-				targetPriority *= tgtPriorityMults[(dist2D > baseRange) * 6];
+	helper->targetCandidateDepth--;
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPriority *= (secDamage + targetUnit->health);
+	std::stable_sort(targets.begin(), targets.end(), [](const std::pair<float, CUnit*>& a, const std::pair<float, CUnit*>& b) { return (a.first < b.first); });
+	return (targets.size());
+}
 
-					if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
-						targetPriority *= tgtPriorityMults[5];
 
-					if (weapon->hasTargetWeight)
-						targetPriority *= weapon->TargetWeight(targetUnit);
+void CGameHelper::BenchmarkTargeting(const UnitDef* unitDef, int numUnits, int numFrames, int teamNum, int enemyTeamNum)
+{
+	const float spacing = std::max(unitDef->xsize, unitDef->zsize) * SQUARE_SIZE;
+	const float3 center = {mapDims.mapx * SQUARE_SIZE * 0.5f, 0.0f, mapDims.mapy * SQUARE_SIZE * 0.5f};
 
-				} else {
-					targetPriority *= (secDamage + 10000.0f);
-				}
+	// two opposing blobs whose front rows are half a weapon-range apart
+	const int gridSize = std::ceil(math::sqrt(numUnits * 0.5f));
+	const float blobOffset = (gridSize * spacing + unitDef->maxWeaponRange) * 0.5f;
 
-				if (targetLOSState & LOS_PREVLOS) {
-					targetPriority /= (damageMul * targetUnit->power * (0.7f + gsRNG.NextFloat() * 0.6f));
-					targetPriority *= tgtPriorityMults[((targetUnit->category & weapon->badTargetCategory) != 0) * 2];
-					targetPriority *= tgtPriorityMults[(targetUnit->IsCrashing()) * 3];
-					targetPriority *= tgtPriorityMults[(targetUnit == lastAttacker) * 4];
-				}
+	const int teamNums[2] = {teamNum, enemyTeamNum};
+	const int allyTeams[2] = {teamHandler.AllyTeam(teamNum), teamHandler.AllyTeam(enemyTeamNum)};
 
-				const bool allowTarget = eventHandler.AllowWeaponTarget(weaponOwner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority);
+	std::vector<CUnit*> benchUnits;
+	benchUnits.reserve(numUnits);
 
-				// Lua call may have changed tempNum, so needs to be set again
-				targetUnit->tempNum = tempNum;
+	for (int i = 0; i < numUnits && unitHandler.CanAddUnit(-1); i++) {
+		const int side = i & 1;
+		const int cell = i >> 1;
 
-				if (!allowTarget)
-					continue;
+		const float px = std::clamp(center.x + (side * 2 - 1) * blobOffset + ((cell % gridSize) - gridSize * 0.5f) * spacing, 0.0f, float(mapDims.mapx * SQUARE_SIZE));
+		const float pz = std::clamp(center.z + ((cell / gridSize) - gridSize * 0.5f) * spacing, 0.0f, float(mapDims.mapy * SQUARE_SIZE));
 
-				targets.emplace_back(targetPriority, targetUnit);
+		const UnitLoadParams unitParams = {
+			unitDef,
+			nullptr,
+
+			float3(px, CGround::GetHeightReal(px, pz), pz),
+			ZeroVector,
+
+			-1,
+			teamNums[side],
+			FACING_SOUTH,
+
+			false,
+			false,
+		};
+
+		CUnit* unit = unitLoader->LoadUnit(unitParams);
+
+		// the LOS maps are not updated during the benchmark; have every
+		// unit be seen as if both sides had been fighting for a while
+		unit->losStatus[allyTeams[side ^ 1]] |= (LOS_INLOS | LOS_INRADAR | LOS_PREVLOS | LOS_CONTRADAR);
+
+		benchUnits.push_back(unit);
+	}
+
+	const CGlobalSyncedRNG syncedRNG = gsRNG;
+
+	spring_time updateTimes[2];
+
+	size_t numWeapons = 0;
+	size_t numTargets = 0;
+
+	// [0] := every weapon gathers its own candidates, [1] := shared sets
+	for (int i = 0; i < 2; i++) {
+		useTargetCandidateSets = (i == 1);
+		numWeapons = 0;
+		numTargets = 0;
+		gsRNG = syncedRNG;
+
+		const spring_time t0 = spring_gettime();
+
+		for (int k = 0; k < numFrames; k++) {
+			// the sim-frame does not advance, so drop what the last one cached
+			ClearTargetCandidateSets();
+
+			for (const CUnit* u: benchUnits) {
+				for (const CWeapon* w: u->weapons) {
+					numTargets += GenerateWeaponTargets(w, nullptr, targetPairs);
+					numWeapons += 1;
+				}
 			}
 		}
+
+		updateTimes[i] = spring_gettime() - t0;
 	}
 
-	std::stable_sort(targets.begin(), targets.end(), [](const std::pair<float, CUnit*>& a, const std::pair<float, CUnit*>& b) { return (a.first < b.first); });
-	return (targets.size());
+	gsRNG = syncedRNG;
+	useTargetCandidateSets = true;
+
+	ClearTargetCandidateSets();
+
+	for (CUnit* u: benchUnits) {
+		u->ForcedKillUnit(nullptr, false, true, false);
+	}
+
+	LOG("[GameHelper::%s] %u x \"%s\" for %d frames (%.1f targets per weapon): per-weapon candidates %.1fus per frame, shared candidate sets %.1fus per frame",
+		__func__, unsigned(benchUnits.size()), unitDef->name.c_str(), numFrames, numTargets / float(std::max(numWeapons, size_t(1))),
+		updateTimes[0].toMicroSecsf() / numFrames, updateTimes[1].toMicroSecsf() / numFrames
+	);
 }
 
 
@@ -10,6 +10,7 @@
 #include "System/type2.h"
 
 #include <array>
+#include <deque>
 #include <vector>
 
 
@@ -128,6 +129,8 @@ public:
 
 	static size_t GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets);
 
+	void BenchmarkTargeting(const UnitDef* unitDef, int numUnits, int numFrames, int teamNum, int enemyTeamNum);
+
 	void Init();
 	void Update();
 
@@ -179,8 +182,39 @@ private:
 		float3 impulse;
 	};
 
+	// per-frame cache of enemy units found in a given set of quads
+	struct TargetCandidateSet {
+		std::vector<int> quads;
+		std::vector<CUnit*> units;
+
+		int frame = -1;
+		int allyTeam = -1;
+
+		unsigned int quadsVersion = 0;
+	};
+
+	// per-call copy of a candidate set for GenerateWeaponTargets, stored
+	// as parallel arrays for the pre-pass; one per nesting level since a
+	// Lua AllowWeaponTarget callin can re-enter target generation
+	struct TargetCandidateScratch {
+		std::vector<CUnit*> units;
+		std::vector<unsigned int> categories;
+		std::vector<unsigned char> losStates;
+		std::vector<unsigned char> keepFlags;
+	};
+
+	const std::vector<CUnit*>& GetWeaponTargetCandidates(int allyTeam, const float3& scanPos, float scanRadius);
+	void ClearTargetCandidateSets();
+
 	// note: size must be a power of two
 	std::array<std::vector<WaitingDamage>, 128> waitingDamages;
+	// note: size must be a power of two (direct-mapped by quad-set hash)
+	std::array<TargetCandidateSet, 64> targetCandidateSets;
+	// deque, references must stay valid when a nested call adds a level
+	std::deque<TargetCandidateScratch> targetCandidateScratch;
+
+	size_t targetCandidateDepth = 0;
+	bool useTargetCandidateSets = true;
 
 public:
 	std::vector<int> targetUnitIDs; // GetEnemyUnits{NoLosTest}
@@ -37,6 +37,8 @@
 #include "System/TdfParser.h"
 #include "System/Input/KeyInput.h"
 #include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/VFSHandler.h"
 #include "System/LoadSave/DemoRecorder.h"
@@ -110,6 +112,18 @@ void CPreGame::LoadDemoFile(const std::string& demo)
 	assert(clientSetup->isHost);
 	wantDemo &= configHandler->GetBool("DemoFromDemo");
 
+	// resume from a keyframe (see CDemoIndex) instead of simulating from the start
+	if (!clientSetup->saveFile.empty() && clientSetup->demoKeyframe >= 0) {
+		saveFileHandler = ILoadSaveHandler::CreateHandler(clientSetup->saveFile);
+
+		if (!saveFileHandler->LoadGameStartInfo(clientSetup->saveFile)) {
+			LOG_L(L_ERROR, "[PreGame::%s] could not load demo keyframe \"%s\", replaying from the start", __func__, clientSetup->saveFile.c_str());
+			spring::SafeDelete(saveFileHandler);
+
+			clientSetup->demoKeyframe = -1;
+		}
+	}
+
 	ReadDataFromDemo(demo);
 }
 
@@ -337,7 +351,8 @@ void CPreGame::UpdateClientNet()
 			case NETMSG_CREATE_NEWPLAYER: {
 				// server will send this first if we're using mid-game join
 				// feature to let us know about ourselves (we won't be in
-				// gamedata), otherwise skip to gamedata
+				// gamedata), otherwise skip to gamedata; also sent after a
+				// game-state snapshot for the players that joined before it
 				try {
 					netcode::UnpackPacket pckt(packet, 3);
 					std::string name;
@@ -379,6 +394,12 @@ void CPreGame::UpdateClientNet()
 				GameDataReceived(packet);
 			} break;
 
+			case NETMSG_GAMESTATE: {
+				// server sends this between gamedata and our player number
+				// if it has a snapshot of the game we are (re)joining
+				GameStateReceived(packet);
+			} break;
+
 			case NETMSG_SETPLAYERNUM: {
 				// this is sent after NETMSG_GAMEDATA, to let us know which
 				// player number we have (server assigns them based on order
@@ -391,6 +412,9 @@ void CPreGame::UpdateClientNet()
 				if (!playerHandler.IsValidPlayer(playerNum))
 					throw content_error("Invalid player number received from server");
 
+				if (gameStateSize > 0)
+					LoadGameState();
+
 				// respond with the client data and content checksums
 				gu->SetMyPlayer(playerNum);
 				clientNet->Send(CBaseNetProtocol::Get().SendClientData(playerNum, ClientData::GetCompressed()));
@@ -490,6 +514,79 @@ void CPreGame::ReadDataFromDemo(const std::string& demoName)
 	assert(gameServer != nullptr);
 }
 
+void CPreGame::GameStateReceived(std::shared_ptr<const netcode::RawPacket> packet)
+{
+	constexpr uint32_t headerSize = sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(int32_t) + sizeof(uint32_t) * 2;
+
+	try {
+		netcode::UnpackPacket pckt(packet, sizeof(uint8_t) + sizeof(uint16_t));
+
+		uint8_t playerNum;
+		int32_t frameNum;
+		uint32_t totalSize;
+		uint32_t offset;
+
+		pckt >> playerNum;
+		pckt >> frameNum;
+		pckt >> totalSize;
+		pckt >> offset;
+
+		if (offset != gameStateData.size() || (gameStateSize != 0 && totalSize != gameStateSize))
+			throw content_error("invalid game-state snapshot received");
+
+		std::vector<std::uint8_t> chunk(packet->length - headerSize);
+		pckt >> chunk;
+
+		gameStateSize = totalSize;
+		gameStateData.reserve(totalSize);
+		gameStateData.insert(gameStateData.end(), chunk.begin(), chunk.end());
+	} catch (const netcode::UnpackPacketException& ex) {
+		throw content_error(std::string("invalid game-state snapshot received: ") + ex.what());
+	}
+}
+
+void CPreGame::LoadGameState()
+{
+	if (gameStateData.size() != gameStateSize)
+		throw content_error("incomplete game-state snapshot received");
+
+	const std::string saveName = "Saves/netgamestate.ssf";
+
+	if (!FileSystem::CreateDirectory("Saves"))
+		throw content_error("could not create save-directory for game-state snapshot");
+
+	{
+		// data is gzip-compressed already, store as-is
+		FILE* file = fopen(dataDirsAccess.LocateFile(saveName, FileQueryFlags::WRITE).c_str(), "wb");
+
+		if (file == nullptr)
+			throw content_error("could not write game-state snapshot \"" + saveName + "\"");
+
+		const size_t numWritten = fwrite(gameStateData.data(), 1, gameStateData.size(), file);
+
+		fclose(file);
+
+		if (numWritten != gameStateData.size())
+			throw content_error("could not write game-state snapshot \"" + saveName + "\"");
+	}
+
+	LOG("[PreGame::%s] loading game-state snapshot (%u KB) sent by server", __func__, unsigned(gameStateData.size() >> 10));
+
+	gameStateData.clear();
+	gameStateData.shrink_to_fit();
+
+	saveFileHandler = ILoadSaveHandler::CreateHandler(saveName);
+
+	if (!saveFileHandler->LoadGameStartInfo(saveName))
+		throw content_error("incompatible game-state snapshot received");
+
+	// a demo would only contain what happened after the snapshot
+	if (clientNet->GetDemoRecorder()->IsValid()) {
+		LOG_L(L_WARNING, "[PreGame::%s] demo recording is not supported when joining from a snapshot", __func__);
+		clientNet->ResetDemoRecorder();
+	}
+}
+
 void CPreGame::GameDataReceived(std::shared_ptr<const netcode::RawPacket> packet)
 {
 	ScopedOnceTimer timer("PreGame::GameDataReceived");
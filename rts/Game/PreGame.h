@@ -3,8 +3,10 @@
 #ifndef PREGAME_H
 #define PREGAME_H
 
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "GameController.h"
 #include "System/Misc/SpringTime.h"
@@ -63,6 +65,9 @@ private:
 	void UpdateClientNet();
 
 	void GameDataReceived(std::shared_ptr<const netcode::RawPacket> packet);
+	void GameStateReceived(std::shared_ptr<const netcode::RawPacket> packet);
+	/// writes the received snapshot to disk and prepares loading it
+	void LoadGameState();
 
 private:
 	/**
@@ -76,6 +81,11 @@ private:
 	std::string modFileName;
 	ILoadSaveHandler* saveFileHandler;
 
+	/// snapshot of a running game, sent by the server (in chunks) instead of
+	/// the packets we missed; if complete, loaded like a savegame
+	std::vector<std::uint8_t> gameStateData;
+	std::uint32_t gameStateSize = 0;
+
 	spring_time connectTimer;
 
 	bool wantDemo;
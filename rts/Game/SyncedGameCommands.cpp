@@ -3,6 +3,7 @@
 
 #include "Action.h"
 #include "Game.h"
+#include "GameHelper.h"
 #include "GlobalUnsynced.h"
 #include "InMapDraw.h"
 #include "SelectedUnitsHandler.h"
@@ -20,11 +21,18 @@
 #include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/ModInfo.h"
+#include "Sim/MoveTypes/MoveDefHandler.h"
+#include "Sim/Path/Default/PathManager.h"
 #include "Sim/Projectiles/ExplosionGenerator.h"
+#include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Projectiles/WeaponProjectiles/WeaponProjectileTypes.h"
+#include "Sim/Units/Scripts/CobEngine.h"
 #include "Sim/Units/UnitDefHandler.h"
 #include "Sim/Units/UnitHandler.h"
 #include "Sim/Units/UnitLoader.h"
 #include "Sim/Units/Unit.h"
+#include "Sim/Weapons/WeaponDef.h"
+#include "Sim/Weapons/WeaponDefHandler.h"
 #include "System/EventHandler.h"
 #include "System/FileSystem/SimpleParser.h"
 #include "System/Log/ILog.h"
@@ -249,6 +257,198 @@ public:
 };
 
 
+class CobBenchActionExecutor : public ISyncedActionExecutor {
+public:
+	CobBenchActionExecutor() : ISyncedActionExecutor(
+		"CobBench",
+		"Runs all COB threads for N extra ticks (default 300) and logs the time taken;"
+		" a second argument of 0 selects the opcode instead of the decoded interpreter",
+		true
+	) {
+	}
+
+	bool Execute(const SyncedAction& action) const final override {
+		const std::vector<std::string>& args = CSimpleParser::Tokenize(action.GetArgs(), 0);
+
+		const int numTicks = (args.size() > 0)? std::max(0, atoi(args[0].c_str())): 300;
+		const bool decoded = (args.size() > 1)? (atoi(args[1].c_str()) != 0): true;
+
+		cobEngine->Benchmark(numTicks, decoded);
+		return true;
+	}
+};
+
+
+class ProjectileBenchActionExecutor : public ISyncedActionExecutor {
+public:
+	ProjectileBenchActionExecutor() : ISyncedActionExecutor(
+		"ProjectileBench",
+		"Spawns N (default 50000) ballistic projectiles above the map, updates them for M frames"
+		" (default 30) and logs the time per projectile update; an optional third argument names"
+		" the weapon to use instead of the first non-targetable cannon. The projectiles are kept"
+		" apart from the game's and hidden from Lua",
+		true
+	) {
+	}
+
+	bool Execute(const SyncedAction& action) const final override {
+		const std::vector<std::string>& args = CSimpleParser::Tokenize(action.GetArgs(), 0);
+
+		const int numProjectiles = (args.size() > 0)? std::max(1, atoi(args[0].c_str())): 50000;
+		const int numFrames = (args.size() > 1)? std::max(1, atoi(args[1].c_str())): 30;
+
+		const WeaponDef* weaponDef = nullptr;
+
+		if (args.size() > 2) {
+			weaponDef = weaponDefHandler->GetWeaponDef(args[2]);
+		} else {
+			for (const WeaponDef& wd: weaponDefHandler->GetWeaponDefsVec()) {
+				if (wd.projectileType != WEAPON_EXPLOSIVE_PROJECTILE)
+					continue;
+				if (wd.targetable)
+					continue;
+
+				weaponDef = &wd;
+				break;
+			}
+		}
+
+		// targetable projectiles would be announced to interceptors
+		if (weaponDef == nullptr || weaponDef->IsHitScanWeapon() || weaponDef->targetable) {
+			LOG_L(L_WARNING, "[%s] no suitable weapon found", __func__);
+			return false;
+		}
+
+		projectileHandler.Benchmark(weaponDef, numProjectiles, numFrames);
+		return true;
+	}
+};
+
+
+class PathBenchActionExecutor : public ISyncedActionExecutor {
+public:
+	PathBenchActionExecutor() : ISyncedActionExecutor(
+		"PathBench",
+		"Runs N (default 2000) max-resolution path searches between random points at most D"
+		" (default 1024) elmos apart and logs the number of nodes searched per second; an"
+		" optional third argument names the MoveDef to use instead of the first one",
+		true
+	) {
+	}
+
+	bool Execute(const SyncedAction& action) const final override {
+		const std::vector<std::string>& args = CSimpleParser::Tokenize(action.GetArgs(), 0);
+
+		const int numQueries = (args.size() > 0)? std::max(1, atoi(args[0].c_str())): 2000;
+		const float maxDistance = (args.size() > 1)? std::max(float(SQUARE_SIZE), float(atof(args[1].c_str()))): 1024.0f;
+
+		CPathManager* pm = dynamic_cast<CPathManager*>(pathManager);
+		const MoveDef* moveDef = nullptr;
+
+		if (args.size() > 2) {
+			moveDef = moveDefHandler.GetMoveDefByName(args[2]);
+		} else if (moveDefHandler.GetNumMoveDefs() > 0) {
+			moveDef = moveDefHandler.GetMoveDefByPathType(0);
+		}
+
+		if (pm == nullptr || moveDef == nullptr) {
+			LOG_L(L_WARNING, "[%s] default pathfinder or MoveDef not available", __func__);
+			return false;
+		}
+
+		pm->Benchmark(moveDef, numQueries, maxDistance);
+		return true;
+	}
+};
+
+
+class CollisionBenchActionExecutor : public ISyncedActionExecutor {
+public:
+	CollisionBenchActionExecutor() : ISyncedActionExecutor(
+		"CollisionBench",
+		"Spawns N (default 500) units of the named ground unit-type in a dense blob at the map"
+		" center, moves them for M frames (default 30) with per-unit and with batched unit"
+		" collisions and logs the time taken by each (only the spawned units are updated)",
+		true
+	) {
+	}
+
+	bool Execute(const SyncedAction& action) const final override {
+		const std::vector<std::string>& args = CSimpleParser::Tokenize(action.GetArgs(), 0);
+
+		if (args.empty()) {
+			LOG_L(L_WARNING, "/%s: missing unit-type argument", GetCommand().c_str());
+			return false;
+		}
+
+		const int numUnits = (args.size() > 1)? std::max(1, atoi(args[1].c_str())): 500;
+		const int numFrames = (args.size() > 2)? std::max(1, atoi(args[2].c_str())): 30;
+
+		const UnitDef* unitDef = unitDefHandler->GetUnitDefByName(args[0]);
+
+		if (unitDef == nullptr || !unitDef->IsGroundUnit()) {
+			LOG_L(L_WARNING, "[%s] \"%s\" is not a ground unit-type", __func__, args[0].c_str());
+			return false;
+		}
+
+		unitHandler.BenchmarkCollisions(unitDef, numUnits, numFrames, playerHandler.Player(action.GetPlayerID())->team);
+		return true;
+	}
+};
+
+
+class TargetingBenchActionExecutor : public ISyncedActionExecutor {
+public:
+	TargetingBenchActionExecutor() : ISyncedActionExecutor(
+		"TargetingBench",
+		"Spawns N (default 1500) units of the named armed unit-type in two opposing blobs (for"
+		" the player's team and the first enemy team) within weapon range of each other, runs"
+		" target acquisition for all their weapons for M frames (default 30) with per-weapon and"
+		" with shared candidate sets and logs the microseconds taken per frame by each",
+		true
+	) {
+	}
+
+	bool Execute(const SyncedAction& action) const final override {
+		const std::vector<std::string>& args = CSimpleParser::Tokenize(action.GetArgs(), 0);
+
+		if (args.empty()) {
+			LOG_L(L_WARNING, "/%s: missing unit-type argument", GetCommand().c_str());
+			return false;
+		}
+
+		const int numUnits = (args.size() > 1)? std::max(2, atoi(args[1].c_str())): 1500;
+		const int numFrames = (args.size() > 2)? std::max(1, atoi(args[2].c_str())): 30;
+
+		const UnitDef* unitDef = unitDefHandler->GetUnitDefByName(args[0]);
+
+		if (unitDef == nullptr || unitDef->maxWeaponRange <= 0.0f) {
+			LOG_L(L_WARNING, "[%s] \"%s\" is not an armed unit-type", __func__, args[0].c_str());
+			return false;
+		}
+
+		const int teamNum = playerHandler.Player(action.GetPlayerID())->team;
+		int enemyTeamNum = -1;
+
+		for (int t = 0; t < teamHandler.ActiveTeams(); t++) {
+			if (teamHandler.AlliedTeams(teamNum, t) || t == teamHandler.GaiaTeamID())
+				continue;
+
+			enemyTeamNum = t;
+			break;
+		}
+
+		if (enemyTeamNum == -1) {
+			LOG_L(L_WARNING, "[%s] no enemy team to spawn the opposing units for", __func__);
+			return false;
+		}
+
+		helper->BenchmarkTargeting(unitDef, numUnits, numFrames, teamNum, enemyTeamNum);
+		return true;
+	}
+};
+
+
 class ReloadCegsActionExecutor : public ISyncedActionExecutor {
 public:
 	ReloadCegsActionExecutor() : ISyncedActionExecutor("ReloadCEGs", "Reloads CEG scripts", true) {
@@ -538,7 +738,14 @@ public:
 	}
 
 	bool Execute(const SyncedAction& action) const final override {
-		if (action.GetArgs().find_first_of("start") == 0) {
+		if (action.GetArgs().find("keyframe") == 0) {
+			std::istringstream buf(action.GetArgs().substr(9));
+			int keyframeNum = -1;
+			int targetFrame = 0;
+			buf >> keyframeNum >> targetFrame;
+			game->ReloadDemoFromKeyframe(keyframeNum, targetFrame);
+		}
+		else if (action.GetArgs().find_first_of("start") == 0) {
 			std::istringstream buf(action.GetArgs().substr(6));
 			int targetFrame;
 			buf >> targetFrame;
@@ -575,6 +782,11 @@ void SyncedGameCommands::AddDefaultActionExecutors()
 	AddActionExecutor(AllocActionExecutor<DestroyActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<NoSpectatorChatActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<ReloadCobActionExecutor>());
+	AddActionExecutor(AllocActionExecutor<CobBenchActionExecutor>());
+	AddActionExecutor(AllocActionExecutor<ProjectileBenchActionExecutor>());
+	AddActionExecutor(AllocActionExecutor<PathBenchActionExecutor>());
+	AddActionExecutor(AllocActionExecutor<CollisionBenchActionExecutor>());
+	AddActionExecutor(AllocActionExecutor<TargetingBenchActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<ReloadCegsActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<DevLuaActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<EditDefsActionExecutor>());
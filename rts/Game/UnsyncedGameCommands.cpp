@@ -21,6 +21,7 @@
 #endif
 
 #include "ExternalAI/AILibraryManager.h"
+#include "ExternalAI/EngineOutHandler.h"
 #include "ExternalAI/SkirmishAIHandler.h"
 
 #include "Game/Players/Player.h"
@@ -82,7 +83,11 @@
 
 #include "Sim/MoveTypes/MoveDefHandler.h"
 #include "Sim/Misc/TeamHandler.h"
+#include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/ModInfo.h"
+#include "Sim/Misc/QuadField.h"
+#include "Sim/Misc/SmoothHeightMesh.h"
+#include "Sim/Path/IPathManager.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Units/UnitDef.h"
 #include "Sim/Units/UnitDefHandler.h"
@@ -91,6 +96,7 @@
 
 #include "System/EventHandler.h"
 #include "System/GlobalConfig.h"
+#include "System/MemoryStats.h"
 #include "System/SafeUtil.h"
 #include "System/TimeProfiler.h"
 #include "System/Log/ILog.h"
@@ -2863,6 +2869,22 @@ public:
 	}
 };
 
+class DebugMemoryActionExecutor : public IUnsyncedActionExecutor {
+public:
+	DebugMemoryActionExecutor(): IUnsyncedActionExecutor(
+		"DebugMemory",
+		"Print live, peak and reserved memory, allocation rate and fragmentation per engine subsystem, optionally only those under the given subsystem (e.g. \"Sim/Path\")"
+	) {
+	}
+
+	bool Execute(const UnsyncedAction& action) const final override {
+		// refresh, the last sample can be up to a second old
+		memoryStats.SampleSubsystems();
+		memoryStats.LogStats(action.GetArgs());
+		return true;
+	}
+};
+
 
 
 class CrashActionExecutor : public IUnsyncedActionExecutor {
@@ -3085,7 +3107,7 @@ class DebugInfoActionExecutor : public IUnsyncedActionExecutor {
 public:
 	DebugInfoActionExecutor() : IUnsyncedActionExecutor(
 		"DebugInfo",
-		"Print debug info to the chat/log-file about either sound, profiling, or command-descriptions"
+		"Print debug info to the chat/log-file about either sound, profiling, command-descriptions, quadfield, pathing, losraycast, smoothmeshupdate, or skirmishai"
 	) {
 	}
 
@@ -3102,8 +3124,49 @@ public:
 			case hashString("cmddescrs"): {
 				commandDescriptionCache.Dump(true);
 			} break;
+			case hashString("quadfield"): {
+				const CQuadField::LoadStats& stats = quadField.GetLoadStats();
+
+				LOG("[DbgInfoAction::%s] QuadField: %d elmo quads, %u of %u occupied, load-factor %.2f", __func__, stats.quadSize, unsigned(stats.numOccupiedQuads), unsigned(stats.numQuads), stats.loadFactor);
+				LOG("\tunits: %u entries (max %u per quad)", unsigned(stats.numUnitEntries), unsigned(stats.maxUnits));
+				LOG("\tfeatures: %u entries (max %u per quad)", unsigned(stats.numFeatureEntries), unsigned(stats.maxFeatures));
+				LOG("\tprojectiles: %u entries (max %u per quad)", unsigned(stats.numProjectileEntries), unsigned(stats.maxProjectiles));
+			} break;
+			case hashString("pathing"): {
+				const IPathManager::SearchStats& stats = pathManager->GetSearchStats();
+
+				LOG("[DbgInfoAction::%s] PathManager: %u searches last frame, %.3fms per search, %.0f nodes/sec", __func__, stats.numSearches, stats.searchTime, stats.nodesPerSecond);
+				LOG("\tqueued requests: %u (max %u)", stats.queueDepth, stats.maxQueueDepth);
+			} break;
+			case hashString("losraycast"): {
+				// radii 16, 32 and 64 (in LOS-map squares) on the local ally-team's map
+				losHandler->los.losMaps[gu->myAllyTeam].BenchmarkRaycast(16, 64, 1000);
+			} break;
+			case hashString("smoothmeshupdate"): {
+				// 1000 craters, 8 heightmap squares in radius; the heightmap is
+				// temporarily deformed, so async AI's must not be reading it
+				eoh->WaitForEventBatches();
+				smoothGround.BenchmarkRegionUpdates(1000, 8);
+			} break;
+			case hashString("skirmishai"): {
+				for (const uint8_t aiID: eoh->GetActiveSkirmishAIs()) {
+					CSkirmishAIWrapper& ai = eoh->GetSkirmishAI(aiID);
+
+					if (!ai.Async()) {
+						LOG("[DbgInfoAction::%s] SkirmishAI %u (team %d): synchronous", __func__, aiID, ai.GetTeamId());
+						continue;
+					}
+
+					const CSkirmishAIWrapper::AsyncStats stats = ai.GetAsyncStats();
+
+					LOG("[DbgInfoAction::%s] SkirmishAI %u (team %d): %u batches, %.3fms last, %.3fms avg, %.3fms max", __func__, aiID, ai.GetTeamId(), stats.numBatches, stats.lastBatchTime, stats.avgBatchTime, stats.maxBatchTime);
+					LOG("\tevents per batch: %u (max %u)", stats.lastBatchSize, stats.maxBatchSize);
+					LOG("\tsim blocked: %.3fms total over %u waits (max %.3fms)", stats.sumStallTime, stats.numStalls, stats.maxStallTime);
+					LOG("\tcommands run on the sim thread: %u", stats.numSimThreadCalls);
+				}
+			} break;
 			default: {
-				LOG_L(L_WARNING, "[DbgInfoAction::%s] unknown argument \"%s\" (use \"sound\", \"profiling\", or \"cmddescrs\")", __func__, args.c_str());
+				LOG_L(L_WARNING, "[DbgInfoAction::%s] unknown argument \"%s\" (use \"sound\", \"profiling\", \"cmddescrs\", \"quadfield\", \"pathing\", \"losraycast\", \"smoothmeshupdate\", or \"skirmishai\")", __func__, args.c_str());
 			} break;
 		}
 
@@ -3363,6 +3426,7 @@ void UnsyncedGameCommands::AddDefaultActionExecutors()
 	AddActionExecutor(AllocActionExecutor<DebugColVolDrawerActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<DebugPathDrawerActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<DebugTraceRayDrawerActionExecutor>());
+	AddActionExecutor(AllocActionExecutor<DebugMemoryActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<MuteActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<SoundActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<SoundChannelEnableActionExecutor>());
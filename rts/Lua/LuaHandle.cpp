@@ -35,6 +35,7 @@
 #include "System/EventHandler.h"
 #include "System/Exceptions.h"
 #include "System/GlobalConfig.h"
+#include "System/MemoryStats.h"
 #include "System/Rectangle.h"
 #include "System/ScopedFPUSettings.h"
 #include "System/StringUtil.h"
@@ -85,6 +86,10 @@ static void LUA_ERASE_CONTEXT(const luaContextData* D, const spring::unsynced_se
 	const_cast<  spring::unsynced_set<const luaContextData*>*  >(S)->erase(D);
 }
 
+static std::string LUA_MEMSTATS_NAME(const CLuaHandle* H) {
+	return (std::string(H->GetSynced()? "Lua/Synced/": "Lua/Unsynced/") + H->GetName());
+}
+
 static int handlepanic(lua_State* L)
 {
 	throw content_error(luaL_optsstring(L, 1, "lua paniced"));
@@ -113,6 +118,11 @@ CLuaHandle::CLuaHandle(const string& _name, int _order, bool _userMode, bool _sy
 
 	LUA_INSERT_CONTEXT(&D, LUAHANDLE_CONTEXTS[D.synced]);
 
+	memoryStats.AddSubsystem(LUA_MEMSTATS_NAME(this), [this](CMemoryStats::Sample& s) {
+		s.liveBytes += D.allocState.allocedBytes.load();
+		s.numAllocs += D.allocState.numLuaAllocs.load();
+	});
+
 	luaL_ref(L, LUA_REGISTRYINDEX);
 
 	// needed for engine traceback
@@ -153,6 +163,8 @@ void CLuaHandle::KillLua(bool inFreeHandler)
 	// false and FreeHandler runs next
 	LUA_ERASE_CONTEXT(&D, LUAHANDLE_CONTEXTS[D.synced]);
 	LUA_CLOSE(&L);
+
+	memoryStats.RemoveSubsystem(LUA_MEMSTATS_NAME(this));
 }
 
 
@@ -2613,6 +2625,8 @@ bool CLuaHandle::AddBasicCalls(lua_State* L)
 		HSTR_PUSH_CFUNC(L, "GetGlobal",       CallOutGetGlobal);
 		HSTR_PUSH_CFUNC(L, "GetRegistry",     CallOutGetRegistry);
 		HSTR_PUSH_CFUNC(L, "GetCallInList",   CallOutGetCallInList);
+		HSTR_PUSH_CFUNC(L, "SetCallInFilter", CallOutSetCallInFilter);
+		HSTR_PUSH_CFUNC(L, "GetCallInFilterStats", CallOutGetCallInFilterStats);
 		HSTR_PUSH_CFUNC(L, "IsEngineMinVersion", CallOutIsEngineMinVersion);
 		// special team constants
 		HSTR_PUSH_NUMBER(L, "NO_ACCESS_TEAM",  CEventClient::NoAccessTeam);
@@ -2743,5 +2757,67 @@ int CLuaHandle::CallOutUpdateCallIn(lua_State* L)
 }
 
 
+int CLuaHandle::CallOutSetCallInFilter(lua_State* L)
+{
+	const CEventClient::FilteredEvent event = CEventClient::GetFilteredEvent(luaL_checkstring(L, 1));
+
+	if (event == CEventClient::FILTER_EVENT_COUNT) {
+		lua_pushboolean(L, false);
+		return 1;
+	}
+
+	CEventClient::CallInFilter& filter = GetHandle(L)->GetCallInFilter(event);
+	filter.Clear();
+
+	// no table removes the filter
+	if (lua_isnoneornil(L, 2)) {
+		lua_pushboolean(L, true);
+		return 1;
+	}
+
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+	// indexed by CallInFilter::KEY_*
+	constexpr const char* keyNames[CEventClient::CallInFilter::KEY_COUNT] = {"unitDefs", "weaponDefs", "teams", "allyTeams"};
+
+	for (unsigned int key = 0; key < CEventClient::CallInFilter::KEY_COUNT; key++) {
+		lua_getfield(L, 2, keyNames[key]);
+
+		if (lua_istable(L, -1)) {
+			filter.RestrictKey(key);
+
+			for (lua_pushnil(L); lua_next(L, -2) != 0; lua_pop(L, 1)) {
+				if (!lua_isnumber(L, -1))
+					continue;
+
+				filter.AddValue(key, lua_toint(L, -1));
+			}
+		}
+
+		lua_pop(L, 1);
+	}
+
+	filter.SetActive(true);
+	lua_pushboolean(L, true);
+	return 1;
+}
+
+
+int CLuaHandle::CallOutGetCallInFilterStats(lua_State* L)
+{
+	const CEventClient::FilteredEvent event = CEventClient::GetFilteredEvent(luaL_checkstring(L, 1));
+
+	if (event == CEventClient::FILTER_EVENT_COUNT)
+		return 0;
+
+	const CEventClient::CallInFilter& filter = GetHandle(L)->GetCallInFilter(event);
+
+	lua_pushboolean(L, filter.IsActive());
+	lua_pushnumber(L, filter.GetNumDelivered());
+	lua_pushnumber(L, filter.GetNumSkipped());
+	return 3;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
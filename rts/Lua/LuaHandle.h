@@ -333,6 +333,8 @@ class CLuaHandle : public CEventClient
 		static int CallOutGetRegistry(lua_State* L);
 		static int CallOutGetCallInList(lua_State* L);
 		static int CallOutUpdateCallIn(lua_State* L);
+		static int CallOutSetCallInFilter(lua_State* L);
+		static int CallOutGetCallInFilterStats(lua_State* L);
 		static int CallOutIsEngineMinVersion(lua_State* L);
 
 	public: // static
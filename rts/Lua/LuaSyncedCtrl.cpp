@@ -484,6 +484,7 @@ static int SetSolidObjectCollisionVolumeData(lua_State* L, CSolidObject* o)
 	if (o == nullptr)
 		return 0;
 
+	o->MarkChanged();
 	return LuaUtils::ParseColVolData(L, 2, &o->collisionVolume);
 }
 
@@ -2407,6 +2408,7 @@ int LuaSyncedCtrl::SetUnitRadiusAndHeight(lua_State* L)
 	}
 
 	unit->SetRadiusAndHeight(newRadius, newHeight);
+	unit->MarkChanged();
 
 	if (updateQuads) {
 		quadField.MovedUnit(unit);
@@ -3208,6 +3210,7 @@ int LuaSyncedCtrl::SetFeatureRadiusAndHeight(lua_State* L)
 	}
 
 	feature->SetRadiusAndHeight(newRadius, newHeight);
+	feature->MarkChanged();
 
 	if (updateQuads) {
 		quadField.AddFeature(feature);
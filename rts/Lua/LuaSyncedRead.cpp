@@ -128,6 +128,8 @@ bool LuaSyncedRead::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetTidal);
 	REGISTER_LUA_CFUNC(GetWind);
 
+	REGISTER_LUA_CFUNC(GetQuadFieldStats);
+
 	REGISTER_LUA_CFUNC(GetHeadingFromVector);
 	REGISTER_LUA_CFUNC(GetVectorFromHeading);
 
@@ -922,6 +924,25 @@ int LuaSyncedRead::GetWind(lua_State* L)
 }
 
 
+int LuaSyncedRead::GetQuadFieldStats(lua_State* L)
+{
+	const CQuadField::LoadStats& stats = quadField.GetLoadStats();
+
+	lua_createtable(L, 0, 10);
+	LuaPushNamedNumber(L, "quadSize",             stats.quadSize);
+	LuaPushNamedNumber(L, "numQuads",             stats.numQuads);
+	LuaPushNamedNumber(L, "numOccupiedQuads",     stats.numOccupiedQuads);
+	LuaPushNamedNumber(L, "numUnitEntries",       stats.numUnitEntries);
+	LuaPushNamedNumber(L, "numFeatureEntries",    stats.numFeatureEntries);
+	LuaPushNamedNumber(L, "numProjectileEntries", stats.numProjectileEntries);
+	LuaPushNamedNumber(L, "maxUnits",             stats.maxUnits);
+	LuaPushNamedNumber(L, "maxFeatures",          stats.maxFeatures);
+	LuaPushNamedNumber(L, "maxProjectiles",       stats.maxProjectiles);
+	LuaPushNamedNumber(L, "loadFactor",           stats.loadFactor);
+	return 1;
+}
+
+
 /******************************************************************************/
 
 int LuaSyncedRead::GetGameRulesParams(lua_State* L)
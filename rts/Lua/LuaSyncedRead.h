@@ -41,6 +41,8 @@ class LuaSyncedRead {
 		static int GetTidal(lua_State* L);
 		static int GetWind(lua_State* L);
 
+		static int GetQuadFieldStats(lua_State* L);
+
 		static int GetHeadingFromVector(lua_State* L);
 		static int GetVectorFromHeading(lua_State* L);
 
@@ -56,6 +56,7 @@
 #include "Game/UI/Groups/Group.h"
 #include "Game/UI/Groups/GroupHandler.h"
 #include "Net/Protocol/NetProtocol.h" // NETMSG_*
+#include "System/MemoryStats.h"
 #include "System/TimeProfiler.h"
 #include "System/Config/ConfigHandler.h"
 #include "System/Config/ConfigVariable.h"
@@ -94,6 +95,7 @@ bool LuaUnsyncedRead::PushEntries(lua_State* L)
 
 	REGISTER_LUA_CFUNC(GetLuaMemUsage);
 	REGISTER_LUA_CFUNC(GetVidMemUsage);
+	REGISTER_LUA_CFUNC(GetMemoryStats);
 
 	REGISTER_LUA_CFUNC(GetDrawFrame);
 	REGISTER_LUA_CFUNC(GetFrameTimeOffset);
@@ -454,6 +456,34 @@ int LuaUnsyncedRead::GetVidMemUsage(lua_State* L)
 	return 2;
 }
 
+int LuaUnsyncedRead::GetMemoryStats(lua_State* L)
+{
+	// optional subsystem prefix, e.g. "Sim" or "Lua/Synced"
+	const std::string prefix = luaL_optsstring(L, 1, "");
+	const std::vector<CMemoryStats::Stats>& stats = memoryStats.GetStats();
+
+	lua_createtable(L, stats.size(), 0);
+
+	int count = 0;
+
+	for (const CMemoryStats::Stats& node: stats) {
+		if (node.name.compare(0, prefix.size(), prefix) != 0)
+			continue;
+
+		lua_createtable(L, 0, 6);
+		HSTR_PUSH_STRING(L, "name", node.name);
+		// (kilo)bytes, can exceed 1<<24 otherwise
+		HSTR_PUSH_NUMBER(L, "live", node.liveBytes / 1024.0f);
+		HSTR_PUSH_NUMBER(L, "peak", node.peakBytes / 1024.0f);
+		HSTR_PUSH_NUMBER(L, "reserved", node.resvBytes / 1024.0f);
+		HSTR_PUSH_NUMBER(L, "allocRate", node.allocRate);
+		HSTR_PUSH_NUMBER(L, "fragmentation", node.fragmentation);
+		lua_rawseti(L, -2, ++count);
+	}
+
+	return 1;
+}
+
 
 /******************************************************************************/
 
@@ -843,6 +873,9 @@ public:
 		objectLists.clear();
 		objectLists.reserve(64);
 
+		visitedQuads.clear();
+		visitedQuads.resize(quadField.GetNumQuadsX() * quadField.GetNumQuadsZ(), false);
+
 		objectCount = 0;
 	}
 
@@ -851,6 +884,16 @@ public:
 
 	const ObjectVector& GetObjectLists() { return objectLists; }
 
+	template<typename F> void AddQuadObjectLists(int x, int y, F&& getQuadObjects) {
+		quadField.ForEachGridCellQuad(x, y, [&](int quadIdx) {
+			if (visitedQuads[quadIdx])
+				return;
+
+			visitedQuads[quadIdx] = true;
+			AddObjectList(getQuadObjects(quadField.GetQuad(quadIdx)));
+		});
+	}
+
 	void AddObjectList(const ObjectList* objects) {
 		if (objects->empty())
 			return;
@@ -863,6 +906,8 @@ protected:
 	// note: stores pointers to lists, not copies
 	// its size equals the number of visible quads
 	ObjectVector objectLists;
+	// neighboring grid-cells can overlap the same quad
+	std::vector<bool> visitedQuads;
 
 	unsigned int objectCount;
 };
@@ -871,30 +916,21 @@ protected:
 class CVisUnitQuadDrawer: public CWorldObjectQuadDrawer<CUnit> {
 public:
 	void DrawQuad(int x, int y) override {
-		const CQuadField::Quad& q = quadField.GetQuadAt(x, y);
-		const ObjectList* o = &q.units;
-
-		AddObjectList(o);
+		AddQuadObjectLists(x, y, [](const CQuadField::Quad& q) { return &q.units; });
 	}
 };
 
 class CVisFeatureQuadDrawer: public CWorldObjectQuadDrawer<CFeature> {
 public:
 	void DrawQuad(int x, int y) override {
-		const CQuadField::Quad& q = quadField.GetQuadAt(x, y);
-		const ObjectList* o = &q.features;
-
-		AddObjectList(o);
+		AddQuadObjectLists(x, y, [](const CQuadField::Quad& q) { return &q.features; });
 	}
 };
 
 class CVisProjectileQuadDrawer: public CWorldObjectQuadDrawer<CProjectile> {
 public:
 	void DrawQuad(int x, int y) override {
-		const CQuadField::Quad& q = quadField.GetQuadAt(x, y);
-		const ObjectList* o = &q.projectiles;
-
-		AddObjectList(o);
+		AddQuadObjectLists(x, y, [](const CQuadField::Quad& q) { return &q.projectiles; });
 	}
 };
 
@@ -944,7 +980,7 @@ int LuaUnsyncedRead::GetVisibleUnits(lua_State* L)
 	static CVisUnitQuadDrawer unitQuadIter;
 
 	unitQuadIter.ResetState();
-	readMap->GridVisibility(nullptr, &unitQuadIter, 1e9, CQuadField::BASE_QUAD_SIZE / SQUARE_SIZE);
+	readMap->GridVisibility(nullptr, &unitQuadIter, 1e9, quadField.GetGridCellSize());
 
 	// Even though we're in unsynced it's ok to use gs->tempNum since its exact value
 	// doesn't matter
@@ -1023,7 +1059,7 @@ int LuaUnsyncedRead::GetVisibleFeatures(lua_State* L)
 	static CVisFeatureQuadDrawer featureQuadIter;
 
 	featureQuadIter.ResetState();
-	readMap->GridVisibility(nullptr, &featureQuadIter, 1e9, CQuadField::BASE_QUAD_SIZE / SQUARE_SIZE);
+	readMap->GridVisibility(nullptr, &featureQuadIter, 1e9, quadField.GetGridCellSize());
 
 	// Even though we're in unsynced it's ok to use gs->tempNum since its exact value
 	// doesn't matter
@@ -1086,7 +1122,7 @@ int LuaUnsyncedRead::GetVisibleProjectiles(lua_State* L)
 
 
 	projQuadIter.ResetState();
-	readMap->GridVisibility(nullptr, &projQuadIter, 1e9, CQuadField::BASE_QUAD_SIZE / SQUARE_SIZE);
+	readMap->GridVisibility(nullptr, &projQuadIter, 1e9, quadField.GetGridCellSize());
 
 	// Even though we're in unsynced it's ok to use gs->tempNum since its exact value
 	// doesn't matter
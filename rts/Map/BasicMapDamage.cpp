@@ -51,6 +51,8 @@ void CBasicMapDamage::Init()
 	explosionSquaresPool.resize(4 * 1024 * 1024);
 	explosionUpdateQueue.clear();
 	explosionUpdateQueue.reserve(64);
+	recalcAreas.clear();
+	recalcAreas.reserve(64);
 
 	std::fill(explosionSquaresPool.begin(), explosionSquaresPool.end(), 0.0f);
 }
@@ -227,6 +229,47 @@ void CBasicMapDamage::RecalcArea(int x1, int x2, int y1, int y2)
 }
 
 
+void CBasicMapDamage::RecalcMergedAreas()
+{
+	const auto GetArea = [](const SRectangle& r) { return ((r.x2 - r.x1 + 1) * (r.z2 - r.z1 + 1)); };
+
+	// merge every pair whose bounding rectangle is not larger than both
+	// of them combined (i.e. mostly overlapping or adjacent craters) so
+	// no square gets recalculated more often than before, and repeat
+	// until nothing changes; the result depends only on queue order
+	for (bool merged = true; merged; ) {
+		merged = false;
+
+		for (size_t i = 0; i < recalcAreas.size(); i++) {
+			for (size_t j = i + 1; j < recalcAreas.size(); ) {
+				const SRectangle& r1 = recalcAreas[i];
+				const SRectangle& r2 = recalcAreas[j];
+				const SRectangle br = {
+					std::min(r1.x1, r2.x1), std::min(r1.z1, r2.z1),
+					std::max(r1.x2, r2.x2), std::max(r1.z2, r2.z2)
+				};
+
+				if (GetArea(br) > (GetArea(r1) + GetArea(r2))) {
+					j++;
+					continue;
+				}
+
+				recalcAreas[i] = br;
+				recalcAreas.erase(recalcAreas.begin() + j);
+
+				merged = true;
+			}
+		}
+	}
+
+	for (const SRectangle& r: recalcAreas) {
+		RecalcArea(r.x1, r.x2, r.z1, r.z2);
+	}
+
+	recalcAreas.clear();
+}
+
+
 void CBasicMapDamage::Update()
 {
 	SCOPED_TIMER("Sim::BasicMapDamage");
@@ -266,9 +309,12 @@ void CBasicMapDamage::Update()
 		if (e.ttl != 0)
 			continue;
 
-		RecalcArea(e.x1 - 1, e.x2 + 1, e.y1 - 1, e.y2 + 1);
+		recalcAreas.emplace_back(e.x1 - 1, e.y1 - 1, e.x2 + 1, e.y2 + 1);
 	}
 
+	// one recalculation per merged area, after all heights were changed
+	RecalcMergedAreas();
+
 
 	// pop explosions that are no longer being processed
 	while (explUpdateQueueIdx < explosionUpdateQueue.size()) {
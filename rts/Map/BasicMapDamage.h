@@ -4,6 +4,7 @@
 #define _BASIC_MAP_DAMAGE_H
 
 #include "MapDamage.h"
+#include "System/Rectangle.h"
 
 #include <vector>
 
@@ -28,6 +29,8 @@ private:
 		explSquaresPoolIdx %= explosionSquaresPool.size();
 	}
 
+	void RecalcMergedAreas();
+
 	struct ExploBuilding {
 		/**
 		 * Searching for building pointers inside these on DependentDied
@@ -60,6 +63,8 @@ private:
 
 	std::vector<float> explosionSquaresPool;
 	std::vector<Explo> explosionUpdateQueue;
+	/// areas of explosions that expired this frame, recalculated together at its end
+	std::vector<SRectangle> recalcAreas;
 
 	static constexpr unsigned int CRATER_TABLE_SIZE = 200;
 	static constexpr unsigned int EXPLOSION_LIFETIME = 10;
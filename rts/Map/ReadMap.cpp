@@ -5,12 +5,12 @@
 #include <cstring> // memcpy
 
 #include "ReadMap.h"
-#include "MapDamage.h"
 #include "MapInfo.h"
 #include "MetalMap.h"
 #include "Rendering/Env/MapRendering.h"
 #include "SMF/SMFReadMap.h"
 #include "Game/LoadScreen.h"
+#include "Sim/Misc/SmoothHeightMesh.h"
 #include "System/bitops.h"
 #include "System/EventHandler.h"
 #include "System/Exceptions.h"
@@ -58,7 +58,7 @@ CR_REG_METADATA(MapDimensions, (
 CR_BIND_INTERFACE(CReadMap)
 CR_REG_METADATA(CReadMap, (
 	CR_IGNORED(initHeightBounds),
-	CR_IGNORED(currHeightBounds),
+	CR_MEMBER(currHeightBounds),
 	CR_IGNORED(boundingRadius),
 	CR_IGNORED(mapChecksum),
 
@@ -223,7 +223,8 @@ void CReadMap::Serialize(creg::ISerializer* s)
 			itm[i] = type ^ iotm[i];
 		}
 
-		mapDamage->RecalcArea(2, mapDims.mapx - 3, 2, mapDims.mapy - 3);
+		// the maps derived from the heightmap are rebuilt once everything
+		// else (LOS, pathing) has been loaded, see CCregLoadSaveHandler
 	}
 
 }
@@ -250,18 +251,35 @@ void CReadMap::PostLoad()
 	sharedSlopeMaps[0] = &slopeMap[0]; // NO UNSYNCED VARIANT
 	sharedSlopeMaps[1] = &slopeMap[0];
 
-	//FIXME reconstruct
-	/*
-	mipPointerHeightMaps.fill(nullptr);
-	mipPointerHeightMaps[0] = &centerHeightMap[0];
-	for (int i = 1; i < numHeightMipMaps; i++) {
-		mipPointerHeightMaps[i] = &mipCenterHeightMaps[i - 1][0];
-	}
-	*/
+	// mipPointerHeightMaps still point into the static mip-maps set up by
+	// Initialize, CCregLoadSaveHandler::LoadGame rebuilds their contents
 }
 #endif //USING_CREG
 
 
+SRectangle CReadMap::GetDamagedHeightMapRect() const
+{
+	const float* curHeightMap = GetCornerHeightMapSynced();
+	const float* orgHeightMap = GetOriginalHeightMapSynced();
+
+	SRectangle rect = {mapDims.mapxp1, mapDims.mapyp1, -1, -1};
+
+	for (int z = 0; z < mapDims.mapyp1; z++) {
+		for (int x = 0; x < mapDims.mapxp1; x++) {
+			if (curHeightMap[z * mapDims.mapxp1 + x] == orgHeightMap[z * mapDims.mapxp1 + x])
+				continue;
+
+			rect.x1 = std::min(rect.x1, x);
+			rect.z1 = std::min(rect.z1, z);
+			rect.x2 = std::max(rect.x2, x);
+			rect.z2 = std::max(rect.z2, z);
+		}
+	}
+
+	return rect;
+}
+
+
 CReadMap::~CReadMap()
 {
 	metalMap.Kill();
@@ -506,6 +524,10 @@ void CReadMap::UpdateHeightMapSynced(const SRectangle& hgtMapRect, bool initiali
 	UpdateFaceNormals(centerRect, initialize);
 	UpdateSlopemap(centerRect, initialize); // must happen after UpdateFaceNormals()!
 
+	// the smoothed mesh is built after the map has been loaded
+	if (!initialize)
+		smoothGround.UpdateSmoothMesh(hgtMapRect);
+
 	#ifdef USE_UNSYNCED_HEIGHTMAP
 	// push the unsynced update; initial one without LOS check
 	if (initialize) {
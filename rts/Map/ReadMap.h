@@ -95,6 +95,8 @@ public:
 	 * such as normals, centerheightmap and slopemap
 	 */
 	void UpdateHeightMapSynced(const SRectangle& hgtMapRect, bool initialize = false);
+	/// bounding rectangle (inclusive) of the squares differing from the original heightmap, x2 < x1 if none
+	SRectangle GetDamagedHeightMapRect() const;
 	void UpdateLOS(const SRectangle& hgtMapRect);
 	void BecomeSpectator();
 	void UpdateDraw(bool firstCall);
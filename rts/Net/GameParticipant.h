@@ -42,6 +42,8 @@ public:
 	bool isLocal = false;
 	bool isReconn = false;
 	bool isMidgameJoin = false;
+	/// absolute packet-cache index of the NETMSG_CREATE_NEWPLAYER announcing a mid-game join
+	size_t joinCacheIndex = 0;
 
 	PlayerStatistics lastStats;
 
@@ -51,6 +51,7 @@
 #include "System/Net/Connection.h"
 #include "System/Net/LocalConnection.h"
 #include "System/Net/UnpackPacket.h"
+#include "System/LoadSave/DemoIndex.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/LoadSave/DemoReader.h"
 #include "System/Log/ILog.h"
@@ -69,6 +70,7 @@ using netcode::RawPacket;
 
 CONFIG(int, AutohostPort).defaultValue(0);
 CONFIG(int, ServerSleepTime).defaultValue(5).description("number of milliseconds to sleep per tick");
+CONFIG(bool, ServerEventDrivenLoop).defaultValue(false).description("Wake the server thread as soon as network data arrives or a new frame is due, instead of sleeping ServerSleepTime milliseconds per tick. Only used if all clients connect over UDP.");
 CONFIG(int, SpeedControl).defaultValue(1).minimumValue(1).maximumValue(2)
 	.description("Sets how server adjusts speed according to player's load (CPU), 1: use average, 2: use highest");
 CONFIG(bool, AllowSpectatorJoin).defaultValue(true).dedicatedValue(false).description("allow any unauthenticated clients to join as spectator with any name, name will be prefixed with ~");
@@ -76,6 +78,7 @@ CONFIG(bool, WhiteListAdditionalPlayers).defaultValue(true);
 CONFIG(bool, ServerRecordDemos).defaultValue(false).dedicatedValue(true);
 CONFIG(bool, ServerLogInfoMessages).defaultValue(false);
 CONFIG(bool, ServerLogDebugMessages).defaultValue(false);
+CONFIG(int, GameStateSnapshotInterval).defaultValue(0).minimumValue(0).description("Minutes between game-state snapshots taken by one of the clients; late-joining and reconnecting clients load the latest snapshot instead of re-simulating the entire game. 0 disables.");
 CONFIG(std::string, AutohostIP).defaultValue("127.0.0.1");
 
 
@@ -111,6 +114,11 @@ static constexpr unsigned gameProgressFrameInterval = GAME_SPEED * 10;
 
 static constexpr unsigned syncResponseEchoInterval = GAME_SPEED * 2;
 
+/// upper bound on (compressed) game-state snapshots accepted from clients
+static constexpr unsigned gameStateSnapshotMaxSize = 256 << 20;
+/// payload bytes per NETMSG_GAMESTATE packet
+static constexpr unsigned gameStateSnapshotChunkSize = 60000;
+
 
 //FIXME remodularize server commands, so they get registered in word completion etc.
 decltype(CGameServer::commandBlacklist) CGameServer::commandBlacklist{
@@ -121,7 +129,7 @@ decltype(CGameServer::commandBlacklist) CGameServer::commandBlacklist{
 	"nopause", "nohelp", "cheat", "godmode", "globallos",
 	"nocost", "forcestart", "nospectatorchat", "nospecdraw",
 	"skip", "reloadcob", "reloadcegs", "devlua", "editdefs",
-	"singlestep", "spec", "specbynum"
+	"singlestep", "spec", "specbynum", "netlatency"
 };
 
 
@@ -164,6 +172,8 @@ void CGameServer::Initialize()
 	whiteListAdditionalPlayers = configHandler->GetBool("WhiteListAdditionalPlayers");
 	logInfoMessages = configHandler->GetBool("ServerLogInfoMessages");
 	logDebugMessages = configHandler->GetBool("ServerLogDebugMessages");
+	eventDrivenLoop = configHandler->GetBool("ServerEventDrivenLoop");
+	snapshotInterval = configHandler->GetInt("GameStateSnapshotInterval") * 60 * GAME_SPEED;
 
 	rng.Seed((myGameData->GetSetupText()).length());
 
@@ -278,7 +288,12 @@ void CGameServer::Initialize()
 void CGameServer::PostLoad(int newServerFrameNum)
 {
 	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
-	serverFrameNum = newServerFrameNum;
+
+	if (demoReader != nullptr) {
+		ResumeDemoFromKeyframe(newServerFrameNum);
+	} else {
+		serverFrameNum = newServerFrameNum;
+	}
 
 	gameHasStarted = !PreSimFrame();
 
@@ -286,6 +301,9 @@ void CGameServer::PostLoad(int newServerFrameNum)
 	for (GameParticipant& p: players) {
 		p.lastFrameResponse = newServerFrameNum;
 	}
+
+	if (demoReader != nullptr && myClientSetup->demoSkipFrame > serverFrameNum)
+		SkipTo(myClientSetup->demoSkipFrame);
 }
 
 
@@ -431,6 +449,50 @@ void CGameServer::SkipTo(int targetFrameNum)
 	isPaused = wasPaused;
 }
 
+bool CGameServer::SkipToDemoKeyframe(int targetFrameNum)
+{
+	// reloading only pays off if it saves at least a minute of re-simulation
+	constexpr int minFrameGain = GAME_SPEED * 60;
+
+	if (!gameHasStarted) { return false; }
+	if (demoReader == nullptr) { return false; }
+	if (!HasLocalClient()) { return false; }
+
+	CDemoIndex demoIndex;
+
+	const CDemoIndex::Keyframe* keyframe = nullptr;
+
+	if (demoIndex.Load(myGameSetup->demoName) && demoIndex.MatchesDemo(demoReader->GetFileHeader()))
+		keyframe = demoIndex.FindKeyframe(targetFrameNum);
+
+	const int keyframeNum = (keyframe != nullptr)? keyframe->frameNum: -1;
+
+	if (targetFrameNum >= serverFrameNum && keyframeNum < (serverFrameNum + minFrameGain))
+		return false;
+
+	// without a usable keyframe a backward skip replays from the start
+	CommandMessage msg(spring::format("skip keyframe %d %d", keyframeNum, targetFrameNum), SERVER_PLAYER);
+	Broadcast(std::shared_ptr<const netcode::RawPacket>(msg.Pack()));
+	return true;
+}
+
+void CGameServer::ResumeDemoFromKeyframe(int keyframeNum)
+{
+	Message(spring::format("Resuming demo from keyframe at frame %d", keyframeNum), false);
+
+	demoKeyframeNum = keyframeNum;
+
+	// same as SkipTo, minus the relaying
+	while (serverFrameNum < demoKeyframeNum && SendDemoData(demoKeyframeNum)) {
+		modGameTime = demoReader->GetModGameTime() + 0.001f;
+	}
+
+	if (serverFrameNum != demoKeyframeNum)
+		Message(spring::format("Warning: demo ended before keyframe (frame %d of %d)", serverFrameNum, demoKeyframeNum));
+
+	lastUpdate = spring_gettime();
+}
+
 std::string CGameServer::GetPlayerNames(const std::vector<int>& indices) const
 {
 	std::string playerstring;
@@ -463,6 +525,13 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 
 		const unsigned msgCode = buf->data[0];
 
+		// the loaded keyframe already contains everything up to its frame
+		// (except for our own bookkeeping of players joining the demo-game)
+		if (serverFrameNum < demoKeyframeNum && msgCode != NETMSG_CREATE_NEWPLAYER) {
+			serverFrameNum += (msgCode == NETMSG_NEWFRAME || msgCode == NETMSG_KEYFRAME);
+			continue;
+		}
+
 		switch (msgCode) {
 			case NETMSG_NEWFRAME:
 			case NETMSG_KEYFRAME: {
@@ -497,6 +566,9 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 					continue;
 				}
 
+				if (serverFrameNum < demoKeyframeNum)
+					continue;
+
 				Broadcast(rpkt);
 				break;
 			}
@@ -504,7 +576,8 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 			case NETMSG_GAMEDATA:
 			case NETMSG_SETPLAYERNUM:
 			case NETMSG_USER_SPEED:
-			case NETMSG_INTERNAL_SPEED: {
+			case NETMSG_INTERNAL_SPEED:
+			case NETMSG_GAMESTATE_REQUEST: {
 				// never send these from demos
 				break;
 			}
@@ -1803,6 +1876,11 @@ void CGameServer::ProcessPacket(const unsigned playerNum, std::shared_ptr<const
 			break;
 		}
 
+		case NETMSG_GAMESTATE: {
+			RecvGameStateSnapshot(a, packet);
+			break;
+		}
+
 #ifdef SYNCDEBUG
 		case NETMSG_SD_CHKRESPONSE:
 		case NETMSG_SD_BLKRESPONSE:
@@ -2155,6 +2233,11 @@ void CGameServer::StartGame(bool forced)
 		// the client told us to start a demo
 		// no need to send startPos and startplaying since its in the demo
 		Message(DemoStart);
+
+		// set when reloading to skip backwards without a keyframe
+		if (myClientSetup->demoSkipFrame > 0)
+			SkipTo(myClientSetup->demoSkipFrame);
+
 		return;
 	}
 
@@ -2429,8 +2512,12 @@ void CGameServer::PushAction(const Action& action, bool fromAutoHost)
 			const int amount = atoi(timeStr.c_str());
 			// the absolute frame to skip to
 			const int endFrame = skipFrames? amount: (GAME_SPEED * amount);
+			const int targetFrame = endFrame + (serverFrameNum * skipRelative);
 
-			SkipTo(endFrame + (serverFrameNum * skipRelative));
+			if (SkipToDemoKeyframe(targetFrame))
+				return;
+
+			SkipTo(targetFrame);
 		} break;
 
 		case hashString("cheat"): {
@@ -2497,6 +2584,18 @@ void CGameServer::PushAction(const Action& action, bool fromAutoHost)
 			}
 		} break;
 
+		case hashString("netlatency"): {
+			if (udpListener == nullptr)
+				break;
+
+			if (action.extra == "reset") {
+				udpListener->GetRelayLatency().Reset();
+				return;
+			}
+
+			Message(spring::format("[%s] relay latency (%s loop): %s", __func__, ((eventDrivenLoop && !HasLocalClient())? "event-driven": "polling"), udpListener->GetRelayLatency().ToString().c_str()));
+		} break;
+
 		case hashString("kill"): {
 			LOG("Server killed!");
 			quitServer = true;
@@ -2623,6 +2722,9 @@ void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 		for (unsigned int i = 0; i < numNewFrames; ++i) {
 			++serverFrameNum;
 
+			if (snapshotInterval > 0 && serverFrameNum > 0 && (serverFrameNum % snapshotInterval) == 0)
+				RequestGameStateSnapshot();
+
 			// Send out new frame messages.
 			if ((serverFrameNum % serverKeyframeInterval) == 0) {
 				Broadcast(CBaseNetProtocol::Get().SendKeyFrame(serverFrameNum));
@@ -2630,6 +2732,10 @@ void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 				Broadcast(CBaseNetProtocol::Get().SendNewFrame());
 			}
 
+			// anything broadcast after this frame is not part of the snapshot
+			if (pendingSnapshot.frameNum == serverFrameNum)
+				pendingSnapshot.cacheIndex = packetCacheBase + packetCache.size();
+
 			// every gameProgressFrameInterval, we broadcast current frame in a
 			// special message (that doesn't get cached and skips normal queue)
 			// to let players know their loading %
@@ -2677,16 +2783,32 @@ void CGameServer::UpdateLoop()
 		Threading::SetAffinity(~0);
 
 		while (!quitServer) {
-			spring_msecs(loopSleepTime).sleep(true);
+			// a local client's packets can not wake up the listener, keep polling for those
+			const bool waitForEvents = (eventDrivenLoop && udpListener != nullptr && !HasLocalClient());
+
+			if (waitForEvents) {
+				udpListener->Wait(GetFrameWaitTime());
+			} else {
+				spring_msecs(loopSleepTime).sleep(true);
+			}
 
 			if (udpListener != nullptr)
 				udpListener->Update();
 
-			std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
-			ServerReadNet();
-			Update();
+			{
+				std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+				ServerReadNet();
+				Update();
+			}
+
+			// do not hold relayed packets back until the next wake-up
+			if (waitForEvents)
+				udpListener->FlushConnections();
 		}
 
+		if (udpListener != nullptr)
+			LOG("[GameServer::%s] relay latency: %s", __func__, udpListener->GetRelayLatency().ToString().c_str());
+
 		if (hostif != nullptr)
 			hostif->SendQuit();
 
@@ -2710,6 +2832,23 @@ void CGameServer::UpdateLoop()
 	} CATCH_SPRING_ERRORS
 }
 
+spring_time CGameServer::GetFrameWaitTime() const
+{
+	const spring_time maxWaitTime = spring_msecs(1000 / GAME_SPEED);
+
+	// frame state is written by CreateNewFrame, which other threads can also call
+	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+
+	if (!gameHasStarted || isPaused || demoReader != nullptr || !spring_istime(lastNewFrameTick))
+		return maxWaitTime;
+
+	// CreateNewFrame leaves frameTimeLeft in (-1, 0]; the next frame is due once it becomes positive
+	const float frameTimeRate = GAME_SPEED * 0.001f * std::max(internalSpeed, 0.01f);
+	const float waitTime = (-frameTimeLeft / frameTimeRate) - (spring_gettime() - lastNewFrameTick).toMilliSecsf();
+
+	return std::min(spring_msecs(std::max(waitTime, 0.0f)), maxWaitTime);
+}
+
 
 void CGameServer::KickPlayer(int playerNum)
 {
@@ -2823,8 +2962,132 @@ void CGameServer::AddAdditionalUser(const std::string& name, const std::string&
 		p.SetValue("password", passwd);
 
 	// inform all the players of the newcomer
-	if (!fromDemo)
+	if (!fromDemo) {
+		p.joinCacheIndex = packetCacheBase + packetCache.size();
 		Broadcast(CBaseNetProtocol::Get().SendCreateNewPlayer(p.id, p.spectator, p.team, p.name));
+	}
+}
+
+
+void CGameServer::RequestGameStateSnapshot()
+{
+	// nothing is cached otherwise, so there would be nothing to replace
+	if (!canReconnect && !allowSpecJoin)
+		return;
+
+	// prefer the host (no upload), then spectators (stalling them while
+	// saving affects nobody else) and only then players; all have to be
+	// caught up or the snapshot would arrive long after it was requested
+	const auto GetPriority = [&](const GameParticipant& p) {
+		if (p.myState != GameParticipant::INGAME)
+			return 0;
+		if ((serverFrameNum - p.lastFrameResponse) > (GAME_SPEED * 2))
+			return 0;
+
+		return (1 + p.spectator + 2 * p.isLocal);
+	};
+
+	unsigned int bestPlayerNum = -1u;
+	int bestPriority = 0;
+
+	for (const GameParticipant& p: players) {
+		const int priority = GetPriority(p);
+
+		if (priority <= bestPriority)
+			continue;
+
+		bestPlayerNum = p.id;
+		bestPriority = priority;
+	}
+
+	// supersedes any request that has not been answered (in full) yet
+	pendingSnapshot = {};
+	snapshotPlayerNum = bestPlayerNum;
+
+	if (bestPlayerNum == -1u)
+		return;
+
+	pendingSnapshot.frameNum = serverFrameNum;
+	players[bestPlayerNum].SendData(CBaseNetProtocol::Get().SendGameStateRequest(serverFrameNum));
+}
+
+void CGameServer::RecvGameStateSnapshot(unsigned playerNum, std::shared_ptr<const netcode::RawPacket> packet)
+{
+	constexpr uint32_t headerSize = sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(int32_t) + sizeof(uint32_t) * 2;
+
+	try {
+		netcode::UnpackPacket pckt(packet, sizeof(uint8_t) + sizeof(uint16_t));
+
+		uint8_t senderNum;
+		int32_t frameNum;
+		uint32_t totalSize;
+		uint32_t offset;
+
+		pckt >> senderNum;
+		pckt >> frameNum;
+		pckt >> totalSize;
+		pckt >> offset;
+
+		if (senderNum != playerNum) {
+			Message(spring::format(WrongPlayer, NETMSG_GAMESTATE, playerNum, (unsigned)senderNum));
+			return;
+		}
+
+		// unsolicited, or answers a request that has since been superseded
+		if (playerNum != snapshotPlayerNum || frameNum != pendingSnapshot.frameNum)
+			return;
+
+		std::vector<uint8_t>& data = pendingSnapshot.data;
+		std::vector<uint8_t> chunk(packet->length - headerSize);
+
+		pckt >> chunk;
+
+		if (offset != data.size() || totalSize > gameStateSnapshotMaxSize || (offset + chunk.size()) > totalSize) {
+			Message(spring::format("[GameServer::%s] discarding malformed game-state snapshot from player \"%s\"", __func__, players[playerNum].name.c_str()), false);
+
+			pendingSnapshot = {};
+			snapshotPlayerNum = -1u;
+			return;
+		}
+
+		data.reserve(totalSize);
+		data.insert(data.end(), chunk.begin(), chunk.end());
+
+		if (data.size() < totalSize)
+			return;
+	} catch (const netcode::UnpackPacketException& ex) {
+		Message(spring::format("[GameServer::%s] exception \"%s\" from player \"%s\"", __func__, ex.what(), players[playerNum].name.c_str()));
+		return;
+	}
+
+	assert(pendingSnapshot.cacheIndex >= packetCacheBase);
+
+	// everything up to the snapshot frame can now be served from the snapshot
+	const size_t numCachedPackets = std::min(pendingSnapshot.cacheIndex - packetCacheBase, packetCache.size());
+
+	packetCache.erase(packetCache.begin(), packetCache.begin() + numCachedPackets);
+	packetCacheBase += numCachedPackets;
+
+	gameStateSnapshot = std::move(pendingSnapshot);
+	pendingSnapshot = {};
+	snapshotPlayerNum = -1u;
+
+	Message(spring::format("[GameServer::%s] game-state snapshot of frame %d (%u KB) received from player \"%s\", dropped %u cached packets", __func__, gameStateSnapshot.frameNum, unsigned(gameStateSnapshot.data.size() >> 10), players[playerNum].name.c_str(), unsigned(numCachedPackets)), false);
+}
+
+void CGameServer::SendGameStateSnapshot(GameParticipant& player)
+{
+	const std::vector<uint8_t>& data = gameStateSnapshot.data;
+
+	std::vector<uint8_t> chunk;
+	chunk.reserve(gameStateSnapshotChunkSize);
+
+	for (size_t offset = 0; offset < data.size(); offset += gameStateSnapshotChunkSize) {
+		const size_t chunkSize = std::min(data.size() - offset, size_t(gameStateSnapshotChunkSize));
+
+		chunk.assign(data.begin() + offset, data.begin() + offset + chunkSize);
+		player.SendData(CBaseNetProtocol::Get().SendGameState(SERVER_PLAYER, gameStateSnapshot.frameNum, data.size(), offset, chunk));
+	}
 }
 
 
@@ -2975,10 +3238,37 @@ unsigned CGameServer::BindConnection(
 		return newPlayerNumber;
 	}
 
+	// a snapshot replaces the cached packets up to the frame it was taken at
+	const bool sendSnapshot = (gameStateSnapshot.frameNum >= 0);
+
 	newPlayer.Connected(clientLink, isLocal);
 	newPlayer.SendData(std::shared_ptr<const RawPacket>(myGameData->Pack()));
+
+	if (sendSnapshot) {
+		SendGameStateSnapshot(newPlayer);
+
+		// re-announce players whose join was dropped from the cache along with
+		// the snapshotted frames; sent before the player-number s.t. PreGame
+		// adds them without PlayerAdded (the snapshot's Lua state saw that)
+		// while later joins still reach the client through the cache below
+		for (const GameParticipant& p: players) {
+			if (!p.isMidgameJoin || p.isFromDemo || p.id == newPlayerNumber)
+				continue;
+			if (p.joinCacheIndex >= gameStateSnapshot.cacheIndex)
+				continue;
+
+			newPlayer.SendData(CBaseNetProtocol::Get().SendCreateNewPlayer(p.id, p.spectator, p.team, p.name));
+		}
+	}
+
 	newPlayer.SendData(CBaseNetProtocol::Get().SendSetPlayerNum((unsigned char)newPlayerNumber));
 
+	if (sendSnapshot) {
+		// replay what the dropped packets carried besides the game state
+		newPlayer.SendData(CBaseNetProtocol::Get().SendGameID(gameID.charArray));
+		newPlayer.SendData(CBaseNetProtocol::Get().SendStartPlaying(0));
+	}
+
 	// after gamedata and playerNum, the player can start loading
 	if (demoReader == nullptr || myGameSetup->demoName.empty()) {
 		// player wants to play -> join team
@@ -159,6 +159,8 @@ private:
 	void StartGame(bool forced);
 	void UpdateLoop();
 	void Update();
+	/// time until CreateNewFrame is next due, or the longest an event-driven UpdateLoop may block
+	spring_time GetFrameWaitTime() const;
 	void ProcessPacket(const unsigned playerNum, std::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
 	void HandleConnectionAttempts();
@@ -175,6 +177,12 @@ private:
 
 	void Broadcast(std::shared_ptr<const netcode::RawPacket> packet);
 
+	/// ask a client to upload the game state right after simulating the next frame
+	void RequestGameStateSnapshot();
+	void RecvGameStateSnapshot(unsigned playerNum, std::shared_ptr<const netcode::RawPacket> packet);
+	/// send the latest snapshot (instead of the packetCache prefix it replaces) to a joining client
+	void SendGameStateSnapshot(GameParticipant& player);
+
 	/**
 	 * @brief skip frames
 	 *
@@ -182,6 +190,16 @@ private:
 	 * targetFrame to all clients
 	 */
 	void SkipTo(int targetFrameNum);
+	/**
+	 * @brief ask the local client to reload the demo from its closest keyframe
+	 *
+	 * Used for skipping backwards, or far enough forwards that restoring a
+	 * keyframe beats re-simulating; see CDemoIndex.
+	 * @return true if a reload was requested
+	 */
+	bool SkipToDemoKeyframe(int targetFrameNum);
+	/// silently consume demo data already contained in a loaded keyframe
+	void ResumeDemoFromKeyframe(int keyframeNum);
 
 	void Message(const std::string& message, bool broadcast = true, bool internal = false);
 	void PrivateMessage(int playerNum, const std::string& message);
@@ -223,6 +241,22 @@ private:
 
 	std::deque< std::shared_ptr<const netcode::RawPacket> > packetCache;
 
+	struct GameStateSnapshot {
+		/// gzip-compressed creg save
+		std::vector<uint8_t> data;
+
+		/// frame the state was saved right after, -1 if none
+		int frameNum = -1;
+		/// absolute packetCache index of the first packet not contained in the state
+		size_t cacheIndex = 0;
+	};
+
+	GameStateSnapshot gameStateSnapshot;
+	GameStateSnapshot pendingSnapshot;
+
+	/// number of packets dropped from the front of packetCache
+	size_t packetCacheBase = 0;
+
 	/////////////////// sync stuff ///////////////////
 #ifdef SYNCCHECK
 	std::set<int> outstandingSyncFrames;
@@ -252,13 +286,19 @@ private:
 
 
 	int serverFrameNum = -1;
+	/// demo packets up to (and including) this frame are not relayed
+	int demoKeyframeNum = -1;
 
 	int syncErrorFrame = 0;
 	int syncWarningFrame = 0;
 
 	int linkMinPacketSize = 1;
+	/// frames between game-state snapshots, 0 if disabled
+	int snapshotInterval = 0;
 
 	unsigned localClientNumber = -1u;
+	/// player uploading pendingSnapshot
+	unsigned snapshotPlayerNum = -1u;
 
 
 	/// The maximum speed users are allowed to set
@@ -279,10 +319,12 @@ private:
 
 	bool logInfoMessages = false;
 	bool logDebugMessages = false;
+	/// wake UpdateLoop on socket activity and frame deadlines instead of sleeping a fixed interval
+	bool eventDrivenLoop = false;
 
 
 	/// If the server receives a command, it will forward it to clients if it is not in this set
-	static std::array<std::string, 25> commandBlacklist;
+	static std::array<std::string, 26> commandBlacklist;
 
 	std::unique_ptr<netcode::UDPListener> udpListener;
 	std::unique_ptr<CDemoReader> demoReader;
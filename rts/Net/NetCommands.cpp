@@ -31,6 +31,7 @@
 #include "System/EventHandler.h"
 #include "System/GlobalConfig.h"
 #include "System/Log/ILog.h"
+#include "System/MemoryStats.h"
 #include "System/SpringMath.h"
 #include "System/TimeProfiler.h"
 #include "System/LoadSave/DemoRecorder.h"
@@ -278,6 +279,10 @@ void CGame::ClientReadNet()
 		if (packet == nullptr)
 			break;
 
+		// every packet can change sim-state, which must not happen while
+		// asynchronous AI's are still handling the previous frame's events
+		eoh->WaitForEventBatches();
+
 		lastReceivedNetPacketTime = spring_gettime();
 
 		const uint8_t* inbuf = packet->data;
@@ -506,6 +511,7 @@ void CGame::ClientReadNet()
 						p[ 8], p[ 9], p[10], p[11], p[12], p[13], p[14], p[15]);
 
 				AddTraffic(-1, packetCode, dataLength);
+				memoryStats.SetGameID(gameID, sizeof(gameID));
 				eventHandler.GameID(gameID, sizeof(gameID));
 			} break;
 
@@ -560,6 +566,7 @@ void CGame::ClientReadNet()
 				lastSimFrameNetPacketTime = spring_gettime();
 
 				SimFrame();
+				SaveDemoKeyframe();
 
 #ifdef SYNCCHECK
 				// both NETMSG_SYNCRESPONSE and NETMSG_NEWFRAME are used for ping calculation by server
@@ -575,6 +582,9 @@ void CGame::ClientReadNet()
 				if ((gs->frameNum & 4095) == 0)
 					CSyncChecker::NewFrame();
 #endif
+				// after the checksum reset, the snapshot continues from there
+				SendGameStateSnapshot();
+
 				AddTraffic(-1, packetCode, dataLength);
 			} break;
 
@@ -1414,6 +1424,16 @@ void CGame::ClientReadNet()
 				AddTraffic(-1, packetCode, dataLength);
 			} break;
 
+			// server wants a snapshot of the state right after this frame
+			case NETMSG_GAMESTATE_REQUEST: {
+				gameStateRequestFrame = *reinterpret_cast<const int32_t*>(inbuf + 1);
+				AddTraffic(-1, packetCode, dataLength);
+			} break;
+			// only relevant to PreGame
+			case NETMSG_GAMESTATE: {
+				AddTraffic(-1, packetCode, dataLength);
+			} break;
+
 			// server sends this second to let us know about new clients that join midgame
 			case NETMSG_CREATE_NEWPLAYER: {
 				try {
@@ -559,6 +559,35 @@ PacketType CBaseNetProtocol::SendClientData(uint8_t playerNum, const std::vector
 }
 
 
+PacketType CBaseNetProtocol::SendGameStateRequest(int32_t frameNum)
+{
+	PackPacket* packet = new PackPacket(5, NETMSG_GAMESTATE_REQUEST);
+	*packet << frameNum;
+	return PacketType(packet);
+}
+
+PacketType CBaseNetProtocol::SendGameState(uint8_t playerNum, int32_t frameNum, uint32_t totalSize, uint32_t offset, const std::vector<uint8_t>& data)
+{
+	const uint32_t payloadSize = sizeof(playerNum) + sizeof(frameNum) + sizeof(totalSize) + sizeof(offset) + data.size();
+	const uint32_t headerSize = sizeof(uint8_t) + sizeof(uint16_t);
+	const uint32_t packetSize = headerSize + payloadSize;
+
+	// packetSize must be an uint32_t for this to work
+	if (packetSize >= (1 << (sizeof(uint16_t) * 8)))
+		throw netcode::PackPacketException("[BaseNetProto::SendGameState] maximum packet-size exceeded");
+
+	PackPacket* packet = new PackPacket(packetSize, NETMSG_GAMESTATE);
+	*packet << static_cast<uint16_t>(packetSize);
+	*packet << playerNum;
+	*packet << frameNum;
+	*packet << totalSize;
+	*packet << offset;
+	*packet << data;
+
+	return PacketType(packet);
+}
+
+
 
 #ifdef SYNCDEBUG
 PacketType CBaseNetProtocol::SendSdCheckrequest(int32_t frameNum)
@@ -666,6 +695,8 @@ CBaseNetProtocol::CBaseNetProtocol()
 	proto->AddType(NETMSG_AI_STATE_CHANGED, 4);
 	proto->AddType(NETMSG_GAME_FRAME_PROGRESS, 5);
 	proto->AddType(NETMSG_PING, 1 + (1 + 1 + 4));
+	proto->AddType(NETMSG_GAMESTATE_REQUEST, 5);
+	proto->AddType(NETMSG_GAMESTATE, -2);
 
 #ifdef SYNCDEBUG
 	proto->AddType(NETMSG_SD_CHKREQUEST, 5);
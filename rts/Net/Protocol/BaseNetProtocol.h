@@ -110,6 +110,9 @@ public:
 
 	PacketType SendClientData(uint8_t playerNum, const std::vector<uint8_t>& data);
 
+	PacketType SendGameStateRequest(int32_t frameNum);
+	PacketType SendGameState(uint8_t playerNum, int32_t frameNum, uint32_t totalSize, uint32_t offset, const std::vector<uint8_t>& data);
+
 #ifdef SYNCDEBUG
 	PacketType SendSdCheckrequest(int32_t frameNum);
 	PacketType SendSdCheckresponse(uint8_t playerNum, uint64_t flop, std::vector<uint32_t> checksums);
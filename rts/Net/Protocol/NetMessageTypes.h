@@ -93,6 +93,9 @@ enum NETMSG {
 
 	NETMSG_PING = 78, // uint8_t playerNum, uint8_t pingTag, float localTime
 
+	NETMSG_GAMESTATE_REQUEST = 79, // int32_t frameNum # sent to a single client, which uploads a snapshot of the game state right after simulating frameNum #
+	NETMSG_GAMESTATE         = 80, // uint16_t msgsize, uint8_t playerNum, int32_t frameNum, uint32_t totalSize, uint32_t offset, std::vector<uint8_t> data # chunk of a (compressed) creg save #
+
 	NETMSG_LAST //max types of netmessages, internal only
 };
 
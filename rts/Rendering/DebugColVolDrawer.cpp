@@ -336,25 +336,28 @@ public:
 	}
 
 	void DrawQuad(int x, int y) override {
-		const CQuadField::Quad& q = quadField.GetQuadAt(x, y);
+		// objects are deduplicated, so overlapping quads need no tracking
+		quadField.ForEachGridCellQuad(x, y, [&](int quadIdx) {
+			const CQuadField::Quad& q = quadField.GetQuad(quadIdx);
 
-		for (const CUnit* u: q.units) {
-			const auto& p = unitIDs.insert(u->id);
+			for (const CUnit* u: q.units) {
+				const auto& p = unitIDs.insert(u->id);
 
-			if (!p.second)
-				continue;
+				if (!p.second)
+					continue;
 
-			DrawUnitColVol(u, ipo);
-		}
+				DrawUnitColVol(u, ipo);
+			}
 
-		for (const CFeature* f: q.features) {
-			const auto& p = featureIDs.insert(f->id);
+			for (const CFeature* f: q.features) {
+				const auto& p = featureIDs.insert(f->id);
 
-			if (!p.second)
-				continue;
+				if (!p.second)
+					continue;
 
-			DrawFeatureColVol(f, ipo);
-		}
+				DrawFeatureColVol(f, ipo);
+			}
+		});
 	}
 
 private:
@@ -424,7 +427,7 @@ namespace DebugColVolDrawer
 
 		cvDrawer.ResetState();
 		cvDrawer.Enable();
-		readMap->GridVisibility(nullptr, &cvDrawer, 1e9, CQuadField::BASE_QUAD_SIZE / SQUARE_SIZE);
+		readMap->GridVisibility(nullptr, &cvDrawer, 1e9, quadField.GetGridCellSize());
 		cvDrawer.Disable();
 	}
 }
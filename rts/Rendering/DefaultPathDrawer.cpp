@@ -240,8 +240,8 @@ void DefaultPathDrawer::UpdateExtraTexture(int extraTex, int starty, int endy, i
 			const PathNodeStateBuffer& medResStates = pm->GetMedResPE()->GetBlockStates();
 			const PathNodeStateBuffer& lowResStates = pm->GetLowResPE()->GetBlockStates();
 
-			const unsigned int medResBlockSize = pm->GetMedResPE()->GetBlockSize(), medResBlocksX = pm->GetMedResPE()->GetNumBlocks().x;
-			const unsigned int lowResBlockSize = pm->GetLowResPE()->GetBlockSize(), lowResBlocksX = pm->GetLowResPE()->GetNumBlocks().x;
+			const unsigned int medResBlockSize = pm->GetMedResPE()->GetBlockSize();
+			const unsigned int lowResBlockSize = pm->GetLowResPE()->GetBlockSize();
 
 			const float gCostMax[3] = {
 				std::max(1.0f, maxResStates.GetMaxCost(NODE_COST_G)),
@@ -259,9 +259,9 @@ void DefaultPathDrawer::UpdateExtraTexture(int extraTex, int starty, int endy, i
 					const unsigned int hy = ty << 1;
 
 					float gCost[3] = {
-						maxResStates.gCost[hy * mapDims.mapx + hx],
-						medResStates.gCost[(hy / medResBlockSize) * medResBlocksX + (hx / medResBlockSize)],
-						lowResStates.gCost[(hy / lowResBlockSize) * lowResBlocksX + (hx / lowResBlockSize)],
+						maxResStates.GetNodeGCost(maxResStates.GetStateIdx(int2(hx, hy))),
+						medResStates.GetNodeGCost(medResStates.GetStateIdx(int2(hx / medResBlockSize, hy / medResBlockSize))),
+						lowResStates.GetNodeGCost(lowResStates.GetStateIdx(int2(hx / lowResBlockSize, hy / lowResBlockSize))),
 					};
 
 					if (std::isinf(gCost[0])) { gCost[0] = gCostMax[0]; }
@@ -347,13 +347,12 @@ void DefaultPathDrawer::Draw(const CPathFinder* pf) const {
 	for (unsigned int idx = 0; idx < pf->openBlockBuffer.GetSize(); idx++) {
 		const PathNode* os = pf->openBlockBuffer.GetNode(idx);
 		const int2 sqr = os->nodePos;
-		const int square = os->nodeNum;
 		float3 p1;
 			p1.x = sqr.x * SQUARE_SIZE;
 			p1.z = sqr.y * SQUARE_SIZE;
 			p1.y = CGround::GetHeightAboveWater(p1.x, p1.z, false) + 15.0f;
 
-		const unsigned int dir = pf->blockStates.nodeMask[square] & PATHOPT_CARDINALS;
+		const unsigned int dir = pf->blockStates.GetNodeMask(pf->blockStates.GetStateIdx(sqr)) & PATHOPT_CARDINALS;
 		const int2 obp = sqr - PF_DIRECTION_VECTORS_2D[dir];
 		float3 p2;
 			p2.x = obp.x * SQUARE_SIZE;
@@ -510,7 +509,7 @@ void DefaultPathDrawer::Draw(const CPathEstimator* pe) const {
 			const PathNode* ob = pe->openBlockBuffer.GetNode(idx);
 			const int blockNr = ob->nodeNum;
 
-			auto pathOptDir = blockStates.nodeMask[blockNr] & PATHOPT_CARDINALS;
+			auto pathOptDir = blockStates.GetNodeMask(blockStates.GetStateIdx(ob->nodePos)) & PATHOPT_CARDINALS;
 			auto pathDir = PathOpt2PathDir(pathOptDir);
 			const int2 obp = pe->BlockIdxToPos(blockNr) - PE_DIRECTION_VECTORS[pathDir];
 			const int obBlockNr = pe->BlockPosToIdx(obp);
@@ -11,6 +11,7 @@
 #include "Sim/Units/CommandAI/BuilderCAI.h"
 #include "System/creg/STL_Set.h"
 #include "System/EventHandler.h"
+#include "System/MemoryStats.h"
 #include "System/TimeProfiler.h"
 
 /******************************************************************************/
@@ -38,9 +39,13 @@ void CFeatureHandler::Init() {
 
 	idPool.Clear();
 	idPool.Expand(0, MAX_FEATURES);
+
+	memoryStats.AddSubsystem("Sim/Features", [](CMemoryStats::Sample& s) { CMemoryStats::SamplePool(featureMemPool, s); });
 }
 
 void CFeatureHandler::Kill() {
+	memoryStats.RemoveSubsystem("Sim/Features");
+
 	for (const int featureID: activeFeatureIDs) {
 		featureMemPool.free(features[featureID]);
 	}
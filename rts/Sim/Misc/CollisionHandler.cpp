@@ -9,15 +9,38 @@
 #include "Sim/Objects/SolidObject.h"
 #include "System/Matrix44f.h"
 #include "System/Log/ILog.h"
+#include "System/Threading/ThreadPool.h"
+
+#include <array>
 
 unsigned int CCollisionHandler::numDiscTests = 0;
 unsigned int CCollisionHandler::numContTests = 0;
 
+// projectile collisions are detected by multiple threads, each counts
+// into its own (cache-line sized) slot until CollectStats sums them up
+struct alignas(64) ThreadTestCounts {
+	unsigned int numDiscTests;
+	unsigned int numContTests;
+};
+
+static std::array<ThreadTestCounts, ThreadPool::MAX_THREADS> threadTestCounts;
+
 
 
 void CCollisionHandler::PrintStats()
 {
-	LOG("[CCollisionHandler] dis-/continuous tests: %i/%i", numDiscTests, numContTests);
+	CollectStats();
+	LOG("[CCollisionHandler] dis-/continuous tests: %u/%u", numDiscTests, numContTests);
+}
+
+void CCollisionHandler::CollectStats()
+{
+	for (ThreadTestCounts& counts: threadTestCounts) {
+		numDiscTests += counts.numDiscTests;
+		numContTests += counts.numContTests;
+
+		counts = {0, 0};
+	}
 }
 
 
@@ -136,7 +159,7 @@ bool CCollisionHandler::CollisionFootPrint(const CSolidObject* o, const float3&
 
 bool CCollisionHandler::Collision(const CollisionVolume* v, const CMatrix44f& m, const float3& p)
 {
-	numDiscTests += 1;
+	threadTestCounts[ThreadPool::GetThreadNum()].numDiscTests += 1;
 
 	// get the inverse volume transformation matrix and
 	// apply it to the projectile's position, then test
@@ -345,7 +368,7 @@ inline bool CCollisionHandler::Intersect(
 
 bool CCollisionHandler::Intersect(const CollisionVolume* v, const CMatrix44f& m, const float3& p0, const float3& p1, CollisionQuery* q)
 {
-	numContTests += 1;
+	threadTestCounts[ThreadPool::GetThreadNum()].numContTests += 1;
 
 	const CMatrix44f mInv = m.InvertAffine();
 	const float3 pi0 = mInv.Mul(p0);
@@ -94,6 +94,9 @@ private:
 class CCollisionHandler {
 	public:
 		static void PrintStats();
+		// adds the per-thread test counts to the totals, must not be
+		// called while other threads might still be running hit-tests
+		static void CollectStats();
 
 		static bool DetectHit(
 			const CSolidObject* o,
@@ -2,6 +2,11 @@
 
 #include <algorithm>
 #include <array>
+#include <cstring>
+
+#ifndef DEDICATED_NOSSE
+#include <xmmintrin.h>
+#endif
 
 #include "LosMap.h"
 #include "LosHandler.h"
@@ -10,6 +15,8 @@
 #include "System/float3.h"
 #include "System/Log/ILog.h"
 #include "System/StringUtil.h"
+#include "System/Misc/SpringTime.h"
+#include "System/Sync/FPUCheck.h"
 #include "System/Threading/ThreadPool.h"
 #ifdef USE_UNSYNCED_HEIGHTMAP
 	#include "Game/GlobalUnsynced.h" // for myAllyTeam
@@ -24,6 +31,13 @@ static std::array<std::vector<float>, ThreadPool::MAX_THREADS> RADIUS_ISQRT_TABL
 static std::array<std::vector<float>, ThreadPool::MAX_THREADS> RAYCAST_ANGLE_TABLES;
 static std::array<std::vector< char>, ThreadPool::MAX_THREADS> LOSRAY_SQUARE_TABLES; // visible squares per instance
 
+// selected once at startup; both kernels produce bitwise identical results
+#ifndef DEDICATED_NOSSE
+static bool simdRaycast = ((springproc::GetProcSSEBits() >> 5) & 1) != 0;
+#else
+static bool simdRaycast = false;
+#endif
+
 
 static float isqrtTableLookup(unsigned r, int threadNum)
 {
@@ -524,7 +538,7 @@ inline void CastLos(
 	float* maxAngle,
 	const int2& off,
 	std::vector<char>& losRaySquares,
-	std::vector<float>& raycastAngles,
+	const std::vector<float>& raycastAngles,
 	int losRadius,
 	int threadNum
 ) {
@@ -550,6 +564,127 @@ inline void CastLos(
 }
 
 
+#ifndef DEDICATED_NOSSE
+// per-lane float masks for the four ray rotations, indexed by lane-bits
+alignas(16) static const unsigned int LANE_MASKS[16][4] = {
+	{0u, 0u, 0u, 0u}, {~0u, 0u, 0u, 0u}, {0u, ~0u, 0u, 0u}, {~0u, ~0u, 0u, 0u},
+	{0u, 0u, ~0u, 0u}, {~0u, 0u, ~0u, 0u}, {0u, ~0u, ~0u, 0u}, {~0u, ~0u, ~0u, 0u},
+	{0u, 0u, 0u, ~0u}, {~0u, 0u, 0u, ~0u}, {0u, ~0u, 0u, ~0u}, {~0u, ~0u, 0u, ~0u},
+	{0u, 0u, ~0u, ~0u}, {~0u, 0u, ~0u, ~0u}, {0u, ~0u, ~0u, ~0u}, {~0u, ~0u, ~0u, ~0u},
+};
+
+static inline __m128 SelectPS(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// CastLos for the same step along all four rotations of a ray at once
+// the rotated squares share their distance (and hence invR) to the ray
+// origin; per lane this performs exactly the same float operations so
+// the visible squares are identical to those of the scalar version
+static inline void CastLosSSE(
+	__m128& prvAngles,
+	__m128& maxAngles,
+	const int2 (&offs)[4],
+	const int laneBits,
+	std::vector<char>& losRaySquares,
+	const std::vector<float>& raycastAngles,
+	int losRadius,
+	int threadNum
+) {
+	const size_t oidx[4] = {
+		ToAngleMapIdx(offs[0], losRadius),
+		ToAngleMapIdx(offs[1], losRadius),
+		ToAngleMapIdx(offs[2], losRadius),
+		ToAngleMapIdx(offs[3], losRadius),
+	};
+
+	const float invR = isqrtTableLookup(offs[0].x * offs[0].x + offs[0].y * offs[0].y, threadNum);
+
+	const __m128 lanes = _mm_load_ps(reinterpret_cast<const float*>(&LANE_MASKS[laneBits][0]));
+	const __m128 angles = _mm_setr_ps(raycastAngles[oidx[0]], raycastAngles[oidx[1]], raycastAngles[oidx[2]], raycastAngles[oidx[3]]);
+
+	const __m128 belowMax = _mm_cmplt_ps(angles, maxAngles);
+	const __m128 belowPrv = _mm_and_ps(_mm_andnot_ps(belowMax, _mm_cmplt_ps(angles, prvAngles)), lanes);
+	const __m128 descAngles = _mm_sub_ps(prvAngles, _mm_mul_ps(_mm_set1_ps(LOS_BONUS_HEIGHT), _mm_set1_ps(invR)));
+
+	maxAngles = SelectPS(belowPrv, descAngles, maxAngles);
+
+	const __m128 hidden = _mm_and_ps(_mm_or_ps(belowMax, _mm_and_ps(belowPrv, _mm_cmplt_ps(angles, maxAngles))), lanes);
+	const int hiddenBits = _mm_movemask_ps(hidden);
+
+	prvAngles = SelectPS(_mm_andnot_ps(hidden, lanes), angles, prvAngles);
+
+	for (int i = 0; i < 4; i++) {
+		if ((hiddenBits >> i) & 1)
+			losRaySquares[oidx[i]] = false;
+	}
+}
+#endif
+
+
+// casts the i-th table ray rotated into all four quadrants; laneFunc returns
+// the rotations that are cast at a step given those active in the previous
+// one, once none are left the ray ends if StopOnEmpty
+template<bool StopOnEmpty, typename LaneFunc>
+static void CastLosRay(
+	CLosTableHelper& helper,
+	size_t rayIdx,
+	std::vector<char>& losRaySquares,
+	const std::vector<float>& raycastAngles,
+	int losRadius,
+	int threadNum,
+	const LaneFunc& laneFunc
+) {
+	const size_t numSquares = helper.GetLosTableRaySize(losRadius, rayIdx);
+
+	int laneBits = 0xF;
+
+#ifndef DEDICATED_NOSSE
+	if (simdRaycast) {
+		__m128 maxAngles = _mm_set1_ps(-1e7);
+		__m128 prvAngles = _mm_set1_ps(-1e7);
+
+		for (size_t n = 0; n < numSquares; n++) {
+			const int2 square = helper.GetLosTableRaySquare(losRadius, rayIdx, n);
+			const int2 offs[4] = {square, -square, int2(square.y, -square.x), int2(-square.y, square.x)};
+
+			if ((laneBits = laneFunc(offs, laneBits)) == 0) {
+				if (StopOnEmpty)
+					break;
+
+				continue;
+			}
+
+			CastLosSSE(prvAngles, maxAngles, offs, laneBits, losRaySquares, raycastAngles, losRadius, threadNum);
+		}
+
+		return;
+	}
+#endif
+
+	float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
+	float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
+
+	for (size_t n = 0; n < numSquares; n++) {
+		const int2 square = helper.GetLosTableRaySquare(losRadius, rayIdx, n);
+		const int2 offs[4] = {square, -square, int2(square.y, -square.x), int2(-square.y, square.x)};
+
+		if ((laneBits = laneFunc(offs, laneBits)) == 0) {
+			if (StopOnEmpty)
+				break;
+
+			continue;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			if ((laneBits >> i) & 1)
+				CastLos(&prvAngles[i], &maxAngles[i], offs[i], losRaySquares, raycastAngles, losRadius, threadNum);
+		}
+	}
+}
+
+
 void CLosMap::AddSquaresToInstance(SLosInstance* li, const std::vector<char>& losRaySquares) const
 {
 	const int2 pos   = li->basePos;
@@ -656,19 +791,7 @@ void CLosMap::UnsafeLosAdd(SLosInstance* li) const
 	const size_t numRays = helper.GetLosTableSize(radius);
 
 	for (size_t i = 0; i < numRays; ++i) {
-		float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-		float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-
-		const size_t numSquares = helper.GetLosTableRaySize(radius, i);
-
-		for (size_t n = 0; n < numSquares; n++) {
-			const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-			CastLos(&prvAngles[0], &maxAngles[0],       square              , losRaySquares, raycastAngles, radius, threadNum);
-			CastLos(&prvAngles[1], &maxAngles[1],      -square              , losRaySquares, raycastAngles, radius, threadNum);
-			CastLos(&prvAngles[2], &maxAngles[2], int2( square.y, -square.x), losRaySquares, raycastAngles, radius, threadNum);
-			CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y,  square.x), losRaySquares, raycastAngles, radius, threadNum);
-		}
+		CastLosRay<true>(helper, i, losRaySquares, raycastAngles, radius, threadNum, [](const int2 (&)[4], int) { return 0xF; });
 	}
 
 	// translate visible square indices to map square idx + RLE
@@ -741,74 +864,104 @@ void CLosMap::SafeLosAdd(SLosInstance* li) const
 	// Cast the Rays
 	const size_t numRays = helper.GetLosTableSize(radius);
 
+	const auto insideLanes = [&](const int2 (&offs)[4]) {
+		int laneBits = 0;
+
+		for (int i = 0; i < 4; i++) {
+			laneBits |= (int(safeRect.Inside(pos + offs[i])) << i);
+		}
+
+		return laneBits;
+	};
+
 	if (safeRect.Inside(pos)) {
 		losRaySquares[ToAngleMapIdx(int2(0, 0), radius)] = true;
 
+		// a rotation stops at its first square outside the map
+		for (size_t i = 0; i < numRays; ++i) {
+			CastLosRay<true>(helper, i, losRaySquares, raycastAngles, radius, threadNum, [&](const int2 (&offs)[4], int laneBits) { return (laneBits & insideLanes(offs)); });
+		}
+	} else {
+		// emit position outside the map
 		for (size_t i = 0; i < numRays; ++i) {
-			float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-			float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
+			CastLosRay<false>(helper, i, losRaySquares, raycastAngles, radius, threadNum, [&](const int2 (&offs)[4], int) { return (insideLanes(offs)); });
+		}
+	}
 
-			const size_t numSquares = helper.GetLosTableRaySize(radius, i);
+	// translate visible square indices to map square idx + RLE
+	AddSquaresToInstance(li, losRaySquares);
+}
 
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
 
-				if (!safeRect.Inside(pos + square))
-					break;
+void CLosMap::BenchmarkRaycast(int minRadius, int maxRadius, int numInstances) const
+{
+	const bool useSIMD = simdRaycast;
 
-				CastLos(&prvAngles[0], &maxAngles[0],  square,                   losRaySquares, raycastAngles, radius, threadNum);
-			}
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
+	std::vector<SLosInstance> instances;
+	std::vector< std::vector<SLosInstance::RLE> > scalarSquares;
 
-				if (!safeRect.Inside(pos - square))
-					break;
+	instances.reserve(numInstances);
+	scalarSquares.resize(numInstances);
 
-				CastLos(&prvAngles[1], &maxAngles[1], -square,                   losRaySquares, raycastAngles, radius, threadNum);
-			}
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
+	LOG("[LosMap::%s] %d instances per radius, SIMD kernel %savailable", __func__, numInstances, useSIMD? "": "not ");
 
-				if (!safeRect.Inside(pos + int2(square.y, -square.x)))
-					break;
+	for (int radius = std::max(1, minRadius); radius <= std::min(maxRadius, MAX_UNIT_SENSOR_RADIUS); radius *= 2) {
+		// fixed pseudo-random positions so runs are comparable
+		unsigned int seed = 0x2545F491u;
 
-				CastLos(&prvAngles[2], &maxAngles[2], int2(square.y, -square.x), losRaySquares, raycastAngles, radius, threadNum);
-			}
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
+		instances.clear();
 
-				if (!safeRect.Inside(pos + int2(-square.y, square.x)))
-					break;
+		for (int i = 0; i < numInstances; i++) {
+			seed = seed * 1664525u + 1013904223u;
+			const int x = (seed >> 8) % size.x;
+			seed = seed * 1664525u + 1013904223u;
+			const int y = (seed >> 8) % size.y;
 
-				CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y, square.x), losRaySquares, raycastAngles, radius, threadNum);
-			}
+			instances.emplace_back(i);
+			instances.back().radius = radius;
+			instances.back().basePos = int2(x, y);
+			instances.back().baseHeight = std::max(0.0f, mipHeightMap[y * size.x + x]) + 20.0f;
 		}
-	} else {
-		// emit position outside the map
-		for (size_t i = 0; i < numRays; ++i) {
-			float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-			float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
 
-			const size_t numSquares = helper.GetLosTableRaySize(radius, i);
+		spring_time kernelTimes[2];
+		bool identical = true;
 
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
+		for (int simd = 0; simd < (1 + useSIMD); simd++) {
+			simdRaycast = (simd != 0);
 
-				if (safeRect.Inside(pos + square))
-					CastLos(&prvAngles[0], &maxAngles[0],  square,                   losRaySquares, raycastAngles, radius, threadNum);
+			const spring_time t0 = spring_gettime();
 
-				if (safeRect.Inside(pos - square))
-					CastLos(&prvAngles[1], &maxAngles[1], -square,                   losRaySquares, raycastAngles, radius, threadNum);
+			for (SLosInstance& li: instances) {
+				li.squares.clear();
+				LosAdd(&li);
+			}
 
-				if (safeRect.Inside(pos + int2(square.y, -square.x)))
-					CastLos(&prvAngles[2], &maxAngles[2], int2(square.y, -square.x), losRaySquares, raycastAngles, radius, threadNum);
+			kernelTimes[simd] = spring_gettime() - t0;
 
-				if (safeRect.Inside(pos + int2(-square.y, square.x)))
-					CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y, square.x), losRaySquares, raycastAngles, radius, threadNum);
+			for (int i = 0; i < numInstances; i++) {
+				const std::vector<SLosInstance::RLE>& squares = instances[i].squares;
+
+				if (simd == 0) {
+					scalarSquares[i] = squares;
+					continue;
+				}
+
+				identical &= (squares.size() == scalarSquares[i].size());
+				identical &= (squares.empty() || memcmp(squares.data(), scalarSquares[i].data(), squares.size() * sizeof(squares[0])) == 0);
 			}
 		}
-	}
 
-	// translate visible square indices to map square idx + RLE
-	AddSquaresToInstance(li, losRaySquares);
+		simdRaycast = useSIMD;
+
+		if (!useSIMD) {
+			LOG("\tradius %2d: scalar %.3fms", radius, kernelTimes[0].toMilliSecsf());
+			continue;
+		}
+
+		LOG("\tradius %2d: scalar %.3fms, SIMD %.3fms (%.2fx), results %s", radius,
+			kernelTimes[0].toMilliSecsf(), kernelTimes[1].toMilliSecsf(),
+			kernelTimes[0].toMilliSecsf() / std::max(kernelTimes[1].toMilliSecsf(), 0.001f),
+			identical? "identical": "DIFFERENT"
+		);
+	}
 }
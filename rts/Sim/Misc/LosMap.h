@@ -43,6 +43,10 @@ public:
 	/// arbitrary area, for losMap, non-circular radar maps, ...
 	void PrepareRaycast(SLosInstance* instance) const;
 
+	/// times raycasting numInstances random instances per radius (doubling
+	/// from minRadius) with the scalar and the SIMD kernel, on this thread
+	void BenchmarkRaycast(int minRadius, int maxRadius, int numInstances) const;
+
 public:
 	int At(int2 p) const {
 		p.x = Clamp(p.x, 0, size.x - 1);
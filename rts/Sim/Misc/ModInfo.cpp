@@ -33,6 +33,8 @@ void CModInfo::ResetState()
 		allowSepAxisCollisionTest  = false;
 		allowGroundUnitGravity     = true;
 		allowHoverUnitStrafing     = true;
+		batchUnitCollisions        = false;
+		parallelUnitMovement       = false;
 	}
 	{
 		constructionDecay      = true;
@@ -95,6 +97,9 @@ void CModInfo::ResetState()
 		pathFinderSystem = NOPFS_TYPE;
 		pfRawDistMult    = 1.25f;
 		pfUpdateRate     = 0.007f;
+		pfDeferRequests  = false;
+
+		quadFieldMaxLoadFactor = 0.0f;
 
 		allowTake = true;
 	}
@@ -134,6 +139,9 @@ void CModInfo::Init(const std::string& modFileName)
 		pathFinderSystem = Clamp(system.GetInt("pathFinderSystem", HAPFS_TYPE), int(NOPFS_TYPE), int(QTPFS_TYPE));
 		pfRawDistMult = system.GetFloat("pathFinderRawDistMult", pfRawDistMult);
 		pfUpdateRate = system.GetFloat("pathFinderUpdateRate", pfUpdateRate);
+		pfDeferRequests = system.GetBool("pathFinderDeferRequests", pfDeferRequests);
+
+		quadFieldMaxLoadFactor = std::max(0.0f, system.GetFloat("quadFieldMaxLoadFactor", quadFieldMaxLoadFactor));
 
 		allowTake = system.GetBool("allowTake", allowTake);
 	}
@@ -152,6 +160,8 @@ void CModInfo::Init(const std::string& modFileName)
 		allowSepAxisCollisionTest = movementTbl.GetBool("allowSepAxisCollisionTest", allowSepAxisCollisionTest);
 		allowGroundUnitGravity = movementTbl.GetBool("allowGroundUnitGravity", allowGroundUnitGravity);
 		allowHoverUnitStrafing = movementTbl.GetBool("allowHoverUnitStrafing", (pathFinderSystem == QTPFS_TYPE));
+		batchUnitCollisions = movementTbl.GetBool("batchUnitCollisions", batchUnitCollisions);
+		parallelUnitMovement = movementTbl.GetBool("parallelUnitMovement", parallelUnitMovement);
 	}
 
 	{
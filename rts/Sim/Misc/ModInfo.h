@@ -51,6 +51,8 @@ public:
 	bool allowSepAxisCollisionTest;  //< determines if (ground-)units perform collision-testing via the SAT
 	bool allowGroundUnitGravity;     //< determines if (ground-)units experience gravity during regular movement
 	bool allowHoverUnitStrafing;     //< determines if (hover-)units carry their momentum sideways when turning
+	bool batchUnitCollisions;        //< determines if (ground-)unit collisions are resolved in one pass after all units moved
+	bool parallelUnitMovement;       //< determines if (ground-)units steer and accelerate in parallel, against the positions at the start of the frame
 
 	// Build behaviour
 	/// Should constructions without builders decay?
@@ -162,6 +164,14 @@ public:
 	float pfRawDistMult;
 	float pfUpdateRate;
 
+	/// whether the default PFS queues unit path-requests and resolves them
+	/// in parallel at the start of the next frame, default false
+	bool pfDeferRequests;
+
+	/// average number of objects per occupied quad above which the QuadField
+	/// is rebuilt at a finer resolution, default 0 (never resize)
+	float quadFieldMaxLoadFactor;
+
 	bool allowTake;
 };
 
@@ -11,6 +11,8 @@
 #include "System/ContainerUtil.h"
 
 #ifndef UNIT_TEST
+	#include "Sim/Misc/ModInfo.h"
+	#include "System/Log/ILog.h"
 	#include "Sim/Features/Feature.h"
 	#include "Sim/Projectiles/Projectile.h"
 	#include "Sim/Units/Unit.h"
@@ -30,7 +32,9 @@ CR_REG_METADATA(CQuadField, (
 	CR_IGNORED(tempFeatures),
 	CR_IGNORED(tempProjectiles),
 	CR_IGNORED(tempSolids),
-	CR_IGNORED(tempQuads)
+	CR_IGNORED(tempQuads),
+
+	CR_IGNORED(unitQuadsVersion)
 ))
 
 CR_BIND(CQuadField::Quad, )
@@ -49,52 +53,145 @@ CQuadField quadField;
 
 
 #ifndef UNIT_TEST
-/*
-void CQuadField::Resize(int quad_size)
-{
-	CQuadField* oldQuadField = &quadField;
-	CQuadField newQuadField;
-
-	newQuadField.Init(int2(mapDims.mapx, mapDims.mapy), quad_size);
-
-	for (int zq = 0; zq < oldQuadField->GetNumQuadsZ(); zq++) {
-		for (int xq = 0; xq < oldQuadField->GetNumQuadsX(); xq++) {
-			const CQuadField::Quad& quad = oldQuadField->GetQuadAt(xq, zq);
-
-			// COPY the object lists because the Remove* functions modify them
-			// NOTE:
-			//   teamUnits is updated internally by RemoveUnit and MovedUnit
-			//
-			//   if a unit exists in multiple quads in the old field, it will
-			//   be removed from all of them and there is no danger of double
-			//   re-insertion (important if new grid has higher resolution)
-			const std::vector<CUnit*      > units       = quad.units;
-			const std::vector<CFeature*   > features    = quad.features;
-			const std::vector<CProjectile*> projectiles = quad.projectiles;
-
-			for (auto it = units.cbegin(); it != units.cend(); ++it) {
-				oldQuadField->RemoveUnit(*it);
-				newQuadField->MovedUnit(*it); // handles addition
+void CQuadField::Resize(int quadSize)
+{
+	const int2 mapDims = {(numQuadsX * quadSizeX) / SQUARE_SIZE, (numQuadsZ * quadSizeZ) / SQUARE_SIZE};
+
+	std::vector<CUnit*> units;
+	std::vector<CFeature*> features;
+	std::vector<CProjectile*> projectiles;
+	std::vector<CPlasmaRepulser*> repulsers;
+
+	{
+		// gather every object once, in order of first appearance when walking
+		// the quads by index; re-inserting in this order makes the rebuilt
+		// per-quad lists (and so all query results) identical on every client
+		const int tempNum = gs->GetTempNum();
+
+		for (const Quad& quad: baseQuads) {
+			for (CUnit* u: quad.units) {
+				if (u->tempNum == tempNum)
+					continue;
+
+				u->tempNum = tempNum;
+				units.push_back(u);
 			}
+			for (CFeature* f: quad.features) {
+				if (f->tempNum == tempNum)
+					continue;
 
-			for (auto it = features.cbegin(); it != features.cend(); ++it) {
-				oldQuadField->RemoveFeature(*it);
-				newQuadField->AddFeature(*it);
+				f->tempNum = tempNum;
+				features.push_back(f);
 			}
+			for (CProjectile* p: quad.projectiles) {
+				if (p->tempNum == tempNum)
+					continue;
 
-			for (auto it = projectiles.cbegin(); it != projectiles.cend(); ++it) {
-				oldQuadField->RemoveProjectile(*it);
-				newQuadField->AddProjectile(*it);
+				p->tempNum = tempNum;
+				projectiles.push_back(p);
+			}
+			for (CPlasmaRepulser* r: quad.repulsers) {
+				spring::VectorInsertUnique(repulsers, r, true);
 			}
 		}
 	}
 
-	quadField = std::move(newQuadField);
+	for (CUnit* u: units) {
+		u->quads.clear();
+	}
+	for (CProjectile* p: projectiles) {
+		p->quads.clear();
+	}
+	for (CPlasmaRepulser* r: repulsers) {
+		r->ClearQuads();
+	}
+
+	Kill();
+	Init(mapDims, quadSize);
+
+	// MovedUnit handles (re)insertion since unit->quads is empty
+	for (CUnit* u: units) {
+		MovedUnit(u);
+	}
+	for (CFeature* f: features) {
+		AddFeature(f);
+	}
+	for (CProjectile* p: projectiles) {
+		AddProjectile(p);
+	}
+	for (CPlasmaRepulser* r: repulsers) {
+		MovedRepulser(r);
+	}
+}
+
+void CQuadField::Update()
+{
+	if (modInfo.quadFieldMaxLoadFactor <= 0.0f)
+		return;
+	if ((gs->frameNum % LOAD_CHECK_RATE) != 0)
+		return;
+
+	const LoadStats stats = GetLoadStats();
+
+	if (stats.loadFactor > modInfo.quadFieldMaxLoadFactor) {
+		const int newQuadSize = quadSizeX >> 1;
+
+		if (newQuadSize < MIN_QUAD_SIZE)
+			return;
+		// quads must tile the map exactly
+		if (((numQuadsX * quadSizeX) % newQuadSize) != 0 || ((numQuadsZ * quadSizeZ) % newQuadSize) != 0)
+			return;
+
+		LOG("[QuadField::%s][f=%d] load-factor %.2f exceeds %.2f, resizing quads from %d to %d elmos", __func__, gs->frameNum, stats.loadFactor, modInfo.quadFieldMaxLoadFactor, quadSizeX, newQuadSize);
+		Resize(newQuadSize);
+		return;
+	}
+
+	// merging four quads into one can at most quadruple the load-factor, so
+	// only go back up once it is below an eighth of the limit; it then stays
+	// at or below half of it and cannot flip back at the next check
+	if ((stats.loadFactor * COARSEN_LOAD_DIVISOR) < modInfo.quadFieldMaxLoadFactor) {
+		const int newQuadSize = quadSizeX << 1;
+
+		if (newQuadSize > BASE_QUAD_SIZE)
+			return;
+		if (((numQuadsX * quadSizeX) % newQuadSize) != 0 || ((numQuadsZ * quadSizeZ) % newQuadSize) != 0)
+			return;
+
+		LOG("[QuadField::%s][f=%d] load-factor %.2f below %.2f, resizing quads from %d to %d elmos", __func__, gs->frameNum, stats.loadFactor, modInfo.quadFieldMaxLoadFactor / COARSEN_LOAD_DIVISOR, quadSizeX, newQuadSize);
+		Resize(newQuadSize);
+	}
 }
-*/
 #endif
 
 
+CQuadField::LoadStats CQuadField::GetLoadStats() const
+{
+	LoadStats stats;
+
+	stats.numQuads = baseQuads.size();
+	stats.quadSize = quadSizeX;
+
+	for (const Quad& quad: baseQuads) {
+		const size_t numObjects = quad.units.size() + quad.features.size() + quad.projectiles.size();
+
+		stats.numOccupiedQuads += (numObjects != 0);
+		stats.numUnitEntries += quad.units.size();
+		stats.numFeatureEntries += quad.features.size();
+		stats.numProjectileEntries += quad.projectiles.size();
+
+		stats.maxUnits = std::max(stats.maxUnits, quad.units.size());
+		stats.maxFeatures = std::max(stats.maxFeatures, quad.features.size());
+		stats.maxProjectiles = std::max(stats.maxProjectiles, quad.projectiles.size());
+	}
+
+	if (stats.numOccupiedQuads > 0)
+		stats.loadFactor = (stats.numUnitEntries + stats.numFeatureEntries + stats.numProjectileEntries) * 1.0f / stats.numOccupiedQuads;
+
+	return stats;
+}
+
+
 void CQuadField::Quad::PostLoad()
 {
 #ifndef UNIT_TEST
@@ -124,6 +221,8 @@ void CQuadField::Init(int2 mapDims, int quadSize)
 	tempQuads.ReserveAll(numQuadsX * numQuadsZ);
 	tempQuads.ReleaseAll();
 
+	unitQuadsVersion += 1;
+
 #ifndef UNIT_TEST
 	for (Quad& quad: baseQuads) {
 		quad.Resize(teamHandler.ActiveAllyTeams());
@@ -139,6 +238,8 @@ void CQuadField::Kill()
 		quad.Clear();
 	}
 
+	unitQuadsVersion += 1;
+
 	tempUnits.ReleaseAll();
 	tempFeatures.ReleaseAll();
 	tempProjectiles.ReleaseAll();
@@ -162,12 +263,17 @@ int CQuadField::WorldPosToQuadFieldIdx(const float3 p) const
 }
 
 
-#ifndef UNIT_TEST
 void CQuadField::GetQuads(QuadFieldQuery& qfq, float3 pos, float radius)
+{
+	qfq.quads = tempQuads.ReserveVector();
+
+	GetQuads(*qfq.quads, pos, radius);
+}
+
+void CQuadField::GetQuads(std::vector<int>& quads, float3 pos, float radius) const
 {
 	pos.AssertNaNs();
 	pos.ClampInBounds();
-	qfq.quads = tempQuads.ReserveVector();
 
 	const int2 min = WorldPosToQuadField(pos - radius);
 	const int2 max = WorldPosToQuadField(pos + radius);
@@ -184,7 +290,7 @@ void CQuadField::GetQuads(QuadFieldQuery& qfq, float3 pos, float radius)
 			assert(z < numQuadsZ);
 			const float3 quadPos = float3(x * quadSizeX + quadSizeX * 0.5f, 0, z * quadSizeZ + quadSizeZ * 0.5f);
 			if (pos.SqDistance2D(quadPos) < maxSqLength) {
-				qfq.quads->push_back(z * numQuadsX + x);
+				quads.push_back(z * numQuadsX + x);
 			}
 		}
 	}
@@ -215,10 +321,9 @@ void CQuadField::GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, cons
 
 	return;
 }
-#endif // UNIT_TEST
 
 
-/// note: this function got an UnitTest, check the tests/ folder!
+/// note: this function (and GetQuads) got an UnitTest, check the tests/ folder!
 void CQuadField::GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const float3& dir, float length)
 {
 	dir.AssertNaNs();
@@ -270,7 +375,7 @@ void CQuadField::GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const f
 	const int startZ = Clamp<int>(startZuc, 0, numQuadsZ - 1);
 	const int finalZ = Clamp<int>(finalZuc, 0, numQuadsZ - 1);
 
-	assert(finalZ < quadSizeZ);
+	assert(finalZ < numQuadsZ);
 
 	const float invDirZ = 1.0f / dir.z;
 
@@ -324,6 +429,8 @@ bool CQuadField::InsertUnitIf(CUnit* unit, const float3& wpos)
 
 	spring::VectorInsertUnique(baseQuads[wposQuadIdx].units, unit, false);
 	spring::VectorInsertUnique(baseQuads[wposQuadIdx].teamUnits[unit->allyteam], unit, false);
+
+	unitQuadsVersion += 1;
 	return true;
 }
 
@@ -354,6 +461,8 @@ bool CQuadField::RemoveUnitIf(CUnit* unit, const float3& wpos)
 
 	spring::VectorErase(baseQuads[wposQuadIdx].units, unit);
 	spring::VectorErase(baseQuads[wposQuadIdx].teamUnits[unit->allyteam], unit);
+
+	unitQuadsVersion += 1;
 	return true;
 }
 #endif
@@ -383,6 +492,7 @@ void CQuadField::MovedUnit(CUnit* unit)
 	}
 
 	unit->quads = std::move(*qfQuery.quads);
+	unitQuadsVersion += 1;
 }
 
 void CQuadField::RemoveUnit(CUnit* unit)
@@ -392,6 +502,7 @@ void CQuadField::RemoveUnit(CUnit* unit)
 		spring::VectorErase(baseQuads[qi].teamUnits[unit->allyteam], unit);
 	}
 
+	unitQuadsVersion += (!unit->quads.empty());
 	unit->quads.clear();
 
 	#ifdef DEBUG_QUADFIELD
@@ -607,6 +718,26 @@ void CQuadField::GetUnitsExact(QuadFieldQuery& qfq, const float3& mins, const fl
 	return;
 }
 
+void CQuadField::GetUnitsRectangle(QuadFieldQuery& qfq, const float3& mins, const float3& maxs)
+{
+	QuadFieldQuery qfQuery;
+	GetQuadsRectangle(qfQuery, mins, maxs);
+	const int tempNum = gs->GetTempNum();
+	qfq.units = tempUnits.ReserveVector();
+
+	for (const int qi: *qfQuery.quads) {
+		for (CUnit* u: baseQuads[qi].units) {
+			if (u->tempNum == tempNum)
+				continue;
+
+			u->tempNum = tempNum;
+			qfq.units->push_back(u);
+		}
+	}
+
+	return;
+}
+
 
 void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& pos, float radius, bool spherical)
 {
@@ -666,6 +797,73 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& mins, const
 }
 
 
+// per-thread stand-in for tempNum, indexed by object id; every query resets
+// the marks it set so the vector stays all-false between queries
+template<typename T>
+static void AddObjectOnce(T* o, std::vector<T*>& objects, std::vector<bool>& marks)
+{
+	if (static_cast<size_t>(o->id) >= marks.size())
+		marks.resize(o->id + 1, false);
+	if (marks[o->id])
+		return;
+
+	marks[o->id] = true;
+	objects.push_back(o);
+}
+
+template<typename T>
+static void ClearObjectMarks(const std::vector<T*>& objects, size_t first, std::vector<bool>& marks)
+{
+	for (size_t i = first, n = objects.size(); i < n; i++) {
+		marks[objects[i]->id] = false;
+	}
+}
+
+void CQuadField::GetUnitsExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CUnit*>& units) const
+{
+	static thread_local std::vector<bool> unitMarks;
+
+	const size_t numUnits = units.size();
+
+	GetQuads(quads, pos, radius);
+
+	for (const int qi: quads) {
+		for (CUnit* u: baseQuads[qi].units) {
+			const float totRad = radius + u->radius;
+
+			if (pos.SqDistance(u->pos) >= (totRad * totRad))
+				continue;
+
+			AddObjectOnce(u, units, unitMarks);
+		}
+	}
+
+	ClearObjectMarks(units, numUnits, unitMarks);
+}
+
+void CQuadField::GetFeaturesExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CFeature*>& features) const
+{
+	static thread_local std::vector<bool> featureMarks;
+
+	const size_t numFeatures = features.size();
+
+	GetQuads(quads, pos, radius);
+
+	for (const int qi: quads) {
+		for (CFeature* f: baseQuads[qi].features) {
+			const float totRad = radius + f->radius;
+
+			if (pos.SqDistance(f->pos) >= (totRad * totRad))
+				continue;
+
+			AddObjectOnce(f, features, featureMarks);
+		}
+	}
+
+	ClearObjectMarks(features, numFeatures, featureMarks);
+}
+
+
 
 void CQuadField::GetProjectilesExact(QuadFieldQuery& qfq, const float3& pos, float radius)
 {
@@ -885,4 +1083,42 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 		}
 	}
 }
+
+void CQuadField::GetUnitsAndFeaturesColVol(
+	const float3& pos,
+	const float radius,
+	std::vector<int>& quads,
+	std::vector<CUnit*>& units,
+	std::vector<CFeature*>& features,
+	std::vector<CPlasmaRepulser*>& repulsers
+) const {
+	// objects spanning several quads are filtered by a linear search instead
+	// of tempNum; keeps the first occurrence so the order matches the above
+	const auto addObject = [&](auto* o, const float3& cvPos, float cvRadius, auto& objects) {
+		const float totRad = radius + cvRadius;
+
+		if (pos.SqDistance(cvPos) >= (totRad * totRad))
+			return;
+		if (std::find(objects.begin(), objects.end(), o) != objects.end())
+			return;
+
+		objects.push_back(o);
+	};
+
+	GetQuads(quads, pos, radius);
+
+	for (const int qi: quads) {
+		const Quad& quad = baseQuads[qi];
+
+		for (CUnit* u: quad.units) {
+			addObject(u, u->collisionVolume.GetWorldSpacePos(u), u->collisionVolume.GetBoundingRadius(), units);
+		}
+		for (CFeature* f: quad.features) {
+			addObject(f, f->collisionVolume.GetWorldSpacePos(f), f->collisionVolume.GetBoundingRadius(), features);
+		}
+		for (CPlasmaRepulser* r: quad.repulsers) {
+			addObject(r, r->weaponMuzzlePos, r->collisionVolume.GetBoundingRadius(), repulsers);
+		}
+	}
+}
 #endif // UNIT_TEST
@@ -7,6 +7,7 @@
 #include <array>
 #include <vector>
 
+#include "Sim/Misc/GlobalConstants.h"
 #include "System/Misc/NonCopyable.h"
 #include "System/creg/creg_cond.h"
 #include "System/float3.h"
@@ -80,19 +81,44 @@ class CQuadField : spring::noncopyable
 
 public:
 
-	/*
-	needed to support dynamic resizing (not used yet)
-	in large games the average loading factor (number of objects per quad)
-	can grow too large to maintain amortized constant performance so more
-	quads are needed
+	struct LoadStats {
+		size_t numQuads = 0;
+		size_t numOccupiedQuads = 0;
 
-	static void Resize(int quadSize);
-	*/
+		size_t numUnitEntries = 0;
+		size_t numFeatureEntries = 0;
+		size_t numProjectileEntries = 0;
+
+		size_t maxUnits = 0;
+		size_t maxFeatures = 0;
+		size_t maxProjectiles = 0;
+
+		int quadSize = 0;
+
+		// average number of object entries per occupied quad
+		float loadFactor = 0.0f;
+	};
 
 	void Init(int2 mapDims, int quadSize);
 	void Kill();
 
+	/**
+	 * In large games the average loading factor (number of objects per quad)
+	 * can grow too large to maintain amortized constant performance, so more
+	 * quads are needed. Update checks the load every LOAD_CHECK_RATE frames
+	 * and halves the quad size when modrules.system.quadFieldMaxLoadFactor
+	 * is exceeded, or doubles it again (up to BASE_QUAD_SIZE) once the load
+	 * has dropped below 1/COARSEN_LOAD_DIVISOR of that; must only be called
+	 * between sim-frames since every object is re-inserted (in a deterministic
+	 * order) by Resize.
+	 */
+	void Update();
+	void Resize(int quadSize);
+
+	LoadStats GetLoadStats() const;
+
 	void GetQuads(QuadFieldQuery& qfq, float3 pos, float radius);
+	void GetQuads(std::vector<int>& quads, float3 pos, float radius) const;
 	void GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
 	void GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const float3& dir, float length);
 
@@ -103,6 +129,19 @@ public:
 		std::vector<CFeature*>& features,
 		std::vector<CPlasmaRepulser*>* repulsers = nullptr
 	);
+	/**
+	 * Same as above but safe to call concurrently (while no objects
+	 * are moved): does not mark objects with tempNum and uses the
+	 * caller's quad buffer, returns objects in the same order
+	 */
+	void GetUnitsAndFeaturesColVol(
+		const float3& pos,
+		const float radius,
+		std::vector<int>& quads,
+		std::vector<CUnit*>& units,
+		std::vector<CFeature*>& features,
+		std::vector<CPlasmaRepulser*>& repulsers
+	) const;
 
 	/**
 	 * Returns all units within @c radius of @c pos,
@@ -120,6 +159,11 @@ public:
 	 * mins and maxs, which extends infinitely along the y-axis
 	 */
 	void GetUnitsExact(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
+	/**
+	 * Returns all units in the quads overlapping the rectangle defined by
+	 * mins and maxs, without testing their positions (callers filter)
+	 */
+	void GetUnitsRectangle(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
 	/**
 	 * Returns all features within @c radius of @c pos,
 	 * takes the 3D model radius of each feature into account,
@@ -132,6 +176,14 @@ public:
 	 */
 	void GetFeaturesExact(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
 
+	/**
+	 * Same as the spherical GetUnitsExact and GetFeaturesExact but safe to
+	 * call concurrently (while no objects are moved, e.g. from asynchronous
+	 * skirmish AI's between sim-frames), see GetUnitsAndFeaturesColVol
+	 */
+	void GetUnitsExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CUnit*>& units) const;
+	void GetFeaturesExact(const float3& pos, float radius, std::vector<int>& quads, std::vector<CFeature*>& features) const;
+
 	void GetProjectilesExact(QuadFieldQuery& qfq, const float3& pos, float radius);
 	void GetProjectilesExact(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
 
@@ -229,7 +281,39 @@ public:
 	int GetQuadSizeX() const { return quadSizeX; }
 	int GetQuadSizeZ() const { return quadSizeZ; }
 
+	/// side-length (in heightmap squares) of the grid-cells to pass to CReadMap::GridVisibility
+	int GetGridCellSize() const { return std::max(1, std::min(quadSizeX, quadSizeZ) / SQUARE_SIZE); }
+
+	/**
+	 * Calls func with the index of every quad overlapping cell (x, z) of a
+	 * GridVisibility pass with GetGridCellSize() cells; since quads are not
+	 * necessarily square, a cell can overlap two quads along either axis
+	 */
+	template<typename F> void ForEachGridCellQuad(int x, int z, F&& func) const {
+		const int cellSize = GetGridCellSize() * SQUARE_SIZE;
+
+		if (x < 0 || z < 0)
+			return;
+
+		const int qx0 = (x * cellSize) / quadSizeX;
+		const int qz0 = (z * cellSize) / quadSizeZ;
+		const int qx1 = std::min(((x + 1) * cellSize - 1) / quadSizeX, numQuadsX - 1);
+		const int qz1 = std::min(((z + 1) * cellSize - 1) / quadSizeZ, numQuadsZ - 1);
+
+		for (int qz = qz0; qz <= qz1; qz++) {
+			for (int qx = qx0; qx <= qx1; qx++) {
+				func(numQuadsX * qz + qx);
+			}
+		}
+	}
+
+	// changes whenever any unit enters or leaves any quad
+	unsigned int GetUnitQuadsVersion() const { return unitQuadsVersion; }
+
 	constexpr static unsigned int BASE_QUAD_SIZE = 128;
+	constexpr static unsigned int MIN_QUAD_SIZE = BASE_QUAD_SIZE / 4;
+	constexpr static unsigned int LOAD_CHECK_RATE = GAME_SPEED * 10;
+	constexpr static float COARSEN_LOAD_DIVISOR = 8.0f;
 
 private:
 	int2 WorldPosToQuadField(const float3 p) const;
@@ -252,6 +336,8 @@ private:
 
 	int quadSizeX;
 	int quadSizeZ;
+
+	unsigned int unitQuadsVersion = 0;
 };
 
 extern CQuadField quadField;
@@ -1,22 +1,39 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <array>
 #include <vector>
 #include <cassert>
+#include <cmath>
 #include <limits>
 
 #include "SmoothHeightMesh.h"
 
 #include "Map/Ground.h"
 #include "Map/ReadMap.h"
+#include "Sim/Misc/GlobalConstants.h"
 #include "System/float3.h"
 #include "System/SpringMath.h"
+#include "System/Misc/SpringTime.h"
 #include "System/TimeProfiler.h"
+#include "System/Log/ILog.h"
 #include "System/Threading/ThreadPool.h"
 
 
 
 SmoothHeightMesh smoothGround;
 
+CR_BIND(SmoothHeightMesh, ())
+CR_REG_METADATA(SmoothHeightMesh, (
+	CR_MEMBER(maxHeight),
+	CR_MEMBER(mesh),
+	CR_MEMBER(origMesh)
+))
+
+static constexpr int BLUR_SIZE = 3;
+static constexpr int NUM_BLURS = 3; // (horizontal, vertical) pass-pairs
+
+static std::array<std::vector<int>, ThreadPool::MAX_THREADS> windowIndices;
+
 
 static float Interpolate(float x, float y, const int maxx, const int maxy, const float res, const float* heightmap)
 {
@@ -56,6 +73,12 @@ void SmoothHeightMesh::Kill() {
 
 	mesh.clear();
 	origMesh.clear();
+
+	colsMaxima.clear();
+	maximaRows.clear();
+	heights.clear();
+	blurBuffers[0].clear();
+	blurBuffers[1].clear();
 }
 
 
@@ -253,7 +276,9 @@ inline static void FixRemainingMaxima(
 
 inline static void BlurHorizontal(
 	const int maxx,
-	const int maxy,
+	const int firstRow,
+	const int lastRow,
+	const int offset,
 	const int blurSize,
 	const float resolution,
 	const std::vector<float>& mesh,
@@ -263,15 +288,16 @@ inline static void BlurHorizontal(
 	const float recipn = 1.0f / n;
 	const int lineSize = maxx + 1;
 
-	for_mt(0, maxy+1, [&](const int y) {
+	// rows [firstRow, lastRow] are stored starting at index <offset>
+	for_mt(firstRow, lastRow+1, [&](const int y) {
 		float avg = 0.0f;
 
 		for (int x = 0; x <= 2 * blurSize; ++x) {
-			avg += mesh[x + y * lineSize];
+			avg += mesh[x + y * lineSize - offset];
 		}
 
 		for (int x = 0; x <= maxx; ++x) {
-			const int idx = x + y * lineSize;
+			const int idx = x + y * lineSize - offset;
 
 			if (x <= blurSize || x > (maxx - blurSize)) {
 				// map-border case
@@ -281,7 +307,7 @@ inline static void BlurHorizontal(
 				const int xend   = std::min(x + blurSize, maxx);
 
 				for (int x1 = xstart; x1 <= xend; ++x1) {
-					smoothed[idx] += mesh[x1 + y * lineSize];
+					smoothed[idx] += mesh[x1 + y * lineSize - offset];
 				}
 
 				const float gh = CGround::GetHeightAboveWater(x * resolution, y * resolution);
@@ -359,6 +385,51 @@ inline static void BlurVertical(
 
 
 
+inline static void BlurVerticalRows(
+	const int maxx,
+	const int maxy,
+	const int firstRow,
+	const int lastRow,
+	const int offset,
+	const int blurSize,
+	const float resolution,
+	const std::vector<float>& mesh,
+	      std::vector<float>& smoothed
+) {
+	const float n = 2.0f * blurSize + 1.0f;
+	const float recipn = 1.0f / n;
+	const int lineSize = maxx + 1;
+
+	// like BlurVertical, but only for rows [firstRow, lastRow] (stored at
+	// index <offset>) and without a running sum since the column is entered
+	// midway; non-border windows are summed directly, which can differ from
+	// a full rebuild in the last bits
+	for_mt(0, maxx+1, [&](const int x) {
+		for (int y = firstRow; y <= lastRow; ++y) {
+			const int idx = x + y * lineSize - offset;
+
+			const int ystart = std::max(y - blurSize, 0);
+			const int yend   = std::min(y + blurSize, maxy);
+
+			float sum = 0.0f;
+
+			for (int y1 = ystart; y1 <= yend; ++y1) {
+				sum += mesh[x + y1 * lineSize - offset];
+			}
+
+			const float gh = CGround::GetHeightAboveWater(x * resolution, y * resolution);
+			const bool border = (y <= blurSize || y > (maxy - blurSize));
+			const float sh = border? (sum / (yend - ystart + 1)): (recipn * sum);
+
+			smoothed[idx] = std::min(readMap->GetCurrMaxHeight(), std::max(gh, sh));
+
+			assert(smoothed[idx] <= std::max(readMap->GetCurrMaxHeight(), 0.0f));
+		}
+	});
+}
+
+
+
 inline static void CheckInvariants(
 	int y,
 	int maxx,
@@ -386,6 +457,49 @@ inline static void CheckInvariants(
 
 
 
+// out[j - c] = max(in[i - a]) for i in [max(a, j - winSize), min(b, j + winSize)]
+// and j in [c, d]; uses a monotonic queue, so every input is touched only twice
+static void SlidingWindowMax(
+	const float* in,
+	const int inStride,
+	float* out,
+	const int outStride,
+	const int a,
+	const int b,
+	const int c,
+	const int d,
+	const int winSize
+) {
+	std::vector<int>& indices = windowIndices[ThreadPool::GetThreadNum()];
+	indices.resize(b - a + 1);
+
+	int head = 0;
+	int tail = 0;
+	int next = a;
+
+	for (int j = c; j <= d; ++j) {
+		const int lo = std::max(a, j - winSize);
+		const int hi = std::min(b, j + winSize);
+
+		for (; next <= hi; ++next) {
+			const float h = in[(next - a) * inStride];
+
+			// anything not higher than the new value can never be the maximum again
+			while (tail > head && in[(indices[tail - 1] - a) * inStride] <= h)
+				--tail;
+
+			indices[tail++] = next;
+		}
+
+		while (indices[head] < lo)
+			++head;
+
+		out[(j - c) * outStride] = in[(indices[head] - a) * inStride];
+	}
+}
+
+
+
 void SmoothHeightMesh::MakeSmoothMesh()
 {
 	ScopedOnceTimer timer("SmoothHeightMesh::MakeSmoothMesh");
@@ -404,13 +518,28 @@ void SmoothHeightMesh::MakeSmoothMesh()
 	//   ...
 	//   Nth row has indices [maxx*(N-1) + (N-1), maxx*(N) + (N-1)] inclusive
 	//
+	//   FindRadialMaximum writes rows with stride <maxx> but the blur-passes
+	//   read them with stride <maxx + 1>; SmoothMeshRows has to follow this
+	//
 	// use sliding window of maximums to reduce computational complexity
 	const     int winSize = smoothRadius / resolution;
-	constexpr int blurSize = 3;
+	constexpr int blurSize = BLUR_SIZE;
 
-	assert(mesh.empty());
-	mesh.resize((maxx + 1) * (maxy + 1), 0.0f);
-	origMesh.resize((maxx + 1) * (maxy + 1), 0.0f);
+	// the first buffer must start out zeroed, FindRadialMaximum leaves its tail untouched
+	std::vector<float>& smoothed = blurBuffers[0];
+	std::vector<float>& scratch = blurBuffers[1];
+
+	smoothed.clear();
+	smoothed.resize((maxx + 1) * (maxy + 1), 0.0f);
+	scratch.clear();
+	scratch.resize((maxx + 1) * (maxy + 1), 0.0f);
+
+	if (mesh.empty()) {
+		mesh.resize((maxx + 1) * (maxy + 1), 0.0f);
+		origMesh.resize((maxx + 1) * (maxy + 1), 0.0f);
+	}
+
+	maxHeight = readMap->GetCurrMaxHeight();
 
 	colsMaxima.clear();
 	colsMaxima.resize(maxx + 1, -std::numeric_limits<float>::max());
@@ -421,7 +550,7 @@ void SmoothHeightMesh::MakeSmoothMesh()
 
 	for (int y = 0; y <= maxy; ++y) {
 		AdvanceMaximaRows(y, maxx, resolution, colsMaxima, maximaRows);
-		FindRadialMaximum(y, maxx, winSize, resolution, colsMaxima, mesh);
+		FindRadialMaximum(y, maxx, winSize, resolution, colsMaxima, smoothed);
 		FixRemainingMaxima(y, maxx, maxy, winSize, resolution, colsMaxima, maximaRows);
 
 #ifdef _DEBUG
@@ -430,11 +559,210 @@ void SmoothHeightMesh::MakeSmoothMesh()
 	}
 
 	// actually smooth with approximate Gaussian blur passes
-	for (int numBlurs = 3; numBlurs > 0; --numBlurs) {
-		BlurHorizontal(maxx, maxy, blurSize, resolution, mesh, origMesh); mesh.swap(origMesh);
-		BlurVertical(maxx, maxy, blurSize, resolution, mesh, origMesh); mesh.swap(origMesh);
+	for (int numBlurs = NUM_BLURS; numBlurs > 0; --numBlurs) {
+		BlurHorizontal(maxx, 0, maxy, 0, blurSize, resolution, smoothed, scratch); smoothed.swap(scratch);
+		BlurVertical(maxx, maxy, blurSize, resolution, smoothed, scratch); smoothed.swap(scratch);
+	}
+
+	// <smoothed> now contains the final smoothed heightmap
+	StoreSmoothedMesh(smoothed.data(), 0, smoothed.size() - 1);
+}
+
+void SmoothHeightMesh::SmoothMeshRows(int firstRow, int lastRow)
+{
+	const int winSize = smoothRadius / resolution;
+	const int lineSize = maxx + 1;
+	const int lastMaxIdx = (maxy + 1) * maxx;
+
+	// rows the first blur-pass needs as input, the index-range they span,
+	// the rows of (stride <maxx>) maxima filling that range and the rows
+	// of heights those maxima are taken over
+	const int bufRow1 = std::max(firstRow - BLUR_SIZE * NUM_BLURS, 0);
+	const int bufRow2 = std::min(lastRow + BLUR_SIZE * NUM_BLURS, maxy);
+	const int bufIdx1 = bufRow1 * lineSize;
+	const int bufIdx2 = (bufRow2 + 1) * lineSize - 1;
+	const int maxRow1 = bufIdx1 / maxx;
+	const int maxRow2 = std::min(bufIdx2 / maxx, maxy);
+	const int hgtRow1 = std::max(maxRow1 - winSize, 0);
+	const int hgtRow2 = std::min(maxRow2 + winSize, maxy);
+
+	const int numMaxRows = maxRow2 - maxRow1 + 1;
+
+	heights.resize((hgtRow2 - hgtRow1 + 1) * lineSize);
+	colsMaxima.resize(numMaxRows * lineSize);
+	blurBuffers[0].resize(std::max(bufIdx2 - bufIdx1 + 1, numMaxRows * lineSize));
+	blurBuffers[1].resize(std::max(bufIdx2 - bufIdx1 + 1, numMaxRows * lineSize));
+
+	std::vector<float>& smoothed = blurBuffers[0];
+	std::vector<float>& scratch = blurBuffers[1];
+
+	for_mt(hgtRow1, hgtRow2 + 1, [&](const int y) {
+		for (int x = 0; x <= maxx; ++x) {
+			heights[(y - hgtRow1) * lineSize + x] = CGround::GetHeightAboveWater(x * resolution, y * resolution);
+		}
+	});
+
+	// the maximum over a square window is separable: first per column, then along rows
+	for_mt(0, maxx + 1, [&](const int x) {
+		SlidingWindowMax(&heights[x], lineSize, &colsMaxima[x], lineSize, hgtRow1, hgtRow2, maxRow1, maxRow2, winSize);
+	});
+	for_mt(0, numMaxRows, [&](const int y) {
+		SlidingWindowMax(&colsMaxima[y * lineSize], 1, &scratch[y * lineSize], 1, 0, maxx, 0, maxx, winSize);
+	});
+
+	// lay the maxima out the way FindRadialMaximum does: each row overwrites
+	// the last maximum of the row before, only the very last one survives
+	for (int i = bufIdx1; i <= bufIdx2; ++i) {
+		if (i < lastMaxIdx) {
+			smoothed[i - bufIdx1] = scratch[(i / maxx - maxRow1) * lineSize + (i % maxx)];
+		} else if (i == lastMaxIdx) {
+			smoothed[i - bufIdx1] = scratch[(maxy - maxRow1) * lineSize + maxx];
+		} else {
+			smoothed[i - bufIdx1] = 0.0f;
+		}
 	}
 
-	// <mesh> now contains the final smoothed heightmap, save it in origMesh
-	std::copy(mesh.begin(), mesh.end(), origMesh.begin());
+	// each vertical pass leaves BLUR_SIZE fewer rows at either (non-map) edge valid
+	int blurRow1 = bufRow1;
+	int blurRow2 = bufRow2;
+
+	for (int numBlurs = NUM_BLURS; numBlurs > 0; --numBlurs) {
+		BlurHorizontal(maxx, blurRow1, blurRow2, bufIdx1, BLUR_SIZE, resolution, smoothed, scratch); smoothed.swap(scratch);
+
+		blurRow1 += (BLUR_SIZE * (blurRow1 > 0));
+		blurRow2 -= (BLUR_SIZE * (blurRow2 < maxy));
+
+		BlurVerticalRows(maxx, maxy, blurRow1, blurRow2, bufIdx1, BLUR_SIZE, resolution, smoothed, scratch); smoothed.swap(scratch);
+	}
+
+	assert(blurRow1 <= firstRow && blurRow2 >= lastRow);
+
+	StoreSmoothedMesh(&smoothed[firstRow * lineSize - bufIdx1], firstRow * lineSize, (lastRow + 1) * lineSize - 1);
+}
+
+void SmoothHeightMesh::StoreSmoothedMesh(const float* smoothed, int firstIdx, int lastIdx)
+{
+	// Lua modifications are kept as offsets relative to the original mesh
+	for (int i = firstIdx; i <= lastIdx; ++i) {
+		mesh[i] = smoothed[i - firstIdx] + (mesh[i] - origMesh[i]);
+		origMesh[i] = smoothed[i - firstIdx];
+	}
+}
+
+void SmoothHeightMesh::UpdateSmoothMesh(const SRectangle& hgtMapRect)
+{
+	if (mesh.empty())
+		return;
+
+	// a new maximum changes the clamping of every blur-pass
+	if (maxHeight != readMap->GetCurrMaxHeight()) {
+		MakeSmoothMesh();
+		return;
+	}
+
+	// ground heights are interpolated, so a changed corner affects
+	// every sample less than one heightmap square away from it
+	const float scale = SQUARE_SIZE / resolution;
+	const SRectangle dirtyRect = {
+		std::max(int(std::floor((hgtMapRect.x1 - 1) * scale)), 0),
+		std::max(int(std::floor((hgtMapRect.z1 - 1) * scale)), 0),
+		std::min(int(std::ceil((hgtMapRect.x2 + 1) * scale)), maxx),
+		std::min(int(std::ceil((hgtMapRect.z2 + 1) * scale)), maxy),
+	};
+
+	if (dirtyRect.x1 > dirtyRect.x2 || dirtyRect.z1 > dirtyRect.z2)
+		return;
+
+	// every maximum whose window contains a changed sample, and the rows its
+	// (stride <maxx>) index falls into when read with stride <maxx + 1>
+	const int winSize = smoothRadius / resolution;
+	const int lineSize = maxx + 1;
+	const SRectangle maxRect = {
+		std::max(dirtyRect.x1 - winSize, 0),
+		std::max(dirtyRect.z1 - winSize, 0),
+		std::min(dirtyRect.x2 + winSize, maxx),
+		std::min(dirtyRect.z2 + winSize, maxy),
+	};
+
+	// the changed samples also clamp the blur-passes in their own rows, and
+	// every vertical pass spreads a change BLUR_SIZE rows further
+	const int firstRow = std::min(dirtyRect.z1, (maxRect.z1 * maxx + maxRect.x1) / lineSize);
+	const int lastRow = std::max(dirtyRect.z2, (maxRect.z2 * maxx + maxRect.x2) / lineSize);
+
+	SmoothMeshRows(std::max(firstRow - BLUR_SIZE * NUM_BLURS, 0), std::min(lastRow + BLUR_SIZE * NUM_BLURS, maxy));
+}
+
+
+void SmoothHeightMesh::BenchmarkRegionUpdates(int numUpdates, int hgtMapRadius)
+{
+	if (mesh.empty())
+		return;
+
+	// this runs unsynced between two frames, so the synced heightmap is dented
+	// in place and everything gets put back afterwards; CReadMap::SetHeight is
+	// bypassed to leave the (synced) height-bounds alone, hence the craters do
+	// not dig below the current minimum height
+	float* heightMap = const_cast<float*>(readMap->GetCornerHeightMapSynced());
+
+	const std::vector<float> liveHeightMap(heightMap, heightMap + mapDims.mapxp1 * mapDims.mapyp1);
+	const std::vector<float> liveMesh = mesh;
+	const std::vector<float> liveOrigMesh = origMesh;
+
+	const float minHeight = readMap->GetCurrMinHeight();
+	const float depth = hgtMapRadius * SQUARE_SIZE * 0.5f;
+
+	// fixed pseudo-random crater positions so runs are comparable
+	unsigned int seed = 0x2545F491u;
+
+	spring_time updateTime = spring_notime;
+
+	for (int i = 0; i < numUpdates; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		const int x = (seed >> 8) % (mapDims.mapx + 1);
+		seed = seed * 1664525u + 1013904223u;
+		const int z = (seed >> 8) % (mapDims.mapy + 1);
+
+		for (int cz = std::max(z - hgtMapRadius, 0); cz <= std::min(z + hgtMapRadius, mapDims.mapy); cz++) {
+			for (int cx = std::max(x - hgtMapRadius, 0); cx <= std::min(x + hgtMapRadius, mapDims.mapx); cx++) {
+				const float d = math::sqrt(float(Square(cx - x) + Square(cz - z))) / hgtMapRadius;
+
+				if (d >= 1.0f)
+					continue;
+
+				float& h = heightMap[cz * mapDims.mapxp1 + cx];
+				h = std::max(minHeight, h - depth * (1.0f - d * d));
+			}
+		}
+
+		const spring_time t = spring_gettime();
+
+		UpdateSmoothMesh({x - hgtMapRadius, z - hgtMapRadius, x + hgtMapRadius, z + hgtMapRadius});
+
+		updateTime += (spring_gettime() - t);
+	}
+
+	const std::vector<float> incrOrigMesh = origMesh;
+	const spring_time t0 = spring_gettime();
+
+	MakeSmoothMesh();
+
+	const spring_time t1 = spring_gettime();
+
+	float maxDiff = 0.0f;
+
+	for (size_t i = 0; i < origMesh.size(); i++) {
+		maxDiff = std::max(maxDiff, std::fabs(origMesh[i] - incrOrigMesh[i]));
+	}
+
+	std::copy(liveHeightMap.begin(), liveHeightMap.end(), heightMap);
+	mesh = liveMesh;
+	origMesh = liveOrigMesh;
+
+	const float fullTime = (t1 - t0).toMilliSecsf();
+	const float incrTime = updateTime.toMilliSecsf() / std::max(numUpdates, 1);
+
+	LOG("[SmoothHeightMesh::%s] %dx%d mesh, %d craters of radius %d", __func__, maxx + 1, maxy + 1, numUpdates, hgtMapRadius);
+	LOG("\tfull rebuild %.3fms, incremental update %.3fms (%.1fx), max. deviation from full rebuild %g",
+		fullTime, incrTime, fullTime / std::max(incrTime, 0.001f), maxDiff
+	);
 }
@@ -5,17 +5,32 @@
 
 #include <vector>
 
+#include "System/Rectangle.h"
+#include "System/creg/creg_cond.h"
+
 class CGround;
 
 /**
  * Provides a GetHeight(x, y) of its own that smooths the mesh.
+ *
+ * The mesh follows synced heightmap changes: the rows a damaged rectangle
+ * can influence get re-smoothed, which matches a full rebuild up to float
+ * rounding. Since it is therefore no longer a pure function of the current
+ * heightmap, it is part of saved games.
  */
 class SmoothHeightMesh
 {
+	CR_DECLARE_STRUCT(SmoothHeightMesh)
+
 public:
 	void Init(float mx, float my, float res, float smoothRad);
 	void Kill();
 
+	/// re-smooths the part of the mesh influenced by a changed heightmap-rectangle (inclusive, in heightmap squares)
+	void UpdateSmoothMesh(const SRectangle& hgtMapRect);
+	/// times a full rebuild against <numUpdates> crater updates of <hgtMapRadius> squares, then restores map and mesh
+	void BenchmarkRegionUpdates(int numUpdates, int hgtMapRadius);
+
 	float GetHeight(float x, float y);
 	float GetHeightAboveWater(float x, float y);
 	float SetHeight(int index, float h);
@@ -33,6 +48,9 @@ public:
 
 private:
 	void MakeSmoothMesh();
+	/// recomputes the smoothed heights of mesh rows [firstRow, lastRow]
+	void SmoothMeshRows(int firstRow, int lastRow);
+	void StoreSmoothedMesh(const float* smoothed, int firstIdx, int lastIdx);
 
 	int maxx = 0;
 	int maxy = 0;
@@ -40,12 +58,17 @@ private:
 	float fmaxy = 0.0f;
 	float resolution = 0.0f;
 	float smoothRadius = 0.0f;
+	/// readMap->GetCurrMaxHeight() at the time of the last full build, clamps every blur-pass
+	float maxHeight = 0.0f;
 
 	std::vector<float> mesh;
 	std::vector<float> origMesh;
 
+	// scratch buffers
+	std::vector<float> heights;
 	std::vector<float> colsMaxima;
 	std::vector<int> maximaRows;
+	std::vector<float> blurBuffers[2];
 };
 
 extern SmoothHeightMesh smoothGround;
@@ -34,6 +34,7 @@
 #include "System/type2.h"
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/HsiehHash.h"
+#include "System/Threading/ThreadPool.h"
 
 #if 1
 #include "Rendering/IPathDrawer.h"
@@ -137,6 +138,14 @@ CR_REG_METADATA(CGroundMoveType, (
 	CR_MEMBER(useMainHeading),
 	CR_MEMBER(useRawMovement),
 
+	CR_IGNORED(mtWantedDir),
+	CR_IGNORED(mtSteerDir),
+	CR_IGNORED(mtSpeedVector),
+	CR_IGNORED(mtFrame),
+	CR_IGNORED(mtOldHeading),
+	CR_IGNORED(mtDeltaHeading),
+	CR_IGNORED(mtWantReverse),
+
 	CR_POSTLOAD(PostLoad)
 ))
 
@@ -165,6 +174,49 @@ static CGroundMoveType::MemberData gmtMemberData = {
 };
 
 
+// unit-unit collisions deferred by HandleUnitCollisions (movement.batchUnitCollisions)
+// and resolved in one sort-and-sweep pass per frame; buffers only, empty between frames
+static struct UnitCollisionSweep {
+	struct Entry {
+		float minX;
+		float maxX;
+		float minZ;
+		float maxZ;
+
+		CUnit* unit;
+		// index into colliders, -1 if the unit is only collided with
+		int colliderIdx;
+	};
+	struct Pair {
+		int colliderIdx;
+		CUnit* collidee;
+	};
+
+	// in update order; the move-type is kept separately since it might
+	// have been replaced (and deleted) by the time the pass runs
+	std::vector< std::pair<CUnit*, CGroundMoveType*> > colliders;
+	// colliders sorted by minX, merged into clusters for the quadfield queries
+	std::vector<int> sortedColliders;
+
+	std::vector<Entry> entries;
+	std::vector<Pair> pairs;
+	std::vector<CUnit*> collidees;
+
+	// per unit-id, index into entries or -1
+	std::vector<int> entryIndices;
+} unitCollisionSweep;
+
+// move-types accepted by PrepareUpdateMT this frame, in update order;
+// emptied by UpdateQueuedMT (movement.parallelUnitMovement)
+static struct MoveTypeUpdateQueueMT {
+	std::vector<CGroundMoveType*> moveTypes;
+
+	// used by the parallel-vs-serial check
+	std::vector<CGroundMoveType::MotionStateMT> initStates;
+	std::vector<CGroundMoveType::MotionStateMT> parallelStates;
+} moveTypeUpdateQueueMT;
+
+
 
 
 namespace SAT {
@@ -285,7 +337,7 @@ static void HandleUnitCollisionsAux(
 
 
 
-static float3 CalcSpeedVectorInclGravity(const CUnit* owner, const CGroundMoveType* mt, float hAcc, float vAcc) {
+static float3 CalcSpeedVectorInclGravity(const CUnit* owner, const CGroundMoveType* mt, const float3& frontDir, const float3& rightDir, float hAcc, float vAcc) {
 	float3 newSpeedVector;
 
 	// NOTE:
@@ -302,7 +354,7 @@ static float3 CalcSpeedVectorInclGravity(const CUnit* owner, const CGroundMoveTy
 	// use terrain-tangent vector because it does not
 	// depend on UnitDef::upright (unlike o->frontdir)
 	const float3& gndNormVec = mt->GetGroundNormal(ownerPos);
-	const float3  gndTangVec = gndNormVec.cross(owner->rightdir);
+	const float3  gndTangVec = gndNormVec.cross(rightDir);
 	const float3& flatFrontDir = mt->GetFlatFrontDir();
 
 	const int dirSign = Sign(flatFrontDir.dot(ownerSpd));
@@ -337,12 +389,12 @@ static float3 CalcSpeedVectorInclGravity(const CUnit* owner, const CGroundMoveTy
 	return newSpeedVector;
 }
 
-static float3 CalcSpeedVectorExclGravity(const CUnit* owner, const CGroundMoveType* mt, float hAcc, float vAcc) {
+static float3 CalcSpeedVectorExclGravity(const CUnit* owner, const CGroundMoveType* mt, const float3& frontDir, const float3& rightDir, float hAcc, float vAcc) {
 	// LuaSyncedCtrl::SetUnitVelocity directly assigns
 	// to owner->speed which gets overridden below, so
 	// need to calculate hSpeedScale from it (not from
 	// currentSpeed) directly
-	return (owner->frontdir * (owner->speed.w * Sign(int(!mt->IsReversing())) + hAcc));
+	return (frontDir * (owner->speed.w * Sign(int(!mt->IsReversing())) + hAcc));
 }
 
 
@@ -503,7 +555,7 @@ bool CGroundMoveType::Update()
 	// these must be executed even when stunned (so
 	// units do not get buried by restoring terrain)
 	UpdateOwnerAccelAndHeading();
-	UpdateOwnerPos(owner->speed, calcSpeedVectorFuncs[modInfo.allowGroundUnitGravity](owner, this, deltaSpeed, myGravity));
+	UpdateOwnerPos(owner->speed, calcSpeedVectorFuncs[modInfo.allowGroundUnitGravity](owner, this, owner->frontdir, owner->rightdir, deltaSpeed, myGravity));
 	HandleObjectCollisions();
 	AdjustPosToWaterLine();
 
@@ -515,6 +567,212 @@ bool CGroundMoveType::Update()
 	return (OwnerMoved(heading, owner->pos - oldPos, float3(float3::cmp_eps(), float3::cmp_eps() * 1e-2f, float3::cmp_eps())));
 }
 
+// first (serial) pass of the split update, see UpdateQueuedMT
+// only plain path-following is split, everything else (skidding,
+// falling, stunned, FPS-controlled or stopping units) takes the
+// regular Update in CommitUpdateMT
+bool CGroundMoveType::PrepareUpdateMT()
+{
+	ASSERT_SYNCED(owner->pos);
+
+	if (owner->GetTransporter() != nullptr)
+		return false;
+	if (owner->IsSkidding() || owner->IsFalling() || owner->IsFlying())
+		return false;
+	if (owner->IsStunned() || owner->beingBuilt)
+		return false;
+	if (owner->UnderFirstPersonControl())
+		return false;
+	if (WantToStop())
+		return false;
+	if (OnSlope(1.0f))
+		return false;
+
+	mtFrame = gs->frameNum;
+	mtOldHeading = owner->heading;
+	mtWantReverse = FollowWayPoints();
+	mtWantedDir = mix(flatFrontDir, waypointDir * Sign(int(!mtWantReverse)), !atGoal);
+
+	pathManager->UpdatePath(owner, pathID);
+
+	moveTypeUpdateQueueMT.moveTypes.push_back(this);
+	return true;
+}
+
+// last (serial) pass of the split update, the remainder of Update
+bool CGroundMoveType::CommitUpdateMT()
+{
+	if (mtFrame != gs->frameNum)
+		return (Update());
+
+	mtFrame = -1;
+
+	// loaded into a transport by a script or Lua callin of an earlier unit
+	if (owner->GetTransporter() != nullptr)
+		return false;
+	// knocked into skidding (or off a cliff) by an earlier unit's collision
+	if (owner->IsSkidding() || owner->IsFalling())
+		return (Update());
+
+	ASSERT_SYNCED(owner->pos);
+
+	// the part of ChangeHeading that touches the owner
+	if (!owner->IsFlying()) {
+		const short absDeltaHeading = mtDeltaHeading * Sign(mtDeltaHeading);
+
+		if (absDeltaHeading >= minScriptChangeHeading)
+			owner->script->ChangeHeading(mtDeltaHeading);
+
+		owner->AddHeading(mtDeltaHeading, !owner->upright && owner->IsOnGround(), owner->IsInAir());
+
+		flatFrontDir = (owner->frontdir * XZVector).Normalize();
+	}
+
+	UpdateOwnerPos(owner->speed, mtSpeedVector);
+	HandleObjectCollisions();
+	AdjustPosToWaterLine();
+
+	ASSERT_SANE_OWNER_SPEED(owner->speed);
+
+	return (OwnerMoved(mtOldHeading, owner->pos - oldPos, float3(float3::cmp_eps(), float3::cmp_eps() * 1e-2f, float3::cmp_eps())));
+}
+
+void CGroundMoveType::UpdateSteeringMT()
+{
+	// move-type replaced (by MoveCtrl) after it was queued
+	if (owner->moveType != this)
+		return;
+
+	mtSteerDir = GetObstacleAvoidanceDir(mtWantedDir, true);
+}
+
+// ChangeHeading and ChangeSpeed plus the speed-vector of Update, but only
+// computing the new heading and direction vectors instead of applying them
+void CGroundMoveType::UpdateMotionMT()
+{
+	if (owner->moveType != this)
+		return;
+
+	const short newHeading = GetHeadingFromVector(mtSteerDir.x, mtSteerDir.z);
+
+	#if (MODEL_TURN_INERTIA == 0)
+	mtDeltaHeading = pathController.GetDeltaHeading(pathID, (wantedHeading = newHeading), owner->heading, turnRate);
+	#else
+	mtDeltaHeading = pathController.GetDeltaHeading(pathID, (wantedHeading = newHeading), owner->heading, turnRate, turnAccel, BrakingDistance(turnSpeed, turnAccel), &turnSpeed);
+	#endif
+
+	// same as CSolidObject::SetHeading
+	const short heading = owner->heading + mtDeltaHeading;
+
+	const float3 upDir = owner->GetWantedUpDir(!owner->upright && owner->IsOnGround(), owner->IsInAir());
+	const float3 rightDir = (GetVectorFromHeading(heading).cross(upDir)).Normalize();
+	const float3 frontDir = upDir.cross(rightDir);
+
+	flatFrontDir = (frontDir * XZVector).Normalize();
+
+	ChangeSpeed(maxWantedSpeed, mtWantReverse, false, heading);
+
+	mtSpeedVector = calcSpeedVectorFuncs[modInfo.allowGroundUnitGravity](owner, this, frontDir, rightDir, deltaSpeed, myGravity);
+}
+
+CGroundMoveType::MotionStateMT CGroundMoveType::GetMotionStateMT() const
+{
+	MotionStateMT state = {};
+
+	state.flatFrontDir = flatFrontDir;
+	state.lastAvoidanceDir = lastAvoidanceDir;
+	state.steerDir = mtSteerDir;
+	state.speedVector = mtSpeedVector;
+
+	state.ownerSpeed = owner->speed.w;
+	state.turnSpeed = turnSpeed;
+	state.wantedSpeed = wantedSpeed;
+	state.currentSpeed = currentSpeed;
+	state.deltaSpeed = deltaSpeed;
+
+	state.nextObstacleAvoidanceFrame = nextObstacleAvoidanceFrame;
+
+	state.wantedHeading = wantedHeading;
+	state.deltaHeading = mtDeltaHeading;
+	return state;
+}
+
+void CGroundMoveType::SetMotionStateMT(const MotionStateMT& state)
+{
+	flatFrontDir = state.flatFrontDir;
+	lastAvoidanceDir = state.lastAvoidanceDir;
+	mtSteerDir = state.steerDir;
+	mtSpeedVector = state.speedVector;
+
+	owner->speed.w = state.ownerSpeed;
+	turnSpeed = state.turnSpeed;
+	wantedSpeed = state.wantedSpeed;
+	currentSpeed = state.currentSpeed;
+	deltaSpeed = state.deltaSpeed;
+
+	nextObstacleAvoidanceFrame = state.nextObstacleAvoidanceFrame;
+
+	wantedHeading = state.wantedHeading;
+	mtDeltaHeading = state.deltaHeading;
+}
+
+unsigned int CGroundMoveType::UpdateQueuedMT(bool parallel, bool check)
+{
+	MoveTypeUpdateQueueMT& queue = moveTypeUpdateQueueMT;
+
+	std::vector<CGroundMoveType*>& moveTypes = queue.moveTypes;
+
+	// steering reads the positions and speeds of all units, the motion pass
+	// writes speed.w; each pass must finish before the next one can start
+	const auto UpdateMoveTypes = [&](bool mt) {
+		if (mt) {
+			for_mt(0, moveTypes.size(), [&](const int i) { moveTypes[i]->UpdateSteeringMT(); });
+			for_mt(0, moveTypes.size(), [&](const int i) { moveTypes[i]->UpdateMotionMT(); });
+		} else {
+			for (CGroundMoveType* mt: moveTypes) { mt->UpdateSteeringMT(); }
+			for (CGroundMoveType* mt: moveTypes) { mt->UpdateMotionMT(); }
+		}
+	};
+
+	if (!check) {
+		UpdateMoveTypes(parallel);
+	} else {
+		queue.initStates.clear();
+		queue.parallelStates.clear();
+
+		for (const CGroundMoveType* mt: moveTypes) {
+			queue.initStates.push_back(mt->GetMotionStateMT());
+		}
+
+		UpdateMoveTypes(true);
+
+		for (size_t i = 0, n = moveTypes.size(); i < n; i++) {
+			queue.parallelStates.push_back(moveTypes[i]->GetMotionStateMT());
+			moveTypes[i]->SetMotionStateMT(queue.initStates[i]);
+		}
+
+		UpdateMoveTypes(false);
+
+		for (size_t i = 0, n = moveTypes.size(); i < n; i++) {
+			const MotionStateMT serialState = moveTypes[i]->GetMotionStateMT();
+
+			if (std::memcmp(&serialState, &queue.parallelStates[i], sizeof(MotionStateMT)) == 0)
+				continue;
+
+			LOG_L(L_ERROR, "[GMT::%s][f=%d] unit %d: parallel and serial movement differ (heading %d vs %d, speed %f vs %f)",
+				__func__, gs->frameNum, moveTypes[i]->owner->id,
+				queue.parallelStates[i].deltaHeading, serialState.deltaHeading,
+				queue.parallelStates[i].speedVector.Length(), serialState.speedVector.Length()
+			);
+		}
+	}
+
+	const unsigned int numMoveTypes = moveTypes.size();
+
+	moveTypes.clear();
+	return numMoveTypes;
+}
+
 void CGroundMoveType::UpdateOwnerAccelAndHeading()
 {
 	if (owner->IsStunned() || owner->beingBuilt) {
@@ -676,86 +934,105 @@ bool CGroundMoveType::FollowPath()
 		SetMainHeading();
 		ChangeSpeed(0.0f, false);
 	} else {
-		ASSERT_SYNCED(currWayPoint);
-		ASSERT_SYNCED(nextWayPoint);
-		ASSERT_SYNCED(owner->pos);
+		const float3& ffd = flatFrontDir;
 
-		const float3& opos = owner->pos;
-		const float3& ovel = owner->speed;
-		const float3&  ffd = flatFrontDir;
-		const float3&  cwp = currWayPoint;
+		wantReverse = FollowWayPoints();
 
-		prevWayPointDist = currWayPointDist;
-		currWayPointDist = currWayPoint.distance2D(opos);
+		// apply obstacle avoidance (steering), prevent unit from chasing its own tail if already at goal
+		const float3  rawWantedDir = waypointDir * Sign(int(!wantReverse));
+		const float3& modWantedDir = GetObstacleAvoidanceDir(mix(ffd, rawWantedDir, !atGoal));
+		// const float3& modWantedDir = GetObstacleAvoidanceDir(mix(ffd, rawWantedDir, (!atGoal) && (wpProjDists.x > wpProjDists.y || wpProjDists.z < 0.995f)));
 
-		{
-			// NOTE:
-			//   uses owner->pos instead of currWayPoint (ie. not the same as atEndOfPath)
-			//
-			//   if our first command is a build-order, then goal-radius is set to our build-range
-			//   and we cannot increase tolerance safely (otherwise the unit might stop when still
-			//   outside its range and fail to start construction)
-			//
-			//   units moving faster than <minGoalDist> elmos per frame might overshoot their goal
-			//   the last two atGoal conditions will just cause flatFrontDir to be selected as the
-			//   "wanted" direction when this happens
-			const float curGoalDistSq = (opos - goalPos).SqLength2D();
-			const float minGoalDistSq = (UNIT_HAS_MOVE_CMD(owner))?
-				Square((goalRadius + extraRadius) * (numIdlingSlowUpdates + 1)):
-				Square((goalRadius + extraRadius)                             );
-			const float spdGoalDistSq = Square(currentSpeed * 1.05f);
+		ChangeHeading(GetHeadingFromVector(modWantedDir.x, modWantedDir.z));
+		ChangeSpeed(maxWantedSpeed, wantReverse);
+	}
 
-			atGoal |= (curGoalDistSq <= minGoalDistSq);
-			atGoal |= ((curGoalDistSq <= spdGoalDistSq) && !reversing && (ffd.dot(goalPos - opos) > 0.0f && ffd.dot(goalPos - (opos + ovel)) <= 0.0f));
-			atGoal |= ((curGoalDistSq <= spdGoalDistSq) &&  reversing && (ffd.dot(goalPos - opos) < 0.0f && ffd.dot(goalPos - (opos + ovel)) >= 0.0f));
-		}
+	pathManager->UpdatePath(owner, pathID);
+	return wantReverse;
+}
 
-		if (!atGoal) {
-			numIdlingUpdates -= ((numIdlingUpdates >                  0) * (1 - idling));
-			numIdlingUpdates += ((numIdlingUpdates < SPRING_MAX_HEADING) *      idling );
-		}
+/*
+ * Goal and waypoint bookkeeping part of FollowPath (everything before
+ * steering), also run by PrepareUpdateMT. Returns whether the owner
+ * wants to move in reverse toward its current waypoint.
+ */
+bool CGroundMoveType::FollowWayPoints()
+{
+	ASSERT_SYNCED(currWayPoint);
+	ASSERT_SYNCED(nextWayPoint);
+	ASSERT_SYNCED(owner->pos);
 
-		// atEndOfPath never becomes true when useRawMovement, except via StopMoving
-		if (!atEndOfPath && !useRawMovement) {
-			SetNextWayPoint();
-		} else {
-			if (atGoal)
-				Arrived(false);
-			else
-				ReRequestPath(false);
-		}
+	const float3& opos = owner->pos;
+	const float3& ovel = owner->speed;
+	const float3&  ffd = flatFrontDir;
+	const float3&  cwp = currWayPoint;
 
+	prevWayPointDist = currWayPointDist;
+	currWayPointDist = currWayPoint.distance2D(opos);
 
-		// set direction to waypoint AFTER requesting it; should not be a null-vector
-		// do not compare y-components since these usually differ and only x&z matter
-		float3 waypointVec;
-		// float3 wpProjDists;
+	{
+		// NOTE:
+		//   uses owner->pos instead of currWayPoint (ie. not the same as atEndOfPath)
+		//
+		//   if our first command is a build-order, then goal-radius is set to our build-range
+		//   and we cannot increase tolerance safely (otherwise the unit might stop when still
+		//   outside its range and fail to start construction)
+		//
+		//   units moving faster than <minGoalDist> elmos per frame might overshoot their goal
+		//   the last two atGoal conditions will just cause flatFrontDir to be selected as the
+		//   "wanted" direction when this happens
+		const float curGoalDistSq = (opos - goalPos).SqLength2D();
+		const float minGoalDistSq = (UNIT_HAS_MOVE_CMD(owner))?
+			Square((goalRadius + extraRadius) * (numIdlingSlowUpdates + 1)):
+			Square((goalRadius + extraRadius)                             );
+		const float spdGoalDistSq = Square(currentSpeed * 1.05f);
+
+		atGoal |= (curGoalDistSq <= minGoalDistSq);
+		atGoal |= ((curGoalDistSq <= spdGoalDistSq) && !reversing && (ffd.dot(goalPos - opos) > 0.0f && ffd.dot(goalPos - (opos + ovel)) <= 0.0f));
+		atGoal |= ((curGoalDistSq <= spdGoalDistSq) &&  reversing && (ffd.dot(goalPos - opos) < 0.0f && ffd.dot(goalPos - (opos + ovel)) >= 0.0f));
+	}
 
-		if (!epscmp(cwp.x, opos.x, float3::cmp_eps()) || !epscmp(cwp.z, opos.z, float3::cmp_eps())) {
-			waypointVec = (cwp - opos) * XZVector;
-			waypointDir = waypointVec / waypointVec.Length();
-			// wpProjDists = {math::fabs(waypointVec.dot(ffd)), 1.0f, math::fabs(waypointDir.dot(ffd))};
-		}
+	if (!atGoal) {
+		numIdlingUpdates -= ((numIdlingUpdates >                  0) * (1 - idling));
+		numIdlingUpdates += ((numIdlingUpdates < SPRING_MAX_HEADING) *      idling );
+	}
 
-		ASSERT_SYNCED(waypointVec);
-		ASSERT_SYNCED(waypointDir);
+	// atEndOfPath never becomes true when useRawMovement, except via StopMoving
+	if (!atEndOfPath && !useRawMovement) {
+		SetNextWayPoint();
+	} else {
+		if (atGoal)
+			Arrived(false);
+		else
+			ReRequestPath(false);
+	}
 
-		wantReverse = WantReverse(waypointDir, ffd);
 
-		// apply obstacle avoidance (steering), prevent unit from chasing its own tail if already at goal
-		const float3  rawWantedDir = waypointDir * Sign(int(!wantReverse));
-		const float3& modWantedDir = GetObstacleAvoidanceDir(mix(ffd, rawWantedDir, !atGoal));
-		// const float3& modWantedDir = GetObstacleAvoidanceDir(mix(ffd, rawWantedDir, (!atGoal) && (wpProjDists.x > wpProjDists.y || wpProjDists.z < 0.995f)));
+	// set direction to waypoint AFTER requesting it; should not be a null-vector
+	// do not compare y-components since these usually differ and only x&z matter
+	float3 waypointVec;
+	// float3 wpProjDists;
 
-		ChangeHeading(GetHeadingFromVector(modWantedDir.x, modWantedDir.z));
-		ChangeSpeed(maxWantedSpeed, wantReverse);
+	if (!epscmp(cwp.x, opos.x, float3::cmp_eps()) || !epscmp(cwp.z, opos.z, float3::cmp_eps())) {
+		waypointVec = (cwp - opos) * XZVector;
+		waypointDir = waypointVec / waypointVec.Length();
+		// wpProjDists = {math::fabs(waypointVec.dot(ffd)), 1.0f, math::fabs(waypointDir.dot(ffd))};
 	}
 
-	pathManager->UpdatePath(owner, pathID);
-	return wantReverse;
+	ASSERT_SYNCED(waypointVec);
+	ASSERT_SYNCED(waypointDir);
+
+	return (WantReverse(waypointDir, ffd));
 }
 
 void CGroundMoveType::ChangeSpeed(float newWantedSpeed, bool wantReverse, bool fpsMode)
+{
+	ChangeSpeed(newWantedSpeed, wantReverse, fpsMode, owner->heading);
+}
+
+// <heading> is the owner's heading for this frame, which UpdateMotionMT
+// computes without applying it yet
+void CGroundMoveType::ChangeSpeed(float newWantedSpeed, bool wantReverse, bool fpsMode, short heading)
 {
 	// round low speeds to zero
 	if ((wantedSpeed = newWantedSpeed) <= 0.0f && currentSpeed < 0.01f) {
@@ -802,13 +1079,13 @@ void CGroundMoveType::ChangeSpeed(float newWantedSpeed, bool wantReverse, bool f
 			const float3  waypointDifRev = -waypointDifFwd;
 
 			const float3& waypointDif = mix(waypointDifFwd, waypointDifRev, reversing);
-			const short turnDeltaHeading = owner->heading - GetHeadingFromVector(waypointDif.x, waypointDif.z);
+			const short turnDeltaHeading = heading - GetHeadingFromVector(waypointDif.x, waypointDif.z);
 
 			const bool startBraking = (UNIT_CMD_QUE_SIZE(owner) <= 1 && curGoalDistSq <= minGoalDistSq && !fpsMode);
 
 			if (!fpsMode && turnDeltaHeading != 0) {
 				// only auto-adjust speed for turns when not in FPS mode
-				const float reqTurnAngle = math::fabs(180.0f * short(owner->heading - wantedHeading) / SPRING_MAX_HEADING);
+				const float reqTurnAngle = math::fabs(180.0f * short(heading - wantedHeading) / SPRING_MAX_HEADING);
 				const float maxTurnAngle = (turnRate / SPRING_CIRCLE_DIVS) * 360.0f;
 
 				const float turnMaxSpeed = mix(maxSpeed, maxReverseSpeed, reversing);
@@ -1261,8 +1538,10 @@ void CGroundMoveType::CalcSkidRot()
 /*
  * Dynamic obstacle avoidance, helps the unit to
  * follow the path even when it's not perfect.
+ * If <concurrent>, this may run for several units
+ * at once (UpdateSteeringMT) and only reads them.
  */
-float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
+float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir, bool concurrent) {
 	#if (IGNORE_OBSTACLES == 1)
 	return desiredDir;
 	#endif
@@ -1304,10 +1583,34 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 	const float avoidanceRadius = std::max(currentSpeed, 1.0f) * (avoider->radius * 2.0f);
 	const float avoiderRadius = avoiderMD->CalcFootPrintMinExteriorRadius();
 
-	QuadFieldQuery qfQuery;
-	quadField.GetSolidsExact(qfQuery, avoider->pos, avoidanceRadius, 0xFFFFFFFF, CSolidObject::CSTATE_BIT_SOLIDOBJECTS);
+	static thread_local std::vector<int> avoideeQuads;
+	static thread_local std::vector<CUnit*> avoideeUnits;
+	static thread_local std::vector<const CSolidObject*> avoidees;
+
+	avoidees.clear();
+
+	if (!concurrent) {
+		QuadFieldQuery qfQuery;
+		quadField.GetSolidsExact(qfQuery, avoider->pos, avoidanceRadius, 0xFFFFFFFF, CSolidObject::CSTATE_BIT_SOLIDOBJECTS);
+		avoidees.assign(qfQuery.solids->begin(), qfQuery.solids->end());
+	} else {
+		// GetSolidsExact marks the objects it visits; features have no MoveDef
+		// and are skipped below anyway, so the read-only unit query suffices
+		avoideeUnits.clear();
+		quadField.GetUnitsExact(avoider->pos, avoidanceRadius, avoideeQuads, avoideeUnits);
+
+		for (const CUnit* u: avoideeUnits) {
+			if (!u->HasPhysicalStateBit(0xFFFFFFFF))
+				continue;
+			if (!u->HasCollidableStateBit(CSolidObject::CSTATE_BIT_SOLIDOBJECTS))
+				continue;
+
+			avoidees.push_back(u);
+		}
+	}
+
+	for (const CSolidObject* avoidee: avoidees) {
 
-	for (const CSolidObject* avoidee: *qfQuery.solids) {
 		const MoveDef* avoideeMD = avoidee->moveDef;
 		const UnitDef* avoideeUD = dynamic_cast<const UnitDef*>(avoidee->GetDef());
 
@@ -1365,7 +1668,7 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 		// if object and unit in relative motion are closing in on one another
 		// (or not yet fully apart), then the object is on the path of the unit
 		// and they are not collided
-		if (DEBUG_DRAWING_ENABLED) {
+		if (!concurrent && DEBUG_DRAWING_ENABLED) {
 			if (selectedUnitsHandler.selectedUnits.find(owner->id) != selectedUnitsHandler.selectedUnits.end())
 				geometricObjects->AddLine(avoider->pos + (UpVector * 20.0f), avoidee->pos + (UpVector * 20.0f), 3, 1, 4);
 		}
@@ -1401,7 +1704,7 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 	avoidanceDir = (mix(desiredDir, avoidanceVec, DESIRED_DIR_WEIGHT)).SafeNormalize();
 	avoidanceDir = (mix(avoidanceDir, lastAvoidanceDir, LAST_DIR_MIX_ALPHA)).SafeNormalize();
 
-	if (DEBUG_DRAWING_ENABLED) {
+	if (!concurrent && DEBUG_DRAWING_ENABLED) {
 		if (selectedUnitsHandler.selectedUnits.find(owner->id) != selectedUnitsHandler.selectedUnits.end()) {
 			const float3 p0 = owner->pos + (    UpVector * 20.0f);
 			const float3 p1 =         p0 + (avoidanceVec * 40.0f);
@@ -1987,188 +2290,396 @@ void CGroundMoveType::HandleUnitCollisions(
 	const UnitDef* colliderUD,
 	const MoveDef* colliderMD
 ) {
+	if (modInfo.batchUnitCollisions) {
+		// resolved by HandleBatchedUnitCollisions once all units have moved
+		unitCollisionSweep.colliders.emplace_back(owner, this);
+		return;
+	}
+
 	// NOTE: probably too large for most units (eg. causes tree falling animations to be skipped)
 	const float3 crushImpulse = collider->speed * collider->mass * Sign(int(!reversing));
 
+	// copy on purpose, since the below can call Lua
+	QuadFieldQuery qfQuery;
+	quadField.GetUnitsExact(qfQuery, collider->pos, colliderParams.x + (colliderParams.y * 2.0f));
+
+	for (CUnit* collidee: *qfQuery.units) {
+		HandleUnitCollision(collider, collidee, colliderParams, crushImpulse, colliderMD);
+	}
+}
+
+void CGroundMoveType::HandleUnitCollision(
+	CUnit* collider,
+	CUnit* collidee,
+	const float3& colliderParams, // .x := speed, .y := radius, .z := fpstretch
+	const float3& crushImpulse,
+	const MoveDef* colliderMD
+) {
 	const bool allowUCO = modInfo.allowUnitCollisionOverlap;
 	const bool allowCAU = modInfo.allowCrushingAlliedUnits;
 	const bool allowPEU = modInfo.allowPushingEnemyUnits;
 	const bool allowSAT = modInfo.allowSepAxisCollisionTest;
 	const bool forceSAT = (colliderParams.z > 0.1f);
 
-	// copy on purpose, since the below can call Lua
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, collider->pos, colliderParams.x + (colliderParams.y * 2.0f));
+	if (collidee == collider) return;
+	if (collidee->IsSkidding()) return;
+	if (collidee->IsFlying()) return;
 
-	for (CUnit* collidee: *qfQuery.units) {
-		if (collidee == collider) continue;
-		if (collidee->IsSkidding()) continue;
-		if (collidee->IsFlying()) continue;
+	const UnitDef* collideeUD = collidee->unitDef;
+	const MoveDef* collideeMD = collidee->moveDef;
 
-		const UnitDef* collideeUD = collidee->unitDef;
-		const MoveDef* collideeMD = collidee->moveDef;
+	const bool colliderMobile = (colliderMD != nullptr); // always true
+	const bool collideeMobile = (collideeMD != nullptr); // maybe true
 
-		const bool colliderMobile = (colliderMD != nullptr); // always true
-		const bool collideeMobile = (collideeMD != nullptr); // maybe true
+	const bool unloadingCollidee = (collidee->unloadingTransportId == collider->id);
+	const bool unloadingCollider = (collider->unloadingTransportId == collidee->id);
 
-		const bool unloadingCollidee = (collidee->unloadingTransportId == collider->id);
-		const bool unloadingCollider = (collider->unloadingTransportId == collidee->id);
+	if (unloadingCollidee)
+		collidee->unloadingTransportId = -1;
+	if (unloadingCollider)
+		collider->unloadingTransportId = -1;
 
-		if (unloadingCollidee)
-			collidee->unloadingTransportId = -1;
-		if (unloadingCollider)
-			collider->unloadingTransportId = -1;
 
+	// don't push/crush either party if the collidee does not block the collider (or vv.)
+	if (colliderMobile && CMoveMath::IsNonBlocking(*colliderMD, collidee, collider))
+		return;
+	if (collideeMobile && CMoveMath::IsNonBlocking(*collideeMD, collider, collidee))
+		return;
 
-		// don't push/crush either party if the collidee does not block the collider (or vv.)
-		if (colliderMobile && CMoveMath::IsNonBlocking(*colliderMD, collidee, collider))
-			continue;
-		if (collideeMobile && CMoveMath::IsNonBlocking(*collideeMD, collider, collidee))
-			continue;
+	// disable collisions between collider and collidee
+	// if collidee is currently inside any transporter,
+	// or if collider is being transported by collidee
+	if (collider->GetTransporter() == collidee) return;
+	if (collidee->GetTransporter() != nullptr) return;
+	// also disable collisions if either party currently
+	// has an order to load units (TODO: do we want this
+	// for unloading as well?)
+	if (collider->loadingTransportId == collidee->id) return;
+	if (collidee->loadingTransportId == collider->id) return;
+
+	// use the collidee's MoveDef footprint as radius if it is mobile
+	// use the collidee's Unit (not UnitDef) footprint as radius otherwise
+	const float2 collideeParams = {collidee->speed.w, collideeMobile? collideeMD->CalcFootPrintMaxInteriorRadius(): collidee->CalcFootPrintMaxInteriorRadius()};
+	const float4 separationVect = {collider->pos - collidee->pos, Square(colliderParams.y + collideeParams.y)};
+
+	if (!checkCollisionFuncs[allowSAT && (forceSAT || (collideeMobile && collideeMD->CalcFootPrintAxisStretchFactor() > 0.1f))](separationVect, collider, collidee, colliderMD, collideeMD))
+		return;
 
-		// disable collisions between collider and collidee
-		// if collidee is currently inside any transporter,
-		// or if collider is being transported by collidee
-		if (collider->GetTransporter() == collidee) continue;
-		if (collidee->GetTransporter() != nullptr) continue;
-		// also disable collisions if either party currently
-		// has an order to load units (TODO: do we want this
-		// for unloading as well?)
-		if (collider->loadingTransportId == collidee->id) continue;
-		if (collidee->loadingTransportId == collider->id) continue;
-
-		// use the collidee's MoveDef footprint as radius if it is mobile
-		// use the collidee's Unit (not UnitDef) footprint as radius otherwise
-		const float2 collideeParams = {collidee->speed.w, collideeMobile? collideeMD->CalcFootPrintMaxInteriorRadius(): collidee->CalcFootPrintMaxInteriorRadius()};
-		const float4 separationVect = {collider->pos - collidee->pos, Square(colliderParams.y + collideeParams.y)};
 
-		if (!checkCollisionFuncs[allowSAT && (forceSAT || (collideeMobile && collideeMD->CalcFootPrintAxisStretchFactor() > 0.1f))](separationVect, collider, collidee, colliderMD, collideeMD))
-			continue;
+	if (unloadingCollidee) {
+		collidee->unloadingTransportId = collider->id;
+		return;
+	}
 
+	if (unloadingCollider) {
+		collider->unloadingTransportId = collidee->id;
+		return;
+	}
 
-		if (unloadingCollidee) {
-			collidee->unloadingTransportId = collider->id;
-			continue;
+
+	// NOTE:
+	//   we exclude aircraft (which have NULL moveDef's) landed
+	//   on the ground, since they would just stack when pushed
+	bool pushCollider = colliderMobile;
+	bool pushCollidee = collideeMobile;
+	bool crushCollidee = false;
+
+	const bool alliedCollision =
+		teamHandler.Ally(collider->allyteam, collidee->allyteam) &&
+		teamHandler.Ally(collidee->allyteam, collider->allyteam);
+	const bool collideeYields = (collider->IsMoving() && !collidee->IsMoving());
+	const bool ignoreCollidee = (collideeYields && alliedCollision);
+
+	crushCollidee |= (!alliedCollision || allowCAU);
+	crushCollidee &= ((colliderParams.x * collider->mass) > (collideeParams.x * collidee->mass));
+
+	if (crushCollidee && !CMoveMath::CrushResistant(*colliderMD, collidee))
+		collidee->Kill(collider, crushImpulse, true);
+
+	if (eventHandler.UnitUnitCollision(collider, collidee))
+		return;
+
+	if (collideeMobile)
+		HandleUnitCollisionsAux(collider, collidee, this, static_cast<CGroundMoveType*>(collidee->moveType));
+
+	// NOTE:
+	//   allowPushingEnemyUnits is (now) useless because alliances are bi-directional
+	//   ie. if !alliedCollision, pushCollider and pushCollidee BOTH become false and
+	//   the collision is treated normally --> not what we want here, but the desired
+	//   behavior (making each party stop and block the other) has many corner-cases
+	//   so instead have collider respond as though collidee is semi-static obstacle
+	//   this also happens when both parties are pushResistant
+	pushCollider = pushCollider && (alliedCollision || allowPEU || !collider->blockEnemyPushing);
+	pushCollidee = pushCollidee && (alliedCollision || allowPEU || !collidee->blockEnemyPushing);
+	pushCollider = pushCollider && (!collider->beingBuilt && !collider->UsingScriptMoveType() && !collider->moveType->IsPushResistant());
+	pushCollidee = pushCollidee && (!collidee->beingBuilt && !collidee->UsingScriptMoveType() && !collidee->moveType->IsPushResistant());
+
+	if ((!collideeMobile && !collideeUD->IsAirUnit()) || (!pushCollider && !pushCollidee)) {
+		// building (always axis-aligned, possibly has a yardmap)
+		// or semi-static collidee that should be handled as such
+		//
+		// since all push-resistant units use the BLOCK_STRUCTURE
+		// mask when stopped, avoid the yardmap || terrain branch
+		// of HSOC which is not well suited to both parties moving
+		// and can leave them inside stuck each other's footprints
+		const bool allowNewPath = (!atEndOfPath && !atGoal);
+		const bool checkYardMap = ((pushCollider || pushCollidee) || collideeUD->IsFactoryUnit());
+
+		if (HandleStaticObjectCollision(collider, collidee, colliderMD,  colliderParams.y, collideeParams.y,  separationVect, allowNewPath, checkYardMap, false))
+			ReRequestPath(false);
+
+		return;
+	}
+
+
+	const float colliderRelRadius = colliderParams.y / (colliderParams.y + collideeParams.y);
+	const float collideeRelRadius = collideeParams.y / (colliderParams.y + collideeParams.y);
+	const float collisionRadiusSum = allowUCO?
+		(colliderParams.y * colliderRelRadius + collideeParams.y * collideeRelRadius):
+		(colliderParams.y                     + collideeParams.y                    );
+
+	const float  sepDistance = separationVect.Length() + 0.1f;
+	const float  penDistance = std::max(collisionRadiusSum - sepDistance, 1.0f);
+	const float  sepResponse = std::min(SQUARE_SIZE * 2.0f, penDistance * 0.5f);
+
+	const float3 sepDirection   = separationVect / sepDistance;
+	const float3 colResponseVec = sepDirection * XZVector * sepResponse;
+
+	const float
+		m1 = collider->mass,
+		m2 = collidee->mass,
+		v1 = std::max(1.0f, colliderParams.x),
+		v2 = std::max(1.0f, collideeParams.x),
+		c1 = 1.0f + (1.0f - math::fabs(collider->frontdir.dot(-sepDirection))) * 5.0f,
+		c2 = 1.0f + (1.0f - math::fabs(collidee->frontdir.dot( sepDirection))) * 5.0f,
+		// weighted momenta
+		s1 = m1 * v1 * c1,
+		s2 = m2 * v2 * c2,
+		// relative momenta
+ 			r1 = s1 / (s1 + s2 + 1.0f),
+ 			r2 = s2 / (s1 + s2 + 1.0f);
+
+	// far from a realistic treatment, but works
+	const float colliderMassScale = Clamp(1.0f - r1, 0.01f, 0.99f) * (allowUCO? (1.0f / colliderRelRadius): 1.0f);
+	const float collideeMassScale = Clamp(1.0f - r2, 0.01f, 0.99f) * (allowUCO? (1.0f / collideeRelRadius): 1.0f);
+
+	// try to prevent both parties from being pushed onto non-traversable
+	// squares (without resetting their position which stops them dead in
+	// their tracks and undoes previous legitimate pushes made this frame)
+	//
+	// if pushCollider and pushCollidee are both false (eg. if each party
+	// is pushResistant), treat the collision as regular and push both to
+	// avoid deadlocks
+	const float colliderSlideSign = Sign( separationVect.dot(collider->rightdir));
+	const float collideeSlideSign = Sign(-separationVect.dot(collidee->rightdir));
+
+	const float3 colliderPushVec  =  colResponseVec * colliderMassScale * int(!ignoreCollidee);
+	const float3 collideePushVec  = -colResponseVec * collideeMassScale;
+	const float3 colliderSlideVec = collider->rightdir * colliderSlideSign * (1.0f / penDistance) * r2;
+	const float3 collideeSlideVec = collidee->rightdir * collideeSlideSign * (1.0f / penDistance) * r1;
+	const float3 colliderMoveVec  = colliderPushVec + colliderSlideVec;
+	const float3 collideeMoveVec  = collideePushVec + collideeSlideVec;
+
+	const bool moveCollider = ((pushCollider || !pushCollidee) && colliderMobile);
+	const bool moveCollidee = ((pushCollidee || !pushCollider) && collideeMobile);
+
+	if (moveCollider && colliderMD->TestMoveSquare(collider, collider->pos + colliderMoveVec, colliderMoveVec))
+		collider->Move(colliderMoveVec, true);
+
+	if (moveCollidee && collideeMD->TestMoveSquare(collidee, collidee->pos + collideeMoveVec, collideeMoveVec))
+		collidee->Move(collideeMoveVec, true);
+}
+
+unsigned int CGroundMoveType::HandleBatchedUnitCollisions()
+{
+	using Entry = UnitCollisionSweep::Entry;
+	using Pair = UnitCollisionSweep::Pair;
+
+	UnitCollisionSweep& ucs = unitCollisionSweep;
+
+	if (ucs.colliders.empty())
+		return 0;
+
+	SCOPED_TIMER("Sim::Unit::MoveType::Collisions");
+
+	// pushes during the pass can move units into range of pairs the sweep did
+	// not report; every entry is padded by this much and once any unit has been
+	// pushed further from its swept position (a unit in a blob is pushed once
+	// per pair, so this is not bounded), the remaining colliders fall back to
+	// exact quadfield queries
+	constexpr float sweepMargin = SQUARE_SIZE * 2.0f;
+
+	const auto GetQueryRadius = [](const CUnit* u) {
+		return (u->speed.w + u->moveDef->CalcFootPrintMaxInteriorRadius() * 2.0f);
+	};
+	const auto AddEntry = [&](CUnit* u, float radius, int colliderIdx) {
+		int& entryIdx = ucs.entryIndices[u->id];
+
+		if (entryIdx >= 0) {
+			// a collider which is also in a cluster-query result
+			ucs.entries[entryIdx].colliderIdx = std::max(ucs.entries[entryIdx].colliderIdx, colliderIdx);
+			return;
 		}
 
-		if (unloadingCollider) {
-			collider->unloadingTransportId = collidee->id;
-			continue;
+		entryIdx = ucs.entries.size();
+		ucs.entries.push_back({u->pos.x - radius, u->pos.x + radius, u->pos.z - radius, u->pos.z + radius, u, colliderIdx});
+	};
+
+	ucs.entryIndices.resize(unitHandler.MaxUnits(), -1);
+	ucs.entries.clear();
+	ucs.pairs.clear();
+	ucs.sortedColliders.clear();
+
+	for (size_t i = 0; i < ucs.colliders.size(); i++) {
+		CUnit* u = ucs.colliders[i].first;
+
+		AddEntry(u, std::max(GetQueryRadius(u), u->radius) + sweepMargin, i);
+		ucs.sortedColliders.push_back(i);
+	}
+
+	const auto colliderCmp = [&](int a, int b) {
+		const Entry& ea = ucs.entries[ucs.entryIndices[ucs.colliders[a].first->id]];
+		const Entry& eb = ucs.entries[ucs.entryIndices[ucs.colliders[b].first->id]];
+		return ((ea.minX < eb.minX) || (ea.minX == eb.minX && ea.unit->id < eb.unit->id));
+	};
+
+	std::sort(ucs.sortedColliders.begin(), ucs.sortedColliders.end(), colliderCmp);
+
+	// gather the passive collidees with one quadfield query per cluster of
+	// colliders whose x-ranges overlap, rather than one query per collider
+	for (size_t i = 0, n = ucs.sortedColliders.size(); i < n; ) {
+		const Entry& first = ucs.entries[ucs.entryIndices[ucs.colliders[ucs.sortedColliders[i]].first->id]];
+
+		float3 mins = {first.minX, 0.0f, first.minZ};
+		float3 maxs = {first.maxX, 0.0f, first.maxZ};
+
+		for (i++; i < n; i++) {
+			const Entry& e = ucs.entries[ucs.entryIndices[ucs.colliders[ucs.sortedColliders[i]].first->id]];
+
+			if (e.minX > maxs.x)
+				break;
+
+			maxs.x = std::max(maxs.x, e.maxX);
+			mins.z = std::min(mins.z, e.minZ);
+			maxs.z = std::max(maxs.z, e.maxZ);
 		}
 
+		QuadFieldQuery qfQuery;
+		quadField.GetUnitsRectangle(qfQuery, mins, maxs);
 
-		// NOTE:
-		//   we exclude aircraft (which have NULL moveDef's) landed
-		//   on the ground, since they would just stack when pushed
-		bool pushCollider = colliderMobile;
-		bool pushCollidee = collideeMobile;
-		bool crushCollidee = false;
-
-		const bool alliedCollision =
-			teamHandler.Ally(collider->allyteam, collidee->allyteam) &&
-			teamHandler.Ally(collidee->allyteam, collider->allyteam);
-		const bool collideeYields = (collider->IsMoving() && !collidee->IsMoving());
-		const bool ignoreCollidee = (collideeYields && alliedCollision);
-
-		crushCollidee |= (!alliedCollision || allowCAU);
-		crushCollidee &= ((colliderParams.x * collider->mass) > (collideeParams.x * collidee->mass));
-
-		if (crushCollidee && !CMoveMath::CrushResistant(*colliderMD, collidee))
-			collidee->Kill(collider, crushImpulse, true);
+		for (CUnit* u: *qfQuery.units) {
+			AddEntry(u, u->radius + sweepMargin, -1);
+		}
+	}
 
-		if (eventHandler.UnitUnitCollision(collider, collidee))
-			continue;
+	// sort-and-sweep along x, every candidate pair is reported once
+	const auto entryCmp = [](const Entry& a, const Entry& b) {
+		return ((a.minX < b.minX) || (a.minX == b.minX && a.unit->id < b.unit->id));
+	};
 
-		if (collideeMobile)
-			HandleUnitCollisionsAux(collider, collidee, this, static_cast<CGroundMoveType*>(collidee->moveType));
+	std::sort(ucs.entries.begin(), ucs.entries.end(), entryCmp);
 
-		// NOTE:
-		//   allowPushingEnemyUnits is (now) useless because alliances are bi-directional
-		//   ie. if !alliedCollision, pushCollider and pushCollidee BOTH become false and
-		//   the collision is treated normally --> not what we want here, but the desired
-		//   behavior (making each party stop and block the other) has many corner-cases
-		//   so instead have collider respond as though collidee is semi-static obstacle
-		//   this also happens when both parties are pushResistant
-		pushCollider = pushCollider && (alliedCollision || allowPEU || !collider->blockEnemyPushing);
-		pushCollidee = pushCollidee && (alliedCollision || allowPEU || !collidee->blockEnemyPushing);
-		pushCollider = pushCollider && (!collider->beingBuilt && !collider->UsingScriptMoveType() && !collider->moveType->IsPushResistant());
-		pushCollidee = pushCollidee && (!collidee->beingBuilt && !collidee->UsingScriptMoveType() && !collidee->moveType->IsPushResistant());
-
-		if ((!collideeMobile && !collideeUD->IsAirUnit()) || (!pushCollider && !pushCollidee)) {
-			// building (always axis-aligned, possibly has a yardmap)
-			// or semi-static collidee that should be handled as such
-			//
-			// since all push-resistant units use the BLOCK_STRUCTURE
-			// mask when stopped, avoid the yardmap || terrain branch
-			// of HSOC which is not well suited to both parties moving
-			// and can leave them inside stuck each other's footprints
-			const bool allowNewPath = (!atEndOfPath && !atGoal);
-			const bool checkYardMap = ((pushCollider || pushCollidee) || collideeUD->IsFactoryUnit());
-
-			if (HandleStaticObjectCollision(collider, collidee, colliderMD,  colliderParams.y, collideeParams.y,  separationVect, allowNewPath, checkYardMap, false))
-				ReRequestPath(false);
+	for (size_t i = 0; i < ucs.entries.size(); i++) {
+		ucs.entryIndices[ucs.entries[i].unit->id] = i;
+	}
+
+	for (size_t i = 0; i < ucs.entries.size(); i++) {
+		const Entry& a = ucs.entries[i];
+
+		for (size_t j = i + 1; j < ucs.entries.size(); j++) {
+			const Entry& b = ucs.entries[j];
+
+			if (b.minX > a.maxX)
+				break;
+			if (b.minZ > a.maxZ || a.minZ > b.maxZ)
+				continue;
 
+			// each side that moved this frame handles the collision from its
+			// point of view (the response is not symmetric), as the per-unit
+			// queries did
+			if (a.colliderIdx >= 0)
+				ucs.pairs.push_back({a.colliderIdx, b.unit});
+			if (b.colliderIdx >= 0)
+				ucs.pairs.push_back({b.colliderIdx, a.unit});
+		}
+	}
+
+	const unsigned int numCandidatePairs = ucs.pairs.size();
+
+	// resolve in update order of the colliders, by unit-id per collider
+	const auto pairCmp = [](const Pair& a, const Pair& b) {
+		return ((a.colliderIdx < b.colliderIdx) || (a.colliderIdx == b.colliderIdx && a.collidee->id < b.collidee->id));
+	};
+
+	std::sort(ucs.pairs.begin(), ucs.pairs.end(), pairCmp);
+
+	const auto IsPushedOutOfSweep = [&](const CUnit* u) {
+		const int entryIdx = ucs.entryIndices[u->id];
+
+		if (entryIdx < 0)
+			return false;
+
+		const Entry& e = ucs.entries[entryIdx];
+		const float2 sweepPos = {(e.minX + e.maxX) * 0.5f, (e.minZ + e.maxZ) * 0.5f};
+
+		return ((Square(u->pos.x - sweepPos.x) + Square(u->pos.z - sweepPos.y)) > Square(sweepMargin));
+	};
+
+	bool sweepIsStale = false;
+
+	for (size_t i = 0; i < ucs.pairs.size(); ) {
+		const int colliderIdx = ucs.pairs[i].colliderIdx;
+
+		CUnit* collider = ucs.colliders[colliderIdx].first;
+		CGroundMoveType* gmt = ucs.colliders[colliderIdx].second;
+
+		// skip if a script move-type was enabled while resolving earlier pairs
+		if (collider->moveType != gmt) {
+			for (; i < ucs.pairs.size() && ucs.pairs[i].colliderIdx == colliderIdx; i++);
 			continue;
 		}
 
+		const float3 colliderParams = {collider->speed.w, collider->moveDef->CalcFootPrintMaxInteriorRadius(), collider->moveDef->CalcFootPrintAxisStretchFactor()};
+		const float3 crushImpulse = collider->speed * collider->mass * Sign(int(!gmt->reversing));
+		const float queryRadius = GetQueryRadius(collider);
 
-		const float colliderRelRadius = colliderParams.y / (colliderParams.y + collideeParams.y);
-		const float collideeRelRadius = collideeParams.y / (colliderParams.y + collideeParams.y);
-		const float collisionRadiusSum = allowUCO?
-			(colliderParams.y * colliderRelRadius + collideeParams.y * collideeRelRadius):
-			(colliderParams.y                     + collideeParams.y                    );
+		// same test as the quadfield query in HandleUnitCollisions, done
+		// for all candidates before any of them is handled
+		ucs.collidees.clear();
 
-		const float  sepDistance = separationVect.Length() + 0.1f;
-		const float  penDistance = std::max(collisionRadiusSum - sepDistance, 1.0f);
-		const float  sepResponse = std::min(SQUARE_SIZE * 2.0f, penDistance * 0.5f);
+		for (; i < ucs.pairs.size() && ucs.pairs[i].colliderIdx == colliderIdx; i++) {
+			CUnit* collidee = ucs.pairs[i].collidee;
 
-		const float3 sepDirection   = separationVect / sepDistance;
-		const float3 colResponseVec = sepDirection * XZVector * sepResponse;
+			if (sweepIsStale)
+				continue;
+			if (collider->pos.SqDistance(collidee->pos) >= Square(queryRadius + collidee->radius))
+				continue;
 
-		const float
-			m1 = collider->mass,
-			m2 = collidee->mass,
-			v1 = std::max(1.0f, colliderParams.x),
-			v2 = std::max(1.0f, collideeParams.x),
-			c1 = 1.0f + (1.0f - math::fabs(collider->frontdir.dot(-sepDirection))) * 5.0f,
-			c2 = 1.0f + (1.0f - math::fabs(collidee->frontdir.dot( sepDirection))) * 5.0f,
-			// weighted momenta
-			s1 = m1 * v1 * c1,
-			s2 = m2 * v2 * c2,
-			// relative momenta
- 			r1 = s1 / (s1 + s2 + 1.0f),
- 			r2 = s2 / (s1 + s2 + 1.0f);
+			ucs.collidees.push_back(collidee);
+		}
 
-		// far from a realistic treatment, but works
-		const float colliderMassScale = Clamp(1.0f - r1, 0.01f, 0.99f) * (allowUCO? (1.0f / colliderRelRadius): 1.0f);
-		const float collideeMassScale = Clamp(1.0f - r2, 0.01f, 0.99f) * (allowUCO? (1.0f / collideeRelRadius): 1.0f);
+		if (sweepIsStale) {
+			QuadFieldQuery qfQuery;
+			quadField.GetUnitsExact(qfQuery, collider->pos, queryRadius);
 
-		// try to prevent both parties from being pushed onto non-traversable
-		// squares (without resetting their position which stops them dead in
-		// their tracks and undoes previous legitimate pushes made this frame)
-		//
-		// if pushCollider and pushCollidee are both false (eg. if each party
-		// is pushResistant), treat the collision as regular and push both to
-		// avoid deadlocks
-		const float colliderSlideSign = Sign( separationVect.dot(collider->rightdir));
-		const float collideeSlideSign = Sign(-separationVect.dot(collidee->rightdir));
-
-		const float3 colliderPushVec  =  colResponseVec * colliderMassScale * int(!ignoreCollidee);
-		const float3 collideePushVec  = -colResponseVec * collideeMassScale;
-		const float3 colliderSlideVec = collider->rightdir * colliderSlideSign * (1.0f / penDistance) * r2;
-		const float3 collideeSlideVec = collidee->rightdir * collideeSlideSign * (1.0f / penDistance) * r1;
-		const float3 colliderMoveVec  = colliderPushVec + colliderSlideVec;
-		const float3 collideeMoveVec  = collideePushVec + collideeSlideVec;
-
-		const bool moveCollider = ((pushCollider || !pushCollidee) && colliderMobile);
-		const bool moveCollidee = ((pushCollidee || !pushCollider) && collideeMobile);
-
-		if (moveCollider && colliderMD->TestMoveSquare(collider, collider->pos + colliderMoveVec, colliderMoveVec))
-			collider->Move(colliderMoveVec, true);
-
-		if (moveCollidee && collideeMD->TestMoveSquare(collidee, collidee->pos + collideeMoveVec, collideeMoveVec))
-			collidee->Move(collideeMoveVec, true);
+			ucs.collidees.assign(qfQuery.units->begin(), qfQuery.units->end());
+
+			std::sort(ucs.collidees.begin(), ucs.collidees.end(), [](const CUnit* a, const CUnit* b) { return (a->id < b->id); });
+		}
+
+		for (CUnit* collidee: ucs.collidees) {
+			gmt->HandleUnitCollision(collider, collidee, colliderParams, crushImpulse, collider->moveDef);
+
+			sweepIsStale = sweepIsStale || IsPushedOutOfSweep(collider) || IsPushedOutOfSweep(collidee);
+		}
+	}
+
+	for (const Entry& e: ucs.entries) {
+		ucs.entryIndices[e.unit->id] = -1;
 	}
+
+	ucs.colliders.clear();
+	return numCandidatePairs;
 }
 
 void CGroundMoveType::HandleFeatureCollisions(
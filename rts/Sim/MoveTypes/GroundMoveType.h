@@ -32,6 +32,9 @@ public:
 	bool Update() override;
 	void SlowUpdate() override;
 
+	bool PrepareUpdateMT() override;
+	bool CommitUpdateMT() override;
+
 	void StartMovingRaw(const float3 moveGoalPos, float moveGoalRadius) override;
 	void StartMoving(float3 pos, float moveGoalRadius) override;
 	void StartMoving(float3 pos, float moveGoalRadius, float speed) override { StartMoving(pos, moveGoalRadius); }
@@ -92,8 +95,56 @@ public:
 	const float3& GetGroundNormal(const float3&) const;
 	float GetGroundHeight(const float3&) const;
 
+	/**
+	 * Resolves the unit-unit collisions deferred by HandleObjectCollisions
+	 * during this frame if movement.batchUnitCollisions is enabled; called
+	 * once after all move-types were updated.
+	 * @return number of candidate pairs found by the sweep
+	 */
+	static unsigned int HandleBatchedUnitCollisions();
+
+	// everything written by the parallel passes of the split update
+	struct MotionStateMT {
+		float3 flatFrontDir;
+		float3 lastAvoidanceDir;
+		float3 steerDir;
+		float3 speedVector;
+
+		float ownerSpeed;
+		float turnSpeed;
+		float wantedSpeed;
+		float currentSpeed;
+		float deltaSpeed;
+
+		unsigned int nextObstacleAvoidanceFrame;
+
+		short wantedHeading;
+		short deltaHeading;
+	};
+
+	/**
+	 * Runs the parallel passes of the split movement update (modrule
+	 * movement.parallelUnitMovement) for every move-type that accepted in
+	 * PrepareUpdateMT this frame: first obstacle avoidance against the unit
+	 * positions left by the serial preparation pass, then the new heading,
+	 * speed and speed-vector. Neither pass writes to the owners, the results
+	 * are applied by CommitUpdateMT in activeUnits order.
+	 * @param parallel if false, both passes run on the calling thread
+	 * @param check if true, both passes run in parallel and then again
+	 *   serially from the same state, every unit with differing results
+	 *   is logged
+	 * @return number of move-types updated
+	 */
+	static unsigned int UpdateQueuedMT(bool parallel, bool check);
+
 private:
-	float3 GetObstacleAvoidanceDir(const float3& desiredDir);
+	MotionStateMT GetMotionStateMT() const;
+	void SetMotionStateMT(const MotionStateMT& state);
+
+	void UpdateSteeringMT();
+	void UpdateMotionMT();
+
+	float3 GetObstacleAvoidanceDir(const float3& desiredDir, bool concurrent = false);
 	float3 Here() const;
 
 	#define SQUARE(x) ((x) * (x))
@@ -136,6 +187,13 @@ private:
 		const UnitDef* colliderUD,
 		const MoveDef* colliderMD
 	);
+	void HandleUnitCollision(
+		CUnit* collider,
+		CUnit* collidee,
+		const float3& colliderParams,
+		const float3& crushImpulse,
+		const MoveDef* colliderMD
+	);
 	void HandleFeatureCollisions(
 		CUnit* collider,
 		const float3& colliderParams,
@@ -144,7 +202,8 @@ private:
 	);
 
 	void SetMainHeading();
-	void ChangeSpeed(float, bool, bool = false);
+	void ChangeSpeed(float newWantedSpeed, bool wantReverse, bool fpsMode = false);
+	void ChangeSpeed(float newWantedSpeed, bool wantReverse, bool fpsMode, short heading);
 	void ChangeHeading(short newHeading);
 
 	void UpdateSkid();
@@ -159,6 +218,7 @@ private:
 	bool UpdateOwnerSpeed(float oldSpeedAbs, float newSpeedAbs, float newSpeedRaw);
 	bool OwnerMoved(const short, const float3&, const float3&);
 	bool FollowPath();
+	bool FollowWayPoints();
 	bool WantReverse(const float3& wpDir, const float3& ffDir) const;
 
 private:
@@ -219,6 +279,18 @@ private:
 	bool canReverse = false;
 	bool useMainHeading = false;            /// if true, turn toward mainHeadingPos until weapons[0] can TryTarget() it
 	bool useRawMovement = false;            /// if true, move towards goal without invoking PFS (unrelated to MoveDef::allowRawMovement)
+
+	// split update state, only valid during frame <mtFrame> (not saved)
+	float3 mtWantedDir;                     /// input of the steering pass
+	float3 mtSteerDir;                      /// output of the steering pass
+	float3 mtSpeedVector;                   /// new speed-vector, given the new heading
+
+	int mtFrame = -1;
+
+	short mtOldHeading = 0;
+	short mtDeltaHeading = 0;
+
+	bool mtWantReverse = false;
 };
 
 #endif // GROUNDMOVETYPE_H
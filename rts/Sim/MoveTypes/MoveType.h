@@ -52,6 +52,13 @@ public:
 	virtual bool Update() = 0;
 	virtual void SlowUpdate();
 
+	// split update (modrule movement.parallelUnitMovement); a move-type
+	// that accepts in PrepareUpdateMT gets its movement computed by the
+	// parallel passes and applied by CommitUpdateMT, all others simply do
+	// their regular Update in CommitUpdateMT
+	virtual bool PrepareUpdateMT() { return false; }
+	virtual bool CommitUpdateMT() { return (Update()); }
+
 	virtual bool IsSkidding() const { return false; }
 	virtual bool IsFlying() const { return false; }
 	virtual bool IsReversing() const { return false; }
@@ -12,6 +12,7 @@
 #include "System/SpringMath.h"
 
 int CSolidObject::deletingRefID = -1;
+uint64_t CSolidObject::lastChangeCount = 0;
 
 
 CR_BIND_DERIVED_INTERFACE(CSolidObject, CWorldObject)
@@ -75,6 +76,8 @@ CR_REG_METADATA(CSolidObject,
 	CR_MEMBER(buildFacing),
 	CR_MEMBER(modParams),
 
+	CR_IGNORED(changeCount),
+
 	CR_POSTLOAD(PostLoad)
 ))
 
@@ -414,6 +417,8 @@ void CSolidObject::UpdateDirVectors(bool useGroundNormal, bool useObjectNormal)
 	frontdir = GetVectorFromHeading(heading);
 	rightdir = (frontdir.cross(updir)).Normalize();
 	frontdir = updir.cross(rightdir);
+
+	MarkChanged();
 }
 
 
@@ -434,6 +439,7 @@ void CSolidObject::ForcedSpin(const float3& newDir)
 	rightdir = xdir;
 	   updir = ydir;
 
+	MarkChanged();
 	SetHeadingFromDirection();
 	UpdateMidAndAimPos();
 }
@@ -124,8 +124,15 @@ public:
 		pos += dv;
 		midPos += dv;
 		aimPos += dv;
+
+		MarkChanged();
 	}
 
+	// stamps this object as changed; must be called whenever anything
+	// hit-tests depend on (position, orientation, collision volume and
+	// radius, collidable state) is modified
+	void MarkChanged() { changeCount = ++lastChangeCount; }
+
 	// this should be called whenever the direction
 	// vectors are changed (ie. after a rotation) in
 	// eg. movetype code
@@ -136,6 +143,7 @@ public:
 	void SetMidAndAimPos(const float3& mp, const float3& ap, bool relative) {
 		SetMidPos(mp, relative);
 		SetAimPos(ap, relative);
+		MarkChanged();
 	}
 
 
@@ -144,6 +152,7 @@ public:
 		rightdir.x = -matrix[0]; updir.x = matrix[4]; frontdir.x = matrix[ 8];
 		rightdir.y = -matrix[1]; updir.y = matrix[5]; frontdir.y = matrix[ 9];
 		rightdir.z = -matrix[2]; updir.z = matrix[6]; frontdir.z = matrix[10];
+		MarkChanged();
 	}
 
 	void AddHeading(short deltaHeading, bool useGroundNormal, bool useObjectNormal) { SetHeading(heading + deltaHeading, useGroundNormal, useObjectNormal); }
@@ -271,8 +280,8 @@ public:
 	}
 
 	bool    HasCollidableStateBit(unsigned int bit) const { return ((collidableState & bit) != 0); }
-	void    SetCollidableStateBit(unsigned int bit) { unsigned int cs = collidableState; cs |= ( bit); collidableState = static_cast<CollidableState>(cs); }
-	void  ClearCollidableStateBit(unsigned int bit) { unsigned int cs = collidableState; cs &= (~bit); collidableState = static_cast<CollidableState>(cs); }
+	void    SetCollidableStateBit(unsigned int bit) { unsigned int cs = collidableState; cs |= ( bit); collidableState = static_cast<CollidableState>(cs); MarkChanged(); }
+	void  ClearCollidableStateBit(unsigned int bit) { unsigned int cs = collidableState; cs &= (~bit); collidableState = static_cast<CollidableState>(cs); MarkChanged(); }
 	void   PushCollidableStateBit(unsigned int bit) { UpdateCollidableStateBit(1u << (32u - bits_ffs(bit)), HasCollidableStateBit(bit)); }
 	void    PopCollidableStateBit(unsigned int bit) { UpdateCollidableStateBit(bit, HasCollidableStateBit(1u << (32u - bits_ffs(bit)))); }
 	bool UpdateCollidableStateBit(unsigned int bit, bool set) {
@@ -414,12 +423,16 @@ public:
 	 */
 	LuaRulesParams::Params  modParams;
 
+	///< value of lastChangeCount at the last MarkChanged call (not saved)
+	uint64_t changeCount = 0;
+
 public:
 	static constexpr float DEFAULT_MASS = 1e5f;
 	static constexpr float MINIMUM_MASS = 1e0f; // 1.0f
 	static constexpr float MAXIMUM_MASS = 1e6f;
 
 	static int deletingRefID;
+	static uint64_t lastChangeCount;
 
 	static void SetDeletingRefID(int id) { deletingRefID = id; }
 	// returns the object (command reference) id of the object currently being deleted,
@@ -31,6 +31,7 @@ void IPathFinder::Init(unsigned int _BLOCK_SIZE)
 
 		maxBlocksToBeSearched = 0;
 		testedBlocks = 0;
+		numTestedBlocks = 0;
 
 		instanceIndex = pathFinderInstances.size();
 	}
@@ -40,7 +41,6 @@ void IPathFinder::Init(unsigned int _BLOCK_SIZE)
 		// blockStates.Clear();
 		// done in ResetSearch
 		// openBlocks.Clear();
-		dirtyBlocks.clear();
 	}
 	{
 		pathFinderInstances.push_back(this);
@@ -71,13 +71,8 @@ void IPathFinder::AllocStateBuffer()
 
 void IPathFinder::ResetSearch()
 {
-	while (!dirtyBlocks.empty()) {
-		blockStates.ClearSquare(dirtyBlocks.back());
-		dirtyBlocks.pop_back();
-	}
-
-	// reserve a batch of dirty blocks
-	dirtyBlocks.reserve(4096);
+	// implicitly clears every block touched by the last search
+	blockStates.StartSearch();
 	openBlocks.Clear();
 
 	testedBlocks = 0;
@@ -126,6 +121,8 @@ IPath::SearchResult IPathFinder::GetPath(
 	// start up a new search
 	const IPath::SearchResult result = InitSearch(moveDef, pfDef, owner);
 
+	numTestedBlocks += testedBlocks;
+
 	// if search was successful, generate new path and cache it
 	if (result == IPath::Ok || result == IPath::GoalOutOfRange) {
 		FinishSearch(moveDef, pfDef, path);
@@ -158,7 +155,7 @@ IPath::SearchResult IPathFinder::InitSearch(const MoveDef& moveDef, const CPathF
 	int2 square = mStartBlock;
 
 	if (BLOCK_SIZE != 1)
-		square = blockStates.peNodeOffsets[moveDef.pathType][mStartBlockIdx];
+		square = GetNodeOffset(moveDef.pathType, mStartBlockIdx);
 
 	const bool isStartGoal = pfDef.IsGoal(square.x, square.y);
 	const bool startInGoal = pfDef.startInGoalRadius;
@@ -179,15 +176,14 @@ IPath::SearchResult IPathFinder::InitSearch(const MoveDef& moveDef, const CPathF
 		return results[allowRawPath];
 
 	// mark and store the start-block; clear all bits except PATHOPT_OBSOLETE
-	blockStates.nodeMask[mStartBlockIdx] &= PATHOPT_OBSOLETE;
-	blockStates.nodeMask[mStartBlockIdx] |= PATHOPT_OPEN;
-	blockStates.fCost[mStartBlockIdx] = 0.0f;
-	blockStates.gCost[mStartBlockIdx] = 0.0f;
+	const unsigned int startStateIdx = blockStates.GetStateIdx(mStartBlock);
+
+	blockStates.ClearNodeMaskBits(startStateIdx, PATHOPT_SIZE & ~PATHOPT_OBSOLETE);
+	blockStates.SetNodeMaskBits(startStateIdx, PATHOPT_OPEN);
+	blockStates.SetNodeCosts(startStateIdx, 0.0f, 0.0f);
 	blockStates.SetMaxCost(NODE_COST_F, 0.0f);
 	blockStates.SetMaxCost(NODE_COST_G, 0.0f);
 
-	dirtyBlocks.push_back(mStartBlockIdx);
-
 	// start a new search and add the starting block to the open-blocks-queue
 	openBlockBuffer.SetSize(0);
 	PathNode* ob = openBlockBuffer.GetNode(openBlockBuffer.GetSize());
@@ -3,6 +3,7 @@
 #ifndef IPATH_FINDER_H
 #define IPATH_FINDER_H
 
+#include <cstdint>
 #include <cstdlib>
 
 #include "IPath.h"
@@ -36,6 +37,9 @@ public:
 	int2 BlockIdxToPos(const unsigned idx) const { return int2(idx % nbrOfBlocks.x, idx / nbrOfBlocks.x); }
 	int  BlockPosToIdx(const int2 pos) const { return (pos.y * nbrOfBlocks.x + pos.x); }
 
+	/// heightmap-square representing block <blockIdx> (PE's override this with their offsets)
+	virtual int2 GetNodeOffset(unsigned int pathType, unsigned int blockIdx) const { return (BlockIdxToPos(blockIdx)); }
+
 
 	/**
 	 * Gives a path from given starting location to target defined in
@@ -139,14 +143,14 @@ public:
 	unsigned int maxBlocksToBeSearched = 0;
 	unsigned int testedBlocks = 0;
 
+	// summed over all searches, for statistics
+	std::uint64_t numTestedBlocks = 0;
+
 	unsigned int instanceIndex = 0;
 
 	PathNodeBuffer openBlockBuffer;
 	PathNodeStateBuffer blockStates;
 	PathPriorityQueue openBlocks;
-
-	// list of blocks changed in last search
-	std::vector<unsigned int> dirtyBlocks;
 };
 
 #endif // IPATH_FINDER_H
@@ -40,6 +40,13 @@ public:
 		float goalRadius,
 		int pathType
 	);
+	/// same as GetCachedPath but without hit statistics, safe for concurrent readers
+	const CacheItem& FindCachedPath(
+		const int2 strtBlock,
+		const int2 goalBlock,
+		float goalRadius,
+		int pathType
+	) const;
 
 private:
 	void RemoveFrontQueItem();
@@ -3,9 +3,10 @@
 #ifndef PATH_DATATYPES_H
 #define PATH_DATATYPES_H
 
-#include <queue>
+#include <algorithm>
+#include <cassert>
+#include <limits>
 #include <vector>
-#include <algorithm> // for std::fill
 
 #include "PathConstants.h"
 #include "System/float3.h"
@@ -44,13 +45,9 @@ struct PathNodeBuffer {
 public:
 	PathNodeBuffer() { Clear(); }
 
-	void Clear() {
-		for (unsigned int i = 0; i < MAX_SEARCHED_NODES; i++) {
-			buffer[i] = {};
-		}
-
-		SetSize(0);
-	}
+	// every node is fully written when it is added, so
+	// the buffer itself never needs to be cleared again
+	void Clear() { SetSize(0); }
 
 	void SetSize(unsigned int i) { idx = i; }
 	unsigned int GetSize() const { return idx; }
@@ -66,7 +63,37 @@ private:
 };
 
 
+/// search-state of a single node, interleaved s.t. each lookup touches one cache-line
+struct PathNodeState {
+	float fCost = PATHCOST_INFINITY;
+	float gCost = PATHCOST_INFINITY;
+
+	/// search in which this state was last written; if it differs from
+	/// the buffer's current generation, all bits except PATHOPT_OBSOLETE
+	/// and both costs are stale and read as if they had been cleared
+	std::uint16_t searchGen = 0;
+
+	/// bitmask of PATHOPT_{OPEN, ..., OBSOLETE} flags
+	std::uint8_t nodeMask = 0;
+};
+
+
+/**
+ * Per-node state of a PF or PE search.
+ *
+ * States are stored in tiles of TILE_SIZE*TILE_SIZE nodes and Morton-
+ * ordered within each tile, so neighbors expanded by a search tend to
+ * share cache-lines. State-indices are obtained via GetStateIdx; node-
+ * indices (as in PathNode::nodeNum) remain row-major.
+ *
+ * Instead of clearing every node touched by the previous search, each
+ * search starts a new generation (StartSearch) which implicitly resets
+ * all states that were written by earlier ones.
+ */
 struct PathNodeStateBuffer {
+	static constexpr unsigned int TILE_SIZE = 8;
+	static constexpr unsigned int TILE_NODES = TILE_SIZE * TILE_SIZE;
+
 	PathNodeStateBuffer() {
 		#if !defined(_MSC_FULL_VER) || _MSC_FULL_VER > 180040000 // ensure that ::max() is constexpr
 		static_assert(PATHOPT_SIZE <= std::numeric_limits<std::uint8_t>::max(), "nodeMask basic type too small to hold PATHOPT bitmask");
@@ -80,10 +107,11 @@ struct PathNodeStateBuffer {
 
 	PathNodeStateBuffer& operator = (const PathNodeStateBuffer& pnsb) = delete;
 	PathNodeStateBuffer& operator = (PathNodeStateBuffer&& pnsb) {
-		fCost = std::move(pnsb.fCost);
-		gCost = std::move(pnsb.gCost);
+		nodeStates = std::move(pnsb.nodeStates);
+
+		tileOffsets[0] = std::move(pnsb.tileOffsets[0]);
+		tileOffsets[1] = std::move(pnsb.tileOffsets[1]);
 
-		nodeMask = std::move(pnsb.nodeMask);
 		peNodeOffsets = std::move(pnsb.peNodeOffsets);
 
 		extraCosts[ true] = std::move(pnsb.extraCosts[ true]);
@@ -105,20 +133,35 @@ struct PathNodeStateBuffer {
 
 		er[ true] = pnsb.er[ true];
 		er[false] = pnsb.er[false];
+
+		searchGen = pnsb.searchGen;
 		return *this;
 	}
 
 
-	unsigned int GetSize() const { return fCost.size(); }
+	/// number of nodes (not of states, which are padded to whole tiles)
+	unsigned int GetSize() const { return (br.x * br.y); }
 
 	void Resize(const int2& bufRes, const int2& mapRes) {
 		ps = mapRes / bufRes;
 		br = bufRes;
 		mr = mapRes;
 
-		fCost.resize(br.x * br.y, PATHCOST_INFINITY);
-		gCost.resize(br.x * br.y, PATHCOST_INFINITY);
-		nodeMask.resize(br.x * br.y, 0);
+		const int2 numTiles = {int((br.x + TILE_SIZE - 1) / TILE_SIZE), int((br.y + TILE_SIZE - 1) / TILE_SIZE)};
+
+		nodeStates.resize(numTiles.x * numTiles.y * TILE_NODES, PathNodeState{});
+
+		// x- and z-parts of each state-index; Morton-order is separable
+		// so an index is the sum of one entry from either table
+		tileOffsets[0].resize(br.x);
+		tileOffsets[1].resize(br.y);
+
+		for (int x = 0; x < br.x; x++) {
+			tileOffsets[0][x] = (x / TILE_SIZE) * TILE_NODES + (SpreadTileBits(x % TILE_SIZE)     );
+		}
+		for (int z = 0; z < br.y; z++) {
+			tileOffsets[1][z] = (z / TILE_SIZE) * TILE_NODES * numTiles.x + (SpreadTileBits(z % TILE_SIZE) << 1);
+		}
 
 		// created on-demand
 		// extraCosts[ true].resize(br.x * br.y, 0.0f);
@@ -132,10 +175,11 @@ struct PathNodeStateBuffer {
 	}
 
 	void Clear() {
-		fCost.clear();
-		gCost.clear();
+		nodeStates.clear();
+
+		tileOffsets[0].clear();
+		tileOffsets[1].clear();
 
-		nodeMask.clear();
 		peNodeOffsets.clear();
 
 		extraCosts[ true].clear();
@@ -153,14 +197,49 @@ struct PathNodeStateBuffer {
 		mr        = {0, 0};
 		er[ true] = {1, 1};
 		er[false] = {1, 1};
+
+		searchGen = 0;
 	}
 
-	void ClearSquare(int idx) {
-		// assert(idx >= 0 && idx < fCost.size());
-		fCost[idx] = PATHCOST_INFINITY;
-		gCost[idx] = PATHCOST_INFINITY;
-		// clear all bits except PATHOPT_OBSOLETE
-		nodeMask[idx] &= PATHOPT_OBSOLETE;
+	/// invalidates the states written by all previous searches
+	void StartSearch() {
+		if ((searchGen += 1) != 0)
+			return;
+
+		// generation wrapped around, make sure no state written 65536
+		// searches ago can be mistaken for one of the new generation
+		for (PathNodeState& ns: nodeStates) {
+			ClearState(ns);
+		}
+
+		searchGen = 1;
+	}
+
+
+	unsigned int GetStateIdx(const int2 nodePos) const { return (tileOffsets[0][nodePos.x] + tileOffsets[1][nodePos.y]); }
+	unsigned int GetStateIdx(unsigned int nodeIdx) const { return (GetStateIdx(int2(nodeIdx % br.x, nodeIdx / br.x))); }
+
+	unsigned int GetNodeMask(unsigned int stateIdx) const {
+		const PathNodeState& ns = nodeStates[stateIdx];
+		return (ns.nodeMask & ((ns.searchGen == searchGen)? PATHOPT_SIZE: PATHOPT_OBSOLETE));
+	}
+	float GetNodeFCost(unsigned int stateIdx) const {
+		const PathNodeState& ns = nodeStates[stateIdx];
+		return ((ns.searchGen == searchGen)? ns.fCost: PATHCOST_INFINITY);
+	}
+	float GetNodeGCost(unsigned int stateIdx) const {
+		const PathNodeState& ns = nodeStates[stateIdx];
+		return ((ns.searchGen == searchGen)? ns.gCost: PATHCOST_INFINITY);
+	}
+
+	void SetNodeMaskBits(unsigned int stateIdx, unsigned int bits) { GetCurrentState(stateIdx).nodeMask |= bits; }
+	void ClearNodeMaskBits(unsigned int stateIdx, unsigned int bits) { GetCurrentState(stateIdx).nodeMask &= ~bits; }
+
+	void SetNodeCosts(unsigned int stateIdx, float fCost, float gCost) {
+		PathNodeState& ns = GetCurrentState(stateIdx);
+
+		ns.fCost = fCost;
+		ns.gCost = gCost;
 	}
 
 
@@ -171,8 +250,8 @@ struct PathNodeStateBuffer {
 		if (!peNodeOffsets.empty())
 			memFootPrint += (peNodeOffsets.size() * (sizeof(std::vector<short2>) + peNodeOffsets[0].size() * sizeof(short2)));
 
-		memFootPrint += (nodeMask.size() * sizeof(std::uint8_t));
-		memFootPrint += ((fCost.size() + gCost.size()) * sizeof(float));
+		memFootPrint += (nodeStates.size() * sizeof(PathNodeState));
+		memFootPrint += ((tileOffsets[0].size() + tileOffsets[1].size()) * sizeof(unsigned int));
 		memFootPrint += ((extraCosts[true].size() + extraCosts[false].size()) * sizeof(float));
 
 		return memFootPrint;
@@ -219,19 +298,57 @@ struct PathNodeStateBuffer {
 		er[synced].y = sz;
 	}
 
-public:
-	std::vector<float> fCost;
-	std::vector<float> gCost;
+	/// read (but never write) the extra costs of <pnsb>, which must have the same resolution
+	void ShareNodeExtraCosts(const PathNodeStateBuffer& pnsb) {
+		for (const bool synced: {false, true}) {
+			if ((extraCostsOverlay[synced] = pnsb.extraCostsOverlay[synced]) != nullptr) {
+				er[synced] = pnsb.er[synced];
+				continue;
+			}
+
+			// null if vector is empty; indexing at buffer resolution
+			// is then equivalent to GetNodeExtraCost's ecd branch
+			extraCostsOverlay[synced] = pnsb.extraCosts[synced].data();
+			er[synced] = pnsb.br;
+		}
+	}
 
-	/// bitmask of PATHOPT_{OPEN, ..., OBSOLETE} flags
-	std::vector<std::uint8_t> nodeMask;
+private:
+	/// spreads the bits of a tile-local coordinate (< TILE_SIZE) to every other bit
+	static unsigned int SpreadTileBits(unsigned int v) { return ((v & 1) | ((v & 2) << 1) | ((v & 4) << 2)); }
+
+	static void ClearState(PathNodeState& ns) {
+		ns.fCost = PATHCOST_INFINITY;
+		ns.gCost = PATHCOST_INFINITY;
+		ns.searchGen = 0;
+		// clear all bits except PATHOPT_OBSOLETE
+		ns.nodeMask &= PATHOPT_OBSOLETE;
+	}
+
+	/// brings a state up to the current generation before it is written
+	PathNodeState& GetCurrentState(unsigned int stateIdx) {
+		PathNodeState& ns = nodeStates[stateIdx];
 
+		if (ns.searchGen != searchGen) {
+			ClearState(ns);
+			ns.searchGen = searchGen;
+		}
+
+		return ns;
+	}
+
+public:
 	/// for the PE, maintains an array of the best accessible
 	/// offset (from a block's center position) per path-type
 	/// peNodeOffsets[pathType][blockIdx]
 	std::vector< std::vector<short2> > peNodeOffsets;
 
 private:
+	std::vector<PathNodeState> nodeStates;
+
+	/// x- and z-components of the state-index of each node-column and -row
+	std::vector<unsigned int> tileOffsets[2];
+
 	// overlay-cost modifiers for nodes (when non-zero, these
 	// modify the behavior of GetPath() and GetNextWaypoint())
 	//
@@ -258,81 +375,94 @@ private:
 	int2 br;    ///< buffer resolution (equal to mr / ps); ignored when extraCosts != NULL
 	int2 mr;    ///< heightmap resolution (equal to mapDims.map{x,y})
 	int2 er[2]; ///< extraCosts resolution
+
+	std::uint16_t searchGen = 0;
 };
 
 
 
-// looks like a std::vector, but holds a fixed-size buffer
-// used as a backing array for the PathPriorityQueue dtype
-class PathVector {
+/**
+ * Open set of a PF or PE search; a 4-ary heap which pops nodes in the
+ * order defined by lessCost. Priorities are stored next to the node
+ * pointers so sifting does not need to dereference any node.
+ */
+class PathPriorityQueue {
 public:
-	typedef int size_type;
-	typedef PathNode* value_type;
-	typedef PathNode* reference;
-	typedef PathNode** iterator;
-	typedef const PathNode* const_reference;
-	typedef const PathNode* const* const_iterator;
-
-		// gcc 4.3 requires concepts, so provide them
-		value_type& operator [] (size_type idx) { return buf[idx]; }
-		const value_type& operator [] (size_type idx) const { return buf[idx]; }
-
-		typedef iterator pointer;
-		typedef const_iterator const_pointer;
-		typedef int difference_type;
-
-		typedef PathNode** reverse_iterator;
-		typedef const PathNode* const* const_reverse_iterator;
-
-		// FIXME: don't ever use these
-		reverse_iterator rbegin() { return 0; }
-		reverse_iterator rend() { return 0; }
-		const_reverse_iterator rbegin() const { return 0; }
-		const_reverse_iterator rend() const { return 0; }
-		PathVector(int, const value_type&): bufPos(-1) { abort(); }
-		PathVector(iterator, iterator): bufPos(-1) { abort(); }
-		void insert(iterator, const value_type&) { abort(); }
-		void insert(iterator, const size_type&, const value_type&) { abort(); }
-		void insert(iterator, iterator, iterator) { abort(); }
-		void erase(iterator, iterator) { abort(); }
-		void erase(iterator) { abort(); }
-		void erase(iterator, iterator, iterator) { abort(); }
-		void swap(PathVector&) { abort(); }
-	// end of concept hax
-
-	PathVector(): bufPos(-1) {
-#ifdef DEBUG
-		// only do this in DEBUG builds for performance reasons
-		// it could help finding logic errors
-		std::fill(std::begin(buf), std::end(buf), nullptr);
-#endif
+	bool empty() const { return (numItems == 0); }
+	unsigned int size() const { return numItems; }
+
+	PathNode* top() const { return items[0].node; }
+
+	void push(PathNode* node) {
+		assert(numItems < MAX_SEARCHED_NODES);
+
+		const HeapItem item = {node->fCost, node->gCost, node};
+		unsigned int i = numItems++;
+
+		// sift up
+		while (i > 0) {
+			const unsigned int p = (i - 1) / HEAP_ARITY;
+
+			if (!HasPriority(item, items[p]))
+				break;
+
+			items[i] = items[p];
+			i = p;
+		}
+
+		items[i] = item;
+	}
+
+	void pop() {
+		assert(numItems > 0);
+
+		const HeapItem item = items[--numItems];
+		unsigned int i = 0;
+
+		// sift down
+		while (true) {
+			const unsigned int c0 = i * HEAP_ARITY + 1;
+			const unsigned int c1 = std::min(c0 + HEAP_ARITY, numItems);
+
+			if (c0 >= numItems)
+				break;
+
+			unsigned int c = c0;
+
+			for (unsigned int j = c0 + 1; j < c1; j++) {
+				c = HasPriority(items[j], items[c])? j: c;
+			}
+
+			if (!HasPriority(items[c], item))
+				break;
+
+			items[i] = items[c];
+			i = c;
+		}
+
+		items[i] = item;
 	}
 
-	inline void push_back(PathNode* os) { buf[++bufPos] = os; }
-	inline void pop_back() { --bufPos; }
-	inline PathNode* back() const { return buf[bufPos]; }
-	inline const value_type& front() const { return buf[0]; }
-	inline value_type& front() { return buf[0]; }
-	inline bool empty() const { return (bufPos < 0); }
-	inline size_type size() const { return bufPos + 1; }
-	inline size_type max_size() const { return (1 << 30); }
-	inline iterator begin() { return &buf[0]; }
-	inline iterator end() { return &buf[bufPos + 1]; }
-	inline const_iterator begin() const { return &buf[0]; }
-	inline const_iterator end() const { return &buf[bufPos + 1]; }
-	inline void clear() { bufPos = -1; }
+	void Clear() { numItems = 0; }
 
 private:
-	int bufPos;
+	static constexpr unsigned int HEAP_ARITY = 4;
 
-	PathNode* buf[MAX_SEARCHED_NODES];
-};
+	struct HeapItem {
+		float fCost;
+		float gCost;
+		PathNode* node;
+	};
 
+	/// true if <a> should be popped before <b>; same order as lessCost
+	static bool HasPriority(const HeapItem& a, const HeapItem& b) {
+		return ((a.fCost == b.fCost)? (a.gCost > b.gCost): (a.fCost < b.fCost));
+	}
 
-class PathPriorityQueue: public std::priority_queue<PathNode*, PathVector, lessCost> {
-public:
-	/// faster than "while (!q.empty()) { q.pop(); }"
-	void Clear() { c.clear(); }
+private:
+	unsigned int numItems = 0;
+
+	HeapItem items[MAX_SEARCHED_NODES];
 };
 
 #endif // PATH_DATATYPES_H
@@ -12,6 +12,8 @@
 #include "PathMemPool.h"
 #include "Game/GlobalUnsynced.h"
 #include "Game/LoadScreen.h"
+#include "Map/MapInfo.h"
+#include "Map/ReadMap.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/ModInfo.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
@@ -28,17 +30,31 @@
 #include "System/Platform/Threading.h"
 #include "System/SafeUtil.h"
 #include "System/StringUtil.h"
+#include "System/Sync/HsiehHash.h"
 #include "System/Sync/SHA512.hpp"
 
 #define ENABLE_NETLOG_CHECKSUM 1
 
 CONFIG(int, PathingThreadCount).defaultValue(0).safemodeValue(1).minimumValue(0);
-CONFIG(int, MaxPathCostsMemoryFootPrint).defaultValue(512).minimumValue(64).description("Maximum memusage (in MByte) of multithreaded pathcache generator at loading time.");
+CONFIG(int, MaxPathCostsMemoryFootPrint).defaultValue(512).minimumValue(64).description("Maximum memusage (in MByte) of multithreaded pathcache generator at loading time, and of the threads resolving deferred path requests in-game.");
 
 PCMemPool pcMemPool;
 PEMemPool peMemPool;
 
 
+// heightmap changes made before the estimators were initialized, tracked
+// per cell of HEIGHT_DELTA_CELL_SIZE^2 squares; see InitHeightMapDelta
+static constexpr int HEIGHT_DELTA_CELL_SIZE = 4;
+static_assert((MEDRES_PE_BLOCKSIZE % HEIGHT_DELTA_CELL_SIZE) == 0, "cells must not straddle blocks");
+static_assert((LOWRES_PE_BLOCKSIZE % HEIGHT_DELTA_CELL_SIZE) == 0, "cells must not straddle blocks");
+
+static std::vector<std::uint8_t> heightDeltaCells;
+static int2 heightDeltaCellDims;
+
+// zero if the original heightmap is not available anymore
+static std::uint32_t baseHeightMapChecksum = 0;
+
+
 static const std::string GetPathCacheDir() {
 	return (FileSystem::GetCacheDir() + "/paths/");
 }
@@ -68,13 +84,18 @@ void CPathEstimator::Init(IPathFinder* pf, unsigned int BLOCK_SIZE, const std::s
 		nextCostMessageIdx = 0;
 
 		pathChecksum = 0;
-		fileHashCode = CalcHash(__func__);
+		fileHashCode = CalcHash(__func__, readMap->CalcHeightmapChecksum());
+		baseHashCode = fileHashCode;
+
+		if (baseHeightMapChecksum != 0)
+			baseHashCode = CalcHash(__func__, baseHeightMapChecksum);
 
 		offsetBlockNum = {nbrOfBlocks.x * nbrOfBlocks.y};
 		costBlockNum = {nbrOfBlocks.x * nbrOfBlocks.y};
 
 		parentPathFinder = pf;
 		nextPathEstimator = nullptr;
+		costEstimator = this;
 	}
 	{
 		vertexCosts.clear();
@@ -83,6 +104,7 @@ void CPathEstimator::Init(IPathFinder* pf, unsigned int BLOCK_SIZE, const std::s
 		maxSpeedMods.resize(moveDefHandler.GetNumMoveDefs(), 0.001f);
 
 		updatedBlocks.clear();
+		wantedBlocks.clear();
 		consumedBlocks.clear();
 		offsetBlocksSortedByCost.clear();
 	}
@@ -136,8 +158,81 @@ void CPathEstimator::Init(IPathFinder* pf, unsigned int BLOCK_SIZE, const std::s
 }
 
 
+void CPathEstimator::InitWorker(const CPathEstimator* pe, IPathFinder* pf)
+{
+	IPathFinder::Init(pe->BLOCK_SIZE);
+
+	parentPathFinder = pf;
+	nextPathEstimator = nullptr;
+	costEstimator = pe;
+
+	pathCache[0] = nullptr;
+	pathCache[1] = nullptr;
+
+	dummyCacheItem = CPathCache::CacheItem{IPath::Error, {}, {-1, -1}, {-1, -1}, -1.0f, -1};
+}
+
+void CPathEstimator::InitHeightMapDelta()
+{
+	const float* currHeightMap = readMap->GetCornerHeightMapSynced();
+	const float* origHeightMap = readMap->GetOriginalHeightMapSynced();
+
+	heightDeltaCellDims.x = (mapDims.mapx + HEIGHT_DELTA_CELL_SIZE - 1) / HEIGHT_DELTA_CELL_SIZE;
+	heightDeltaCellDims.y = (mapDims.mapy + HEIGHT_DELTA_CELL_SIZE - 1) / HEIGHT_DELTA_CELL_SIZE;
+
+	heightDeltaCells.clear();
+	heightDeltaCells.resize(heightDeltaCellDims.x * heightDeltaCellDims.y, 0);
+
+	// the original heightmap is overwritten by every CalcHeightmapChecksum
+	// call (e.g. by a previous estimator initialization), verify it still
+	// is the one the map-checksum was calculated from
+	std::uint32_t origChecksum = 0;
+
+	for (int i = 0; i < (mapDims.mapxp1 * mapDims.mapyp1); ++i) {
+		origChecksum = HsiehHash(&origHeightMap[i], sizeof(origHeightMap[i]), origChecksum);
+	}
+
+	origChecksum = HsiehHash(mapInfo->map.name.c_str(), mapInfo->map.name.size(), origChecksum);
+	baseHeightMapChecksum = 0;
+
+	if (origChecksum != readMap->GetMapChecksum())
+		return;
+
+	unsigned int numChangedCells = 0;
+
+	for (int z = 0; z <= mapDims.mapy; z++) {
+		for (int x = 0; x <= mapDims.mapx; x++) {
+			const int idx = z * mapDims.mapxp1 + x;
+
+			if (currHeightMap[idx] == origHeightMap[idx])
+				continue;
+
+			// a corner is shared by up to four squares
+			for (int sz = std::max(z - 1, 0); sz <= std::min(z, mapDims.mapy - 1); sz++) {
+				for (int sx = std::max(x - 1, 0); sx <= std::min(x, mapDims.mapx - 1); sx++) {
+					std::uint8_t& cell = heightDeltaCells[(sz / HEIGHT_DELTA_CELL_SIZE) * heightDeltaCellDims.x + (sx / HEIGHT_DELTA_CELL_SIZE)];
+
+					numChangedCells += (cell == 0);
+					cell = 1;
+				}
+			}
+		}
+	}
+
+	baseHeightMapChecksum = origChecksum;
+
+	LOG("[PathEstimator::%s] %u of %u heightmap cells modified since map load", __func__, numChangedCells, unsigned(heightDeltaCells.size()));
+}
+
 void CPathEstimator::Kill()
 {
+	if (costEstimator != this) {
+		// worker; return the node-state buffer for reuse
+		IPathFinder::Kill();
+		deferredCacheItems.clear();
+		return;
+	}
+
 	pcMemPool.free(pathCache[0]);
 	pcMemPool.free(pathCache[1]);
 }
@@ -161,7 +256,7 @@ void CPathEstimator::InitEstimator(const std::string& peFileName, const std::str
 	// Not much point in multithreading these...
 	InitBlocks();
 
-	if (!ReadFile(peFileName, mapFileName)) {
+	if (!ReadFile(peFileName, mapFileName, fileHashCode) && !ReadDeltaFile(peFileName, mapFileName)) {
 		// start extra threads if applicable, but always keep the total
 		// memory-footprint made by CPathFinder instances within bounds
 		const unsigned int minMemFootPrint = sizeof(CPathFinder) + parentPathFinder->GetMemFootPrint();
@@ -460,26 +555,33 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 	// bi-directional vertices
 	for (int z = upperZ; z >= lowerZ; z--) {
 		for (int x = upperX; x >= lowerX; x--) {
-			const int idx = BlockPosToIdx(int2(x, z));
+			const unsigned int stateIdx = blockStates.GetStateIdx(int2(x, z));
 
-			if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) != 0)
+			if ((blockStates.GetNodeMask(stateIdx) & PATHOPT_OBSOLETE) != 0)
 				continue;
 
 			updatedBlocks.emplace_back(x, z);
-			blockStates.nodeMask[idx] |= PATHOPT_OBSOLETE;
+			blockStates.SetNodeMaskBits(stateIdx, PATHOPT_OBSOLETE);
 		}
 	}
 }
 
 
 /**
- * Update some obsolete blocks using the FIFO-principle
+ * Update some obsolete blocks using the FIFO-principle, after those
+ * that searches were waiting on
  */
 void CPathEstimator::Update()
 {
 	pathCache[0]->Update();
 	pathCache[1]->Update();
 
+	// sorted because the order in which searches found these depends on
+	// request scheduling
+	PullWantedBlocks();
+	std::sort(wantedBlocks.begin(), wantedBlocks.end());
+	wantedBlocks.erase(std::unique(wantedBlocks.begin(), wantedBlocks.end()), wantedBlocks.end());
+
 	const unsigned int numMoveDefs = moveDefHandler.GetNumMoveDefs();
 
 	if (numMoveDefs == 0)
@@ -513,12 +615,32 @@ void CPathEstimator::Update()
 	consumedBlocks.clear();
 	consumedBlocks.reserve(consumeBlocks);
 
-	// get blocks to update
+	// get blocks that searches are waiting on first, those not served
+	// within this update's budget are kept for the next
+	{
+		size_t numWantedBlocks = 0;
+
+		for (const unsigned int idx: wantedBlocks) {
+			if ((blockStates.GetNodeMask(blockStates.GetStateIdx(idx)) & PATHOPT_OBSOLETE) == 0)
+				continue;
+
+			if (consumedBlocks.size() >= blocksToUpdate) {
+				wantedBlocks[numWantedBlocks++] = idx;
+				continue;
+			}
+
+			ConsumeBlock(BlockIdxToPos(idx), idx);
+		}
+
+		wantedBlocks.resize(numWantedBlocks);
+	}
+
+	// get remaining blocks to update (FIFO)
 	while (!updatedBlocks.empty()) {
 		const int2& pos = updatedBlocks.front();
 		const int idx = BlockPosToIdx(pos);
 
-		if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0) {
+		if ((blockStates.GetNodeMask(blockStates.GetStateIdx(pos)) & PATHOPT_OBSOLETE) == 0) {
 			updatedBlocks.pop_front();
 			continue;
 		}
@@ -526,23 +648,8 @@ void CPathEstimator::Update()
 		if (consumedBlocks.size() >= blocksToUpdate)
 			break;
 
-		// issue repathing for all active movedefs
-		for (unsigned int i = 0; i < numMoveDefs; i++) {
-			const MoveDef* md = moveDefHandler.GetMoveDefByPathType(i);
-
-			consumedBlocks.emplace_back(pos, md);
-		}
-
-		// inform dependent estimator that costs were updated and it should do the same
-		// FIXME?
-		//   adjacent med-res PE blocks will cause a low-res block to be updated twice
-		//   (in addition to the overlap that already exists because MapChanged() adds
-		//   boundary blocks)
-		if (true && nextPathEstimator != nullptr)
-			nextPathEstimator->MapChanged(pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE, pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE);
-
+		ConsumeBlock(pos, idx);
 		updatedBlocks.pop_front(); // must happen _after_ last usage of the `pos` reference!
-		blockStates.nodeMask[idx] &= ~PATHOPT_OBSOLETE;
 	}
 
 	// FindOffset (threadsafe)
@@ -567,13 +674,110 @@ void CPathEstimator::Update()
 }
 
 
+void CPathEstimator::ConsumeBlock(const int2 blockPos, unsigned int blockIdx)
+{
+	// issue repathing for all active movedefs
+	for (unsigned int i = 0; i < moveDefHandler.GetNumMoveDefs(); i++) {
+		const MoveDef* md = moveDefHandler.GetMoveDefByPathType(i);
+
+		consumedBlocks.emplace_back(blockPos, md);
+	}
+
+	// inform dependent estimator that costs were updated and it should do the same
+	// FIXME?
+	//   adjacent med-res PE blocks will cause a low-res block to be updated twice
+	//   (in addition to the overlap that already exists because MapChanged() adds
+	//   boundary blocks)
+	if (true && nextPathEstimator != nullptr)
+		nextPathEstimator->MapChanged(blockPos.x * BLOCK_SIZE, blockPos.y * BLOCK_SIZE, blockPos.x * BLOCK_SIZE, blockPos.y * BLOCK_SIZE);
+
+	blockStates.ClearNodeMaskBits(blockStates.GetStateIdx(blockPos), PATHOPT_OBSOLETE);
+}
+
+/**
+ * Low-res estimates are derived from (searches over) med-res ones, so when
+ * a search waits on a low-res block the med-res blocks it covers are wanted
+ * as well and should be updated first.
+ */
+void CPathEstimator::PullWantedBlocks()
+{
+	if (nextPathEstimator == nullptr)
+		return;
+
+	const unsigned int numSubBlocks = nextPathEstimator->BLOCK_SIZE / BLOCK_SIZE;
+
+	for (const unsigned int nextBlockIdx: nextPathEstimator->wantedBlocks) {
+		const int2 nextBlockPos = nextPathEstimator->BlockIdxToPos(nextBlockIdx);
+
+		for (unsigned int z = 0; z < numSubBlocks; z++) {
+			for (unsigned int x = 0; x < numSubBlocks; x++) {
+				const int2 blockPos = {int(nextBlockPos.x * numSubBlocks + x), int(nextBlockPos.y * numSubBlocks + z)};
+
+				if (static_cast<unsigned int>(blockPos.x) >= nbrOfBlocks.x || static_cast<unsigned int>(blockPos.y) >= nbrOfBlocks.y)
+					continue;
+
+				const unsigned int blockIdx = BlockPosToIdx(blockPos);
+
+				if ((blockStates.GetNodeMask(blockStates.GetStateIdx(blockPos)) & PATHOPT_OBSOLETE) == 0)
+					continue;
+
+				wantedBlocks.push_back(blockIdx);
+			}
+		}
+	}
+}
+
+void CPathEstimator::MergeWantedBlocks(CPathEstimator& pe)
+{
+	wantedBlocks.insert(wantedBlocks.end(), pe.wantedBlocks.begin(), pe.wantedBlocks.end());
+	pe.wantedBlocks.clear();
+}
+
+void CPathEstimator::MergeDeferredCacheItems(CPathEstimator& pe)
+{
+	deferredCacheItems.insert(deferredCacheItems.end(), pe.deferredCacheItems.begin(), pe.deferredCacheItems.end());
+	pe.deferredCacheItems.clear();
+}
+
+void CPathEstimator::CommitDeferredCacheItems()
+{
+	// the items of one request all come from the same worker, in the order
+	// they were found; the cache keeps the first of several identical keys
+	std::stable_sort(deferredCacheItems.begin(), deferredCacheItems.end(), [](const DeferredCacheItem& a, const DeferredCacheItem& b) {
+		return (a.requestIdx < b.requestIdx);
+	});
+
+	for (const DeferredCacheItem& dci: deferredCacheItems) {
+		const CPathCache::CacheItem& ci = dci.item;
+		AddCache(&ci.path, ci.result, ci.strtBlock, ci.goalBlock, ci.goalRadius, ci.pathType, dci.synced);
+	}
+
+	deferredCacheItems.clear();
+}
+
+
 const CPathCache::CacheItem& CPathEstimator::GetCache(const int2 strtBlock, const int2 goalBlock, float goalRadius, int pathType, const bool synced) const
 {
-	return pathCache[synced]->GetCachedPath(strtBlock, goalBlock, goalRadius, pathType);
+	if (pathCache[synced] != nullptr)
+		return pathCache[synced]->GetCachedPath(strtBlock, goalBlock, goalRadius, pathType);
+
+	// worker; the owner's cache is only written between batches, so every
+	// worker sees the same entries whichever requests it happens to run
+	if (costEstimator != this && costEstimator->pathCache[synced] != nullptr)
+		return costEstimator->pathCache[synced]->FindCachedPath(strtBlock, goalBlock, goalRadius, pathType);
+
+	return dummyCacheItem;
 }
 
 void CPathEstimator::AddCache(const IPath::Path* path, const IPath::SearchResult result, const int2 strtBlock, const int2 goalBlock, float goalRadius, int pathType, const bool synced)
 {
+	if (pathCache[synced] == nullptr) {
+		if (costEstimator != this)
+			deferredCacheItems.push_back({CPathCache::CacheItem{result, *path, strtBlock, goalBlock, goalRadius, pathType}, deferredCacheRequestIdx, synced});
+
+		return;
+	}
+
 	pathCache[synced]->AddPath(path, result, strtBlock, goalBlock, goalRadius, pathType);
 }
 
@@ -622,19 +826,21 @@ IPath::SearchResult CPathEstimator::DoSearch(const MoveDef& moveDef, const CPath
 
 	// get the goal square offset
 	const int2 goalSqrOffset = peDef.GoalSquareOffset(BLOCK_SIZE);
-	const float maxSpeedMod = maxSpeedMods[moveDef.pathType];
+	const float maxSpeedMod = costEstimator->maxSpeedMods[moveDef.pathType];
 
 	while (!openBlocks.empty() && (openBlockBuffer.GetSize() < maxBlocksToBeSearched)) {
 		// get the open block with lowest cost
 		const PathNode* ob = openBlocks.top();
 		openBlocks.pop();
 
+		const unsigned int obStateIdx = blockStates.GetStateIdx(ob->nodePos);
+
 		// check if the block has been marked as unaccessible during its time in the queue
-		if (blockStates.nodeMask[ob->nodeNum] & (PATHOPT_BLOCKED | PATHOPT_CLOSED))
+		if (blockStates.GetNodeMask(obStateIdx) & (PATHOPT_BLOCKED | PATHOPT_CLOSED))
 			continue;
 
 		// no, check if the goal is already reached
-		const int2 bSquare = blockStates.peNodeOffsets[moveDef.pathType][ob->nodeNum];
+		const int2 bSquare = GetNodeOffsets(moveDef.pathType)[ob->nodeNum];
 		const int2 gSquare = ob->nodePos * BLOCK_SIZE + goalSqrOffset;
 
 		bool runBlkSearch = false;
@@ -671,7 +877,7 @@ IPath::SearchResult CPathEstimator::DoSearch(const MoveDef& moveDef, const CPath
 		TestBlock(moveDef, peDef, ob, owner, PATHDIR_LEFT_DOWN,  PATHOPT_OPEN, maxSpeedMod);
 
 		// mark this block as closed
-		blockStates.nodeMask[ob->nodeNum] |= PATHOPT_CLOSED;
+		blockStates.SetNodeMaskBits(obStateIdx, PATHOPT_CLOSED);
 	}
 
 	// we found our goal
@@ -721,26 +927,34 @@ bool CPathEstimator::TestBlock(
 	// read precached vertex costs
 	const unsigned int openBlockIdx = BlockPosToIdx(openBlockPos);
 	const unsigned int testBlockIdx = BlockPosToIdx(testBlockPos);
+	const unsigned int testStateIdx = blockStates.GetStateIdx(testBlockPos);
 
 	// check if the block is unavailable
-	if (blockStates.nodeMask[testBlockIdx] & (PATHOPT_BLOCKED | PATHOPT_CLOSED))
+	if (blockStates.GetNodeMask(testStateIdx) & (PATHOPT_BLOCKED | PATHOPT_CLOSED))
 		return false;
 
+	// remember stale estimates this search had to use, Update serves them
+	// first; unsynced searches must not influence which blocks that is
+	if (peDef.synced && (costEstimator->blockStates.GetNodeMask(costEstimator->blockStates.GetStateIdx(testBlockPos)) & PATHOPT_OBSOLETE) != 0) {
+		if (wantedBlocks.empty() || wantedBlocks.back() != testBlockIdx)
+			wantedBlocks.push_back(testBlockIdx);
+	}
+
 	const unsigned int vertexBaseIdx = moveDef.pathType * nbrOfBlocks.x * nbrOfBlocks.y * PATH_DIRECTION_VERTICES;
 	const unsigned int vertexCostIdx =
 		vertexBaseIdx +
 		openBlockIdx * PATH_DIRECTION_VERTICES +
 		GetBlockVertexOffset(pathDir, nbrOfBlocks.x);
 
-	assert(testBlockIdx < blockStates.peNodeOffsets[moveDef.pathType].size());
-	assert(vertexCostIdx < vertexCosts.size());
+	assert(testBlockIdx < GetNodeOffsets(moveDef.pathType).size());
+	assert(vertexCostIdx < costEstimator->vertexCosts.size());
 
 	// best accessible heightmap-coordinate within tested block
-	// [DBG] const int2 openBlockSquare = blockStates.peNodeOffsets[moveDef.pathType][openBlockIdx];
-	const int2 testBlockSquare = blockStates.peNodeOffsets[moveDef.pathType][testBlockIdx];
+	// [DBG] const int2 openBlockSquare = GetNodeOffsets(moveDef.pathType)[openBlockIdx];
+	const int2 testBlockSquare = GetNodeOffsets(moveDef.pathType)[testBlockIdx];
 
 	// transition-cost from parent to tested child
-	float testVertexCost = vertexCosts[vertexCostIdx];
+	float testVertexCost = costEstimator->vertexCosts[vertexCostIdx];
 
 
 	// inf-cost means we can not get from the parent VERTEX to the child
@@ -761,8 +975,7 @@ bool CPathEstimator::TestBlock(
 		// etc. in the nodeMask but that is complicated and not
 		// worth it: would just save the vertexCosts[] lookup
 		//
-		// blockStates.nodeMask[testBlockIdx] |= (PathDir2PathOpt(pathDir) | PATHOPT_BLOCKED);
-		// dirtyBlocks.push_back(testBlockIdx);
+		// blockStates.SetNodeMaskBits(testStateIdx, PathDir2PathOpt(pathDir) | PATHOPT_BLOCKED);
 		if (blockedSearch || DoBlockSearch(owner, moveDef, peDef.wsStartPos, SquareToFloat3(testBlockSquare)) != IPath::Ok)
 			return false;
 
@@ -775,8 +988,7 @@ bool CPathEstimator::TestBlock(
 
 	// check if the block is outside constraints
 	if (!peDef.WithinConstraints(testBlockSquare)) {
-		blockStates.nodeMask[testBlockIdx] |= PATHOPT_BLOCKED;
-		dirtyBlocks.push_back(testBlockIdx);
+		blockStates.SetNodeMaskBits(testStateIdx, PATHOPT_BLOCKED);
 		return false;
 	}
 
@@ -804,8 +1016,7 @@ bool CPathEstimator::TestBlock(
 					// we cannot set PATHOPT_BLOCKED here either, result
 					// depends on direction of entry from the parent node
 					//
-					// blockStates.nodeMask[testBlockIdx] |= PATHOPT_BLOCKED;
-					// dirtyBlocks.push_back(testBlockIdx);
+					// blockStates.SetNodeMaskBits(testStateIdx, PATHOPT_BLOCKED);
 					return false;
 				}
 			}
@@ -832,13 +1043,13 @@ bool CPathEstimator::TestBlock(
 	const float fCost = gCost + hCost;
 
 	// already in the open set?
-	if (blockStates.nodeMask[testBlockIdx] & PATHOPT_OPEN) {
+	if (blockStates.GetNodeMask(testStateIdx) & PATHOPT_OPEN) {
 		// check if new found path is better or worse than the old one
-		if (blockStates.fCost[testBlockIdx] <= fCost)
+		if (blockStates.GetNodeFCost(testStateIdx) <= fCost)
 			return true;
 
 		// no, clear old path data
-		blockStates.nodeMask[testBlockIdx] &= ~PATHOPT_CARDINALS;
+		blockStates.ClearNodeMaskBits(testStateIdx, PATHOPT_CARDINALS);
 	}
 
 	// look for improvements
@@ -862,11 +1073,8 @@ bool CPathEstimator::TestBlock(
 	blockStates.SetMaxCost(NODE_COST_G, std::max(blockStates.GetMaxCost(NODE_COST_G), gCost));
 
 	// mark this block as open
-	blockStates.fCost[testBlockIdx] = fCost;
-	blockStates.gCost[testBlockIdx] = gCost;
-	blockStates.nodeMask[testBlockIdx] |= (PathDir2PathOpt(pathDir) | PATHOPT_OPEN);
-
-	dirtyBlocks.push_back(testBlockIdx);
+	blockStates.SetNodeCosts(testStateIdx, fCost, gCost);
+	blockStates.SetNodeMaskBits(testStateIdx, PathDir2PathOpt(pathDir) | PATHOPT_OPEN);
 	return true;
 }
 
@@ -883,7 +1091,7 @@ void CPathEstimator::FinishSearch(const MoveDef& moveDef, const CPathFinderDef&
 		{
 			#if 1
 			while (blockIdx != mStartBlockIdx) {
-				const unsigned int pathOpt = blockStates.nodeMask[blockIdx] & PATHOPT_CARDINALS;
+				const unsigned int pathOpt = blockStates.GetNodeMask(blockStates.GetStateIdx(blockIdx)) & PATHOPT_CARDINALS;
 				const unsigned int pathDir = PathOpt2PathDir(pathOpt);
 
 				blockIdx  = BlockPosToIdx(BlockIdxToPos(blockIdx) - PE_DIRECTION_VECTORS[pathDir]);
@@ -907,7 +1115,7 @@ void CPathEstimator::FinishSearch(const MoveDef& moveDef, const CPathFinderDef&
 
 		while (true) {
 			// use offset defined by the block
-			const int2 square = blockStates.peNodeOffsets[moveDef.pathType][blockIdx];
+			const int2 square = GetNodeOffsets(moveDef.pathType)[blockIdx];
 
 			// foundPath.squares.push_back(square);
 			foundPath.path.emplace_back(square.x * SQUARE_SIZE, CMoveMath::yLevel(moveDef, square.x, square.y), square.y * SQUARE_SIZE);
@@ -916,7 +1124,7 @@ void CPathEstimator::FinishSearch(const MoveDef& moveDef, const CPathFinderDef&
 				break;
 
 			// next step backwards
-			const unsigned int pathOpt = blockStates.nodeMask[blockIdx] & PATHOPT_CARDINALS;
+			const unsigned int pathOpt = blockStates.GetNodeMask(blockStates.GetStateIdx(blockIdx)) & PATHOPT_CARDINALS;
 			const unsigned int pathDir = PathOpt2PathDir(pathOpt);
 
 			blockIdx = BlockPosToIdx(BlockIdxToPos(blockIdx) - PE_DIRECTION_VECTORS[pathDir]);
@@ -926,21 +1134,25 @@ void CPathEstimator::FinishSearch(const MoveDef& moveDef, const CPathFinderDef&
 			foundPath.pathGoal = foundPath.path[0];
 	}
 
-	foundPath.pathCost = blockStates.fCost[mGoalBlockIdx] - mGoalHeuristic;
+	foundPath.pathCost = blockStates.GetNodeFCost(blockStates.GetStateIdx(mGoalBlockIdx)) - mGoalHeuristic;
 }
 
 
 bool CPathEstimator::RemoveCacheFile(const std::string& peFileName, const std::string& mapFileName)
 {
+	// also drop the file holding the delta-layers, if data was loaded from it
+	if (baseHashCode != fileHashCode)
+		FileSystem::Remove(GetCacheFileName(IntToString(baseHashCode, "%x"), peFileName, mapFileName));
+
 	return (FileSystem::Remove(GetCacheFileName(IntToString(fileHashCode, "%x"), peFileName, mapFileName)));
 }
 
 /**
  * Try to read offset and vertices data from file, return false on failure
  */
-bool CPathEstimator::ReadFile(const std::string& peFileName, const std::string& mapFileName)
+bool CPathEstimator::ReadFile(const std::string& peFileName, const std::string& mapFileName, std::uint32_t hashCode)
 {
-	const std::string hashHexString = IntToString(fileHashCode, "%x");
+	const std::string hashHexString = IntToString(hashCode, "%x");
 	const std::string cacheFileName = GetCacheFileName(hashHexString, peFileName, mapFileName);
 
 	LOG("[PathEstimator::%s] hash=%s file=\"%s\" (exists=%d)", __func__, hashHexString.c_str(), cacheFileName.c_str(), FileSystem::FileExists(cacheFileName));
@@ -976,7 +1188,7 @@ bool CPathEstimator::ReadFile(const std::string& peFileName, const std::string&
 	const unsigned int blockSize = blockStates.GetSize() * sizeof(short2);
 	unsigned int pos = sizeof(unsigned);
 
-	if (filehash != fileHashCode) {
+	if (filehash != hashCode) {
 		FileSystem::Remove(cacheFileName);
 		return false;
 	}
@@ -1053,6 +1265,309 @@ bool CPathEstimator::WriteFile(const std::string& peFileName, const std::string&
 }
 
 
+/**
+ * Try to load the data of the unmodified map and bring it up to date with
+ * the current heightmap, either from a stored delta-layer or by recomputing
+ * only the affected blocks (which are then stored as a new layer).
+ * Typemap or blocking-map changes are not handled here (they change the
+ * base hash as well), neither are modifications that touch most blocks.
+ */
+bool CPathEstimator::ReadDeltaFile(const std::string& peFileName, const std::string& mapFileName)
+{
+	if (baseHashCode == fileHashCode)
+		return false;
+
+	if (!ReadFile(peFileName, mapFileName, baseHashCode))
+		return false;
+
+	if (ReadDeltaLayer(peFileName, mapFileName))
+		return true;
+
+	std::vector<unsigned int> deltaBlocks;
+
+	if (!CalcDeltaLayer(deltaBlocks))
+		return false;
+
+	char calcMsg[512];
+	sprintf(calcMsg, "[%s] writing PE%u cache-file %s-%x layer %x (%u blocks)", __func__, BLOCK_SIZE, peFileName.c_str(), baseHashCode, fileHashCode, unsigned(deltaBlocks.size()));
+	loadscreen->SetLoadMessage(calcMsg, true);
+
+	WriteDeltaLayer(peFileName, mapFileName, deltaBlocks);
+	return true;
+}
+
+/**
+ * Layout of a delta-layer, all data for the blocks listed (in this order):
+ *   [hash][numBlocks][blockIdx * numBlocks]
+ *   [offsets * numBlocks] for each pathType
+ *   [vertex-costs * PATH_DIRECTION_VERTICES * numBlocks] for each pathType
+ */
+bool CPathEstimator::ReadDeltaLayer(const std::string& peFileName, const std::string& mapFileName)
+{
+	const std::string cacheFileName = GetCacheFileName(IntToString(baseHashCode, "%x"), peFileName, mapFileName);
+	const std::string layerName = IntToString(fileHashCode, "pathdelta-%x");
+
+	std::unique_ptr<IArchive> upfile(archiveLoader.OpenArchive(dataDirsAccess.LocateFile(cacheFileName), "sdz"));
+
+	if (upfile == nullptr || !upfile->IsOpen())
+		return false;
+
+	const unsigned fid = upfile->FindFile(layerName);
+
+	LOG("[PathEstimator::%s] layer=%s file=\"%s\" (exists=%d)", __func__, layerName.c_str(), cacheFileName.c_str(), fid < upfile->NumFiles());
+
+	if (fid >= upfile->NumFiles())
+		return false;
+
+	std::vector<std::uint8_t> buffer;
+
+	if (!upfile->GetFile(fid, buffer) || buffer.size() < (sizeof(unsigned int) * 2))
+		return false;
+
+	const unsigned int numMoveDefs = moveDefHandler.GetNumMoveDefs();
+	const unsigned int blockDataSize = sizeof(unsigned int) + numMoveDefs * (sizeof(short2) + PATH_DIRECTION_VERTICES * sizeof(float));
+
+	unsigned int layerHash = 0;
+	unsigned int numBlocks = 0;
+	unsigned int pos = sizeof(unsigned int) * 2;
+
+	std::memcpy(&layerHash, &buffer[0], sizeof(layerHash));
+	std::memcpy(&numBlocks, &buffer[sizeof(layerHash)], sizeof(numBlocks));
+
+	if (layerHash != fileHashCode || numBlocks > blockStates.GetSize() || buffer.size() != (pos + numBlocks * blockDataSize))
+		return false;
+
+	std::vector<unsigned int> deltaBlocks(numBlocks);
+
+	if (numBlocks > 0)
+		std::memcpy(deltaBlocks.data(), &buffer[pos], numBlocks * sizeof(unsigned int));
+
+	pos += (numBlocks * sizeof(unsigned int));
+
+	for (const unsigned int blockIdx: deltaBlocks) {
+		if (blockIdx >= blockStates.GetSize())
+			return false;
+	}
+
+	for (unsigned int pathType = 0; pathType < numMoveDefs; ++pathType) {
+		for (const unsigned int blockIdx: deltaBlocks) {
+			std::memcpy(&blockStates.peNodeOffsets[pathType][blockIdx], &buffer[pos], sizeof(short2));
+			pos += sizeof(short2);
+		}
+	}
+
+	for (unsigned int pathType = 0; pathType < numMoveDefs; ++pathType) {
+		for (const unsigned int blockIdx: deltaBlocks) {
+			std::memcpy(&vertexCosts[(pathType * blockStates.GetSize() + blockIdx) * PATH_DIRECTION_VERTICES], &buffer[pos], PATH_DIRECTION_VERTICES * sizeof(float));
+			pos += (PATH_DIRECTION_VERTICES * sizeof(float));
+		}
+	}
+
+	return true;
+}
+
+bool CPathEstimator::WriteDeltaLayer(const std::string& peFileName, const std::string& mapFileName, const std::vector<unsigned int>& deltaBlocks)
+{
+	const std::string cacheFileName = GetCacheFileName(IntToString(baseHashCode, "%x"), peFileName, mapFileName);
+	const std::string layerName = IntToString(fileHashCode, "pathdelta-%x");
+
+	LOG("[PathEstimator::%s] layer=%s file=\"%s\" (blocks=%u)", __func__, layerName.c_str(), cacheFileName.c_str(), unsigned(deltaBlocks.size()));
+
+	// entries to carry over if the archive has to be rewritten
+	std::vector< std::pair<std::string, std::vector<std::uint8_t>> > keptEntries;
+
+	{
+		std::unique_ptr<IArchive> upfile(archiveLoader.OpenArchive(dataDirsAccess.LocateFile(cacheFileName), "sdz"));
+
+		if (upfile == nullptr || !upfile->IsOpen())
+			return false;
+
+		// a layer that ReadDeltaLayer rejected (e.g. written for a different
+		// number of movedefs) must be replaced rather than shadowed by a new
+		// entry of the same name, zip offers no way to remove it in place
+		if (upfile->FindFile(layerName) < upfile->NumFiles()) {
+			keptEntries.reserve(upfile->NumFiles() - 1);
+
+			for (unsigned int fid = 0; fid < upfile->NumFiles(); fid++) {
+				std::string entryName;
+				upfile->FileInfoName(fid, entryName);
+
+				if (entryName == layerName)
+					continue;
+
+				keptEntries.emplace_back(std::move(entryName), std::vector<std::uint8_t>{});
+
+				if (!upfile->GetFile(fid, keptEntries.back().second))
+					return false;
+			}
+		}
+	}
+
+	// add the layer to the existing archive, or recreate it without the stale one
+	zipFile file = zipOpen(dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE).c_str(), keptEntries.empty()? APPEND_STATUS_ADDINZIP: APPEND_STATUS_CREATE);
+
+	if (file == nullptr)
+		return false;
+
+	for (const auto& entry: keptEntries) {
+		zipOpenNewFileInZip(file, entry.first.c_str(), nullptr, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_BEST_COMPRESSION);
+		zipWriteInFileInZip(file, entry.second.data(), entry.second.size());
+		zipCloseFileInZip(file);
+	}
+
+	const unsigned int numMoveDefs = moveDefHandler.GetNumMoveDefs();
+	const unsigned int numBlocks = deltaBlocks.size();
+
+	std::vector<std::uint8_t> buffer;
+	buffer.reserve(sizeof(unsigned int) * 2 + numBlocks * (sizeof(unsigned int) + numMoveDefs * (sizeof(short2) + PATH_DIRECTION_VERTICES * sizeof(float))));
+
+	const auto AppendData = [&](const void* data, size_t size) {
+		buffer.insert(buffer.end(), reinterpret_cast<const std::uint8_t*>(data), reinterpret_cast<const std::uint8_t*>(data) + size);
+	};
+
+	AppendData(&fileHashCode, sizeof(fileHashCode));
+	AppendData(&numBlocks, sizeof(numBlocks));
+	AppendData(deltaBlocks.data(), numBlocks * sizeof(unsigned int));
+
+	for (unsigned int pathType = 0; pathType < numMoveDefs; ++pathType) {
+		for (const unsigned int blockIdx: deltaBlocks) {
+			AppendData(&blockStates.peNodeOffsets[pathType][blockIdx], sizeof(short2));
+		}
+	}
+
+	for (unsigned int pathType = 0; pathType < numMoveDefs; ++pathType) {
+		for (const unsigned int blockIdx: deltaBlocks) {
+			AppendData(&vertexCosts[(pathType * blockStates.GetSize() + blockIdx) * PATH_DIRECTION_VERTICES], PATH_DIRECTION_VERTICES * sizeof(float));
+		}
+	}
+
+	zipOpenNewFileInZip(file, layerName.c_str(), nullptr, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_BEST_COMPRESSION);
+	zipWriteInFileInZip(file, buffer.data(), buffer.size());
+	zipCloseFileInZip(file);
+	zipClose(file, nullptr);
+	return true;
+}
+
+/**
+ * Recompute the (base-layer) data of blocks affected by heightmap changes.
+ * Offsets only depend on the speedmods within a block and vertex-costs on
+ * those within the two blocks connected plus both their offsets, while a
+ * speedmod only depends on heights a few squares around it; so the result
+ * matches a full recomputation, which is required since the data is part
+ * of the synced checksum.
+ * Outputs the blocks whose data differs from the base-layer.
+ */
+bool CPathEstimator::CalcDeltaLayer(std::vector<unsigned int>& deltaBlocks)
+{
+	const unsigned int numMoveDefs = moveDefHandler.GetNumMoveDefs();
+	const unsigned int numBlocks = blockStates.GetSize();
+
+	// 1 = offsets (and costs) need updating, 2 = costs need updating
+	std::vector<std::uint8_t> blockMarks(numBlocks, 0);
+	std::vector<unsigned int> offsetBlocks;
+	std::vector<unsigned int> costBlocks;
+
+	for (int cz = 0; cz < heightDeltaCellDims.y; cz++) {
+		for (int cx = 0; cx < heightDeltaCellDims.x; cx++) {
+			if (heightDeltaCells[cz * heightDeltaCellDims.x + cx] == 0)
+				continue;
+
+			// neighboring cells serve as margin for slopes and normals
+			for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, heightDeltaCellDims.y - 1); z++) {
+				for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, heightDeltaCellDims.x - 1); x++) {
+					const int2 blockPos = {
+						std::min(int((x * HEIGHT_DELTA_CELL_SIZE) / BLOCK_SIZE), int(nbrOfBlocks.x - 1)),
+						std::min(int((z * HEIGHT_DELTA_CELL_SIZE) / BLOCK_SIZE), int(nbrOfBlocks.y - 1)),
+					};
+
+					blockMarks[BlockPosToIdx(blockPos)] = 1;
+				}
+			}
+		}
+	}
+
+	for (unsigned int blockIdx = 0; blockIdx < numBlocks; blockIdx++) {
+		if (blockMarks[blockIdx] != 1)
+			continue;
+
+		const int2 blockPos = BlockIdxToPos(blockIdx);
+
+		offsetBlocks.push_back(blockIdx);
+
+		// vertex-costs are stored for half the directions at either end
+		for (int z = std::max(blockPos.y - 1, 0); z <= std::min(blockPos.y + 1, int(nbrOfBlocks.y - 1)); z++) {
+			for (int x = std::max(blockPos.x - 1, 0); x <= std::min(blockPos.x + 1, int(nbrOfBlocks.x - 1)); x++) {
+				std::uint8_t& mark = blockMarks[BlockPosToIdx(int2(x, z))];
+
+				if (mark == 0)
+					mark = 2;
+			}
+		}
+	}
+
+	for (unsigned int blockIdx = 0; blockIdx < numBlocks; blockIdx++) {
+		if (blockMarks[blockIdx] != 0)
+			costBlocks.push_back(blockIdx);
+	}
+
+	// not worth it, let all threads recompute everything
+	if ((costBlocks.size() * 4) > numBlocks)
+		return false;
+
+	// keep the base-layer data to compare against
+	std::vector<short2> baseOffsets;
+	std::vector<float> baseCosts;
+
+	baseOffsets.reserve(numMoveDefs * costBlocks.size());
+	baseCosts.reserve(numMoveDefs * costBlocks.size() * PATH_DIRECTION_VERTICES);
+
+	for (unsigned int pathType = 0; pathType < numMoveDefs; ++pathType) {
+		for (const unsigned int blockIdx: costBlocks) {
+			const float* costs = &vertexCosts[(pathType * numBlocks + blockIdx) * PATH_DIRECTION_VERTICES];
+
+			baseOffsets.push_back(blockStates.peNodeOffsets[pathType][blockIdx]);
+			baseCosts.insert(baseCosts.end(), costs, costs + PATH_DIRECTION_VERTICES);
+		}
+	}
+
+	// same order of dependencies as CalcOffsetsAndPathCosts
+	for (const unsigned int blockIdx: offsetBlocks) {
+		const int2 blockPos = BlockIdxToPos(blockIdx);
+
+		for (unsigned int i = 0; i < numMoveDefs; i++) {
+			const MoveDef* md = moveDefHandler.GetMoveDefByPathType(i);
+
+			blockStates.peNodeOffsets[md->pathType][blockIdx] = FindBlockPosOffset(*md, blockPos.x, blockPos.y);
+		}
+	}
+
+	for (const unsigned int blockIdx: costBlocks) {
+		for (unsigned int i = 0; i < numMoveDefs; i++) {
+			CalcVertexPathCosts(*moveDefHandler.GetMoveDefByPathType(i), BlockIdxToPos(blockIdx));
+		}
+	}
+
+	for (unsigned int n = 0; n < costBlocks.size(); n++) {
+		const unsigned int blockIdx = costBlocks[n];
+
+		bool changed = false;
+
+		for (unsigned int pathType = 0; pathType < numMoveDefs && !changed; ++pathType) {
+			const unsigned int baseIdx = pathType * costBlocks.size() + n;
+			const float* costs = &vertexCosts[(pathType * numBlocks + blockIdx) * PATH_DIRECTION_VERTICES];
+
+			changed |= (std::memcmp(&baseOffsets[baseIdx], &blockStates.peNodeOffsets[pathType][blockIdx], sizeof(short2)) != 0);
+			changed |= (std::memcmp(&baseCosts[baseIdx * PATH_DIRECTION_VERTICES], costs, PATH_DIRECTION_VERTICES * sizeof(float)) != 0);
+		}
+
+		if (changed)
+			deltaBlocks.push_back(blockIdx);
+	}
+
+	return true;
+}
+
+
 std::uint32_t CPathEstimator::CalcChecksum() const
 {
 	std::uint32_t chksum = 0;
@@ -1117,9 +1632,8 @@ std::uint32_t CPathEstimator::CalcChecksum() const
 /**
  * Returns a hash-code identifying the dataset of this estimator.
  */
-std::uint32_t CPathEstimator::CalcHash(const char* caller) const
+std::uint32_t CPathEstimator::CalcHash(const char* caller, std::uint32_t hmChecksum) const
 {
-	const unsigned int hmChecksum = readMap->CalcHeightmapChecksum();
 	const unsigned int tmChecksum = readMap->CalcTypemapChecksum();
 	const unsigned int mdChecksum = moveDefHandler.GetCheckSum();
 	const unsigned int bmChecksum = groundBlockingObjectMap.CalcChecksum();
@@ -41,8 +41,24 @@ public:
 	 *   Ex. PE-name "pe" + Mapname "Desert" => "Desert.pe"
 	 */
 	void Init(IPathFinder*, unsigned int BSIZE, const std::string& peFileName, const std::string& mapFileName);
+	/**
+	 * Creates a search-only estimator which reads the block offsets and
+	 * vertex costs of <pe> but has its own node buffers, so that several
+	 * of these can search concurrently. Has no path cache of its own but
+	 * reads that of <pe>, and must not be Update'd; <pf> is used for the
+	 * max-res sub-searches.
+	 */
+	void InitWorker(const CPathEstimator* pe, IPathFinder* pf);
 	void Kill();
 
+	/**
+	 * Records where the heightmap differs from the map's original one
+	 * (e.g. after synced Lua terraformed it during Initialize), so the
+	 * cache of the unmodified map can be reused with a delta-layer on
+	 * top. Must be called once before the estimators are Init'ed.
+	 */
+	static void InitHeightMapDelta();
+
 	bool RemoveCacheFile(const std::string& peFileName, const std::string& mapFileName);
 
 
@@ -60,6 +76,7 @@ public:
 	void Update();
 
 	IPathFinder* GetParent() override { return parentPathFinder; }
+	int2 GetNodeOffset(unsigned int pathType, unsigned int blockIdx) const override { return (GetNodeOffsets(pathType)[blockIdx]); }
 
 	/**
 	 * Returns a checksum that can be used to check if every player has the same
@@ -107,9 +124,17 @@ protected: // IPathFinder impl
 	) override;
 
 private:
+	const std::vector<short2>& GetNodeOffsets(unsigned int pathType) const { return (costEstimator->blockStates.peNodeOffsets[pathType]); }
+
 	void InitEstimator(const std::string& peFileName, const std::string& mapFileName);
 	void InitBlocks();
 
+	void ConsumeBlock(const int2 blockPos, unsigned int blockIdx);
+	void PullWantedBlocks();
+	void MergeWantedBlocks(CPathEstimator& pe);
+	void MergeDeferredCacheItems(CPathEstimator& pe);
+	void CommitDeferredCacheItems();
+
 	void CalcOffsetsAndPathCosts(unsigned int threadNum, spring::barrier* pathBarrier);
 	void CalculateBlockOffsets(unsigned int, unsigned int);
 	void EstimatePathCosts(unsigned int, unsigned int);
@@ -118,11 +143,16 @@ private:
 	void CalcVertexPathCosts(const MoveDef&, int2, unsigned int threadNum = 0);
 	void CalcVertexPathCost(const MoveDef&, int2, unsigned int pathDir, unsigned int threadNum = 0);
 
-	bool ReadFile(const std::string& peFileName, const std::string& mapFileName);
+	bool ReadFile(const std::string& peFileName, const std::string& mapFileName, std::uint32_t hashCode);
 	bool WriteFile(const std::string& peFileName, const std::string& mapFileName);
 
+	bool ReadDeltaFile(const std::string& peFileName, const std::string& mapFileName);
+	bool ReadDeltaLayer(const std::string& peFileName, const std::string& mapFileName);
+	bool WriteDeltaLayer(const std::string& peFileName, const std::string& mapFileName, const std::vector<unsigned int>& deltaBlocks);
+	bool CalcDeltaLayer(std::vector<unsigned int>& deltaBlocks);
+
 	std::uint32_t CalcChecksum() const;
-	std::uint32_t CalcHash(const char* caller) const;
+	std::uint32_t CalcHash(const char* caller, std::uint32_t hmChecksum) const;
 
 private:
 	friend class CPathManager;
@@ -137,6 +167,7 @@ private:
 
 	std::uint32_t pathChecksum = 0;
 	std::uint32_t fileHashCode = 0;
+	std::uint32_t baseHashCode = 0; // fileHashCode for the map's original heightmap
 
 	std::atomic<std::int64_t> offsetBlockNum = {0};
 	std::atomic<std::int64_t> costBlockNum = {0};
@@ -145,6 +176,10 @@ private:
 	CPathEstimator* nextPathEstimator; // next lower-resolution estimator
 	CPathCache* pathCache[2]; // [0] = !synced, [1] = synced
 
+	// owner of the offsets and vertex-costs used for searching (this, or the PE a worker was created from)
+	const CPathEstimator* costEstimator = this;
+	CPathCache::CacheItem dummyCacheItem;
+
 	std::vector<IPathFinder*> pathFinders; // InitEstimator helpers
 	std::vector<spring::thread> threads;
 
@@ -152,6 +187,18 @@ private:
 	std::vector<float> vertexCosts;
 	/// blocks that may need an update due to map changes
 	std::deque<int2> updatedBlocks;
+	/// obsolete blocks that synced searches ran into, updated before the rest
+	std::vector<unsigned int> wantedBlocks;
+
+	struct DeferredCacheItem {
+		CPathCache::CacheItem item;
+		unsigned int requestIdx;
+		bool synced;
+	};
+
+	/// paths found by a worker, added to its owner's cache in request order after a batch
+	std::vector<DeferredCacheItem> deferredCacheItems;
+	unsigned int deferredCacheRequestIdx = 0;
 
 	struct SOffsetBlock {
 		float cost;
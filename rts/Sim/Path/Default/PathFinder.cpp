@@ -210,8 +210,10 @@ IPath::SearchResult CPathFinder::DoSearch(
 		const PathNode* openSquare = openBlocks.top();
 		openBlocks.pop();
 
+		const unsigned int openStateIdx = blockStates.GetStateIdx(openSquare->nodePos);
+
 		// check if this PathNode has become obsolete
-		if (blockStates.fCost[openSquare->nodeNum] != openSquare->fCost)
+		if (blockStates.GetNodeFCost(openStateIdx) != openSquare->fCost)
 			continue;
 
 		// check if the goal has been reached
@@ -223,8 +225,7 @@ IPath::SearchResult CPathFinder::DoSearch(
 		}
 
 		if (!pfDef.WithinConstraints(openSquare->nodePos.x, openSquare->nodePos.y)) {
-			blockStates.nodeMask[openSquare->nodeNum] |= PATHOPT_CLOSED;
-			dirtyBlocks.push_back(openSquare->nodeNum);
+			blockStates.SetNodeMaskBits(openStateIdx, PATHOPT_CLOSED);
 			continue;
 		}
 
@@ -271,7 +272,6 @@ void CPathFinder::TestNeighborSquares(
 		const unsigned int dirIdx = &sqState - &ngbStates[0];
 		const unsigned int optDir = PathDir2PathOpt(dirIdx);
 		const int2 ngbSquareCoors = squarePos + PF_DIRECTION_VECTORS_2D[optDir];
-		const unsigned int ngbSquareIdx = BlockPosToIdx(ngbSquareCoors);
 
 		sqState.insideMap &= (static_cast<unsigned int>(ngbSquareCoors.x) < nbrOfBlocks.x);
 		sqState.insideMap &= (static_cast<unsigned int>(ngbSquareCoors.y) < nbrOfBlocks.y);
@@ -279,13 +279,14 @@ void CPathFinder::TestNeighborSquares(
 		if (!sqState.insideMap)
 			continue;
 
-		if (blockStates.nodeMask[ngbSquareIdx] & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) //FIXME
+		const unsigned int ngbStateIdx = blockStates.GetStateIdx(ngbSquareCoors);
+
+		if (blockStates.GetNodeMask(ngbStateIdx) & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) //FIXME
 			continue;
 
 		// IsBlockedNoSpeedModCheck; very expensive call but with a ~20% (?) chance of early-out
 		if ((sqState.blockMask = blockCheckFunc(moveDef, ngbSquareCoors.x, ngbSquareCoors.y, owner)) & MMBT::BLOCK_STRUCTURE) {
-			blockStates.nodeMask[ngbSquareIdx] |= PATHOPT_CLOSED;
-			dirtyBlocks.push_back(ngbSquareIdx);
+			blockStates.SetNodeMaskBits(ngbStateIdx, PATHOPT_CLOSED);
 			continue;
 		}
 
@@ -300,10 +301,8 @@ void CPathFinder::TestNeighborSquares(
 			//
 			// only close node if search is directionally independent, since it
 			// might still be entered from another (better) direction otherwise
-			if ((sqState.speedMod = CMoveMath::GetPosSpeedMod(moveDef, ngbSquareCoors.x, ngbSquareCoors.y)) == 0.0f) {
-				blockStates.nodeMask[ngbSquareIdx] |= PATHOPT_CLOSED;
-				dirtyBlocks.push_back(ngbSquareIdx);
-			}
+			if ((sqState.speedMod = CMoveMath::GetPosSpeedMod(moveDef, ngbSquareCoors.x, ngbSquareCoors.y)) == 0.0f)
+				blockStates.SetNodeMaskBits(ngbStateIdx, PATHOPT_CLOSED);
 		}
 
 		// LHS is only here to save some cycles
@@ -374,8 +373,7 @@ void CPathFinder::TestNeighborSquares(
 	#endif
 
 	// mark this square as closed
-	blockStates.nodeMask[square->nodeNum] |= PATHOPT_CLOSED;
-	dirtyBlocks.push_back(square->nodeNum);
+	blockStates.SetNodeMaskBits(blockStates.GetStateIdx(squarePos), PATHOPT_CLOSED);
 }
 
 bool CPathFinder::TestBlock(
@@ -396,7 +394,10 @@ bool CPathFinder::TestBlock(
 	// bounds-check
 	assert(static_cast<unsigned>(square.x) < nbrOfBlocks.x);
 	assert(static_cast<unsigned>(square.y) < nbrOfBlocks.y);
-	assert((blockStates.nodeMask[sqrIdx] & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) == 0);
+
+	const unsigned int sqrStateIdx = blockStates.GetStateIdx(square);
+
+	assert((blockStates.GetNodeMask(sqrStateIdx) & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) == 0);
 	assert((blockStatus & MMBT::BLOCK_STRUCTURE) == 0);
 	assert(speedMod != 0.0f);
 
@@ -434,12 +435,12 @@ bool CPathFinder::TestBlock(
 	const float hCost = pfDef.Heuristic(square.x, square.y, BLOCK_SIZE); // h
 	const float fCost = gCost + hCost;                                   // f
 
-	if (blockStates.nodeMask[sqrIdx] & PATHOPT_OPEN) {
+	if (blockStates.GetNodeMask(sqrStateIdx) & PATHOPT_OPEN) {
 		// already in the open set, look for a cost-improvement
-		if (blockStates.fCost[sqrIdx] <= fCost)
+		if (blockStates.GetNodeFCost(sqrStateIdx) <= fCost)
 			return true;
 
-		blockStates.nodeMask[sqrIdx] &= ~PATHOPT_CARDINALS;
+		blockStates.ClearNodeMaskBits(sqrStateIdx, PATHOPT_CARDINALS);
 	}
 
 	// if heuristic says this node is closer to goal than previous h-estimate, keep it
@@ -462,11 +463,8 @@ bool CPathFinder::TestBlock(
 	blockStates.SetMaxCost(NODE_COST_F, std::max(blockStates.GetMaxCost(NODE_COST_F), fCost));
 	blockStates.SetMaxCost(NODE_COST_G, std::max(blockStates.GetMaxCost(NODE_COST_G), gCost));
 
-	blockStates.fCost[sqrIdx] = os->fCost;
-	blockStates.gCost[sqrIdx] = os->gCost;
-	blockStates.nodeMask[sqrIdx] |= (PATHOPT_OPEN | pathOptDir);
-
-	dirtyBlocks.push_back(sqrIdx);
+	blockStates.SetNodeCosts(sqrStateIdx, os->fCost, os->gCost);
+	blockStates.SetNodeMaskBits(sqrStateIdx, PATHOPT_OPEN | pathOptDir);
 	return true;
 }
 
@@ -482,9 +480,11 @@ void CPathFinder::FinishSearch(const MoveDef& moveDef, const CPathFinderDef& pfD
 
 		{
 			while (blockIdx != mStartBlockIdx) {
-				assert(PF_DIRECTION_VECTORS_2D[blockStates.nodeMask[blockIdx] & PATHOPT_CARDINALS] != int2(0, 0));
+				const unsigned int pathOpt = blockStates.GetNodeMask(blockStates.GetStateIdx(square)) & PATHOPT_CARDINALS;
+
+				assert(PF_DIRECTION_VECTORS_2D[pathOpt] != int2(0, 0));
 
-				square   -= PF_DIRECTION_VECTORS_2D[blockStates.nodeMask[blockIdx] & PATHOPT_CARDINALS];
+				square   -= PF_DIRECTION_VECTORS_2D[pathOpt];
 				blockIdx  = BlockPosToIdx(square);
 				numNodes += 1;
 			}
@@ -514,7 +514,7 @@ void CPathFinder::FinishSearch(const MoveDef& moveDef, const CPathFinderDef& pfD
 			if (blockIdx == mStartBlockIdx)
 				break;
 
-			square -= PF_DIRECTION_VECTORS_2D[blockStates.nodeMask[blockIdx] & PATHOPT_CARDINALS];
+			square -= PF_DIRECTION_VECTORS_2D[blockStates.GetNodeMask(blockStates.GetStateIdx(square)) & PATHOPT_CARDINALS];
 			blockIdx = BlockPosToIdx(square);
 		}
 
@@ -522,7 +522,7 @@ void CPathFinder::FinishSearch(const MoveDef& moveDef, const CPathFinderDef& pfD
 			foundPath.pathGoal = foundPath.path[0];
 	}
 
-	foundPath.pathCost = blockStates.fCost[mGoalBlockIdx];
+	foundPath.pathCost = blockStates.GetNodeFCost(blockStates.GetStateIdx(mGoalBlockIdx));
 }
 
 
@@ -552,12 +552,12 @@ void CPathFinder::SmoothMidWaypoint(
 ) const {
 	constexpr float COSTMOD = 1.39f; // (math::sqrt(2) + 1) / math::sqrt(3)
 
-	const int tstSqrIdx = BlockPosToIdx(testSqr);
-	const int prvSqrIdx = BlockPosToIdx(prevSqr);
+	const unsigned int tstStateIdx = blockStates.GetStateIdx(testSqr);
+	const unsigned int prvStateIdx = blockStates.GetStateIdx(prevSqr);
 
-	if ((blockStates.nodeMask[tstSqrIdx] & PATHOPT_BLOCKED) != 0)
+	if ((blockStates.GetNodeMask(tstStateIdx) & PATHOPT_BLOCKED) != 0)
 		return;
-	if (blockStates.fCost[tstSqrIdx] > (COSTMOD * blockStates.fCost[prvSqrIdx]))
+	if (blockStates.GetNodeFCost(tstStateIdx) > (COSTMOD * blockStates.GetNodeFCost(prvStateIdx)))
 		return;
 
 	const float3& p2 = foundPath.path[foundPath.path.size() - 3];
@@ -12,8 +12,13 @@
 #include "Sim/Misc/ModInfo.h"
 #include "Sim/Objects/SolidObject.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/Log/ILog.h"
+#include "System/MemoryStats.h"
 #include "System/TimeProfiler.h"
+#include "System/Threading/ThreadPool.h"
+
+#include <atomic>
 
 
 static CPathFinder    gMaxResPF;
@@ -27,6 +32,9 @@ CPathManager::CPathManager()
 , lowResPE(nullptr)
 , pathFlowMap(nullptr)
 , pathHeatMap(nullptr)
+, numTestedNodes(0)
+, searchTime(spring_notime)
+, numSearches(0)
 , nextPathID(0)
 {
 	IPathFinder::InitStatic();
@@ -37,6 +45,23 @@ CPathManager::CPathManager()
 
 	pathMap.reserve(1024);
 
+	memoryStats.AddSubsystem("Sim/Path/Pools", [](CMemoryStats::Sample& s) {
+		CMemoryStats::SamplePool(pcMemPool, s);
+		CMemoryStats::SamplePool(peMemPool, s);
+		CMemoryStats::SamplePool(pfMemPool, s);
+	});
+	memoryStats.AddSubsystem("Sim/Path/NodeStates", [this](CMemoryStats::Sample& s) {
+		if (maxResPF == nullptr)
+			return;
+
+		s.liveBytes += (maxResPF->GetMemFootPrint() + medResPE->GetMemFootPrint() + lowResPE->GetMemFootPrint());
+
+		for (const SearchWorker& worker: searchWorkers) {
+			const PathFinderSet& finders = worker.finders;
+			s.liveBytes += (finders.maxResPF->GetMemFootPrint() + finders.medResPE->GetMemFootPrint() + finders.lowResPE->GetMemFootPrint());
+		}
+	});
+
 	// PathNode::nodePos is an ushort2, PathNode::nodeNum is an int
 	// therefore the maximum map size is limited to 64k*64k squares
 	assert(mapDims.mapx <= 0xFFFFU && mapDims.mapy <= 0xFFFFU);
@@ -44,8 +69,13 @@ CPathManager::CPathManager()
 
 CPathManager::~CPathManager()
 {
+	memoryStats.RemoveSubsystem("Sim/Path/NodeStates");
+	memoryStats.RemoveSubsystem("Sim/Path/Pools");
+
 	// Finalize is not called in case of forced exit
 	if (maxResPF != nullptr) {
+		KillSearchWorkers();
+
 		lowResPE->Kill();
 		medResPE->Kill();
 		maxResPF->Kill();
@@ -81,10 +111,20 @@ std::int64_t CPathManager::Finalize() {
 		medResPE = &gMedResPE;
 		lowResPE = &gLowResPE;
 
+		// must precede estimator init, which overwrites the original heightmap
+		CPathEstimator::InitHeightMapDelta();
+
 		// maxResPF only runs on the main thread, so can be unsafe
 		maxResPF->Init(false);
 		medResPE->Init(maxResPF, MEDRES_PE_BLOCKSIZE, "pe" , mapInfo->map.name);
 		lowResPE->Init(medResPE, LOWRES_PE_BLOCKSIZE, "pe2", mapInfo->map.name);
+
+		if (modInfo.pfDeferRequests) {
+			InitSearchWorkers(ThreadPool::GetNumThreads());
+
+			LOG("[PathManager::%s] %u of %d path-search workers (%u MB)", __func__, unsigned(searchWorkers.size()), ThreadPool::GetNumThreads(),
+				unsigned((searchWorkers.size() * searchWorkers[0].memFootPrint) / (1024 * 1024)));
+		}
 	}
 
 	const spring_time dt = spring_gettime() - t0;
@@ -129,7 +169,63 @@ void CPathManager::FinalizePath(MultiPath* path, const float3 startPos, const fl
 }
 
 
+std::uint64_t CPathManager::PathFinderSet::GetNumTestedNodes() const {
+	return (maxResPF->numTestedBlocks + medResPE->numTestedBlocks + lowResPE->numTestedBlocks);
+}
+
+
+void CPathManager::InitSearchWorkers(unsigned int numWorkers)
+{
+	if (searchWorkers.size() >= numWorkers)
+		return;
+
+	// keep the node-buffers of all workers within the same bounds as the
+	// PE's helper PF's at load time; there is always at least one worker
+	const size_t maxMemFootPrint = configHandler->GetInt("MaxPathCostsMemoryFootPrint") * size_t(1024 * 1024);
+
+	while (searchWorkers.size() < numWorkers) {
+		if (!searchWorkers.empty() && ((searchWorkers.size() + 1) * searchWorkers[0].memFootPrint) > maxMemFootPrint)
+			break;
+
+		searchWorkers.emplace_back();
+
+		SearchWorker& worker = searchWorkers.back();
+		PathFinderSet& finders = worker.finders;
+
+		finders.maxResPF = pfMemPool.alloc<CPathFinder>(true);
+		finders.medResPE = peMemPool.alloc<CPathEstimator>();
+		finders.lowResPE = peMemPool.alloc<CPathEstimator>();
+
+		finders.medResPE->InitWorker(medResPE, finders.maxResPF);
+		finders.lowResPE->InitWorker(lowResPE, finders.medResPE);
+
+		worker.memFootPrint = sizeof(CPathFinder) + sizeof(CPathEstimator) * 2;
+		worker.memFootPrint += (finders.maxResPF->GetMemFootPrint() + finders.medResPE->GetMemFootPrint() + finders.lowResPE->GetMemFootPrint());
+		worker.numTestedNodes = 0;
+		worker.searchTime = spring_notime;
+	}
+}
+
+void CPathManager::KillSearchWorkers()
+{
+	for (SearchWorker& worker: searchWorkers) {
+		PathFinderSet& finders = worker.finders;
+
+		finders.lowResPE->Kill();
+		finders.medResPE->Kill();
+		finders.maxResPF->Kill();
+
+		peMemPool.free(finders.lowResPE);
+		peMemPool.free(finders.medResPE);
+		pfMemPool.free(finders.maxResPF);
+	}
+
+	searchWorkers.clear();
+}
+
+
 IPath::SearchResult CPathManager::ArrangePath(
+	const PathFinderSet& pfs,
 	MultiPath* newPath,
 	const MoveDef* moveDef,
 	const float3& startPos,
@@ -158,7 +254,7 @@ IPath::SearchResult CPathManager::ArrangePath(
 	constexpr bool useConstraints[] = {false, false, false};
 	constexpr bool allowRawSearch[] = {false, false, false};
 
-	IPathFinder* pathFinders[] = {lowResPE, medResPE, maxResPF};
+	IPathFinder* pathFinders[] = {pfs.lowResPE, pfs.medResPE, pfs.maxResPF};
 	IPath::Path* pathObjects[] = {&newPath->lowResPath, &newPath->medResPath, &newPath->maxResPath};
 
 	IPath::SearchResult bestResult = IPath::Error;
@@ -377,18 +473,55 @@ unsigned int CPathManager::RequestPath(
 	newPath.caller = caller;
 	newPath.peDef.synced = synced;
 
+	if (modInfo.pfDeferRequests && caller != nullptr && synced) {
+		// resolved at the start of the next frame by ProcessQueuedRequests,
+		// until then NextWayPoint hands out temporary waypoints (as QTPFS)
+		newPath.queued = true;
+		queuedRequests.push_back(Store(newPath));
+		return (queuedRequests.back());
+	}
+
+	const PathFinderSet finders = GetPathFinderSet();
+
+	const spring_time t0 = spring_gettime();
+	const std::uint64_t n0 = finders.GetNumTestedNodes();
+
 	if (caller != nullptr)
 		caller->UnBlock();
 
-	const IPath::SearchResult result = ArrangePath(&newPath, moveDef, startPos, goalPos, caller);
+	SearchPath(finders, newPath);
+
+	if (caller != nullptr)
+		caller->Block();
+
+	searchTime += (spring_gettime() - t0);
+	numTestedNodes += (finders.GetNumTestedNodes() - n0);
+	numSearches += 1;
+
+	if (newPath.searchResult == IPath::Error)
+		return 0;
+
+	return (Store(newPath));
+}
+
+
+void CPathManager::SearchPath(const PathFinderSet& pfs, MultiPath& newPath) const
+{
+	// start and finalGoal are already clamped
+	const float3 startPos = newPath.start;
+	const float3 goalPos = newPath.finalGoal;
+
+	const bool synced = newPath.peDef.synced;
+
+	CSolidObject* caller = newPath.caller;
 
-	unsigned int pathID = 0;
+	const IPath::SearchResult result = ArrangePath(pfs, &newPath, newPath.moveDef, startPos, goalPos, caller);
 
 	if (result != IPath::Error) {
 		if (newPath.maxResPath.path.empty()) {
 			if (result != IPath::CantGetCloser) {
-				LowRes2MedRes(newPath, startPos, caller, synced);
-				MedRes2MaxRes(newPath, startPos, caller, synced);
+				LowRes2MedRes(pfs, newPath, startPos, caller, synced);
+				MedRes2MaxRes(pfs, newPath, startPos, caller, synced);
 			} else {
 				// add one dummy waypoint so that the calling MoveType
 				// does not consider this request a failure, which can
@@ -403,19 +536,14 @@ unsigned int CPathManager::RequestPath(
 		}
 
 		FinalizePath(&newPath, startPos, goalPos, result == IPath::CantGetCloser);
-		newPath.searchResult = result;
-		pathID = Store(newPath);
 	}
 
-	if (caller != nullptr)
-		caller->Block();
-
-	return pathID;
+	newPath.searchResult = result;
 }
 
 
 // converts part of a med-res path into a max-res path
-void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, const CSolidObject* owner, bool synced) const
+void CPathManager::MedRes2MaxRes(const PathFinderSet& pfs, MultiPath& multiPath, const float3& startPos, const CSolidObject* owner, bool synced) const
 {
 	assert(IsFinalized());
 
@@ -448,7 +576,7 @@ void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, c
 	// Perform the search.
 	// If this is the final improvement of the path, then use the original goal.
 	const auto& pfd = (medResPath.path.empty() && lowResPath.path.empty()) ? multiPath.peDef : rangedGoalDef;
-	const IPath::SearchResult result = maxResPF->GetPath(*multiPath.moveDef, pfd, owner, startPos, maxResPath, MAX_SEARCHED_NODES_ON_REFINE);
+	const IPath::SearchResult result = pfs.maxResPF->GetPath(*multiPath.moveDef, pfd, owner, startPos, maxResPath, MAX_SEARCHED_NODES_ON_REFINE);
 
 	// If no refined path could be found, set goal as desired goal.
 	if (result == IPath::CantGetCloser || result == IPath::Error) {
@@ -457,7 +585,7 @@ void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, c
 }
 
 // converts part of a low-res path into a med-res path
-void CPathManager::LowRes2MedRes(MultiPath& multiPath, const float3& startPos, const CSolidObject* owner, bool synced) const
+void CPathManager::LowRes2MedRes(const PathFinderSet& pfs, MultiPath& multiPath, const float3& startPos, const CSolidObject* owner, bool synced) const
 {
 	assert(IsFinalized());
 
@@ -487,7 +615,7 @@ void CPathManager::LowRes2MedRes(MultiPath& multiPath, const float3& startPos, c
 	// Perform the search.
 	// If there is no low-res path left, use original goal.
 	const auto& pfd = (lowResPath.path.empty()) ? multiPath.peDef : rangedGoalDef;
-	const IPath::SearchResult result = medResPE->GetPath(*multiPath.moveDef, pfd, owner, startPos, medResPath, MAX_SEARCHED_NODES_ON_REFINE);
+	const IPath::SearchResult result = pfs.medResPE->GetPath(*multiPath.moveDef, pfd, owner, startPos, medResPath, MAX_SEARCHED_NODES_ON_REFINE);
 
 	// If no refined path could be found, set goal as desired goal.
 	if (result == IPath::CantGetCloser || result == IPath::Error) {
@@ -525,6 +653,14 @@ float3 CPathManager::NextWayPoint(
 	if (multiPath == nullptr)
 		return noPathPoint;
 
+	if (multiPath->queued) {
+		// request has not been processed yet; keep the caller pointed a
+		// fixed small distance toward its goal, y=-1 tells GMT that this
+		// is a temporary waypoint and to wait for the actual path
+		const float3 targetDirec = ((multiPath->finalGoal - callerPos) * XZVector).SafeNormalize() * SQUARE_SIZE;
+		return float3(callerPos.x + targetDirec.x, -1.0f, callerPos.z + targetDirec.z);
+	}
+
 	if (numRetries > MAX_PATH_REFINEMENT_DEPTH)
 		return (multiPath->finalGoal);
 
@@ -550,9 +686,9 @@ float3 CPathManager::NextWayPoint(
 			multiPath->caller->UnBlock();
 
 		if (extendMedResPath)
-			LowRes2MedRes(*multiPath, callerPos, owner, synced);
+			LowRes2MedRes(GetPathFinderSet(), *multiPath, callerPos, owner, synced);
 
-		MedRes2MaxRes(*multiPath, callerPos, owner, synced);
+		MedRes2MaxRes(GetPathFinderSet(), *multiPath, callerPos, owner, synced);
 
 		if (multiPath->caller != nullptr)
 			multiPath->caller->Block();
@@ -594,7 +730,6 @@ float3 CPathManager::NextWayPoint(
 	} while ((callerPos.SqDistance2D(waypoint) < Square(radius)) && (waypoint != maxResPath.pathGoal));
 
 	// y=0 indicates this is not a temporary waypoint
-	// (the default PFS does not queue path-requests)
 	return (waypoint * XZVector);
 }
 
@@ -625,6 +760,129 @@ void CPathManager::Update()
 
 	medResPE->Update();
 	lowResPE->Update();
+
+	// estimator costs are current, resolve the previous frame's requests
+	ProcessQueuedRequests();
+	UpdateSearchStats();
+}
+
+void CPathManager::ProcessQueuedRequests()
+{
+	searchStats.queueDepth = queuedRequests.size();
+	searchStats.maxQueueDepth = std::max(searchStats.maxQueueDepth, searchStats.queueDepth);
+
+	if (queuedRequests.empty())
+		return;
+
+	SCOPED_TIMER("Sim::Path::QueuedRequests");
+
+	queuedPaths.clear();
+	queuedPaths.reserve(queuedRequests.size());
+
+	// skip requests whose paths were deleted in the meantime
+	for (const unsigned int pathID: queuedRequests) {
+		MultiPath* multiPath = GetMultiPath(pathID);
+
+		if (multiPath == nullptr)
+			continue;
+
+		queuedPaths.push_back(multiPath);
+	}
+
+	InitSearchWorkers(ThreadPool::GetNumThreads());
+
+	for (SearchWorker& worker: searchWorkers) {
+		PathFinderSet& finders = worker.finders;
+
+		// extra costs can only change on the main thread, not while searching
+		finders.maxResPF->GetNodeStateBuffer().ShareNodeExtraCosts(maxResPF->GetNodeStateBuffer());
+		finders.medResPE->GetNodeStateBuffer().ShareNodeExtraCosts(medResPE->GetNodeStateBuffer());
+		finders.lowResPE->GetNodeStateBuffer().ShareNodeExtraCosts(lowResPE->GetNodeStateBuffer());
+
+		worker.numTestedNodes = 0;
+		worker.searchTime = spring_notime;
+	}
+
+	std::atomic<unsigned int> nextQueuedPath = {0};
+
+	// each search reads only state that stays constant until the barrier
+	// below (including the estimators' path caches, which the workers only
+	// add to afterwards) and writes only to its own MultiPath and worker
+	// buffers, so results do not depend on which worker runs which request
+	// callers are not UnBlock'ed; CMoveMath never considers an object an
+	// obstacle to itself
+	// there can be fewer workers than threads, each takes requests in turn
+	for_mt(0, searchWorkers.size(), [&](const int w) {
+		SearchWorker& worker = searchWorkers[w];
+
+		for (unsigned int i = nextQueuedPath++; i < queuedPaths.size(); i = nextQueuedPath++) {
+			MultiPath* multiPath = queuedPaths[i];
+
+			const spring_time t0 = spring_gettime();
+			const std::uint64_t n0 = worker.finders.GetNumTestedNodes();
+
+			worker.finders.medResPE->deferredCacheRequestIdx = i;
+			worker.finders.lowResPE->deferredCacheRequestIdx = i;
+
+			SearchPath(worker.finders, *multiPath);
+
+			worker.searchTime += (spring_gettime() - t0);
+			worker.numTestedNodes += (worker.finders.GetNumTestedNodes() - n0);
+		}
+	});
+
+	for (MultiPath* multiPath: queuedPaths) {
+		multiPath->queued = false;
+	}
+
+	// hand stale blocks the searches ran into to the estimators owning them
+	// and the paths they found to their caches, for the next batch
+	for (SearchWorker& worker: searchWorkers) {
+		medResPE->MergeWantedBlocks(*worker.finders.medResPE);
+		lowResPE->MergeWantedBlocks(*worker.finders.lowResPE);
+		medResPE->MergeDeferredCacheItems(*worker.finders.medResPE);
+		lowResPE->MergeDeferredCacheItems(*worker.finders.lowResPE);
+	}
+
+	medResPE->CommitDeferredCacheItems();
+	lowResPE->CommitDeferredCacheItems();
+
+	// commit in request order; failed requests become dangling IDs
+	// for which NextWayPoint returns noPathPoint, so GMT will stop
+	for (const unsigned int pathID: queuedRequests) {
+		const auto pi = pathMap.find(pathID);
+
+		if (pi == pathMap.end())
+			continue;
+		if ((pi->second).searchResult != IPath::Error)
+			continue;
+
+		pathMap.erase(pi);
+	}
+
+	for (const SearchWorker& worker: searchWorkers) {
+		numTestedNodes += worker.numTestedNodes;
+		searchTime += worker.searchTime;
+	}
+
+	numSearches += queuedPaths.size();
+
+	queuedRequests.clear();
+	queuedPaths.clear();
+}
+
+void CPathManager::UpdateSearchStats()
+{
+	// time is summed over all threads, so this is per thread-second
+	const float searchSecs = searchTime.toSecsf();
+
+	searchStats.numSearches = numSearches;
+	searchStats.searchTime = (numSearches > 0)? (searchTime.toMilliSecsf() / numSearches): 0.0f;
+	searchStats.nodesPerSecond = (searchSecs > 0.0f)? (numTestedNodes / searchSecs): 0.0f;
+
+	numTestedNodes = 0;
+	searchTime = spring_notime;
+	numSearches = 0;
 }
 
 // used to deposit heat on the heat-map as a unit moves along its path
@@ -777,6 +1035,50 @@ const float* CPathManager::GetNodeExtraCosts(bool synced) const {
 	return costs;
 }
 
+void CPathManager::Benchmark(const MoveDef* moveDef, unsigned int numQueries, float maxDistance)
+{
+	if (!IsFinalized())
+		return;
+
+	// no synced RNG, would be advanced differently than without the benchmark
+	unsigned int seed = 0x9E3779B9u;
+
+	const auto RandFloat = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return ((seed >> 8) * (1.0f / (1 << 24)));
+	};
+
+	unsigned int numResults[IPath::Error + 1] = {0};
+
+	IPath::Path path;
+
+	const std::uint64_t n0 = maxResPF->numTestedBlocks;
+	const spring_time t0 = spring_gettime();
+
+	for (unsigned int n = 0; n < numQueries; n++) {
+		const float3 startPos = {RandFloat() * float3::maxxpos, 0.0f, RandFloat() * float3::maxzpos};
+		const float3 goalDir = {RandFloat() * 2.0f - 1.0f, 0.0f, RandFloat() * 2.0f - 1.0f};
+		const float3 goalPos = (startPos + goalDir * maxDistance).cClampInBounds();
+
+		// unsynced, so neither the synced extra-costs nor any cache are involved
+		CCircularSearchConstraint pfDef(startPos, goalPos, 0.0f, 2.0f, Square(maxDistance / SQUARE_SIZE));
+		pfDef.synced = false;
+		pfDef.testMobile = false;
+
+		numResults[maxResPF->GetPath(*moveDef, pfDef, nullptr, startPos, path, MAX_SEARCHED_NODES_PF)] += 1;
+	}
+
+	const spring_time t1 = spring_gettime();
+	const std::uint64_t n1 = maxResPF->numTestedBlocks;
+
+	LOG("[PathManager::%s] %u max-res queries for \"%s\" (distance <= %.0f): %.3fms, " _STPF_ " nodes, %.0f nodes/s (ok=%u out-of-range=%u cant-get-closer=%u error=%u)",
+		__func__, numQueries, moveDef->name.c_str(), maxDistance, (t1 - t0).toMilliSecsf(), size_t(n1 - n0),
+		(n1 - n0) / std::max(0.001f, (t1 - t0).toSecsf()),
+		numResults[IPath::Ok], numResults[IPath::GoalOutOfRange], numResults[IPath::CantGetCloser], numResults[IPath::Error]
+	);
+}
+
+
 int2 CPathManager::GetNumQueuedUpdates() const {
 	int2 data;
 
@@ -4,11 +4,13 @@
 #define PATHMANAGER_H
 
 #include <cinttypes>
+#include <vector>
 
 #include "Sim/Path/IPathManager.h"
 #include "IPath.h"
 #include "PathFinderDef.h"
 #include "System/UnorderedMap.hpp"
+#include "System/Misc/SpringTime.h"
 
 class CSolidObject;
 class CPathFinder;
@@ -28,6 +30,7 @@ public:
 			, peDef(startPos, goalPos, goalRadius, 3.0f, 2000)
 			, moveDef(moveDef)
 			, caller(nullptr)
+			, queued(false)
 		{}
 
 		MultiPath(const MultiPath& mp) = delete;
@@ -47,6 +50,7 @@ public:
 			peDef   = mp.peDef;
 			moveDef = mp.moveDef;
 			caller  = mp.caller;
+			queued  = mp.queued;
 
 			mp.moveDef = nullptr;
 			mp.caller  = nullptr;
@@ -70,6 +74,28 @@ public:
 
 		// additional information
 		CSolidObject* caller;
+
+		// true until the request is resolved by ProcessQueuedRequests
+		bool queued;
+	};
+
+	struct PathFinderSet {
+		CPathFinder* maxResPF;
+		CPathEstimator* medResPE;
+		CPathEstimator* lowResPE;
+
+		std::uint64_t GetNumTestedNodes() const;
+	};
+
+	/// private node-buffers for one ThreadPool thread
+	struct SearchWorker {
+		PathFinderSet finders;
+
+		size_t memFootPrint;
+
+		// accumulated during a batch
+		std::uint64_t numTestedNodes;
+		spring_time searchTime;
 	};
 
 public:
@@ -145,6 +171,10 @@ public:
 
 	int2 GetNumQueuedUpdates() const override;
 
+	/// runs <numQueries> unsynced max-res searches between random points and logs the node throughput
+	void Benchmark(const MoveDef* moveDef, unsigned int numQueries, float maxDistance);
+	SearchStats GetSearchStats() const override { return searchStats; }
+
 
 	const CPathFinder* GetMaxResPF() const { return maxResPF; }
 	const CPathEstimator* GetMedResPE() const { return medResPE; }
@@ -157,6 +187,7 @@ public:
 
 private:
 	IPath::SearchResult ArrangePath(
+		const PathFinderSet& pfs,
 		MultiPath* newPath,
 		const MoveDef* moveDef,
 		const float3& startPos,
@@ -181,10 +212,19 @@ private:
 
 	static void FinalizePath(MultiPath* path, const float3 startPos, const float3 goalPos, const bool cantGetCloser);
 
-	void LowRes2MedRes(MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
-	void MedRes2MaxRes(MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
+	/// runs all searches for a new request and sets its searchResult
+	void SearchPath(const PathFinderSet& pfs, MultiPath& path) const;
+
+	void LowRes2MedRes(const PathFinderSet& pfs, MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
+	void MedRes2MaxRes(const PathFinderSet& pfs, MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
+
+	void InitSearchWorkers(unsigned int numWorkers);
+	void KillSearchWorkers();
+	void ProcessQueuedRequests();
+	void UpdateSearchStats();
 
 	bool IsFinalized() const { return (maxResPF != nullptr); }
+	PathFinderSet GetPathFinderSet() const { return {maxResPF, medResPE, lowResPE}; }
 
 private:
 	CPathFinder* maxResPF;
@@ -196,6 +236,18 @@ private:
 
 	spring::unordered_map<unsigned int, MultiPath> pathMap;
 
+	// IDs of deferred requests in the order they were made
+	std::vector<unsigned int> queuedRequests;
+	std::vector<MultiPath*> queuedPaths;
+	std::vector<SearchWorker> searchWorkers;
+
+	SearchStats searchStats;
+
+	// accumulated over a sim-frame, folded into searchStats by Update
+	std::uint64_t numTestedNodes;
+	spring_time searchTime;
+	unsigned int numSearches;
+
 	unsigned int nextPathID;
 };
 
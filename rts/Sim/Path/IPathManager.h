@@ -14,6 +14,20 @@ struct MoveDef;
 class CSolidObject;
 
 class IPathManager {
+public:
+	struct SearchStats {
+		/// requests resolved at the last frame barrier (deferred requests only)
+		unsigned int queueDepth = 0;
+		unsigned int maxQueueDepth = 0;
+		/// requests searched during the last sim-frame
+		unsigned int numSearches = 0;
+
+		/// average wall-time per request in milliseconds
+		float searchTime = 0.0f;
+		/// nodes expanded per second of search-time
+		float nodesPerSecond = 0.0f;
+	};
+
 public:
 	static IPathManager* GetInstance(int type);
 	static void FreeInstance(IPathManager*);
@@ -170,6 +184,7 @@ public:
 	virtual const float* GetNodeExtraCosts(bool synced) const { return nullptr; }
 
 	virtual int2 GetNumQueuedUpdates() const { return (int2(0, 0)); }
+	virtual SearchStats GetSearchStats() const { return {}; }
 };
 
 extern IPathManager* pathManager;
@@ -8,6 +8,8 @@
 #include "Game/GlobalUnsynced.h"
 #include "Game/TraceRay.h"
 #include "Map/Ground.h"
+#include "Map/MapInfo.h"
+#include "Map/ReadMap.h"
 #include "Rendering/GlobalRendering.h"
 #include "Rendering/GroundFlash.h"
 #include "Sim/Features/Feature.h"
@@ -19,7 +21,13 @@
 #include "Sim/Misc/TeamHandler.h"
 #include "Rendering/Env/Particles/Classes/FlyingPiece.h"
 #include "Rendering/Env/Particles/Classes/NanoProjectile.h"
+#include "Sim/Projectiles/ProjectileParams.h"
+#include "Sim/Projectiles/WeaponProjectiles/ExplosiveProjectile.h"
+#include "Sim/Projectiles/WeaponProjectiles/LaserProjectile.h"
+#include "Sim/Projectiles/WeaponProjectiles/MissileProjectile.h"
 #include "Sim/Projectiles/WeaponProjectiles/WeaponProjectile.h"
+#include "Sim/Projectiles/WeaponProjectiles/WeaponProjectileFactory.h"
+#include "Sim/Projectiles/WeaponProjectiles/WeaponProjectileTypes.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
 #include "Sim/Units/UnitHandler.h"
@@ -28,8 +36,11 @@
 #include "System/Config/ConfigHandler.h"
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
+#include "System/MemoryStats.h"
 #include "System/SpringMath.h"
 #include "System/TimeProfiler.h"
+#include "System/Misc/SpringTime.h"
+#include "System/Threading/ThreadPool.h"
 
 
 // reserve 5% of maxNanoParticles for important stuff such as capture and reclaim other teams' units
@@ -41,6 +52,56 @@ CONFIG(int, MaxParticles).defaultValue(10000).headlessValue(0).minimumValue(0);
 CONFIG(int, MaxNanoParticles).defaultValue(2000).headlessValue(0).minimumValue(0);
 
 
+// projectiles per work-item in the parallel collision detection phase
+static constexpr size_t COLLISION_CHUNK_SIZE = 128;
+
+// first object a projectile was found to hit during detection
+struct ProjectileHit {
+	CSolidObject* object = nullptr;
+	CollisionQuery cq;
+
+	bool isUnit = false;
+	// detection was not possible without side-effects; redo it while resolving
+	bool serial = false;
+};
+
+struct CollisionScratch {
+	void Clear() {
+		quads.clear();
+		units.clear();
+		features.clear();
+		repulsers.clear();
+	}
+
+	std::vector<int> quads;
+	std::vector<CUnit*> units;
+	std::vector<CFeature*> features;
+	std::vector<CPlasmaRepulser*> repulsers;
+};
+
+static std::array<CollisionScratch, ThreadPool::MAX_THREADS> collisionScratch;
+static std::vector<ProjectileHit> projectileHits;
+
+// projectiles grouped for updating; the bulk weapon types get their own
+// (devirtualized) update loop, everything else goes through the last one
+enum {
+	UPDATE_BUCKET_EXPLOSIVE = 0,
+	UPDATE_BUCKET_LASER     = 1,
+	UPDATE_BUCKET_MISSILE   = 2,
+	UPDATE_BUCKET_VIRTUAL   = 3,
+	UPDATE_BUCKET_COUNT     = 4,
+};
+
+static std::array<std::vector<CProjectile*>, UPDATE_BUCKET_COUNT> updateBuckets;
+
+// true while Benchmark runs, its projectiles are hidden from Lua
+static bool benchmarkRunning = false;
+
+static std::vector<CUnit*> tempUnits;
+static std::vector<CFeature*> tempFeatures;
+static std::vector<CPlasmaRepulser*> tempRepulsers;
+
+
 CR_BIND(CProjectileHandler, )
 CR_REG_METADATA(CProjectileHandler, (
 	CR_MEMBER(projectileContainers),
@@ -117,11 +178,15 @@ void CProjectileHandler::Init()
 
 	// register ConfigNotify()
 	configHandler->NotifyOnChange(this, {"MaxParticles", "MaxNanoParticles"});
+
+	// also holds unsynced projectiles and ground-flashes
+	memoryStats.AddSubsystem("Sim/Projectiles", [](CMemoryStats::Sample& s) { CMemoryStats::SamplePool(projMemPool, s); });
 }
 
 void CProjectileHandler::Kill()
 {
 	configHandler->RemoveObserver(this);
+	memoryStats.RemoveSubsystem("Sim/Projectiles");
 
 	{
 		// synced first, to avoid callback crashes
@@ -180,6 +245,37 @@ static void MAPPOS_SANITY_CHECK(const float3 v)
 }
 
 
+static int GetUpdateBucket(const CProjectile* p)
+{
+	// Lua-controlled projectiles are rare, keep them off the fast paths
+	if (!p->weapon || p->luaMoveCtrl)
+		return UPDATE_BUCKET_VIRTUAL;
+
+	switch (p->GetProjectileType()) {
+		case WEAPON_EXPLOSIVE_PROJECTILE: { return UPDATE_BUCKET_EXPLOSIVE; } break;
+		case WEAPON_LASER_PROJECTILE    : { return UPDATE_BUCKET_LASER    ; } break;
+		case WEAPON_MISSILE_PROJECTILE  : { return UPDATE_BUCKET_MISSILE  ; } break;
+		default                         : {                                 } break;
+	}
+
+	return UPDATE_BUCKET_VIRTUAL;
+}
+
+template<typename T>
+static void UpdateProjectileBucket(const std::vector<CProjectile*>& bucket)
+{
+	for (CProjectile* p: bucket) {
+		MAPPOS_SANITY_CHECK(p->pos);
+
+		// qualified call, every projectile in the bucket is exactly a T
+		static_cast<T*>(p)->T::Update();
+		quadField.MovedProjectile(p);
+
+		MAPPOS_SANITY_CHECK(p->pos);
+	}
+}
+
+
 void CProjectileHandler::UpdateProjectiles(bool synced)
 {
 	ProjectileContainer& pc = projectileContainers[synced];
@@ -216,8 +312,35 @@ void CProjectileHandler::UpdateProjectiles(bool synced)
 
 	SCOPED_TIMER("Sim::Projectiles::Update");
 
-	// WARNING: same as above but for p->Update()
-	for (size_t i = 0; i < pc.size(); ++i) {
+	// update per type (in container order within each type, buckets in fixed
+	// order) so the same code and data are hot for consecutive projectiles
+	for (std::vector<CProjectile*>& bucket: updateBuckets) {
+		bucket.clear();
+	}
+
+	const size_t numBucketed = pc.size();
+
+	for (size_t i = 0; i < numBucketed; ++i) {
+		assert(pc[i] != nullptr);
+		updateBuckets[GetUpdateBucket(pc[i])].push_back(pc[i]);
+	}
+
+	UpdateProjectileBucket<CExplosiveProjectile>(updateBuckets[UPDATE_BUCKET_EXPLOSIVE]);
+	UpdateProjectileBucket<CLaserProjectile    >(updateBuckets[UPDATE_BUCKET_LASER    ]);
+	UpdateProjectileBucket<CMissileProjectile  >(updateBuckets[UPDATE_BUCKET_MISSILE  ]);
+
+	for (CProjectile* p: updateBuckets[UPDATE_BUCKET_VIRTUAL]) {
+		MAPPOS_SANITY_CHECK(p->pos);
+
+		p->Update();
+		quadField.MovedProjectile(p);
+
+		MAPPOS_SANITY_CHECK(p->pos);
+	}
+
+	// WARNING: Update() can add projectiles to the container, these are
+	// updated in the same frame (by index since pc might be reallocated)
+	for (size_t i = numBucketed; i < pc.size(); ++i) {
 		CProjectile* p = pc[i];
 		assert(p != nullptr);
 
@@ -231,6 +354,80 @@ void CProjectileHandler::UpdateProjectiles(bool synced)
 }
 
 
+void CProjectileHandler::Benchmark(const WeaponDef* weaponDef, int numProjectiles, int numFrames)
+{
+	// the volley lives in its own synced container (the game's projectiles are
+	// not advanced), Lua does not see it and the synced RNG and ID state it used
+	// are restored afterwards; only unsynced effects (trails) are left behind
+	const CGlobalSyncedRNG syncedRNG = gsRNG;
+	const std::vector<int> syncedFreeIDs = freeProjectileIDs[true];
+	const std::vector<CProjectile*> syncedProjMap = projectileMaps[true];
+
+	ProjectileContainer gameProjectiles;
+	std::swap(gameProjectiles, projectileContainers[true]);
+
+	benchmarkRunning = true;
+
+	// ballistic volley above the map, on a trajectory that returns to its
+	// start height after numFrames and with a ttl that outlasts the run
+	const float gravity = mix(mapInfo->map.gravity, -weaponDef->myGravity, weaponDef->myGravity != 0.0f);
+	const float height = readMap->GetCurrMaxHeight() + 500.0f;
+
+	ProjectileParams params;
+	params.weaponDef = weaponDef;
+	params.ttl = numFrames + 2;
+	params.gravity = gravity;
+
+	unsigned int seed = 0x9E3779B9u;
+
+	const auto RandFloat = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return ((seed >> 8) * (1.0f / (1 << 24)));
+	};
+
+	for (int i = 0; i < numProjectiles; i++) {
+		params.pos = float3(RandFloat() * float3::maxxpos, height, RandFloat() * float3::maxzpos);
+		params.end = params.pos;
+		params.speed = float3(RandFloat() - 0.5f, -gravity * numFrames * 0.5f, RandFloat() - 0.5f);
+
+		WeaponProjectileFactory::LoadProjectile(params);
+	}
+
+	// first update also runs the creation events for the new projectiles
+	UpdateProjectiles(true);
+
+	const size_t numUpdated = projectileContainers[true].size();
+	const spring_time t0 = spring_gettime();
+
+	for (int i = 0; i < numFrames; i++) {
+		UpdateProjectiles(true);
+	}
+
+	const spring_time t1 = spring_gettime();
+
+	for (CProjectile* p: projectileContainers[true]) {
+		if (!p->createMe)
+			eventHandler.RenderProjectileDestroyed(p);
+
+		projMemPool.free(p);
+	}
+
+	projectileContainers[true].clear();
+	std::swap(gameProjectiles, projectileContainers[true]);
+
+	freeProjectileIDs[true] = syncedFreeIDs;
+	projectileMaps[true] = syncedProjMap;
+	gsRNG = syncedRNG;
+
+	benchmarkRunning = false;
+
+	LOG("[ProjectileHandler::%s] %d x \"%s\" (%u synced projectiles) for %d frames: %.3fms, %.1fns per projectile update",
+		__func__, numProjectiles, weaponDef->name.c_str(), unsigned(numUpdated), numFrames, (t1 - t0).toMilliSecsf(),
+		(t1 - t0).toNanoSecsf() / std::max(size_t(1), numUpdated * numFrames)
+	);
+}
+
+
 template<class T>
 static void UPDATE_PTR_CONTAINER(T& cont) {
 	if (cont.empty())
@@ -294,7 +491,7 @@ void CProjectileHandler::CreateProjectile(CProjectile* p)
 {
 	p->createMe = false;
 
-	if (p->synced || PH_UNSYNCED_PROJECTILE_EVENTS == 1)
+	if ((p->synced || PH_UNSYNCED_PROJECTILE_EVENTS == 1) && !benchmarkRunning)
 		eventHandler.ProjectileCreated(p, p->GetAllyteamID());
 
 	eventHandler.RenderProjectileCreated(p);
@@ -307,7 +504,8 @@ void CProjectileHandler::DestroyProjectile(CProjectile* p)
 	eventHandler.RenderProjectileDestroyed(p);
 
 	if (p->synced) {
-		eventHandler.ProjectileDestroyed(p, p->GetAllyteamID());
+		if (!benchmarkRunning)
+			eventHandler.ProjectileDestroyed(p, p->GetAllyteamID());
 
 		projectileMaps[true][p->id] = nullptr;
 		freeProjectileIDs[true].push_back(p->id);
@@ -468,6 +666,101 @@ static bool CheckProjectileCollisionFlags(const CProjectile* p, const CUnit* u)
 }
 
 
+template<typename T>
+static void ApplyProjectileHit(CProjectile* p, T* object, const CollisionQuery& cq, const float3 ppos0)
+{
+	if (cq.GetHitPiece() != nullptr)
+		object->SetLastHitPiece(cq.GetHitPiece(), gs->frameNum, p->synced);
+
+	if (!cq.InsideHit()) {
+		p->SetPosition(cq.GetHitPos());
+		p->Collision(object);
+		p->SetPosition(ppos0);
+	} else {
+		p->Collision(object);
+	}
+}
+
+static void DetectProjectileHit(const CProjectile* p, CollisionScratch& scratch, ProjectileHit& hit)
+{
+	const float3 ppos0 = p->pos;
+	const float3 ppos1 = p->pos + p->speed;
+
+	scratch.Clear();
+	quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, scratch.quads, scratch.units, scratch.features, scratch.repulsers);
+
+	// shield interceptions change shield state, leave those to the serial path
+	if (p->weapon && !scratch.repulsers.empty()) {
+		if (static_cast<const CWeaponProjectile*>(p)->GetWeaponDef()->interceptedByShieldType != 0) {
+			hit.serial = true;
+			return;
+		}
+	}
+
+	// same filters and order as CheckUnitCollisions
+	for (CUnit* unit: scratch.units) {
+		if (unit == p->owner())
+			continue;
+		if (!unit->HasCollidableStateBit(CSolidObject::CSTATE_BIT_PROJECTILES))
+			continue;
+
+		if (!CheckProjectileCollisionFlags(p, unit))
+			continue;
+
+		// piece matrices are lazily updated, not safe to touch from here
+		if (unit->collisionVolume.DefaultToPieceTree()) {
+			hit.serial = true;
+			return;
+		}
+
+		if (CCollisionHandler::DetectHit(unit, unit->GetTransformMatrix(true), ppos0, ppos1, &hit.cq)) {
+			hit.object = unit;
+			hit.isUnit = true;
+			return;
+		}
+	}
+
+	if ((p->GetCollisionFlags() & Collision::NOFEATURES) != 0)
+		return;
+
+	// same filters and order as CheckFeatureCollisions
+	for (CFeature* feature: scratch.features) {
+		if (!feature->HasCollidableStateBit(CSolidObject::CSTATE_BIT_PROJECTILES))
+			continue;
+
+		if (feature->collisionVolume.DefaultToPieceTree()) {
+			hit.serial = true;
+			return;
+		}
+
+		if (CCollisionHandler::DetectHit(feature, feature->GetTransformMatrix(true), ppos0, ppos1, &hit.cq)) {
+			hit.object = feature;
+			return;
+		}
+	}
+}
+
+
+// true if an object DetectProjectileHit could have tested <p> against was
+// moved, turned, reshaped or created (see CSolidObject::MarkChanged) since
+// <changeCount>, e.g. by Lua reacting to the Collision() of another projectile
+static bool ProjectileHitChanged(const CProjectile* p, const ProjectileHit& hit, uint64_t changeCount, CollisionScratch& scratch)
+{
+	if (hit.object != nullptr && hit.object->changeCount > changeCount)
+		return true;
+
+	scratch.Clear();
+	quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, scratch.quads, scratch.units, scratch.features, scratch.repulsers);
+
+	const auto IsChanged = [&](const CSolidObject* o) { return (o->changeCount > changeCount); };
+
+	if (std::find_if(scratch.units.begin(), scratch.units.end(), IsChanged) != scratch.units.end())
+		return true;
+
+	return (std::find_if(scratch.features.begin(), scratch.features.end(), IsChanged) != scratch.features.end());
+}
+
+
 void CProjectileHandler::CheckUnitCollisions(
 	CProjectile* p,
 	std::vector<CUnit*>& tempUnits,
@@ -492,17 +785,7 @@ void CProjectileHandler::CheckUnitCollisions(
 			continue;
 
 		if (CCollisionHandler::DetectHit(unit, unit->GetTransformMatrix(true), ppos0, ppos1, &cq)) {
-			if (cq.GetHitPiece() != nullptr)
-				unit->SetLastHitPiece(cq.GetHitPiece(), gs->frameNum, p->synced);
-
-			if (!cq.InsideHit()) {
-				p->SetPosition(cq.GetHitPos());
-				p->Collision(unit);
-				p->SetPosition(ppos0);
-			} else {
-				p->Collision(unit);
-			}
-
+			ApplyProjectileHit(p, unit, cq, ppos0);
 			break;
 		}
 	}
@@ -530,17 +813,7 @@ void CProjectileHandler::CheckFeatureCollisions(
 			continue;
 
 		if (CCollisionHandler::DetectHit(feature, feature->GetTransformMatrix(true), ppos0, ppos1, &cq)) {
-			if (cq.GetHitPiece() != nullptr)
-				feature->SetLastHitPiece(cq.GetHitPiece(), gs->frameNum, p->synced);
-
-			if (!cq.InsideHit()) {
-				p->SetPosition(cq.GetHitPos());
-				p->Collision(feature);
-				p->SetPosition(ppos0);
-			} else {
-				p->Collision(feature);
-			}
-
+			ApplyProjectileHit(p, feature, cq, ppos0);
 			break;
 		}
 	}
@@ -600,27 +873,87 @@ void CProjectileHandler::CheckShieldCollisions(
 	}
 }
 
+void CProjectileHandler::CheckUnitFeatureCollisions(CProjectile* p)
+{
+	const float3 ppos0 = p->pos;
+	const float3 ppos1 = p->pos + p->speed;
+	// const float3 ppos1 = p->pos + p->dir * (p->speed.w + p->radius);
+
+	quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, tempUnits, tempFeatures, &tempRepulsers);
+
+	CheckShieldCollisions(p, tempRepulsers, ppos0, ppos1); tempRepulsers.clear();
+	CheckUnitCollisions(p, tempUnits, ppos0, ppos1); tempUnits.clear();
+	CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1); tempFeatures.clear();
+}
+
 void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc)
 {
-	static std::vector<CUnit*> tempUnits;
-	static std::vector<CFeature*> tempFeatures;
-	static std::vector<CPlasmaRepulser*> tempRepulsers;
+	// phase one: broad- and narrow-phase for all projectiles in parallel; this
+	// has no side-effects and only sees the state from before any hit resolves
+	const size_t numDetected = pc.size();
+	const uint64_t detectChangeCount = CSolidObject::lastChangeCount;
+
+	projectileHits.clear();
+	projectileHits.resize(numDetected);
+
+	for_mt(0, (numDetected + COLLISION_CHUNK_SIZE - 1) / COLLISION_CHUNK_SIZE, [&](const int chunkIdx) {
+		CollisionScratch& scratch = collisionScratch[ThreadPool::GetThreadNum()];
+
+		for (size_t i = chunkIdx * COLLISION_CHUNK_SIZE, n = std::min(numDetected, i + COLLISION_CHUNK_SIZE); i < n; ++i) {
+			const CProjectile* p = pc[i];
+
+			if (!p->checkCol) continue;
+			if ( p->deleteMe) continue;
 
+			DetectProjectileHit(p, scratch, projectileHits[i]);
+		}
+	});
+
+	CCollisionHandler::CollectStats();
+
+	// phase two: resolve hits serially in projectile order; projectiles added
+	// by Collision() callbacks and those that could not be handled in phase one
+	// take the serial path, as do projectiles near objects changed (including
+	// made non-collidable) by an earlier Collision() since phase one
 	for (size_t i = 0; i < pc.size(); ++i) {
 		CProjectile* p = pc[i];
 
 		if (!p->checkCol) continue;
 		if ( p->deleteMe) continue;
 
+		if (i >= numDetected || projectileHits[i].serial) {
+			CheckUnitFeatureCollisions(p);
+			continue;
+		}
+
+		const ProjectileHit& hit = projectileHits[i];
+
+		if (CSolidObject::lastChangeCount != detectChangeCount && ProjectileHitChanged(p, hit, detectChangeCount, collisionScratch[ThreadPool::GetThreadNum()])) {
+			CheckUnitFeatureCollisions(p);
+			continue;
+		}
+
+		if (hit.object == nullptr)
+			continue;
+
 		const float3 ppos0 = p->pos;
 		const float3 ppos1 = p->pos + p->speed;
-		// const float3 ppos1 = p->pos + p->dir * (p->speed.w + p->radius);
 
-		quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, tempUnits, tempFeatures, &tempRepulsers);
+		if (!hit.isUnit) {
+			ApplyProjectileHit(p, static_cast<CFeature*>(hit.object), hit.cq, ppos0);
+			continue;
+		}
+
+		ApplyProjectileHit(p, static_cast<CUnit*>(hit.object), hit.cq, ppos0);
+
+		// projectile survived the unit-hit, features are next
+		if (!p->checkCol)
+			continue;
+
+		quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, tempUnits, tempFeatures);
 
-		CheckShieldCollisions(p, tempRepulsers, ppos0, ppos1); tempRepulsers.clear();
-		CheckUnitCollisions(p, tempUnits, ppos0, ppos1); tempUnits.clear();
 		CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1); tempFeatures.clear();
+		tempUnits.clear();
 	}
 }
 
@@ -19,6 +19,7 @@ class CFeature;
 class CPlasmaRepulser;
 class CGroundFlash;
 struct UnitDef;
+struct WeaponDef;
 struct FlyingPiece;
 
 
@@ -44,6 +45,7 @@ public:
 	void CheckUnitCollisions(CProjectile*, std::vector<CUnit*>&, const float3, const float3);
 	void CheckFeatureCollisions(CProjectile*, std::vector<CFeature*>&, const float3, const float3);
 	void CheckShieldCollisions(CProjectile*, std::vector<CPlasmaRepulser*>&, const float3, const float3);
+	void CheckUnitFeatureCollisions(CProjectile*);
 	void CheckUnitFeatureCollisions(ProjectileContainer&);
 	void CheckGroundCollisions(ProjectileContainer&);
 	void CheckCollisions();
@@ -53,6 +55,9 @@ public:
 
 	void Update();
 
+	/// spawns numProjectiles of weaponDef and times numFrames updates of them
+	void Benchmark(const WeaponDef* weaponDef, int numProjectiles, int numFrames);
+
 	float GetParticleSaturation(bool randomized = true) const;
 	float GetNanoParticleSaturation(float priority) const {
 		const float total = std::max(1.0f, maxNanoParticles * priority);
@@ -4,6 +4,13 @@
 #include "CobEngine.h"
 #include "CobThread.h"
 #include "CobFile.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+
+#include <algorithm>
+
+CONFIG(bool, DecodedCobScripts).defaultValue(true).description("Run COB scripts from their pre-decoded instruction streams. If false the original opcode interpreter is used, which behaves identically (for validation).");
 
 
 CR_BIND(CCobEngine, )
@@ -13,20 +20,27 @@ CR_REG_METADATA(CCobEngine, (
 	CR_MEMBER(tickAddedThreads),
 
 	CR_MEMBER(runningThreadIDs),
-	CR_MEMBER(sleepingThreadIDs),
+	CR_MEMBER(sleepingThreads),
+	CR_IGNORED(cascadedThreads),
 	// always null/empty when saving
 	CR_IGNORED(waitingThreadIDs),
 
 	CR_IGNORED(curThread),
 
 	CR_MEMBER(currentTime),
-	CR_MEMBER(threadCounter)
+	CR_MEMBER(threadCounter),
+	CR_MEMBER(sleepWheelTime),
+	CR_MEMBER(sleepSequence),
+
+	CR_IGNORED(numTickedThreads),
+	CR_IGNORED(decodedScripts)
 ))
 
 CR_BIND(CCobEngine::SleepingThread, )
 CR_REG_METADATA(CCobEngine::SleepingThread, (
 	CR_MEMBER(id),
-	CR_MEMBER(wt)
+	CR_MEMBER(wt),
+	CR_MEMBER(seq)
 ))
 
 
@@ -54,7 +68,7 @@ void CCobEngine::ScheduleThread(const CCobThread* thread)
 			waitingThreadIDs.push_back(thread->GetID());
 		} break;
 		case CCobThread::Sleep: {
-			sleepingThreadIDs.push(SleepingThread{thread->GetID(), thread->GetWakeTime()});
+			AddSleepingThread(SleepingThread{thread->GetID(), thread->GetWakeTime(), sleepSequence++});
 		} break;
 		default: {
 			LOG_L(L_ERROR, "[COBEngine::%s] unknown state %d for thread %d", __func__, thread->GetState(), thread->GetID());
@@ -76,10 +90,29 @@ void CCobEngine::SanityCheckThreads(const CCobInstance* owner)
 }
 
 
+void CCobEngine::Init()
+{
+	threadInstances.reserve(2048);
+	tickAddedThreads.reserve(128);
+
+	runningThreadIDs.reserve(512);
+	waitingThreadIDs.reserve(512);
+
+	threadCounter = 0;
+	numTickedThreads = 0;
+
+	sleepingThreads.resize(SLEEP_WHEEL_LEVELS * SLEEP_WHEEL_SLOTS + 1);
+	sleepWheelTime = currentTime;
+
+	decodedScripts = configHandler->GetBool("DecodedCobScripts");
+}
+
+
 void CCobEngine::TickThread(CCobThread* thread)
 {
 	// for error messages originating in CUnitScript
 	curThread = thread;
+	numTickedThreads++;
 
 	// NB: threadID is still in <runningThreadIDs> here, TickRunningThreads clears it
 	if (thread != nullptr && !thread->Tick())
@@ -88,39 +121,92 @@ void CCobEngine::TickThread(CCobThread* thread)
 	curThread = nullptr;
 }
 
-void CCobEngine::WakeSleepingThreads()
+void CCobEngine::AddSleepingThread(const SleepingThread& st)
 {
-	// check on the sleeping threads, remove any whose owner died
-	while (!sleepingThreadIDs.empty()) {
-		CCobThread* zzzThread = GetThread((sleepingThreadIDs.top()).id);
+	// wake-times in the past (negative sleeps) are due in the slot being processed
+	const int wt = std::max(st.wt, sleepWheelTime);
+	const int dt = wt - sleepWheelTime;
+
+	for (int level = 0; level < SLEEP_WHEEL_LEVELS; level++) {
+		const int shift = SLEEP_WHEEL_BITS * level;
 
-		if (zzzThread == nullptr) {
-			sleepingThreadIDs.pop();
+		if (dt >= (1 << (shift + SLEEP_WHEEL_BITS)))
 			continue;
+
+		sleepingThreads[level * SLEEP_WHEEL_SLOTS + ((wt >> shift) & (SLEEP_WHEEL_SLOTS - 1))].push_back(st);
+		return;
+	}
+
+	sleepingThreads[SLEEP_WHEEL_LEVELS * SLEEP_WHEEL_SLOTS].push_back(st);
+}
+
+void CCobEngine::CascadeSleepingThreads()
+{
+	// whenever the wheel-time crosses a slot-boundary of level L, redistribute
+	// the threads of the slot it enters over the lower levels (this only ever
+	// moves them closer to level 0, except for the overflow slot)
+	for (int level = 1; level <= SLEEP_WHEEL_LEVELS; level++) {
+		const int shift = SLEEP_WHEEL_BITS * level;
+
+		if ((sleepWheelTime & ((1 << shift) - 1)) != 0)
+			return;
+
+		const int slotIdx = (level < SLEEP_WHEEL_LEVELS)?
+			(level * SLEEP_WHEEL_SLOTS + ((sleepWheelTime >> shift) & (SLEEP_WHEEL_SLOTS - 1))):
+			(SLEEP_WHEEL_LEVELS * SLEEP_WHEEL_SLOTS);
+
+		cascadedThreads.clear();
+		cascadedThreads.swap(sleepingThreads[slotIdx]);
+
+		for (const SleepingThread& st: cascadedThreads) {
+			AddSleepingThread(st);
 		}
+	}
+}
 
-		// not yet time to execute this thread or any subsequent sleepers
-		if (zzzThread->GetWakeTime() >= currentTime)
-			break;
-
-		// remove executing thread from the queue
-		sleepingThreadIDs.pop();
-
-		// wake up the thread and tick it (if not dead)
-		// this can quite possibly re-add the thread to <sleepingThreadIDs>
-		// again, but any thread is guaranteed to sleep for at least 1 tick
-		switch (zzzThread->GetState()) {
-			case CCobThread::Sleep: {
-				zzzThread->SetState(CCobThread::Run);
-				TickThread(zzzThread);
-			} break;
-			case CCobThread::Dead: {
-				RemoveThread(zzzThread->GetID());
-			} break;
-			default: {
-				LOG_L(L_ERROR, "[COBEngine::%s] unknown state %d for thread %d", __func__, zzzThread->GetState(), zzzThread->GetID());
-			} break;
+void CCobEngine::WakeSleepingThreads()
+{
+	// advance the wheel through every ms since the last tick, waking threads
+	// in order of wake-time (and per wake-time in order of scheduling)
+	for (; sleepWheelTime < currentTime; sleepWheelTime++) {
+		CascadeSleepingThreads();
+
+		std::vector<SleepingThread>& slot = sleepingThreads[sleepWheelTime & (SLEEP_WHEEL_SLOTS - 1)];
+
+		// threads cascaded down from higher levels were appended after those
+		// scheduled straight into this slot, restore the scheduling order
+		const auto seqCmp = [](const SleepingThread& a, const SleepingThread& b) { return (int(a.seq - b.seq) < 0); };
+
+		if (!std::is_sorted(slot.begin(), slot.end(), seqCmp))
+			std::sort(slot.begin(), slot.end(), seqCmp);
+
+		// a woken thread can go back to sleep in this same slot if its sleep
+		// was negative, so index rather than iterate (slot may reallocate)
+		for (size_t i = 0; i < slot.size(); i++) {
+			// check on the sleeping threads, skip any whose owner died
+			CCobThread* zzzThread = GetThread(slot[i].id);
+
+			if (zzzThread == nullptr)
+				continue;
+
+			// wake up the thread and tick it (if not dead)
+			// this can quite possibly re-add the thread to the wheel again,
+			// but any thread is guaranteed to sleep for at least 1 tick
+			switch (zzzThread->GetState()) {
+				case CCobThread::Sleep: {
+					zzzThread->SetState(CCobThread::Run);
+					TickThread(zzzThread);
+				} break;
+				case CCobThread::Dead: {
+					RemoveThread(zzzThread->GetID());
+				} break;
+				default: {
+					LOG_L(L_ERROR, "[COBEngine::%s] unknown state %d for thread %d", __func__, zzzThread->GetState(), zzzThread->GetID());
+				} break;
+			}
 		}
+
+		slot.clear();
 	}
 }
 
@@ -136,6 +222,33 @@ void CCobEngine::Tick(int deltaTime)
 }
 
 
+void CCobEngine::Benchmark(int numTicks, bool decoded)
+{
+	const bool decodedCfg = decodedScripts;
+
+	decodedScripts = decoded;
+	numTickedThreads = 0;
+
+	const spring_time t0 = spring_gettime();
+
+	for (int i = 0; i < numTicks; i++) {
+		// same delta as CGame::SimFrame
+		Tick(33);
+	}
+
+	const spring_time t1 = spring_gettime();
+	const float dt = (t1 - t0).toMilliSecsf();
+
+	LOG("[COBEngine::%s] %d ticks (%s interpreter): %u thread-ticks in %.2fms (%.3fus per thread-tick, %.3fms per tick)",
+		__func__, numTicks, decoded? "decoded": "opcode", numTickedThreads, dt,
+		(numTickedThreads > 0)? (dt * 1000.0f / numTickedThreads): 0.0f,
+		(numTicks > 0)? (dt / numTicks): 0.0f
+	);
+
+	decodedScripts = decodedCfg;
+}
+
+
 void CCobEngine::ShowScriptError(const std::string& msg)
 {
 	if (curThread != nullptr) {
@@ -12,7 +12,6 @@
 
 #include "CobThread.h"
 #include "System/creg/creg_cond.h"
-#include "System/creg/STL_Queue.h"
 #include "System/creg/STL_Map.h"
 
 
@@ -31,25 +30,19 @@ private:
 
 		int id;
 		int wt;
+		// scheduling order, compared with wrap-around
+		unsigned int seq;
 	};
 
-	struct CCobThreadComp {
-	public:
-		bool operator() (const SleepingThread& a, const SleepingThread& b) const {
-			return (a.wt > b.wt);
-		}
-	};
+	// sleeping threads are kept in a hierarchical timer-wheel keyed by their
+	// wake-time (sim ms); level L has SLEEP_WHEEL_SLOTS slots spanning 64^L ms
+	// each, wake-times beyond the last level go into a final overflow slot
+	static constexpr int SLEEP_WHEEL_LEVELS = 4;
+	static constexpr int SLEEP_WHEEL_BITS = 6;
+	static constexpr int SLEEP_WHEEL_SLOTS = 1 << SLEEP_WHEEL_BITS;
 
 public:
-	void Init() {
-		threadInstances.reserve(2048);
-		tickAddedThreads.reserve(128);
-
-		runningThreadIDs.reserve(512);
-		waitingThreadIDs.reserve(512);
-
-		threadCounter = 0;
-	}
+	void Init();
 	void Kill() {
 		// threadInstances is never explicitly iterated, so
 		// calling clear_unordered_map (between reloads) is
@@ -60,14 +53,23 @@ public:
 		runningThreadIDs.clear();
 		waitingThreadIDs.clear();
 
-		while (!sleepingThreadIDs.empty()) {
-			sleepingThreadIDs.pop();
+		for (std::vector<SleepingThread>& slot: sleepingThreads) {
+			slot.clear();
 		}
 	}
 
 	void Tick(int deltaTime);
 	void ShowScriptError(const std::string& msg);
 
+	/**
+	 * Runs numTicks extra script ticks (COB threads only, no animations)
+	 * with the decoded or the opcode interpreter and logs the time taken.
+	 * Advances synced state, must be called on all clients alike.
+	 */
+	void Benchmark(int numTicks, bool decoded);
+
+	bool UseDecodedScripts() const { return decodedScripts; }
+
 
 	CCobThread* GetThread(int threadID) {
 		const auto it = threadInstances.find(threadID);
@@ -97,7 +99,7 @@ public:
 	void AddQueuedThreads() {
 		// move new threads spawned by START into threadInstances;
 		// their ID's will already have been scheduled into either
-		// waitingThreadIDs or sleepingThreadIDs
+		// waitingThreadIDs or sleepingThreads
 		for (CCobThread& t: tickAddedThreads) {
 			AddThread(std::move(t));
 		}
@@ -111,6 +113,8 @@ public:
 private:
 	void TickThread(CCobThread* thread);
 
+	void AddSleepingThread(const SleepingThread& st);
+	void CascadeSleepingThreads();
 	void WakeSleepingThreads();
 	void TickRunningThreads() {
 		// advance all currently running threads
@@ -139,12 +143,24 @@ private:
 
 	// stores <id, waketime> pairs s.t. after waking up the ID can be checked
 	// for validity; thread owner might get removed while a thread is sleeping
-	std::priority_queue<SleepingThread, std::vector<SleepingThread>, CCobThreadComp> sleepingThreadIDs;
+	std::vector< std::vector<SleepingThread> > sleepingThreads;
+	std::vector<SleepingThread> cascadedThreads;
+
+	// wake-times below this have been processed
+	int sleepWheelTime = 0;
+	// sequence number of the next thread put to sleep
+	unsigned int sleepSequence = 0;
 
 	CCobThread* curThread = nullptr;
 
 	int currentTime = 0;
 	int threadCounter = 0;
+
+	// number of TickThread calls, for Benchmark
+	unsigned int numTickedThreads = 0;
+
+	// both interpreters behave the same, so this need not be synced
+	bool decodedScripts = true;
 };
 
 
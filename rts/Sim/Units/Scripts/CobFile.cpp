@@ -3,6 +3,7 @@
 
 #include "Sim/Misc/GlobalConstants.h"
 #include "CobFile.h"
+#include "CobOpcodes.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/Log/ILog.h"
 #include "System/Sound/ISound.h"
@@ -196,6 +197,192 @@ CCobFile::CCobFile(CFileHandler& in, const std::string& scriptName)
 
 		scriptIndex[pair.second] = fn;
 	}
+
+	if (!Decode()) {
+		LOG_L(L_WARNING, "[%s] script \"%s\" could not be pre-decoded, using the opcode interpreter", __func__, name.c_str());
+
+		instructions.clear();
+		codeInstructions.clear();
+		scriptInstructions.clear();
+		fireScripts.clear();
+	}
+}
+
+
+/**
+ * Splits code into an instruction stream with resolved jump-targets and
+ * calls (CALL is otherwise rewritten to REAL_CALL or LUA_CALL the first time
+ * it executes), s.t. CCobThread does not need to parse raw opcodes. Fails
+ * for code the opcode interpreter would not run through the same sequence
+ * of instructions, i.e. entry points or jump-targets that point into the
+ * middle of an instruction or operands that exceed the code section.
+ */
+bool CCobFile::Decode()
+{
+	using namespace CobOpcodes;
+
+	if (scriptOffsets.empty())
+		return false;
+
+	const int codeSize = scriptOffsets.back() + scriptLengths.back();
+
+	if (codeSize < 0 || codeSize >= int(code.size()))
+		return false;
+
+	instructions.clear();
+	instructions.reserve(codeSize / 2 + 1);
+	codeInstructions.clear();
+	codeInstructions.resize(codeSize + 1, -1);
+
+	// the word following the code is reached by scripts without a final
+	// RETURN, which the interpreter treats as an opcode as well; decoding
+	// it as an unknown instruction is only correct if it is none
+	for (int pc = 0; pc <= codeSize; ) {
+		const int opcode = code[pc];
+
+		Instruction instr = {OP_UNKNOWN, pc, {opcode, 0}};
+		int numArgs = 0;
+
+		switch (opcode) {
+			case MOVE            : { instr.op = OP_MOVE            ; numArgs = 2; } break;
+			case TURN            : { instr.op = OP_TURN            ; numArgs = 2; } break;
+			case SPIN            : { instr.op = OP_SPIN            ; numArgs = 2; } break;
+			case STOP_SPIN       : { instr.op = OP_STOP_SPIN       ; numArgs = 2; } break;
+			case SHOW            : { instr.op = OP_SHOW            ; numArgs = 1; } break;
+			case HIDE            : { instr.op = OP_HIDE            ; numArgs = 1; } break;
+			case CACHE           : { instr.op = OP_NOP             ; numArgs = 1; } break;
+			case DONT_CACHE      : { instr.op = OP_NOP             ; numArgs = 1; } break;
+			case MOVE_NOW        : { instr.op = OP_MOVE_NOW        ; numArgs = 2; } break;
+			case TURN_NOW        : { instr.op = OP_TURN_NOW        ; numArgs = 2; } break;
+			case SHADE           : { instr.op = OP_NOP             ; numArgs = 1; } break;
+			case DONT_SHADE      : { instr.op = OP_NOP             ; numArgs = 1; } break;
+			case EMIT_SFX        : { instr.op = OP_EMIT_SFX        ; numArgs = 1; } break;
+
+			case WAIT_TURN       : { instr.op = OP_WAIT_TURN       ; numArgs = 2; } break;
+			case WAIT_MOVE       : { instr.op = OP_WAIT_MOVE       ; numArgs = 2; } break;
+			case SLEEP           : { instr.op = OP_SLEEP           ; numArgs = 0; } break;
+
+			case PUSH_CONSTANT   : { instr.op = OP_PUSH_CONSTANT   ; numArgs = 1; } break;
+			case PUSH_LOCAL_VAR  : { instr.op = OP_PUSH_LOCAL_VAR  ; numArgs = 1; } break;
+			case PUSH_STATIC     : { instr.op = OP_PUSH_STATIC     ; numArgs = 1; } break;
+			case CREATE_LOCAL_VAR: { instr.op = OP_CREATE_LOCAL_VAR; numArgs = 0; } break;
+			case POP_LOCAL_VAR   : { instr.op = OP_POP_LOCAL_VAR   ; numArgs = 1; } break;
+			case POP_STATIC      : { instr.op = OP_POP_STATIC      ; numArgs = 1; } break;
+			case POP_STACK       : { instr.op = OP_POP_STACK       ; numArgs = 0; } break;
+
+			case ADD             : { instr.op = OP_ADD             ; numArgs = 0; } break;
+			case SUB             : { instr.op = OP_SUB             ; numArgs = 0; } break;
+			case MUL             : { instr.op = OP_MUL             ; numArgs = 0; } break;
+			case DIV             : { instr.op = OP_DIV             ; numArgs = 0; } break;
+			case MOD             : { instr.op = OP_MOD             ; numArgs = 0; } break;
+			case BITWISE_AND     : { instr.op = OP_BITWISE_AND     ; numArgs = 0; } break;
+			case BITWISE_OR      : { instr.op = OP_BITWISE_OR      ; numArgs = 0; } break;
+			case BITWISE_XOR     : { instr.op = OP_BITWISE_XOR     ; numArgs = 0; } break;
+			case BITWISE_NOT     : { instr.op = OP_BITWISE_NOT     ; numArgs = 0; } break;
+
+			case RAND            : { instr.op = OP_RAND            ; numArgs = 0; } break;
+			case GET_UNIT_VALUE  : { instr.op = OP_GET_UNIT_VALUE  ; numArgs = 0; } break;
+			case GET             : { instr.op = OP_GET             ; numArgs = 0; } break;
+
+			case SET_LESS            : { instr.op = OP_SET_LESS            ; numArgs = 0; } break;
+			case SET_LESS_OR_EQUAL   : { instr.op = OP_SET_LESS_OR_EQUAL   ; numArgs = 0; } break;
+			case SET_GREATER         : { instr.op = OP_SET_GREATER         ; numArgs = 0; } break;
+			case SET_GREATER_OR_EQUAL: { instr.op = OP_SET_GREATER_OR_EQUAL; numArgs = 0; } break;
+			case SET_EQUAL           : { instr.op = OP_SET_EQUAL           ; numArgs = 0; } break;
+			case SET_NOT_EQUAL       : { instr.op = OP_SET_NOT_EQUAL       ; numArgs = 0; } break;
+			case LOGICAL_AND         : { instr.op = OP_LOGICAL_AND         ; numArgs = 0; } break;
+			case LOGICAL_OR          : { instr.op = OP_LOGICAL_OR          ; numArgs = 0; } break;
+			case LOGICAL_XOR         : { instr.op = OP_LOGICAL_XOR         ; numArgs = 0; } break;
+			case LOGICAL_NOT         : { instr.op = OP_LOGICAL_NOT         ; numArgs = 0; } break;
+
+			case START           : { instr.op = OP_START           ; numArgs = 2; } break;
+			case CALL            : { instr.op = OP_REAL_CALL       ; numArgs = 2; } break;
+			case REAL_CALL       : { instr.op = OP_REAL_CALL       ; numArgs = 2; } break;
+			case LUA_CALL        : { instr.op = OP_LUA_CALL        ; numArgs = 2; } break;
+			case JUMP            : { instr.op = OP_JUMP            ; numArgs = 1; } break;
+			case RETURN          : { instr.op = OP_RETURN          ; numArgs = 0; } break;
+			case JUMP_NOT_EQUAL  : { instr.op = OP_JUMP_NOT_EQUAL  ; numArgs = 1; } break;
+			case SIGNAL          : { instr.op = OP_SIGNAL          ; numArgs = 0; } break;
+			case SET_SIGNAL_MASK : { instr.op = OP_SET_SIGNAL_MASK ; numArgs = 0; } break;
+
+			case EXPLODE         : { instr.op = OP_EXPLODE         ; numArgs = 1; } break;
+			case PLAY_SOUND      : { instr.op = OP_PLAY_SOUND      ; numArgs = 1; } break;
+
+			case SET             : { instr.op = OP_SET             ; numArgs = 0; } break;
+			case ATTACH          : { instr.op = OP_ATTACH          ; numArgs = 0; } break;
+			case DROP            : { instr.op = OP_DROP            ; numArgs = 0; } break;
+			default: {} break;
+		}
+
+		if (pc == codeSize && instr.op != OP_UNKNOWN)
+			return false;
+		if ((pc + 1 + numArgs) > codeSize && pc != codeSize)
+			return false;
+
+		for (int i = 0; i < numArgs; i++) {
+			instr.args[i] = code[pc + 1 + i];
+		}
+
+		switch (opcode) {
+			case CALL: {
+				if (static_cast<size_t>(instr.args[0]) >= scriptNames.size())
+					return false;
+
+				// same test as the interpreter, lua_ functions are zero-length
+				if (scriptNames[instr.args[0]].find("lua_") == 0) {
+					instr.op = OP_LUA_CALL;
+					break;
+				}
+			} // fall-through
+			case REAL_CALL:
+			case START: {
+				if (static_cast<size_t>(instr.args[0]) >= scriptLengths.size())
+					return false;
+
+				// zero-length functions are neither called nor started
+				if (scriptLengths[instr.args[0]] == 0)
+					instr.op = OP_NOP;
+			} break;
+			default: {} break;
+		}
+
+		codeInstructions[pc] = instructions.size();
+		instructions.push_back(instr);
+
+		pc += (1 + numArgs);
+	}
+
+	for (Instruction& instr: instructions) {
+		if (instr.op != OP_JUMP && instr.op != OP_JUMP_NOT_EQUAL)
+			continue;
+
+		if (!IsDecoded(instr.args[0]))
+			return false;
+
+		instr.args[0] = codeInstructions[instr.args[0]];
+	}
+
+	scriptInstructions.clear();
+	scriptInstructions.reserve(scriptOffsets.size());
+
+	for (const int offset: scriptOffsets) {
+		if (!IsDecoded(offset))
+			return false;
+
+		scriptInstructions.push_back(codeInstructions[offset]);
+	}
+
+	fireScripts.clear();
+	fireScripts.resize(scriptNames.size(), false);
+
+	for (int i = 0; i < MAX_WEAPONS_PER_UNIT; ++i) {
+		const int fn = scriptIndex[COBFN_FirePrimary + COBFN_Weapon_Funcs * i];
+
+		if (fn >= 0)
+			fireScripts[fn] = true;
+	}
+
+	return true;
 }
 
 
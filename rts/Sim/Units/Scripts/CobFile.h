@@ -15,6 +15,15 @@ class CFileHandler;
 
 class CCobFile
 {
+public:
+	struct Instruction {
+		int op; ///< CobOpcodes::DecodedOp
+		int pc; ///< offset of the instruction into code
+
+		// immediate operands; jump-targets are instruction indices
+		int args[2];
+	};
+
 public:
 	CCobFile(CFileHandler& in, const std::string& scriptName);
 	CCobFile(CCobFile&& f) { *this = std::move(f); }
@@ -33,12 +42,25 @@ public:
 		luaScripts = std::move(f.luaScripts);
 		scriptMap = std::move(f.scriptMap);
 
+		instructions = std::move(f.instructions);
+		codeInstructions = std::move(f.codeInstructions);
+		scriptInstructions = std::move(f.scriptInstructions);
+		fireScripts = std::move(f.fireScripts);
+
 		name = std::move(f.name);
 		return *this;
 	}
 
 	int GetFunctionId(const std::string& name);
 
+	/// @return true if execution can continue from code offset pc in the decoded stream
+	bool IsDecoded(int pc) const {
+		return (static_cast<size_t>(pc) < codeInstructions.size() && codeInstructions[pc] >= 0);
+	}
+
+private:
+	bool Decode();
+
 public:
 	int numStaticVars = 0;
 
@@ -53,6 +75,15 @@ public:
 	std::vector<LuaHashString> luaScripts;
 	spring::unordered_map<std::string, int> scriptMap;
 
+	// pre-decoded form of code, empty if it could not be decoded
+	std::vector<Instruction> instructions;
+	/// instruction index for each offset into code, -1 if not an instruction boundary
+	std::vector<int> codeInstructions;
+	/// instruction index of each script's entry point
+	std::vector<int> scriptInstructions;
+	/// whether each script is a weapon's Fire-function (SHOW then shows a flare)
+	std::vector<bool> fireScripts;
+
 	std::string name;
 };
 
@@ -46,6 +46,7 @@ CR_REG_METADATA(CCobInstance, (
 
 	CR_MEMBER(staticVars),
 	CR_MEMBER(threadIDs),
+	CR_MEMBER(animWaitThreadIDs),
 
 	CR_POSTLOAD(PostLoad)
 ))
@@ -106,6 +107,8 @@ CCobInstance::~CCobInstance()
 		threadIDs.pop_back();
 	}
 
+	animWaitThreadIDs.clear();
+
 	cobEngine->SanityCheckThreads(this);
 }
 
@@ -457,10 +460,18 @@ float CCobInstance::TargetWeight(int weaponNum, const CUnit* targetUnit)
 
 void CCobInstance::AnimFinished(AnimType type, int piece, int axis)
 {
-	for (int threadID: threadIDs) {
+	// only threads blocked on an animation need to be visited; those that
+	// were woken (or have since died) drop out of the list, order is kept
+	const auto pred = [&](int threadID) {
 		CCobThread* t = cobEngine->GetThread(threadID);
-		t->AnimFinished(type, piece, axis);
-	}
+
+		if (t == nullptr || !t->IsWaiting())
+			return true;
+
+		return (t->AnimFinished(type, piece, axis));
+	};
+
+	animWaitThreadIDs.erase(std::remove_if(animWaitThreadIDs.begin(), animWaitThreadIDs.end(), pred), animWaitThreadIDs.end());
 }
 
 
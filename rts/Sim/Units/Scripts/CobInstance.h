@@ -48,6 +48,8 @@ public:
 
 	std::vector<int> staticVars;
 	std::vector<int> threadIDs;
+	// subset of threadIDs blocked in WAIT_TURN or WAIT_MOVE, in blocking order
+	std::vector<int> animWaitThreadIDs;
 
 public:
 	// creg only
@@ -59,6 +61,7 @@ public:
 	void PostLoad();
 
 	void AddThreadID(int threadID) { threadIDs.push_back(threadID); }
+	void AddAnimWaitThreadID(int threadID) { animWaitThreadIDs.push_back(threadID); }
 	bool RemoveThreadID(int threadID)
 	{
 		const auto it = std::find(threadIDs.begin(), threadIDs.end(), threadID);
@@ -67,6 +70,12 @@ public:
 			return false;
 
 		threadIDs.erase(it);
+
+		const auto jt = std::find(animWaitThreadIDs.begin(), animWaitThreadIDs.end(), threadID);
+
+		if (jt != animWaitThreadIDs.end())
+			animWaitThreadIDs.erase(jt);
+
 		return true;
 	}
 
@@ -0,0 +1,112 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef COB_OPCODES_H
+#define COB_OPCODES_H
+
+namespace CobOpcodes {
+
+// Command documentation from http://visualta.tauniverse.com/Downloads/cob-commands.txt
+// And some information from basm0.8 source (basm ops.txt)
+
+// Model interaction
+constexpr int MOVE       = 0x10001000;
+constexpr int TURN       = 0x10002000;
+constexpr int SPIN       = 0x10003000;
+constexpr int STOP_SPIN  = 0x10004000;
+constexpr int SHOW       = 0x10005000;
+constexpr int HIDE       = 0x10006000;
+constexpr int CACHE      = 0x10007000;
+constexpr int DONT_CACHE = 0x10008000;
+constexpr int MOVE_NOW   = 0x1000B000;
+constexpr int TURN_NOW   = 0x1000C000;
+constexpr int SHADE      = 0x1000D000;
+constexpr int DONT_SHADE = 0x1000E000;
+constexpr int EMIT_SFX   = 0x1000F000;
+
+// Blocking operations
+constexpr int WAIT_TURN  = 0x10011000;
+constexpr int WAIT_MOVE  = 0x10012000;
+constexpr int SLEEP      = 0x10013000;
+
+// Stack manipulation
+constexpr int PUSH_CONSTANT    = 0x10021001;
+constexpr int PUSH_LOCAL_VAR   = 0x10021002;
+constexpr int PUSH_STATIC      = 0x10021004;
+constexpr int CREATE_LOCAL_VAR = 0x10022000;
+constexpr int POP_LOCAL_VAR    = 0x10023002;
+constexpr int POP_STATIC       = 0x10023004;
+constexpr int POP_STACK        = 0x10024000; ///< Not sure what this is supposed to do
+
+// Arithmetic operations
+constexpr int ADD         = 0x10031000;
+constexpr int SUB         = 0x10032000;
+constexpr int MUL         = 0x10033000;
+constexpr int DIV         = 0x10034000;
+constexpr int MOD		  = 0x10034001; ///< spring specific
+constexpr int BITWISE_AND = 0x10035000;
+constexpr int BITWISE_OR  = 0x10036000;
+constexpr int BITWISE_XOR = 0x10037000;
+constexpr int BITWISE_NOT = 0x10038000;
+
+// Native function calls
+constexpr int RAND           = 0x10041000;
+constexpr int GET_UNIT_VALUE = 0x10042000;
+constexpr int GET            = 0x10043000;
+
+// Comparison
+constexpr int SET_LESS             = 0x10051000;
+constexpr int SET_LESS_OR_EQUAL    = 0x10052000;
+constexpr int SET_GREATER          = 0x10053000;
+constexpr int SET_GREATER_OR_EQUAL = 0x10054000;
+constexpr int SET_EQUAL            = 0x10055000;
+constexpr int SET_NOT_EQUAL        = 0x10056000;
+constexpr int LOGICAL_AND          = 0x10057000;
+constexpr int LOGICAL_OR           = 0x10058000;
+constexpr int LOGICAL_XOR          = 0x10059000;
+constexpr int LOGICAL_NOT          = 0x1005A000;
+
+// Flow control
+constexpr int START           = 0x10061000;
+constexpr int CALL            = 0x10062000; ///< converted when executed
+constexpr int REAL_CALL       = 0x10062001; ///< spring custom
+constexpr int LUA_CALL        = 0x10062002; ///< spring custom
+constexpr int JUMP            = 0x10064000;
+constexpr int RETURN          = 0x10065000;
+constexpr int JUMP_NOT_EQUAL  = 0x10066000;
+constexpr int SIGNAL          = 0x10067000;
+constexpr int SET_SIGNAL_MASK = 0x10068000;
+
+// Piece destruction
+constexpr int EXPLODE    = 0x10071000;
+constexpr int PLAY_SOUND = 0x10072000;
+
+// Special functions
+constexpr int SET    = 0x10082000;
+constexpr int ATTACH = 0x10083000;
+constexpr int DROP   = 0x10084000;
+
+
+// operations of the pre-decoded instruction stream (see CCobFile::Decode);
+// one per opcode except CALL, which is resolved into REAL_CALL or LUA_CALL
+#define COB_DECODED_OPS(OP) \
+	OP(MOVE) OP(TURN) OP(SPIN) OP(STOP_SPIN) OP(SHOW) OP(HIDE) OP(MOVE_NOW) OP(TURN_NOW) OP(EMIT_SFX) \
+	OP(WAIT_TURN) OP(WAIT_MOVE) OP(SLEEP) \
+	OP(PUSH_CONSTANT) OP(PUSH_LOCAL_VAR) OP(PUSH_STATIC) OP(CREATE_LOCAL_VAR) OP(POP_LOCAL_VAR) OP(POP_STATIC) OP(POP_STACK) \
+	OP(ADD) OP(SUB) OP(MUL) OP(DIV) OP(MOD) OP(BITWISE_AND) OP(BITWISE_OR) OP(BITWISE_XOR) OP(BITWISE_NOT) \
+	OP(RAND) OP(GET_UNIT_VALUE) OP(GET) \
+	OP(SET_LESS) OP(SET_LESS_OR_EQUAL) OP(SET_GREATER) OP(SET_GREATER_OR_EQUAL) OP(SET_EQUAL) OP(SET_NOT_EQUAL) \
+	OP(LOGICAL_AND) OP(LOGICAL_OR) OP(LOGICAL_XOR) OP(LOGICAL_NOT) \
+	OP(START) OP(REAL_CALL) OP(LUA_CALL) OP(JUMP) OP(RETURN) OP(JUMP_NOT_EQUAL) OP(SIGNAL) OP(SET_SIGNAL_MASK) \
+	OP(EXPLODE) OP(PLAY_SOUND) OP(SET) OP(ATTACH) OP(DROP) \
+	OP(NOP) OP(UNKNOWN)
+
+#define COB_DECODED_OP_ENUM(name) OP_##name,
+enum DecodedOp {
+	COB_DECODED_OPS(COB_DECODED_OP_ENUM)
+	NUM_DECODED_OPS
+};
+#undef COB_DECODED_OP_ENUM
+
+}
+
+#endif // COB_OPCODES_H
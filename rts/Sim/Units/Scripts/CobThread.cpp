@@ -5,9 +5,19 @@
 #include "CobFile.h"
 #include "CobInstance.h"
 #include "CobEngine.h"
+#include "CobOpcodes.h"
 #include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/GlobalSynced.h"
 
+using namespace CobOpcodes;
+
+// computed-goto dispatch for the decoded instruction stream
+#if defined(__GNUC__)
+	#define COB_THREADED_DISPATCH 1
+#else
+	#define COB_THREADED_DISPATCH 0
+#endif
+
 CR_BIND(CCobThread, )
 
 CR_REG_METADATA(CCobThread, (
@@ -198,86 +208,6 @@ void CCobThread::InitStack(unsigned int n, CCobThread* t)
 
 
 
-// Command documentation from http://visualta.tauniverse.com/Downloads/cob-commands.txt
-// And some information from basm0.8 source (basm ops.txt)
-
-// Model interaction
-constexpr int MOVE       = 0x10001000;
-constexpr int TURN       = 0x10002000;
-constexpr int SPIN       = 0x10003000;
-constexpr int STOP_SPIN  = 0x10004000;
-constexpr int SHOW       = 0x10005000;
-constexpr int HIDE       = 0x10006000;
-constexpr int CACHE      = 0x10007000;
-constexpr int DONT_CACHE = 0x10008000;
-constexpr int MOVE_NOW   = 0x1000B000;
-constexpr int TURN_NOW   = 0x1000C000;
-constexpr int SHADE      = 0x1000D000;
-constexpr int DONT_SHADE = 0x1000E000;
-constexpr int EMIT_SFX   = 0x1000F000;
-
-// Blocking operations
-constexpr int WAIT_TURN  = 0x10011000;
-constexpr int WAIT_MOVE  = 0x10012000;
-constexpr int SLEEP      = 0x10013000;
-
-// Stack manipulation
-constexpr int PUSH_CONSTANT    = 0x10021001;
-constexpr int PUSH_LOCAL_VAR   = 0x10021002;
-constexpr int PUSH_STATIC      = 0x10021004;
-constexpr int CREATE_LOCAL_VAR = 0x10022000;
-constexpr int POP_LOCAL_VAR    = 0x10023002;
-constexpr int POP_STATIC       = 0x10023004;
-constexpr int POP_STACK        = 0x10024000; ///< Not sure what this is supposed to do
-
-// Arithmetic operations
-constexpr int ADD         = 0x10031000;
-constexpr int SUB         = 0x10032000;
-constexpr int MUL         = 0x10033000;
-constexpr int DIV         = 0x10034000;
-constexpr int MOD		  = 0x10034001; ///< spring specific
-constexpr int BITWISE_AND = 0x10035000;
-constexpr int BITWISE_OR  = 0x10036000;
-constexpr int BITWISE_XOR = 0x10037000;
-constexpr int BITWISE_NOT = 0x10038000;
-
-// Native function calls
-constexpr int RAND           = 0x10041000;
-constexpr int GET_UNIT_VALUE = 0x10042000;
-constexpr int GET            = 0x10043000;
-
-// Comparison
-constexpr int SET_LESS             = 0x10051000;
-constexpr int SET_LESS_OR_EQUAL    = 0x10052000;
-constexpr int SET_GREATER          = 0x10053000;
-constexpr int SET_GREATER_OR_EQUAL = 0x10054000;
-constexpr int SET_EQUAL            = 0x10055000;
-constexpr int SET_NOT_EQUAL        = 0x10056000;
-constexpr int LOGICAL_AND          = 0x10057000;
-constexpr int LOGICAL_OR           = 0x10058000;
-constexpr int LOGICAL_XOR          = 0x10059000;
-constexpr int LOGICAL_NOT          = 0x1005A000;
-
-// Flow control
-constexpr int START           = 0x10061000;
-constexpr int CALL            = 0x10062000; ///< converted when executed
-constexpr int REAL_CALL       = 0x10062001; ///< spring custom
-constexpr int LUA_CALL        = 0x10062002; ///< spring custom
-constexpr int JUMP            = 0x10064000;
-constexpr int RETURN          = 0x10065000;
-constexpr int JUMP_NOT_EQUAL  = 0x10066000;
-constexpr int SIGNAL          = 0x10067000;
-constexpr int SET_SIGNAL_MASK = 0x10068000;
-
-// Piece destruction
-constexpr int EXPLODE    = 0x10071000;
-constexpr int PLAY_SOUND = 0x10072000;
-
-// Special functions
-constexpr int SET    = 0x10082000;
-constexpr int ATTACH = 0x10083000;
-constexpr int DROP   = 0x10084000;
-
 // Indices for SET, GET, and GET_UNIT_VALUE for LUA return values
 #define LUA0 110 // (LUA0 returns the lua call status, 0 or 1)
 #define LUA1 111
@@ -386,6 +316,14 @@ bool CCobThread::Tick()
 
 	state = Run;
 
+	if (cobEngine->UseDecodedScripts() && cobFile->IsDecoded(pc))
+		return TickDecoded();
+
+	return TickInterpreted();
+}
+
+bool CCobThread::TickInterpreted()
+{
 	int r1, r2, r3, r4, r5, r6;
 
 	while (state == Run) {
@@ -456,7 +394,10 @@ bool CCobThread::Tick()
 
 				if (cobFile->scriptNames[r1].find("lua_") == 0) {
 					cobFile->code[pc - 1] = LUA_CALL;
-					LuaCall();
+
+					r1 = GET_LONG_PC();
+					r2 = GET_LONG_PC();
+					LuaCall(r1, r2);
 					break;
 				}
 
@@ -483,7 +424,9 @@ bool CCobThread::Tick()
 				pc = cobFile->scriptOffsets[r1];
 			} break;
 			case LUA_CALL: {
-				LuaCall();
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				LuaCall(r1, r2);
 			} break;
 
 
@@ -756,6 +699,7 @@ bool CCobThread::Tick()
 					state = WaitTurn;
 					waitPiece = r1;
 					waitAxis = r2;
+					cobInst->AddAnimWaitThreadID(id);
 					return true;
 				}
 			} break;
@@ -767,6 +711,7 @@ bool CCobThread::Tick()
 					state = WaitMove;
 					waitPiece = r1;
 					waitAxis = r2;
+					cobInst->AddAnimWaitThreadID(id);
 					return true;
 				}
 			} break;
@@ -863,6 +808,495 @@ bool CCobThread::Tick()
 	return (state != Dead);
 }
 
+
+// runs the pre-decoded form of the same opcodes as TickInterpreted; pc is
+// only brought up to date when leaving or before calling out (it is read
+// by ShowError and saved with the thread)
+bool CCobThread::TickDecoded()
+{
+	const CCobFile::Instruction* instrs = cobFile->instructions.data();
+	const CCobFile::Instruction* instr = nullptr;
+
+	int ip = cobFile->codeInstructions[pc];
+	int r1, r2, r3, r4, r5, r6;
+
+	#define SYNC_PC() (pc = instrs[ip].pc)
+
+	#if (COB_THREADED_DISPATCH == 1)
+	#define COB_OP_LABEL(name) &&op_##name,
+	static const void* dispatchTable[] = {COB_DECODED_OPS(COB_OP_LABEL)};
+	#undef COB_OP_LABEL
+
+	static_assert((sizeof(dispatchTable) / sizeof(dispatchTable[0])) == NUM_DECODED_OPS, "");
+
+	#define COB_CASE(name) op_##name
+	#define COB_NEXT() do { if (state != Run) goto done; instr = &instrs[ip++]; goto *dispatchTable[instr->op]; } while (false)
+
+	COB_NEXT();
+	{
+	#else
+	#define COB_CASE(name) case OP_##name
+	#define COB_NEXT() continue
+
+	while (state == Run) {
+		instr = &instrs[ip++];
+
+		switch (instr->op) {
+	#endif
+
+			COB_CASE(PUSH_CONSTANT): {
+				PushDataStack(instr->args[0]);
+			} COB_NEXT();
+			COB_CASE(SLEEP): {
+				r1 = PopDataStack();
+				wakeTime = cobEngine->GetCurrentTime() + r1;
+				state = Sleep;
+
+				SYNC_PC();
+				cobEngine->ScheduleThread(this);
+				return true;
+			}
+			COB_CASE(SPIN): {
+				r3 = PopDataStack();         // speed
+				r4 = PopDataStack();         // accel
+
+				SYNC_PC();
+				cobInst->Spin(instr->args[0], instr->args[1], r3, r4);
+			} COB_NEXT();
+			COB_CASE(STOP_SPIN): {
+				r3 = PopDataStack();         // decel
+
+				SYNC_PC();
+				cobInst->StopSpin(instr->args[0], instr->args[1], r3);
+			} COB_NEXT();
+			COB_CASE(RETURN): {
+				retCode = PopDataStack();
+
+				if (LocalReturnAddr() == -1) {
+					state = Dead;
+
+					SYNC_PC();
+					return false;
+				}
+
+				// return to caller
+				pc = LocalReturnAddr();
+				dataStackSize = std::min(dataStackSize, LocalStackFrame());
+				callStackSize -= 1;
+
+				// only reachable by a caller that was interpreted
+				if (!cobFile->IsDecoded(pc))
+					return TickInterpreted();
+
+				ip = cobFile->codeInstructions[pc];
+			} COB_NEXT();
+
+
+			COB_CASE(NOP): {
+			} COB_NEXT();
+
+
+			COB_CASE(REAL_CALL): {
+				r1 = instr->args[0];
+				r2 = instr->args[1];
+
+				CallInfo& ci = PushCallStackRef();
+				ci.functionId = r1;
+				ci.returnAddr = instrs[ip].pc;
+				ci.stackTop = dataStackSize - r2;
+
+				paramCount = r2;
+
+				ip = cobFile->scriptInstructions[r1];
+			} COB_NEXT();
+			COB_CASE(LUA_CALL): {
+				SYNC_PC();
+				LuaCall(instr->args[0], instr->args[1]);
+			} COB_NEXT();
+
+
+			COB_CASE(POP_STATIC): {
+				r1 = instr->args[0];
+				r2 = PopDataStack();
+
+				if (static_cast<size_t>(r1) < cobInst->staticVars.size())
+					cobInst->staticVars[r1] = r2;
+			} COB_NEXT();
+			COB_CASE(POP_STACK): {
+				PopDataStack();
+			} COB_NEXT();
+
+
+			COB_CASE(START): {
+				SYNC_PC();
+
+				CCobThread t(cobInst);
+
+				t.SetID(cobEngine->GenThreadID());
+				t.InitStack(instr->args[1], this);
+				t.Start(instr->args[0], signalMask, {{0}}, true);
+
+				// calling AddThread directly might move <this>, defer it
+				cobEngine->QueueAddThread(std::move(t));
+			} COB_NEXT();
+
+			COB_CASE(CREATE_LOCAL_VAR): {
+				if (paramCount == 0) {
+					PushDataStack(0);
+				} else {
+					paramCount--;
+				}
+			} COB_NEXT();
+			COB_CASE(GET_UNIT_VALUE): {
+				r1 = PopDataStack();
+
+				if ((r1 >= LUA0) && (r1 <= LUA9)) {
+					PushDataStack(luaArgs[r1 - LUA0]);
+					COB_NEXT();
+				}
+
+				SYNC_PC();
+				PushDataStack(cobInst->GetUnitVal(r1, 0, 0, 0, 0));
+			} COB_NEXT();
+
+
+			COB_CASE(JUMP_NOT_EQUAL): {
+				if (PopDataStack() == 0)
+					ip = instr->args[0];
+			} COB_NEXT();
+			COB_CASE(JUMP): {
+				ip = instr->args[0];
+			} COB_NEXT();
+
+
+			COB_CASE(POP_LOCAL_VAR): {
+				r2 = PopDataStack();
+				dataStack[LocalStackFrame() + instr->args[0]] = r2;
+			} COB_NEXT();
+			COB_CASE(PUSH_LOCAL_VAR): {
+				r2 = dataStack[LocalStackFrame() + instr->args[0]];
+				PushDataStack(r2);
+			} COB_NEXT();
+
+
+			COB_CASE(BITWISE_AND): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(r1 & r2);
+			} COB_NEXT();
+			COB_CASE(BITWISE_OR): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(r1 | r2);
+			} COB_NEXT();
+			COB_CASE(BITWISE_XOR): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(r1 ^ r2);
+			} COB_NEXT();
+			COB_CASE(BITWISE_NOT): {
+				r1 = PopDataStack();
+				PushDataStack(~r1);
+			} COB_NEXT();
+
+			COB_CASE(EXPLODE): {
+				r2 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->Explode(instr->args[0], r2);
+			} COB_NEXT();
+
+			COB_CASE(PLAY_SOUND): {
+				r2 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->PlayUnitSound(instr->args[0], r2);
+			} COB_NEXT();
+
+			COB_CASE(PUSH_STATIC): {
+				r1 = instr->args[0];
+
+				if (static_cast<size_t>(r1) < cobInst->staticVars.size())
+					PushDataStack(cobInst->staticVars[r1]);
+			} COB_NEXT();
+
+			COB_CASE(SET_NOT_EQUAL): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+
+				PushDataStack(int(r1 != r2));
+			} COB_NEXT();
+			COB_CASE(SET_EQUAL): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+
+				PushDataStack(int(r1 == r2));
+			} COB_NEXT();
+
+			COB_CASE(SET_LESS): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				PushDataStack(int(r1 < r2));
+			} COB_NEXT();
+			COB_CASE(SET_LESS_OR_EQUAL): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				PushDataStack(int(r1 <= r2));
+			} COB_NEXT();
+
+			COB_CASE(SET_GREATER): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				PushDataStack(int(r1 > r2));
+			} COB_NEXT();
+			COB_CASE(SET_GREATER_OR_EQUAL): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				PushDataStack(int(r1 >= r2));
+			} COB_NEXT();
+
+			COB_CASE(RAND): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+				r3 = gsRNG.NextInt(r2 - r1 + 1) + r1;
+				PushDataStack(r3);
+			} COB_NEXT();
+			COB_CASE(EMIT_SFX): {
+				r1 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->EmitSfx(r1, instr->args[0]);
+			} COB_NEXT();
+			COB_CASE(MUL): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(r1 * r2);
+			} COB_NEXT();
+
+
+			COB_CASE(SIGNAL): {
+				r1 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->Signal(r1);
+			} COB_NEXT();
+			COB_CASE(SET_SIGNAL_MASK): {
+				signalMask = PopDataStack();
+			} COB_NEXT();
+
+
+			COB_CASE(TURN): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->Turn(instr->args[0], instr->args[1], r1, r2);
+			} COB_NEXT();
+			COB_CASE(GET): {
+				r5 = PopDataStack();
+				r4 = PopDataStack();
+				r3 = PopDataStack();
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				if ((r1 >= LUA0) && (r1 <= LUA9)) {
+					PushDataStack(luaArgs[r1 - LUA0]);
+					COB_NEXT();
+				}
+
+				SYNC_PC();
+				r6 = cobInst->GetUnitVal(r1, r2, r3, r4, r5);
+				PushDataStack(r6);
+			} COB_NEXT();
+			COB_CASE(ADD): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+				PushDataStack(r1 + r2);
+			} COB_NEXT();
+			COB_CASE(SUB): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+				PushDataStack(r1 - r2);
+			} COB_NEXT();
+
+			COB_CASE(DIV): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				if (r2 != 0) {
+					r3 = r1 / r2;
+				} else {
+					r3 = 1000; // infinity!
+					SYNC_PC();
+					ShowError("division by zero");
+				}
+				PushDataStack(r3);
+			} COB_NEXT();
+			COB_CASE(MOD): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				if (r2 != 0) {
+					PushDataStack(r1 % r2);
+				} else {
+					PushDataStack(0);
+					SYNC_PC();
+					ShowError("modulo division by zero");
+				}
+			} COB_NEXT();
+
+
+			COB_CASE(MOVE): {
+				r4 = PopDataStack();
+				r3 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->Move(instr->args[0], instr->args[1], r3, r4);
+			} COB_NEXT();
+			COB_CASE(MOVE_NOW): {
+				r3 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->MoveNow(instr->args[0], instr->args[1], r3);
+			} COB_NEXT();
+			COB_CASE(TURN_NOW): {
+				r3 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->TurnNow(instr->args[0], instr->args[1], r3);
+			} COB_NEXT();
+
+
+			COB_CASE(WAIT_TURN): {
+				r1 = instr->args[0];
+				r2 = instr->args[1];
+
+				SYNC_PC();
+
+				if (cobInst->NeedsWait(CCobInstance::ATurn, r1, r2)) {
+					state = WaitTurn;
+					waitPiece = r1;
+					waitAxis = r2;
+					cobInst->AddAnimWaitThreadID(id);
+					return true;
+				}
+			} COB_NEXT();
+			COB_CASE(WAIT_MOVE): {
+				r1 = instr->args[0];
+				r2 = instr->args[1];
+
+				SYNC_PC();
+
+				if (cobInst->NeedsWait(CCobInstance::AMove, r1, r2)) {
+					state = WaitMove;
+					waitPiece = r1;
+					waitAxis = r2;
+					cobInst->AddAnimWaitThreadID(id);
+					return true;
+				}
+			} COB_NEXT();
+
+
+			COB_CASE(SET): {
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				if ((r1 >= LUA0) && (r1 <= LUA9)) {
+					luaArgs[r1 - LUA0] = r2;
+					COB_NEXT();
+				}
+
+				SYNC_PC();
+				cobInst->SetUnitVal(r1, r2);
+			} COB_NEXT();
+
+
+			COB_CASE(ATTACH): {
+				r3 = PopDataStack();
+				r2 = PopDataStack();
+				r1 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->AttachUnit(r2, r1);
+			} COB_NEXT();
+			COB_CASE(DROP): {
+				r1 = PopDataStack();
+
+				SYNC_PC();
+				cobInst->DropUnit(r1);
+			} COB_NEXT();
+
+			// like bitwise ops, but only on values 1 and 0
+			COB_CASE(LOGICAL_NOT): {
+				r1 = PopDataStack();
+				PushDataStack(int(r1 == 0));
+			} COB_NEXT();
+			COB_CASE(LOGICAL_AND): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(int(r1 && r2));
+			} COB_NEXT();
+			COB_CASE(LOGICAL_OR): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(int(r1 || r2));
+			} COB_NEXT();
+			COB_CASE(LOGICAL_XOR): {
+				r1 = PopDataStack();
+				r2 = PopDataStack();
+				PushDataStack(int((!!r1) ^ (!!r2)));
+			} COB_NEXT();
+
+
+			COB_CASE(HIDE): {
+				SYNC_PC();
+				cobInst->SetVisibility(instr->args[0], false);
+			} COB_NEXT();
+
+			COB_CASE(SHOW): {
+				SYNC_PC();
+
+				// if true, we are in a Fire-script and should show a special flare effect
+				if (cobFile->fireScripts[LocalFunctionID()]) {
+					cobInst->ShowFlare(instr->args[0]);
+				} else {
+					cobInst->SetVisibility(instr->args[0], true);
+				}
+			} COB_NEXT();
+
+			COB_CASE(UNKNOWN): {
+				const char* name = cobFile->name.c_str();
+				const char* func = cobFile->scriptNames[LocalFunctionID()].c_str();
+
+				LOG_L(L_ERROR, "[COBThread::%s] unknown opcode %x (in %s:%s at %x)", __func__, instr->args[0], name, func, instr->pc);
+
+				pc = instr->pc + 1;
+				state = Dead;
+				return false;
+			}
+	#if (COB_THREADED_DISPATCH == 1)
+	}
+
+done:
+	#else
+		}
+	}
+	#endif
+
+	SYNC_PC();
+
+	#undef COB_NEXT
+	#undef COB_CASE
+	#undef SYNC_PC
+
+	// can arrive here as dead, through CCobInstance::Signal()
+	return (state != Dead);
+}
+
 void CCobThread::ShowError(const char* msg)
 {
 	if ((errorCounter = std::max(errorCounter - 1, 0)) == 0)
@@ -880,10 +1314,9 @@ void CCobThread::ShowError(const char* msg)
 }
 
 
-void CCobThread::LuaCall()
+void CCobThread::LuaCall(int r1, int r2)
 {
-	const int r1 = GET_LONG_PC(); // script id
-	const int r2 = GET_LONG_PC(); // arg count
+	// r1 is the script id, r2 the arg count
 
 	// setup the parameter array
 	const int size = dataStackSize;
@@ -918,18 +1351,19 @@ void CCobThread::LuaCall()
 }
 
 
-void CCobThread::AnimFinished(CUnitScript::AnimType type, int piece, int axis)
+bool CCobThread::AnimFinished(CUnitScript::AnimType type, int piece, int axis)
 {
 	if (piece != waitPiece || axis != waitAxis)
-		return;
+		return false;
 
 	if (!Reschedule(type))
-		return;
+		return false;
 
 	state = Run;
 	waitPiece = -1;
 	waitAxis = -1;
 
 	cobEngine->ScheduleThread(this);
+	return true;
 }
 
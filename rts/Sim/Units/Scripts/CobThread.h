@@ -74,7 +74,8 @@ public:
 	 * interpreter.
 	 */
 	void ShowError(const char* msg);
-	void AnimFinished(CUnitScript::AnimType type, int piece, int axis);
+	/// @return true if the thread was waiting on this animation and got rescheduled
+	bool AnimFinished(CUnitScript::AnimType type, int piece, int axis);
 
 	const std::string& GetName();
 
@@ -105,7 +106,10 @@ protected:
 		int stackTop = -1;
 	};
 
-	void LuaCall();
+	bool TickInterpreted();
+	bool TickDecoded();
+
+	void LuaCall(int scriptID, int numArgs);
 
 	bool PushCallStack(CallInfo v) { return (callStackSize < callStack.size() && PushCallStackRaw(v)); }
 	bool PushDataStack(     int v) { return (dataStackSize < dataStack.size() && PushDataStackRaw(v)); }
@@ -860,17 +860,25 @@ void CUnit::SetLosStatus(int at, unsigned short newStatus)
 
 
 unsigned short CUnit::CalcLosStatus(int at) const
+{
+	const bool inLos = losHandler->InLos(this, at);
+	const bool inRadar = !inLos && losHandler->InRadar(this, at);
+
+	return (CalcLosStatus(at, inLos, inRadar));
+}
+
+unsigned short CUnit::CalcLosStatus(int at, bool inLos, bool inRadar) const
 {
 	const unsigned short currStatus = losStatus[at];
 
 	unsigned short newStatus = currStatus;
 	unsigned short mask = ~(currStatus >> LOS_MASK_SHIFT);
 
-	if (losHandler->InLos(this, at)) {
+	if (inLos) {
 		newStatus |= (mask & (LOS_INLOS   | LOS_INRADAR |
 		                      LOS_PREVLOS | LOS_CONTRADAR));
 	}
-	else if (losHandler->InRadar(this, at)) {
+	else if (inRadar) {
 		newStatus |=  (mask & LOS_INRADAR);
 		newStatus &= ~(mask & LOS_INLOS);
 	}
@@ -174,6 +174,8 @@ public:
 	void SetLosStatus(int allyTeam, unsigned short newStatus);
 	void UpdateLosStatus(int allyTeam);
 	unsigned short CalcLosStatus(int allyTeam) const;
+	/// variant for pre-sampled LOS- and radar-coverage (see CUnitHandler::UpdateUnitLosStates)
+	unsigned short CalcLosStatus(int allyTeam, bool inLos, bool inRadar) const;
 
 	void UpdateWeapons();
 
@@ -5,23 +5,36 @@
 #include "UnitHandler.h"
 #include "Unit.h"
 #include "UnitDefHandler.h"
+#include "UnitLoader.h"
 #include "UnitMemPool.h"
 #include "UnitTypes/Builder.h"
 #include "UnitTypes/ExtractorBuilding.h"
 #include "UnitTypes/Factory.h"
 
 #include "CommandAI/BuilderCAI.h"
+#include "Map/Ground.h"
+#include "Map/ReadMap.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/LosHandler.h"
+#include "Sim/Misc/ModInfo.h"
+#include "Sim/Misc/QuadField.h"
 #include "Sim/Misc/TeamHandler.h"
-#include "Sim/MoveTypes/MoveType.h"
+#include "Sim/MoveTypes/GroundMoveType.h"
 #include "Sim/Weapons/Weapon.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/EventHandler.h"
+#include "System/FastMath.h"
 #include "System/Log/ILog.h"
+#include "System/MemoryStats.h"
 #include "System/SpringMath.h"
 #include "System/TimeProfiler.h"
+#include "System/Threading/ThreadPool.h" // for_mt
 #include "System/creg/STL_Deque.h"
 #include "System/creg/STL_Set.h"
 
+CONFIG(bool, UpdateMoveTypesMT).defaultValue(true).description("Run the parallel passes of the split unit movement update (modrule movement.parallelUnitMovement) on worker threads; results do not depend on this.");
+CONFIG(bool, CheckMoveTypesMT).defaultValue(false).description("Run the parallel passes of the split unit movement update both in parallel and serially and log every unit whose results differ (for headless validation runs).");
+
 
 CR_BIND(CUnitHandler, )
 CR_REG_METADATA(CUnitHandler, (
@@ -40,7 +53,12 @@ CR_REG_METADATA(CUnitHandler, (
 	CR_MEMBER(maxUnits),
 	CR_MEMBER(maxUnitRadius),
 
-	CR_MEMBER(inUpdateCall)
+	CR_MEMBER(inUpdateCall),
+
+	CR_IGNORED(updateMoveTypesMT),
+	CR_IGNORED(checkMoveTypesMT),
+
+	CR_IGNORED(unitLosVisBits)
 ))
 
 
@@ -98,6 +116,10 @@ void CUnitHandler::Init() {
 		activeSlowUpdateUnit = 0;
 		activeUpdateUnit = 0;
 	}
+	{
+		updateMoveTypesMT = configHandler->GetBool("UpdateMoveTypesMT");
+		checkMoveTypesMT = configHandler->GetBool("CheckMoveTypesMT");
+	}
 	{
 		units.resize(maxUnits, nullptr);
 		activeUnits.reserve(maxUnits);
@@ -113,11 +135,15 @@ void CUnitHandler::Init() {
 			unitsByDefs[teamNum].resize(unitDefHandler->NumUnitDefs() + 1);
 		}
 	}
+
+	memoryStats.AddSubsystem("Sim/Units", [](CMemoryStats::Sample& s) { CMemoryStats::SamplePool(unitMemPool, s); });
 }
 
 
 void CUnitHandler::Kill()
 {
+	memoryStats.RemoveSubsystem("Sim/Units");
+
 	for (CUnit* u: activeUnits) {
 		// ~CUnit dereferences featureHandler which is destroyed already
 		u->KilledScriptFinished(-1);
@@ -297,22 +323,64 @@ void CUnitHandler::DeleteUnit(CUnit* delUnit)
 }
 
 
-void CUnitHandler::UpdateUnitMoveTypes()
+unsigned int CUnitHandler::UpdateUnitMoveTypes()
 {
 	SCOPED_TIMER("Sim::Unit::MoveType");
 
+	if (modInfo.parallelUnitMovement) {
+		UpdateUnitMoveTypesMT();
+	} else {
+		for (activeUpdateUnit = 0; activeUpdateUnit < activeUnits.size(); ++activeUpdateUnit) {
+			CUnit* unit = activeUnits[activeUpdateUnit];
+			AMoveType* moveType = unit->moveType;
+
+			unit->SanityCheck();
+			unit->PreUpdate();
+
+			if (moveType->Update())
+				eventHandler.UnitMoved(unit);
+
+			// this unit is not coming back, kill it now without any death
+			// sequence (s.t. deathScriptFinished becomes true immediately)
+			if (!unit->pos.IsInBounds() && (unit->speed.w > MAX_UNIT_SPEED))
+				unit->ForcedKillUnit(nullptr, false, true, false);
+
+			unit->SanityCheck();
+			assert(activeUnits[activeUpdateUnit] == unit);
+		}
+	}
+
+	if (!modInfo.batchUnitCollisions)
+		return 0;
+
+	// unit-unit collisions deferred by the ground movetypes above
+	return (CGroundMoveType::HandleBatchedUnitCollisions());
+}
+
+void CUnitHandler::UpdateUnitMoveTypesMT()
+{
+	// path-following bookkeeping (waypoints, path requests, Arrived) is
+	// done serially since it can call into scripts, Lua and the PFS
 	for (activeUpdateUnit = 0; activeUpdateUnit < activeUnits.size(); ++activeUpdateUnit) {
 		CUnit* unit = activeUnits[activeUpdateUnit];
-		AMoveType* moveType = unit->moveType;
 
 		unit->SanityCheck();
 		unit->PreUpdate();
+		unit->moveType->PrepareUpdateMT();
+	}
 
-		if (moveType->Update())
+	{
+		SCOPED_TIMER("Sim::Unit::MoveType::MT");
+		CGroundMoveType::UpdateQueuedMT(updateMoveTypesMT, checkMoveTypesMT);
+	}
+
+	// apply the new headings and speeds, then move and collide in unit order
+	for (activeUpdateUnit = 0; activeUpdateUnit < activeUnits.size(); ++activeUpdateUnit) {
+		CUnit* unit = activeUnits[activeUpdateUnit];
+
+		if (unit->moveType->CommitUpdateMT())
 			eventHandler.UnitMoved(unit);
 
-		// this unit is not coming back, kill it now without any death
-		// sequence (s.t. deathScriptFinished becomes true immediately)
 		if (!unit->pos.IsInBounds() && (unit->speed.w > MAX_UNIT_SPEED))
 			unit->ForcedKillUnit(nullptr, false, true, false);
 
@@ -321,11 +389,167 @@ void CUnitHandler::UpdateUnitMoveTypes()
 	}
 }
 
+
+void CUnitHandler::BenchmarkCollisions(const UnitDef* unitDef, int numUnits, int numFrames, int teamNum)
+{
+	// overlapping footprints, s.t. every unit starts out colliding with its neighbors
+	const float spacing = std::max(unitDef->xsize, unitDef->zsize) * SQUARE_SIZE * 0.5f;
+	const float3 center = {mapDims.mapx * SQUARE_SIZE * 0.5f, 0.0f, mapDims.mapy * SQUARE_SIZE * 0.5f};
+
+	const int gridSize = std::ceil(math::sqrt(float(numUnits)));
+
+	std::vector<CUnit*> benchUnits;
+	std::vector<float3> spawnPositions;
+
+	benchUnits.reserve(numUnits);
+	spawnPositions.reserve(numUnits);
+
+	for (int i = 0; i < numUnits && CanAddUnit(-1); i++) {
+		const float px = center.x + ((i % gridSize) - gridSize * 0.5f) * spacing;
+		const float pz = center.z + ((i / gridSize) - gridSize * 0.5f) * spacing;
+
+		const UnitLoadParams unitParams = {
+			unitDef,
+			nullptr,
+
+			float3(px, CGround::GetHeightReal(px, pz), pz),
+			ZeroVector,
+
+			-1,
+			teamNum,
+			FACING_SOUTH,
+
+			false,
+			false,
+		};
+
+		benchUnits.push_back(unitLoader->LoadUnit(unitParams));
+		spawnPositions.push_back(benchUnits.back()->pos);
+	}
+
+	const bool batchUnitCollisions = modInfo.batchUnitCollisions;
+
+	spring_time updateTimes[2];
+	unsigned int numCandidatePairs = 0;
+
+	// same start state for both runs; everything else (paths, speeds) is
+	// rebuilt by the move orders, so the runs are close but not identical
+	for (int i = 0; i < 2; i++) {
+		modInfo.batchUnitCollisions = (i == 1);
+
+		for (size_t j = 0; j < benchUnits.size(); j++) {
+			CUnit* u = benchUnits[j];
+
+			u->moveType->StopMoving(false, true);
+			u->Move(spawnPositions[j], false);
+			u->SetVelocityAndSpeed(ZeroVector);
+			u->moveType->StartMoving(center, 0.0f);
+
+			quadField.MovedUnit(u);
+		}
+
+		const spring_time t0 = spring_gettime();
+
+		// same as UpdateUnitMoveTypes, but only for the spawned units; the
+		// rest of the world is not updated and only takes part as collidees
+		for (int k = 0; k < numFrames; k++) {
+			for (CUnit* u: benchUnits) {
+				u->PreUpdate();
+
+				if (u->moveType->Update())
+					eventHandler.UnitMoved(u);
+			}
+
+			if (!modInfo.batchUnitCollisions)
+				continue;
+
+			numCandidatePairs += CGroundMoveType::HandleBatchedUnitCollisions();
+		}
+
+		updateTimes[i] = spring_gettime() - t0;
+	}
+
+	modInfo.batchUnitCollisions = batchUnitCollisions;
+
+	for (CUnit* u: benchUnits) {
+		u->ForcedKillUnit(nullptr, false, true, false);
+	}
+
+	LOG("[UnitHandler::%s] %u x \"%s\" (%u active units) for %d frames: per-unit collisions %.3fms, batched collisions %.3fms (%.1f candidate pairs per frame)",
+		__func__, unsigned(benchUnits.size()), unitDef->name.c_str(), unsigned(activeUnits.size()), numFrames,
+		updateTimes[0].toMilliSecsf(), updateTimes[1].toMilliSecsf(), numCandidatePairs / float(std::max(numFrames, 1))
+	);
+}
+
 void CUnitHandler::UpdateUnitLosStates()
 {
-	for (CUnit* unit: activeUnits) {
-		for (int at = 0; at < teamHandler.ActiveAllyTeams(); ++at) {
-			unit->UpdateLosStatus(at);
+	SCOPED_TIMER("Sim::Unit::LosStatus");
+
+	// two bits per allyteam: LOS_VIS_INLOS, LOS_VIS_INRADAR, or both if not sampled
+	constexpr uint64_t LOS_VIS_INLOS   = 1;
+	constexpr uint64_t LOS_VIS_INRADAR = 2;
+	constexpr uint64_t LOS_VIS_SKIPPED = LOS_VIS_INLOS | LOS_VIS_INRADAR;
+
+	const int numAllyTeams = teamHandler.ActiveAllyTeams();
+	const size_t numWords = (numAllyTeams * 2 + 63) / 64;
+	const size_t numUnits = activeUnits.size();
+
+	unitLosVisBits.clear();
+	unitLosVisBits.resize(numUnits * numWords, 0);
+
+	// read-only phase; samples the LOS and radar maps for every unit and
+	// allyteam into a packed bitset, masked states are not sampled
+	for_mt(0, numUnits, [&](const int i) {
+		const CUnit* unit = activeUnits[i];
+
+		uint64_t* visBits = &unitLosVisBits[i * numWords];
+
+		for (int at = 0; at < numAllyTeams; ++at) {
+			uint64_t vis = LOS_VIS_SKIPPED;
+
+			if ((unit->losStatus[at] & LOS_ALL_MASK_BITS) != LOS_ALL_MASK_BITS) {
+				const bool inLos = losHandler->InLos(unit, at);
+				const bool inRadar = !inLos && losHandler->InRadar(unit, at);
+
+				vis = (LOS_VIS_INLOS * inLos) | (LOS_VIS_INRADAR * inRadar);
+			}
+
+			visBits[(at * 2) / 64] |= (vis << ((at * 2) % 64));
+		}
+	});
+
+	// serial diff pass in the original (unit, allyteam) order; only changed
+	// states are applied, so only those fire Unit{Entered,Left}{Los,Radar}
+	// the status is derived from the current bits s.t. masks set by call-ins
+	// are respected, units added by call-ins are processed the regular way
+	for (size_t i = 0; i < activeUnits.size(); ++i) {
+		CUnit* unit = activeUnits[i];
+
+		for (int at = 0; at < numAllyTeams; ++at) {
+			const unsigned short currStatus = unit->losStatus[at];
+
+			if ((currStatus & LOS_ALL_MASK_BITS) == LOS_ALL_MASK_BITS)
+				continue;
+
+			if (i >= numUnits) {
+				unit->UpdateLosStatus(at);
+				continue;
+			}
+
+			const uint64_t vis = (unitLosVisBits[i * numWords + (at * 2) / 64] >> ((at * 2) % 64)) & LOS_VIS_SKIPPED;
+
+			if (vis == LOS_VIS_SKIPPED) {
+				// mask was cleared by a call-in after sampling
+				unit->UpdateLosStatus(at);
+				continue;
+			}
+
+			const unsigned short newStatus = unit->CalcLosStatus(at, (vis & LOS_VIS_INLOS) != 0, (vis & LOS_VIS_INRADAR) != 0);
+
+			if (newStatus == currStatus)
+				continue;
+
+			unit->SetLosStatus(at, newStatus);
 		}
 	}
 }
@@ -4,6 +4,7 @@
 #define UNITHANDLER_H
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
 #include "Sim/Misc/GlobalConstants.h"
@@ -29,6 +30,9 @@ public:
 	void Update();
 	bool AddUnit(CUnit* unit);
 
+	/// spawns a blob of ground units and logs the MoveType update time with and without batched unit collisions
+	void BenchmarkCollisions(const UnitDef* unitDef, int numUnits, int numFrames, int teamNum);
+
 	bool CanAddUnit(int id) const {
 		// do we want to be assigned a random ID and are any left in pool?
 		if (id < 0)
@@ -80,7 +84,8 @@ private:
 	void DeleteUnit(CUnit* unit);
 	void DeleteUnits();
 	void SlowUpdateUnits();
-	void UpdateUnitMoveTypes();
+	unsigned int UpdateUnitMoveTypes();
+	void UpdateUnitMoveTypesMT();
 	void UpdateUnitLosStates();
 	void UpdateUnits();
 	void UpdateUnitWeapons();
@@ -96,6 +101,10 @@ private:
 
 	spring::unordered_map<unsigned int, CBuilderCAI*> builderCAIs;
 
+	///< per active unit, LOS- and radar-coverage of each allyteam as sampled
+	///< in parallel by UpdateUnitLosStates (scratch, rebuilt every frame)
+	std::vector<uint64_t> unitLosVisBits;
+
 
 	size_t activeSlowUpdateUnit = 0;  ///< first unit of batch that will be SlowUpdate'd this frame
 	size_t activeUpdateUnit = 0;      ///< first unit of batch that will be SlowUpdate'd this frame
@@ -110,6 +119,10 @@ private:
 	float maxUnitRadius = 0.0f;
 
 	bool inUpdateCall = false;
+
+	///< UpdateMoveTypesMT and CheckMoveTypesMT config values
+	bool updateMoveTypesMT = true;
+	bool checkMoveTypesMT = false;
 };
 
 extern CUnitHandler unitHandler;
@@ -25,6 +25,7 @@
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
 #include "System/Log/ILog.h"
+#include "System/MemoryStats.h"
 
 #include <limits>
 
@@ -35,8 +36,18 @@ WeaponMemPool weaponMemPool;
 static_assert((sizeof(UnitDef::weapons) / sizeof(UnitDef::weapons[0])) == MAX_WEAPONS_PER_UNIT, "");
 static_assert(MAX_WEAPONS_PER_UNIT < std::numeric_limits<decltype(udWeaponCounts)::value_type>::max(), "");
 
-void CWeaponLoader::InitStatic() { udWeaponCounts.fill(MAX_WEAPONS_PER_UNIT + 1); weaponMemPool.reserve(128); }
-void CWeaponLoader::KillStatic() { udWeaponCounts.fill(MAX_WEAPONS_PER_UNIT + 1); weaponMemPool.clear(); }
+void CWeaponLoader::InitStatic() {
+	udWeaponCounts.fill(MAX_WEAPONS_PER_UNIT + 1);
+	weaponMemPool.reserve(128);
+
+	memoryStats.AddSubsystem("Sim/Weapons", [](CMemoryStats::Sample& s) { CMemoryStats::SamplePool(weaponMemPool, s); });
+}
+void CWeaponLoader::KillStatic() {
+	udWeaponCounts.fill(MAX_WEAPONS_PER_UNIT + 1);
+	weaponMemPool.clear();
+
+	memoryStats.RemoveSubsystem("Sim/Weapons");
+}
 
 
 
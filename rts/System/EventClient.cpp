@@ -38,6 +38,26 @@ bool CEventClient::WantsEvent(const std::string& eventName)
 }
 
 
+CEventClient::FilteredEvent CEventClient::GetFilteredEvent(const std::string& eventName)
+{
+	// indexed by FilteredEvent
+	static const std::array<std::string, FILTER_EVENT_COUNT> eventNames = {{
+		"UnitCreated",
+		"UnitFinished",
+		"UnitDestroyed",
+		"UnitDamaged",
+		"UnitUnitCollision",
+		"ProjectileCreated",
+		"ProjectileDestroyed",
+		"Explosion",
+	}};
+
+	const auto iter = std::find(eventNames.begin(), eventNames.end(), eventName);
+
+	return (FilteredEvent(iter - eventNames.begin()));
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
 //
@@ -4,6 +4,8 @@
 #define EVENT_CLIENT_H
 
 #include <algorithm>
+#include <array>
+#include <cinttypes>
 #include <typeinfo>
 #include <string>
 #include <vector>
@@ -75,6 +77,92 @@ class CEventClient
 			return (GetFullRead() || (GetReadAllyTeam() == allyTeam));
 		}
 
+		/// high-frequency call-ins that can be filtered before being passed to the client
+		enum FilteredEvent {
+			FILTER_UNIT_CREATED,
+			FILTER_UNIT_FINISHED,
+			FILTER_UNIT_DESTROYED,
+			FILTER_UNIT_DAMAGED,
+			FILTER_UNIT_UNIT_COLLISION,
+			FILTER_PROJECTILE_CREATED,
+			FILTER_PROJECTILE_DESTROYED,
+			FILTER_EXPLOSION,
+			FILTER_EVENT_COUNT
+		};
+
+		/**
+		 * Per-event subscription filter; an event is passed on if for every
+		 * restricted key its value (-1 if the event has none) is in the set.
+		 */
+		struct CallInFilter {
+		public:
+			enum {
+				KEY_UNITDEF   = 0,
+				KEY_WEAPONDEF = 1,
+				KEY_TEAM      = 2,
+				KEY_ALLYTEAM  = 3,
+				KEY_COUNT     = 4
+			};
+
+			bool Match(int unitDefID, int weaponDefID, int teamID, int allyTeamID) const {
+				return (MatchKey(KEY_UNITDEF, unitDefID) && MatchKey(KEY_WEAPONDEF, weaponDefID) && MatchKey(KEY_TEAM, teamID) && MatchKey(KEY_ALLYTEAM, allyTeamID));
+			}
+			bool MatchKey(unsigned int key, int value) const {
+				return (((restrictedKeys >> key) & 1) == 0 || (unsigned(value) < masks[key].size() && masks[key][value]));
+			}
+
+			bool Count(bool delivered) {
+				numDelivered += delivered;
+				numSkipped += !delivered;
+				return delivered;
+			}
+
+			void Clear() { *this = {}; }
+			void RestrictKey(unsigned int key) { restrictedKeys |= (1 << key); }
+			void AddValue(unsigned int key, int value) {
+				RestrictKey(key);
+
+				if (value < 0)
+					return;
+
+				masks[key].resize(std::max(masks[key].size(), size_t(value + 1)), false);
+				masks[key][value] = true;
+			}
+
+			bool IsActive() const { return active; }
+			void SetActive(bool b) { active = b; }
+
+			uint64_t GetNumDelivered() const { return numDelivered; }
+			uint64_t GetNumSkipped() const { return numSkipped; }
+
+		private:
+			std::array<std::vector<bool>, KEY_COUNT> masks;
+
+			// call-ins passed to or withheld from the client since the filter was set
+			uint64_t numDelivered = 0;
+			uint64_t numSkipped = 0;
+
+			unsigned int restrictedKeys = 0;
+
+			bool active = false;
+		};
+
+		/// @return FILTER_EVENT_COUNT if the named call-in can not be filtered
+		static FilteredEvent GetFilteredEvent(const std::string& eventName);
+
+		CallInFilter& GetCallInFilter(FilteredEvent event) { return callInFilters[event]; }
+		const CallInFilter& GetCallInFilter(FilteredEvent event) const { return callInFilters[event]; }
+
+		/// used by the eventHandler before passing a filterable event to this client
+		inline bool WantsCallIn(FilteredEvent event, int unitDefID, int weaponDefID, int teamID, int allyTeamID) {
+			CallInFilter& f = callInFilters[event];
+
+			if (!f.IsActive())
+				return true;
+
+			return (f.Count(f.Match(unitDefID, weaponDefID, teamID, allyTeamID)));
+		}
+
 	protected:
 		CEventClient(const std::string& name, int order, bool synced);
 		virtual ~CEventClient();
@@ -91,6 +179,8 @@ class CEventClient
 
 		std::vector<LinkPair> autoLinkedEvents;
 
+		std::array<CallInFilter, FILTER_EVENT_COUNT> callInFilters;
+
 		template <class T>
 		void RegisterLinkedEvents(T* foo) {
 			#define SETUP_EVENT(eventname, props) \
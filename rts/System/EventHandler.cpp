@@ -4,6 +4,9 @@
 
 #include "Lua/LuaCallInCheck.h"
 #include "Lua/LuaOpenGL.h"  // FIXME -- should be moved
+#include "Sim/Projectiles/WeaponProjectiles/WeaponProjectile.h"
+#include "Sim/Units/UnitDef.h"
+#include "Sim/Weapons/WeaponDef.h"
 
 #include "System/Config/ConfigHandler.h"
 #include "System/Platform/Threading.h"
@@ -205,6 +208,31 @@ void CEventHandler::ListRemove(EventClientList& ecList, CEventClient* ec)
 }
 
 
+int CEventHandler::GetUnitDefID(const CUnit* unit)
+{
+	if (unit == nullptr)
+		return -1;
+
+	return unit->unitDef->id;
+}
+
+void CEventHandler::GetProjectileFilterKeys(const CProjectile* proj, int& unitDefID, int& weaponDefID)
+{
+	unitDefID = GetUnitDefID(proj->owner());
+	weaponDefID = -1;
+
+	if (!proj->weapon)
+		return;
+
+	const WeaponDef* wd = static_cast<const CWeaponProjectile*>(proj)->GetWeaponDef();
+
+	if (wd == nullptr)
+		return;
+
+	weaponDefID = wd->id;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
 
@@ -333,6 +333,10 @@ class CEventHandler
 		void ListInsert(EventClientList& ciList, CEventClient* ec);
 		void ListRemove(EventClientList& ciList, CEventClient* ec);
 
+		/// keys of a unit or projectile for CEventClient::WantsCallIn, -1 if not applicable
+		static int GetUnitDefID(const CUnit* unit);
+		static void GetProjectileFilterKeys(const CProjectile* proj, int& unitDefID, int& weaponDefID);
+
 	private:
 		CEventClient* mouseOwner;
 
@@ -390,15 +394,38 @@ extern CEventHandler eventHandler;
 		i += (i < list##name.size() && ec == list##name[i]);       \
 	}
 
+// as above, also skipping clients whose CEventClient::CallInFilter rejects the event
+#define ITERATE_FILTERED_UNIT_ALLYTEAM_EVENTCLIENTLIST(name, filter, wdID, unit, ...)   \
+	const auto unitAllyTeam = unit->allyteam;                                         \
+	const auto unitDefID = GetUnitDefID(unit);                                        \
+	for (size_t i = 0; i < list##name.size(); ) {                                    \
+		CEventClient* ec = list##name[i];                                            \
+                                                                                     \
+		if (!ec->CanReadAllyTeam(unitAllyTeam)) {                                    \
+			i += 1;                                                                  \
+			continue;                                                                \
+		}                                                                            \
+		if (ec->WantsCallIn(CEventClient::filter, unitDefID, wdID, unit->team, unitAllyTeam)) \
+			ec->name(unit, ##__VA_ARGS__);                                           \
+                                                                                     \
+		/* the call-in may remove itself from the list */                            \
+		i += (i < list##name.size() && ec == list##name[i]);                         \
+	}
+
 inline void CEventHandler::UnitCreated(const CUnit* unit, const CUnit* builder)
 {
-	ITERATE_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitCreated, unit, builder)
+	ITERATE_FILTERED_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitCreated, FILTER_UNIT_CREATED, -1, unit, builder)
 }
 
 
 inline void CEventHandler::UnitDestroyed(const CUnit* unit, const CUnit* attacker)
 {
-	ITERATE_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitDestroyed, unit, attacker)
+	ITERATE_FILTERED_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitDestroyed, FILTER_UNIT_DESTROYED, -1, unit, attacker)
+}
+
+inline void CEventHandler::UnitFinished(const CUnit* unit)
+{
+	ITERATE_FILTERED_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitFinished, FILTER_UNIT_FINISHED, -1, unit)
 }
 
 #define UNIT_CALLIN_NO_PARAM(name)                                 \
@@ -416,7 +443,6 @@ inline void CEventHandler::UnitDestroyed(const CUnit* unit, const CUnit* attacke
 	}
 
 UNIT_CALLIN_NO_PARAM(UnitReverseBuilt);
-UNIT_CALLIN_NO_PARAM(UnitFinished)
 UNIT_CALLIN_NO_PARAM(UnitIdle)
 UNIT_CALLIN_NO_PARAM(UnitMoveFailed)
 UNIT_CALLIN_NO_PARAM(UnitEnteredWater)
@@ -467,6 +493,19 @@ inline bool CEventHandler::UnitUnitCollision(const CUnit* collider, const CUnit*
 	for (size_t i = 0; i < clients.size(); ) {
 		CEventClient* ec = clients[i];
 
+		// passed on if the filter accepts either unit, counted once
+		CEventClient::CallInFilter& f = ec->GetCallInFilter(CEventClient::FILTER_UNIT_UNIT_COLLISION);
+
+		if (f.IsActive()) {
+			const bool matchCollider = f.Match(GetUnitDefID(collider), -1, collider->team, collider->allyteam);
+			const bool matchCollidee = f.Match(GetUnitDefID(collidee), -1, collidee->team, collidee->allyteam);
+
+			if (!f.Count(matchCollider || matchCollidee)) {
+				i += 1;
+				continue;
+			}
+		}
+
 		// discard return-value from clients lacking full-read access
 		// (redundant for synced gadgets; watchWeaponDefs is checked)
 		// NOTE: the call-in may remove itself from the client list
@@ -523,7 +562,7 @@ inline void CEventHandler::UnitDamaged(
 	int projectileID,
 	bool paralyzer)
 {
-	ITERATE_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitDamaged, unit, attacker, damage, weaponDefID, projectileID, paralyzer)
+	ITERATE_FILTERED_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitDamaged, FILTER_UNIT_DAMAGED, weaponDefID, unit, attacker, damage, weaponDefID, projectileID, paralyzer)
 }
 
 inline void CEventHandler::UnitStunned(
@@ -643,11 +682,21 @@ inline void CEventHandler::FeatureMoved(const CFeature* feature, const float3& o
 inline void CEventHandler::ProjectileCreated(const CProjectile* proj, int allyTeam)
 {
 	const size_t count = listProjectileCreated.size();
+
+	if (count == 0)
+		return;
+
+	int unitDefID = -1;
+	int weaponDefID = -1;
+
+	GetProjectileFilterKeys(proj, unitDefID, weaponDefID);
+
 	for (size_t i = 0; i < count; i++) {
 		CEventClient* ec = listProjectileCreated[i];
 		if ((allyTeam < 0) || // projectile had no owner at creation
 		    ec->CanReadAllyTeam(allyTeam)) {
-			ec->ProjectileCreated(proj);
+			if (ec->WantsCallIn(CEventClient::FILTER_PROJECTILE_CREATED, unitDefID, weaponDefID, proj->GetTeamID(), allyTeam))
+				ec->ProjectileCreated(proj);
 		}
 	}
 }
@@ -657,11 +706,20 @@ inline void CEventHandler::ProjectileDestroyed(const CProjectile* proj, int ally
 {
 	const size_t count = listProjectileDestroyed.size();
 
+	if (count == 0)
+		return;
+
+	int unitDefID = -1;
+	int weaponDefID = -1;
+
+	GetProjectileFilterKeys(proj, unitDefID, weaponDefID);
+
 	for (size_t i = 0; i < count; i++) {
 		CEventClient* ec = listProjectileDestroyed[i];
 		if ((allyTeam < 0) || // projectile had no owner at creation
 		    ec->CanReadAllyTeam(allyTeam)) {
-			ec->ProjectileDestroyed(proj);
+			if (ec->WantsCallIn(CEventClient::FILTER_PROJECTILE_DESTROYED, unitDefID, weaponDefID, proj->GetTeamID(), allyTeam))
+				ec->ProjectileDestroyed(proj);
 		}
 	}
 }
@@ -679,9 +737,18 @@ inline bool CEventHandler::Explosion(int weaponDefID, int projectileID, const fl
 {
 	auto& clients = listExplosion;
 
+	const int ownerUnitDefID = GetUnitDefID(owner);
+	const int ownerTeam = (owner != nullptr)? owner->team: -1;
+	const int ownerAllyTeam = (owner != nullptr)? owner->allyteam: -1;
+
 	for (size_t i = 0; i < clients.size(); ) {
 		CEventClient* ec = clients[i];
 
+		if (!ec->WantsCallIn(CEventClient::FILTER_EXPLOSION, ownerUnitDefID, weaponDefID, ownerTeam, ownerAllyTeam)) {
+			i += 1;
+			continue;
+		}
+
 		// discard return-value from clients lacking full-read access
 		// (redundant for synced gadgets; watchWeaponDefs is checked)
 		// NOTE: the call-in may remove itself from the client list
@@ -750,6 +817,7 @@ inline void CEventHandler::RenderProjectileDestroyed(const CProjectile* proj)
 #undef ITERATE_EVENTCLIENTLIST
 #undef ITERATE_ALLYTEAM_EVENTCLIENTLIST
 #undef ITERATE_UNIT_ALLYTEAM_EVENTCLIENTLIST
+#undef ITERATE_FILTERED_UNIT_ALLYTEAM_EVENTCLIENTLIST
 #undef UNIT_CALLIN_NO_PARAM
 #undef UNIT_CALLIN_INT_PARAMS
 #undef UNIT_CALLIN_LOS_PARAM
@@ -28,7 +28,7 @@ CGZFileHandler::CGZFileHandler(const char* fileName, const char* modes)
 }
 
 
-CGZFileHandler::CGZFileHandler(const std::string& fileName, const std::string& modes)
+CGZFileHandler::CGZFileHandler(const std::string& fileName, const std::string& modes, bool _allowTruncated): allowTruncated(_allowTruncated)
 {
 	Open(fileName, modes);
 }
@@ -47,6 +47,11 @@ bool CGZFileHandler::ReadToBuffer(const std::string& path)
 	while (true) {
 		int unzippedBytes = gzread(file, unzipBuffer, BUFFER_SIZE);
 		if (unzippedBytes < 0) {
+			// a truncated file (e.g. a streamed demo whose writer crashed)
+			// still yields every complete block that came before the error
+			if (allowTruncated && !fileBuffer.empty())
+				break;
+
 			fileBuffer.clear();
 			fileSize = -1;
 			gzclose(file);
@@ -86,7 +91,8 @@ bool CGZFileHandler::UncompressBuffer()
 		zstream.avail_out = BUFFER_SIZE;
 		zstream.next_out = unzipBuffer;
 		const int ret = inflate(&zstream, Z_NO_FLUSH);
-		if (ret != Z_OK) {
+		if (ret != Z_OK && ret != Z_STREAM_END) {
+			inflateEnd(&zstream);
 			fileBuffer.clear();
 			fileSize = -1;
 			return false;
@@ -95,8 +101,13 @@ bool CGZFileHandler::UncompressBuffer()
 		const size_t unzippedBytes = BUFFER_SIZE - zstream.avail_out;
 		fileBuffer.insert(fileBuffer.end(), unzipBuffer, unzipBuffer + unzippedBytes);
 
-		if (ret == Z_STREAM_END)
+		if (ret != Z_STREAM_END)
+			continue;
+		// concatenated gzip members (as written by CDemoStreamWriter) form one stream
+		if (zstream.avail_in == 0)
 			break;
+
+		inflateReset(&zstream);
 	}
 
 	inflateEnd(&zstream);
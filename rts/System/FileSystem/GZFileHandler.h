@@ -15,7 +15,12 @@ class CGZFileHandler : public CFileHandler
 {
 public:
 	CGZFileHandler(const char* fileName, const char* modes = SPRING_VFS_RAW_FIRST);
-	CGZFileHandler(const std::string& fileName, const std::string& modes = SPRING_VFS_RAW_FIRST);
+	/**
+	 * @param allowTruncated if true, a raw file that ends in the middle of a
+	 *   gzip member yields everything decoded up to that point instead of
+	 *   failing to open (used for demos whose streaming writer was killed)
+	 */
+	CGZFileHandler(const std::string& fileName, const std::string& modes = SPRING_VFS_RAW_FIRST, bool allowTruncated = false);
 
 private:
 	bool TryReadFromPWD(const std::string& fileName) override;
@@ -23,6 +28,9 @@ private:
 	bool TryReadFromVFS(const std::string& fileName, int section) override;
 	bool ReadToBuffer(const std::string& path);
 	bool UncompressBuffer();
+
+private:
+	bool allowTruncated = false;
 };
 
 #endif // _GZ_FILE_HANDLER_H
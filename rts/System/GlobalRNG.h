@@ -83,6 +83,7 @@ public:
 	}
 
 	val_type state() const { return val; }
+	void set_state(const val_type _val) { val = _val; }
 
 public:
 	static constexpr res_type min_res = std::numeric_limits<res_type>::min();
@@ -119,6 +120,8 @@ public:
 	rng_val_type GetInitSeed() const { return initSeed; }
 	rng_val_type GetLastSeed() const { return lastSeed; }
 	rng_val_type GetGenState() const { return (gen.state()); }
+	// only meaningful after SetSeed has restored the sequence-id
+	void SetGenState(rng_val_type state) { gen.set_state(state); }
 
 	// needed for std::{random_}shuffle
 	rng_res_type operator()(              ) { return (gen. next( )); }
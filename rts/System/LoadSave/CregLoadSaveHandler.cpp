@@ -20,13 +20,16 @@
 #include "Sim/Features/FeatureHandler.h"
 #include "Sim/Units/UnitHandler.h"
 #include "Sim/Misc/BuildingMaskMap.h"
+#include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/InterceptHandler.h"
 #include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/QuadField.h"
+#include "Sim/Misc/SmoothHeightMesh.h"
 #include "Sim/Misc/CategoryHandler.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/Wind.h"
+#include "Sim/Path/IPathManager.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Units/CommandAI/CommandDescription.h"
 #include "Sim/Units/Scripts/CobEngine.h"
@@ -44,7 +47,16 @@
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
 
+#ifdef SYNCCHECK
+	#include "System/Sync/SyncChecker.h"
+#endif
+
 #define MAX_STRING_SIZE (1 << 19) // 512kB excluding null-term
+#define SAVE_CHUNK_SIZE (1 << 20) // 1MB per gzread/gzwrite call
+
+// follows the engine version in saves that end with the synced RNG state and
+// checksum; older saves have the setup-script there, which never matches this
+#define SAVE_FORMAT_TAG "SSF2"
 
 
 CCregLoadSaveHandler::CCregLoadSaveHandler()
@@ -86,6 +98,7 @@ void CGameStateCollector::Serialize(creg::ISerializer* s)
 	s->SerializeObjectInstance(&interceptHandler, interceptHandler.GetClass());
 	s->SerializeObjectInstance(CCategoryHandler::Instance(), CCategoryHandler::Instance()->GetClass());
 	s->SerializeObjectInstance(&buildingMaskMap, buildingMaskMap.GetClass());
+	s->SerializeObjectInstance(&smoothGround, smoothGround.GetClass());
 	s->SerializeObjectInstance(&projectileHandler, projectileHandler.GetClass());
 	CPlasmaRepulser::SerializeShieldSegmentCollectionPool(s);
 	CColorMap::SerializeColorMaps(s);
@@ -160,6 +173,24 @@ static void ReadString(std::istream& s, std::string& str)
 }
 
 
+#ifdef USING_CREG
+// saves only hold the heightmap itself, everything derived from it (center
+// heightmap, mip-maps, normals, slopes, LOS and path costs) still reflects
+// the original map and has to be rebuilt wherever the loaded one differs
+static void UpdateLoadedTerrain()
+{
+	const SRectangle r = readMap->GetDamagedHeightMapRect();
+
+	if (r.x2 < r.x1)
+		return;
+
+	readMap->UpdateHeightMapSynced({r.x1, r.z1, std::min(r.x2 + 1, mapDims.mapx), std::min(r.z2 + 1, mapDims.mapy)}, true);
+	losHandler->UpdateHeightMapSynced(r);
+	pathManager->TerrainChange(r.x1, r.z1, r.x2, r.z2, TERRAINCHANGE_DAMAGE_RECALCULATION);
+}
+#endif //USING_CREG
+
+
 static void SaveLuaState(CSplitLuaHandle* handle, creg::COutputStreamSerializer& os, std::stringstream& oss)
 {
 	CLuaStateCollector lsc;
@@ -194,6 +225,61 @@ static void LoadLuaState(CSplitLuaHandle* handle, creg::CInputStreamSerializer&
 }
 
 
+#ifdef USING_CREG
+void CCregLoadSaveHandler::WriteGameState(std::stringstream& oss)
+{
+	// write our own header. SavePackage() will add its own
+	WriteString(oss, SpringVersion::GetSync());
+	WriteString(oss, SAVE_FORMAT_TAG);
+	WriteString(oss, gameSetup->setupText);
+	WriteString(oss, modName);
+	WriteString(oss, mapName);
+
+	creg::COutputStreamSerializer os;
+
+	// save lua state first as lua unit scripts depend on it
+	const int luaStart = oss.tellp();
+	SaveLuaState(luaGaia, os, oss);
+	SaveLuaState(luaRules, os, oss);
+	PrintSize("Lua", ((int)oss.tellp()) - luaStart);
+
+	// save creg state
+	const int gameStart = oss.tellp();
+	CGameStateCollector gsc;
+	os.SavePackage(&oss, &gsc, gsc.GetClass());
+	PrintSize("Game", ((int)oss.tellp()) - gameStart);
+
+
+	// save AI state
+	const int aiStart = oss.tellp();
+
+	for (const auto& ai: skirmishAIHandler.GetAllSkirmishAIs()) {
+		std::stringstream aiData;
+		eoh->Save(&aiData, ai.first);
+
+		std::streamsize aiSize = aiData.tellp();
+		os.SerializeInt(&aiSize, sizeof(aiSize));
+		if (aiSize > 0)
+			oss << aiData.rdbuf();
+	}
+	PrintSize("AIs", ((int)oss.tellp()) - aiStart);
+
+	// synced state not covered by creg; needed for a client joining
+	// a running game from this save to stay in sync (NETMSG_GAMESTATE)
+	std::uint64_t rngState[3] = {gsRNG.GetInitSeed(), gsRNG.GetLastSeed(), gsRNG.GetGenState()};
+	unsigned int syncChecksum = 0;
+#ifdef SYNCCHECK
+	syncChecksum = CSyncChecker::GetChecksum();
+#endif
+
+	for (std::uint64_t& v: rngState) {
+		os.SerializeInt(&v, sizeof(v));
+	}
+
+	os.SerializeInt(&syncChecksum, sizeof(syncChecksum));
+}
+#endif //USING_CREG
+
 void CCregLoadSaveHandler::SaveGame(const std::string& path)
 {
 #ifdef USING_CREG
@@ -202,43 +288,7 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 	try {
 		std::stringstream oss;
 
-		// write our own header. SavePackage() will add its own
-		WriteString(oss, SpringVersion::GetSync());
-		WriteString(oss, gameSetup->setupText);
-		WriteString(oss, modName);
-		WriteString(oss, mapName);
-
-
-		{
-			creg::COutputStreamSerializer os;
-
-			// save lua state first as lua unit scripts depend on it
-			const int luaStart = oss.tellp();
-			SaveLuaState(luaGaia, os, oss);
-			SaveLuaState(luaRules, os, oss);
-			PrintSize("Lua", ((int)oss.tellp()) - luaStart);
-
-			// save creg state
-			const int gameStart = oss.tellp();
-			CGameStateCollector gsc;
-			os.SavePackage(&oss, &gsc, gsc.GetClass());
-			PrintSize("Game", ((int)oss.tellp()) - gameStart);
-
-
-			// save AI state
-			const int aiStart = oss.tellp();
-
-			for (const auto& ai: skirmishAIHandler.GetAllSkirmishAIs()) {
-				std::stringstream aiData;
-				eoh->Save(&aiData, ai.first);
-
-				std::streamsize aiSize = aiData.tellp();
-				os.SerializeInt(&aiSize, sizeof(aiSize));
-				if (aiSize > 0)
-					oss << aiData.rdbuf();
-			}
-			PrintSize("AIs", ((int)oss.tellp()) - aiStart);
-		}
+		WriteGameState(oss);
 
 		{
 			gzFile file = gzopen(dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE).c_str(), "wb5");
@@ -248,16 +298,23 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 				return;
 			}
 
-			std::string data = std::move(oss.str());
-			std::function<void(gzFile, std::string&&)> func = [](gzFile file, std::string&& data) {
-				gzwrite(file, data.c_str(), data.size());
+			// the stream itself is handed over and compressed chunk-wise straight
+			// from its buffer; oss.str() would copy the entire save in one piece
+			std::function<void(gzFile, std::stringstream&&)> func = [](gzFile file, std::stringstream&& data) {
+				std::vector<char> chunk(SAVE_CHUNK_SIZE);
+				std::streambuf* sbuf = data.rdbuf();
+
+				for (std::streamsize n = 0; (n = sbuf->sgetn(chunk.data(), chunk.size())) > 0; ) {
+					gzwrite(file, chunk.data(), n);
+				}
+
 				gzflush(file, Z_FINISH);
 				gzclose(file);
 			};
 
 			// gzFile is just a plain typedef (struct gzFile_s {}* gzFile), can be copied
 			// need to keep a reference to the future around or its destructor will block
-			ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(data))));
+			ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(oss))));
 		}
 
 		//FIXME add lua state
@@ -277,19 +334,88 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 #endif //USING_CREG
 }
 
+bool CCregLoadSaveHandler::SaveGameToBuffer(std::vector<std::uint8_t>& buffer)
+{
+#ifdef USING_CREG
+	buffer.clear();
+
+	try {
+		std::stringstream oss;
+
+		WriteGameState(oss);
+
+		// compressed synchronously (the caller wants the data right away) but
+		// at the fastest level, and gzip-wrapped (windowBits + 16) so the data
+		// can be written to disk as-is and read back by LoadGameStartInfo
+		z_stream zs = {};
+
+		if (deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return false;
+
+		std::vector<char> chunk(SAVE_CHUNK_SIZE);
+		std::streambuf* sbuf = oss.rdbuf();
+
+		for (int flush = Z_NO_FLUSH; flush != Z_FINISH; ) {
+			const std::streamsize n = sbuf->sgetn(chunk.data(), chunk.size());
+
+			flush = (n < std::streamsize(chunk.size()))? Z_FINISH: Z_NO_FLUSH;
+
+			zs.next_in = reinterpret_cast<Bytef*>(chunk.data());
+			zs.avail_in = n;
+
+			do {
+				const size_t pos = buffer.size();
+
+				buffer.resize(pos + SAVE_CHUNK_SIZE);
+
+				zs.next_out = &buffer[pos];
+				zs.avail_out = SAVE_CHUNK_SIZE;
+
+				deflate(&zs, flush);
+				buffer.resize(pos + SAVE_CHUNK_SIZE - zs.avail_out);
+			} while (zs.avail_out == 0);
+		}
+
+		deflateEnd(&zs);
+		return true;
+	} catch (const std::exception& ex) {
+		LOG_L(L_ERROR, "[LSH::%s] exception \"%s\"", __func__, ex.what());
+	}
+
+	buffer.clear();
+#else //USING_CREG
+	LOG_L(L_ERROR, "[LSH::%s] creg is disabled", __func__);
+#endif //USING_CREG
+	return false;
+}
+
 /// loads the data (map&mod-name,setup-script) needed by PreGame
 bool CCregLoadSaveHandler::LoadGameStartInfo(const std::string& path)
 {
-	CGZFileHandler saveFile(dataDirsAccess.LocateFile(FindSaveFile(path)), SPRING_VFS_RAW_FIRST);
+	const std::string saveFilePath = dataDirsAccess.LocateFile(FindSaveFile(path));
 
 	std::stringbuf* sbuf = iss.rdbuf();
 	std::string saveVersion;
 	std::string syncVersion = SpringVersion::GetSync();
 
-	char buf[4096];
-	int len;
-	while ((len = saveFile.Read(buf, sizeof(buf))) > 0)
-		sbuf->sputn(buf, len);
+	std::vector<char> chunk(SAVE_CHUNK_SIZE);
+	gzFile file = gzopen(saveFilePath.c_str(), "rb");
+
+	if (file != nullptr) {
+		// decompress straight into the stream, without buffering the file first
+		for (int len = 0; (len = gzread(file, chunk.data(), chunk.size())) > 0; ) {
+			sbuf->sputn(chunk.data(), len);
+		}
+
+		gzclose(file);
+	} else {
+		// not a raw file, try the VFS
+		CGZFileHandler saveFile(saveFilePath, SPRING_VFS_RAW_FIRST);
+
+		for (int len = 0; (len = saveFile.Read(chunk.data(), chunk.size())) > 0; ) {
+			sbuf->sputn(chunk.data(), len);
+		}
+	}
 
 	ReadString(iss, saveVersion);
 
@@ -301,6 +427,9 @@ bool CCregLoadSaveHandler::LoadGameStartInfo(const std::string& path)
 
 	// read our own header
 	ReadString(iss, scriptText);
+
+	if ((hasSyncTrailer = (scriptText == SAVE_FORMAT_TAG)))
+		ReadString(iss, scriptText);
 	ReadString(iss, modName);
 	ReadString(iss, mapName);
 
@@ -331,6 +460,8 @@ void CCregLoadSaveHandler::LoadGame()
 		CGameStateCollector* gsc = static_cast<CGameStateCollector*>(pGSC);
 		spring::SafeDelete(gsc);
 
+		UpdateLoadedTerrain();
+
 		// load ai state
 		for (const auto& ai: skirmishAIHandler.GetAllSkirmishAIs()) {
 			std::streamsize aiSize;
@@ -343,6 +474,25 @@ void CCregLoadSaveHandler::LoadGame()
 
 			eoh->Load(&aiData, ai.first);
 		}
+
+		if (hasSyncTrailer) {
+			std::uint64_t rngState[3] = {0, 0, 0};
+			unsigned int syncChecksum = 0;
+
+			for (std::uint64_t& v: rngState) {
+				inputStream.SerializeInt(&v, sizeof(v));
+			}
+
+			inputStream.SerializeInt(&syncChecksum, sizeof(syncChecksum));
+
+			gsRNG.SetSeed(rngState[0], true);
+			gsRNG.SetSeed(rngState[1], false);
+			gsRNG.SetGenState(rngState[2]);
+
+#ifdef SYNCCHECK
+			CSyncChecker::SetChecksum(syncChecksum);
+#endif
+		}
 	}
 
 	// cleanup
@@ -3,8 +3,11 @@
 #ifndef CREG_LOAD_SAVE_HANDLER_H
 #define CREG_LOAD_SAVE_HANDLER_H
 
+#include <cstdint>
 #include <string>
 #include <sstream>
+#include <vector>
+
 #include "LoadSaveHandler.h"
 
 class CCregLoadSaveHandler : public ILoadSaveHandler
@@ -16,9 +19,17 @@ public:
 	bool LoadGameStartInfo(const std::string& path) override;
 	void LoadGame() override;
 	void SaveGame(const std::string& path) override;
+	/// same as SaveGame, but returns the (gzip-compressed) save instead of writing it to disk
+	bool SaveGameToBuffer(std::vector<std::uint8_t>& buffer);
+
+protected:
+	void WriteGameState(std::stringstream& oss);
 
 protected:
 	std::stringstream iss;
+
+	/// false for saves written before the synced RNG state and checksum were appended
+	bool hasSyncTrailer = false;
 };
 
 #endif // CREG_LOAD_SAVE_HANDLER_H
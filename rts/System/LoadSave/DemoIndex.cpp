@@ -0,0 +1,151 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <zlib.h>
+
+#include "DemoIndex.h"
+#include "Demo.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/GZFileHandler.h"
+#include "System/Log/ILog.h"
+
+static constexpr const char* DEMOINDEX_MAGIC = "spring demoindex";
+static constexpr int DEMOINDEX_VERSION = 1;
+
+
+std::string CDemoIndex::GetGameIDString(const DemoFileHeader& header)
+{
+	std::string str;
+	char buf[3];
+
+	for (unsigned char c: header.gameID) {
+		snprintf(buf, sizeof(buf), "%02x", c);
+		str += buf;
+	}
+
+	return str;
+}
+
+
+void CDemoIndex::Init(const std::string& _demoName, const DemoFileHeader& header)
+{
+	demoName = _demoName;
+	gameID = GetGameIDString(header);
+
+	keyframes.clear();
+}
+
+bool CDemoIndex::Load(const std::string& _demoName)
+{
+	demoName = _demoName;
+	keyframes.clear();
+
+	CGZFileHandler indexFile(GetFileName(demoName), SPRING_VFS_PWD_ALL);
+	std::string indexText;
+
+	if (!indexFile.FileExists() || !indexFile.LoadStringData(indexText))
+		return false;
+
+	std::istringstream stream(indexText);
+	std::string line;
+	std::string key;
+
+	// first line must match the current magic and version exactly
+	if (!std::getline(stream, line) || line != (std::string(DEMOINDEX_MAGIC) + " " + std::to_string(DEMOINDEX_VERSION))) {
+		LOG_L(L_WARNING, "[DemoIndex::%s] ignoring index \"%s\" (bad magic or version)", __func__, GetFileName(demoName).c_str());
+		return false;
+	}
+
+	while (std::getline(stream, line)) {
+		std::istringstream entry(line);
+
+		if (!(entry >> key))
+			continue;
+
+		if (key == "gameid") {
+			entry >> gameID;
+			continue;
+		}
+		if (key == "keyframe") {
+			Keyframe kf;
+
+			if ((entry >> kf.frameNum) && std::getline(entry >> std::ws, kf.saveFile))
+				keyframes.push_back(kf);
+
+			continue;
+		}
+	}
+
+	std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe& a, const Keyframe& b) { return (a.frameNum < b.frameNum); });
+	return true;
+}
+
+bool CDemoIndex::Save() const
+{
+	const std::string& fileName = dataDirsAccess.LocateFile(GetFileName(demoName), FileQueryFlags::WRITE);
+
+	gzFile file = gzopen(fileName.c_str(), "wb9");
+
+	if (file == nullptr) {
+		LOG_L(L_ERROR, "[DemoIndex::%s] could not open \"%s\" for writing", __func__, fileName.c_str());
+		return false;
+	}
+
+	gzprintf(file, "%s %d\n", DEMOINDEX_MAGIC, DEMOINDEX_VERSION);
+	gzprintf(file, "gameid %s\n", gameID.c_str());
+
+	for (const Keyframe& kf: keyframes) {
+		gzprintf(file, "keyframe %d %s\n", kf.frameNum, kf.saveFile.c_str());
+	}
+
+	gzclose(file);
+	return true;
+}
+
+
+void CDemoIndex::AddKeyframe(int frameNum, const std::string& saveFile)
+{
+	const auto pred = [](const Keyframe& kf, int f) { return (kf.frameNum < f); };
+	const auto iter = std::lower_bound(keyframes.begin(), keyframes.end(), frameNum, pred);
+
+	// overwrite a previously stored keyframe for the same frame
+	if (iter != keyframes.end() && iter->frameNum == frameNum) {
+		if (iter->saveFile != saveFile)
+			FileSystem::DeleteFile(dataDirsAccess.LocateFile(iter->saveFile));
+
+		iter->saveFile = saveFile;
+		return;
+	}
+
+	keyframes.insert(iter, {frameNum, saveFile});
+}
+
+void CDemoIndex::RemoveKeyframes()
+{
+	for (const Keyframe& kf: keyframes) {
+		const std::string& fileName = dataDirsAccess.LocateFile(kf.saveFile);
+
+		if (!FileSystem::FileExists(fileName))
+			continue;
+
+		LOG("[DemoIndex::%s] removing stale keyframe \"%s\"", __func__, fileName.c_str());
+		FileSystem::DeleteFile(fileName);
+	}
+
+	keyframes.clear();
+}
+
+const CDemoIndex::Keyframe* CDemoIndex::FindKeyframe(int frameNum) const
+{
+	const auto pred = [](int f, const Keyframe& kf) { return (f < kf.frameNum); };
+	const auto iter = std::upper_bound(keyframes.begin(), keyframes.end(), frameNum, pred);
+
+	if (iter == keyframes.begin())
+		return nullptr;
+
+	return &*(iter - 1);
+}
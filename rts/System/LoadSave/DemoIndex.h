@@ -0,0 +1,56 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEMO_INDEX_H
+#define DEMO_INDEX_H
+
+#include <string>
+#include <vector>
+
+struct DemoFileHeader;
+
+/**
+ * @brief Keyframe index stored next to a demo ("<demo>.sdfi")
+ *
+ * Lists the creg keyframes (savegames) that were written while the demo
+ * was being watched, keyed by sim-frame (as in gs->frameNum). A demo server
+ * can load the closest keyframe and replay only the remaining tail instead
+ * of re-simulating the whole game.
+ */
+class CDemoIndex
+{
+public:
+	struct Keyframe {
+		int frameNum;
+		std::string saveFile;
+	};
+
+	static std::string GetFileName(const std::string& demoName) { return (demoName + ".sdfi"); }
+
+public:
+	static std::string GetGameIDString(const DemoFileHeader& header);
+
+	/// starts an empty index for the demo described by <header>
+	void Init(const std::string& demoName, const DemoFileHeader& header);
+	bool Load(const std::string& demoName);
+	bool Save() const;
+
+	void AddKeyframe(int frameNum, const std::string& saveFile);
+	/// deletes the savegames of all listed keyframes and empties the index
+	void RemoveKeyframes();
+
+	/// @return last keyframe at or before frameNum, or nullptr
+	const Keyframe* FindKeyframe(int frameNum) const;
+
+	bool MatchesDemo(const DemoFileHeader& header) const { return (gameID == GetGameIDString(header)); }
+
+	const std::vector<Keyframe>& GetKeyframes() const { return keyframes; }
+	const std::string& GetDemoName() const { return demoName; }
+
+private:
+	std::string demoName;
+	std::string gameID;
+
+	std::vector<Keyframe> keyframes;
+};
+
+#endif // DEMO_INDEX_H
@@ -14,6 +14,7 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileHandler.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/Log/ILog.h"
 #include "System/Threading/ThreadPool.h"
 
@@ -26,6 +27,10 @@
 #endif
 
 
+CONFIG(bool, DemoRecorderStreaming).defaultValue(false).dedicatedValue(true).description("Compress and write demos to disk incrementally while recording instead of buffering the whole game in memory.");
+CONFIG(int, DemoRecorderFlushSize).defaultValue(1024).minimumValue(64).description("Size in KB of recorded demo data at which a streaming demo recorder hands a block to its writer thread.");
+
+
 // server and client memory-streams
 static std::string demoStreams[2];
 static spring::mutex demoMutex;
@@ -35,9 +40,19 @@ CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modN
 {
 	std::lock_guard<spring::mutex> lock(demoMutex);
 
-	SetStream();
 	SetName(mapName, modName);
 	SetFileHeader();
+
+	if (configHandler->GetBool("DemoRecorderStreaming")) {
+		streamFlushSize = configHandler->GetInt("DemoRecorderFlushSize") * 1024;
+		// the writer blocks on a full queue, allow two blocks in flight
+		streamWriter.reset(new CDemoStreamWriter(demoName, streamFlushSize * 2));
+		SetStream();
+		WriteFileHeader(false);
+		return;
+	}
+
+	SetStream();
 	WriteFileHeader(false);
 
 	file = gzopen(demoName.c_str(), "wb9");
@@ -45,7 +60,7 @@ CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modN
 
 CDemoRecorder::~CDemoRecorder()
 {
-	if (file == nullptr)
+	if (file == nullptr && streamWriter == nullptr)
 		return;
 
 	WriteWinnerList();
@@ -59,6 +74,14 @@ CDemoRecorder::~CDemoRecorder()
 void CDemoRecorder::SetStream()
 {
 	demoStreams[isServerDemo].clear();
+
+	// a streaming recorder hands its buffer to the writer after every block,
+	// so only reserve one block plus headroom for the packet that crosses it
+	if (streamWriter != nullptr) {
+		demoStreams[isServerDemo].reserve(streamFlushSize + 64 * 1024);
+		return;
+	}
+
 	demoStreams[isServerDemo].reserve(8 * 1024 * 1024);
 }
 
@@ -84,6 +107,17 @@ void CDemoRecorder::WriteDemoFile()
 	// allocation routines by default" (so code below should be OK)
 	// gz* should usually be finished before ctor runs again when reloading, but take no chances
 	std::string& data = demoStreams[isServerDemo];
+
+	if (streamWriter != nullptr) {
+		LOG("[DemoRecorder::%s] closing streamed %s-demo \"%s\" (" _STPF_ " bytes remaining)", __func__, (isServerDemo? "server": "client"), demoName.c_str(), data.size());
+
+		// remainder is small (at most one block plus stats), finish synchronously
+		streamWriter->QueueData(data);
+		streamWriter->Close();
+		streamWriter.reset();
+		return;
+	}
+
 	std::function<void(gzFile, std::string&)> func = [](gzFile file, std::string& data) {
 		std::lock_guard<spring::mutex> lock(demoMutex);
 
@@ -124,6 +158,22 @@ void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length,
 	demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&chunkHeader), sizeof(chunkHeader));
 	demoStreams[isServerDemo].append(reinterpret_cast<const char*>(buf), length);
 	fileHeader.demoStreamSize += (length + sizeof(chunkHeader));
+
+	if (streamWriter == nullptr)
+		return;
+	if (demoStreams[isServerDemo].size() < streamFlushSize)
+		return;
+
+	FlushDemoStream();
+}
+
+void CDemoRecorder::FlushDemoStream()
+{
+	// keep the on-disk header current (script size, game ID) in case we crash
+	WriteFileHeader(false);
+
+	streamWriter->QueueData(demoStreams[isServerDemo]);
+	SetStream();
 }
 
 void CDemoRecorder::SetName(const std::string& mapName, const std::string& modName)
@@ -229,6 +279,11 @@ unsigned int CDemoRecorder::WriteFileHeader(bool updateStreamLength)
 	// to little endian
 	tmpHeader.swab();
 
+	if (streamWriter != nullptr) {
+		streamWriter->SetHeader(tmpHeader);
+		return (demoStreams[isServerDemo].size());
+	}
+
 	if (demoStreams[isServerDemo].empty()) {
 		demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&tmpHeader), sizeof(tmpHeader));
 	} else {
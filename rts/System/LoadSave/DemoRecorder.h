@@ -3,11 +3,13 @@
 #ifndef DEMO_RECORDER
 #define DEMO_RECORDER
 
+#include <memory>
 #include <vector>
 #include <sstream>
 #include <zlib.h>
 
 #include "Demo.h"
+#include "DemoStreamWriter.h"
 #include "Game/Players/PlayerStatistics.h"
 #include "Sim/Misc/TeamStatistics.h"
 
@@ -33,6 +35,8 @@ public:
 		memset(&r.fileHeader, 0, sizeof(fileHeader));
 
 		std::swap(file, r.file);
+		std::swap(streamWriter, r.streamWriter);
+		std::swap(streamFlushSize, r.streamFlushSize);
 
 		std::swap(demoName, r.demoName);
 		std::swap(playerStats, r.playerStats);
@@ -44,7 +48,7 @@ public:
 	}
 
 
-	bool IsValid() const { return (file != nullptr); }
+	bool IsValid() const { return (file != nullptr || (streamWriter != nullptr && streamWriter->IsOpen())); }
 
 	void WriteSetupText(const std::string& text);
 	void SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime);
@@ -69,10 +73,15 @@ private:
 	void WriteTeamStats();
 	void WriteWinnerList();
 	void WriteDemoFile();
+	void FlushDemoStream();
 
 private:
 	gzFile file = nullptr;
 
+	// set instead of <file> when recording in streaming mode
+	std::unique_ptr<CDemoStreamWriter> streamWriter;
+	size_t streamFlushSize = 0;
+
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
 	std::vector<unsigned char> winningAllyTeams;
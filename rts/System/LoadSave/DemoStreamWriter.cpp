@@ -0,0 +1,207 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <cassert>
+#include <cstring>
+#include <zlib.h>
+
+#include "DemoStreamWriter.h"
+#include "System/MainDefines.h"
+#include "System/Log/ILog.h"
+#include "System/Platform/Threading.h"
+
+
+// gzip member header (no name, no mtime, unknown OS) followed by the
+// header-byte of a single final stored deflate block; LEN and NLEN are
+// appended separately
+static constexpr unsigned char STORED_MEMBER_PREFIX[] = {0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x01};
+static constexpr size_t STORED_MEMBER_DATA_OFFSET = sizeof(STORED_MEMBER_PREFIX) + 4;
+
+
+static void AppendLE32(std::string& buf, unsigned int v)
+{
+	for (int i = 0; i < 4; i++) {
+		buf.push_back(char((v >> (i * 8)) & 0xff));
+	}
+}
+
+
+CDemoStreamWriter::CDemoStreamWriter(const std::string& fileName, size_t _maxQueuedBytes): maxQueuedBytes(_maxQueuedBytes)
+{
+	memset(&header, 0, sizeof(header));
+
+	if ((file = fopen(fileName.c_str(), "wb")) == nullptr) {
+		LOG_L(L_ERROR, "[DemoStreamWriter::%s] could not open \"%s\" for writing", __func__, fileName.c_str());
+		return;
+	}
+
+	thread = spring::thread(&CDemoStreamWriter::ThreadFunc, this);
+}
+
+
+void CDemoStreamWriter::SetHeader(const DemoFileHeader& swabbedHeader)
+{
+	if (file == nullptr)
+		return;
+
+	std::unique_lock<spring::mutex> lock(mutex);
+	memcpy(&header, &swabbedHeader, sizeof(header));
+
+	// first header is written before any data could have been queued
+	if (headerMemberPos < 0) {
+		assert(queue.empty());
+		WriteHeaderMember(header, false);
+		return;
+	}
+
+	headerDirty = true;
+}
+
+void CDemoStreamWriter::QueueData(std::string& data)
+{
+	if (file == nullptr || data.empty())
+		return;
+
+	std::unique_lock<spring::mutex> lock(mutex);
+
+	// throttle the producer if compression can not keep up
+	queueCond.wait(lock, [&]() { return (queuedBytes <= maxQueuedBytes); });
+
+	queuedBytes += data.size();
+	queue.emplace_back();
+	queue.back().swap(data);
+
+	queueCond.notify_all();
+}
+
+void CDemoStreamWriter::Close()
+{
+	if (file == nullptr)
+		return;
+
+	{
+		std::unique_lock<spring::mutex> lock(mutex);
+		quit = true;
+		queueCond.notify_all();
+	}
+
+	thread.join();
+
+	// writer thread is gone, remaining members have been flushed
+	if (headerMemberPos >= 0)
+		WriteHeaderMember(header, true);
+	fclose(file);
+
+	file = nullptr;
+}
+
+
+void CDemoStreamWriter::WriteHeaderMember(const DemoFileHeader& hdr, bool patch)
+{
+	const size_t headerSize = sizeof(hdr);
+	const unsigned int crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(&hdr), headerSize);
+
+	std::string trailer;
+	AppendLE32(trailer, crc);
+	AppendLE32(trailer, headerSize);
+
+	if (patch) {
+		const long endPos = ftell(file);
+
+		fseek(file, headerMemberPos + STORED_MEMBER_DATA_OFFSET, SEEK_SET);
+		fwrite(&hdr, headerSize, 1, file);
+		fwrite(trailer.data(), trailer.size(), 1, file);
+		fseek(file, endPos, SEEK_SET);
+		fflush(file);
+		return;
+	}
+
+	static_assert(sizeof(DemoFileHeader) <= 0xffff, "header does not fit into a single stored block");
+
+	const unsigned short len = headerSize;
+	const unsigned short nlen = ~len;
+	const unsigned char lens[4] = {
+		static_cast<unsigned char>(len & 0xff), static_cast<unsigned char>(len >> 8),
+		static_cast<unsigned char>(nlen & 0xff), static_cast<unsigned char>(nlen >> 8),
+	};
+
+	headerMemberPos = ftell(file);
+
+	fwrite(STORED_MEMBER_PREFIX, sizeof(STORED_MEMBER_PREFIX), 1, file);
+	fwrite(lens, sizeof(lens), 1, file);
+	fwrite(&hdr, headerSize, 1, file);
+	fwrite(trailer.data(), trailer.size(), 1, file);
+	fflush(file);
+}
+
+void CDemoStreamWriter::WriteDataMember(const std::string& data)
+{
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+
+	// +16 writes a gzip wrapper, so every block is a self-contained member
+	if (deflateInit2(&zstream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		LOG_L(L_ERROR, "[DemoStreamWriter::%s] deflateInit2 failed, dropping " _STPF_ " bytes", __func__, data.size());
+		return;
+	}
+
+	compressBuffer.resize(deflateBound(&zstream, data.size()) + 32);
+
+	zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+	zstream.avail_in = data.size();
+	zstream.next_out = reinterpret_cast<Bytef*>(&compressBuffer[0]);
+	zstream.avail_out = compressBuffer.size();
+
+	const int ret = deflate(&zstream, Z_FINISH);
+	const size_t numBytes = compressBuffer.size() - zstream.avail_out;
+
+	deflateEnd(&zstream);
+
+	if (ret != Z_STREAM_END) {
+		LOG_L(L_ERROR, "[DemoStreamWriter::%s] deflate failed (%d), dropping " _STPF_ " bytes", __func__, ret, data.size());
+		return;
+	}
+
+	fwrite(compressBuffer.data(), numBytes, 1, file);
+	fflush(file);
+}
+
+void CDemoStreamWriter::ThreadFunc()
+{
+	Threading::SetThreadName("demowriter");
+
+	std::string data;
+	DemoFileHeader headerCopy;
+
+	while (true) {
+		bool patchHeader = false;
+
+		{
+			std::unique_lock<spring::mutex> lock(mutex);
+			queueCond.wait(lock, [&]() { return (quit || headerDirty || !queue.empty()); });
+
+			if (queue.empty() && !headerDirty)
+				break;
+
+			if (!queue.empty()) {
+				data.swap(queue.front());
+				queue.pop_front();
+				queuedBytes -= data.size();
+				queueCond.notify_all();
+			}
+
+			std::swap(patchHeader, headerDirty);
+
+			// snapshot under the lock, SetHeader may overwrite it concurrently
+			if (patchHeader)
+				memcpy(&headerCopy, &header, sizeof(header));
+		}
+
+		if (patchHeader)
+			WriteHeaderMember(headerCopy, true);
+
+		if (!data.empty())
+			WriteDataMember(data);
+
+		data.clear();
+	}
+}
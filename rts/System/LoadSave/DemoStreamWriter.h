@@ -0,0 +1,72 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEMO_STREAM_WRITER_H
+#define DEMO_STREAM_WRITER_H
+
+#include <cstdio>
+#include <deque>
+#include <string>
+
+#include "demofile.h"
+#include "System/Threading/SpringThreading.h"
+
+
+/**
+ * @brief Incrementally compresses and appends demo data to disk
+ *
+ * The file is written as a sequence of concatenated gzip members, which
+ * gzread (and thus CDemoReader) transparently decompresses as one stream:
+ *
+ * - one stored (uncompressed) member holding the DemoFileHeader, so the
+ *   header can be patched in place (together with the member CRC) on Close
+ * - one deflated member per queued data block, each of them complete and
+ *   flushed to disk by a background thread as soon as it is compressed
+ *
+ * If the process dies before Close, every fully written member is still
+ * readable and the header keeps demoStreamSize=0 (meaning "until EOF").
+ */
+class CDemoStreamWriter
+{
+public:
+	CDemoStreamWriter(const std::string& fileName, size_t maxQueuedBytes);
+	CDemoStreamWriter(const CDemoStreamWriter&) = delete;
+	~CDemoStreamWriter() { Close(); }
+
+	CDemoStreamWriter& operator = (const CDemoStreamWriter&) = delete;
+
+	bool IsOpen() const { return (file != nullptr); }
+
+	/// first call writes the header member, later calls only update it
+	void SetHeader(const DemoFileHeader& swabbedHeader);
+	/// blocks while more than maxQueuedBytes are waiting for compression
+	void QueueData(std::string& data);
+	/// writes out everything still queued and patches the header
+	void Close();
+
+private:
+	void WriteHeaderMember(const DemoFileHeader& hdr, bool patch);
+	void WriteDataMember(const std::string& data);
+	void ThreadFunc();
+
+private:
+	FILE* file = nullptr;
+
+	spring::thread thread;
+	spring::mutex mutex;
+	spring::condition_variable_any queueCond;
+
+	std::deque<std::string> queue;
+	std::string compressBuffer;
+
+	DemoFileHeader header;
+
+	size_t queuedBytes = 0;
+	size_t maxQueuedBytes = 0;
+
+	long headerMemberPos = -1;
+
+	bool headerDirty = false;
+	bool quit = false;
+};
+
+#endif // DEMO_STREAM_WRITER_H
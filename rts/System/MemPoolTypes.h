@@ -34,6 +34,7 @@ public:
 		}
 
 		m = pages[curr_page_index = i].data();
+		num_allocs += 1;
 
 		table.emplace(m, i);
 		return m;
@@ -74,6 +75,7 @@ public:
 
 	size_t alloc_size() const { return (pages.size() * PAGE_SIZE()); } // size of total number of pages added over the pool's lifetime
 	size_t freed_size() const { return (indcs.size() * PAGE_SIZE()); } // size of number of pages that were freed and are awaiting reuse
+	size_t alloc_count() const { return num_allocs; } // number of allocations made over the pool's lifetime
 
 	bool mapped(void* p) const { return (table.find(p) != table.end()); }
 	bool alloced(void* p) const { return ((curr_page_index < pages.size()) && (pages[curr_page_index].data() == p)); }
@@ -98,6 +100,7 @@ private:
 	spring::unsynced_map<void*, size_t> table;
 
 	size_t curr_page_index = 0;
+	size_t num_allocs = 0;
 };
 
 
@@ -138,6 +141,7 @@ public:
 		const uint32_t idx = spring::VectorBackPop(indcs);
 
 		assert(size <= PAGE_SIZE());
+		num_allocs += 1;
 		memcpy(ptr = page_mem(page_index = idx), &idx, sizeof(idx));
 		return (ptr + sizeof(idx));
 	}
@@ -203,6 +207,7 @@ public:
 
 	size_t alloc_size() const { return (num_chunks * NUM_PAGES() * PAGE_SIZE()); } // size of total number of pages added over the pool's lifetime
 	size_t freed_size() const { return (indcs.size() * PAGE_SIZE()); } // size of number of pages that were freed and are awaiting reuse
+	size_t alloc_count() const { return num_allocs; } // number of allocations made over the pool's lifetime
 
 	bool mapped(void* ptr) const { return ((page_idx(ptr) < (num_chunks * K)) && (page_mem(page_idx(ptr), sizeof(uint32_t)) == ptr)); }
 	bool alloced(void* ptr) const { return ((page_index < (num_chunks * K)) && (page_mem(page_index, sizeof(uint32_t)) == ptr)); }
@@ -217,6 +222,7 @@ private:
 
 	size_t num_chunks = 0;
 	size_t page_index = 0;
+	size_t num_allocs = 0;
 };
 
 
@@ -240,6 +246,7 @@ public:
 			i = indcs[--free_page_count];
 		}
 
+		num_allocs += 1;
 		return (pages[curr_page_index = i].data());
 	}
 
@@ -275,6 +282,7 @@ public:
 	size_t alloc_size() const { return (used_page_count * PAGE_SIZE()); } // size of total number of pages added over the pool's lifetime
 	size_t freed_size() const { return (free_page_count * PAGE_SIZE()); } // size of number of pages that were freed and are awaiting reuse
 	size_t total_size() const { return (NUM_PAGES() * PAGE_SIZE()); }
+	size_t alloc_count() const { return num_allocs; } // number of allocations made over the pool's lifetime
 	size_t base_offset(const void* p) const { return (reinterpret_cast<const uint8_t*>(p) - reinterpret_cast<const uint8_t*>(pages[0].data())); }
 
 	bool mapped(const void* p) const { return (((base_offset(p) / PAGE_SIZE()) < total_size()) && ((base_offset(p) % PAGE_SIZE()) == 0)); }
@@ -300,6 +308,7 @@ private:
 	size_t used_page_count = 0;
 	size_t free_page_count = 0; // indcs[fpc-1] is the last recycled page
 	size_t curr_page_index = 0;
+	size_t num_allocs = 0;
 };
 
 #endif
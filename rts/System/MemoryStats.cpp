@@ -0,0 +1,215 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+
+#include "System/MemoryStats.h"
+#include "System/MainDefines.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/Log/ILog.h"
+
+CONFIG(int, MemoryStatsCSVInterval).defaultValue(0).minimumValue(0).description("If > 0, append the memory statistics of every engine subsystem (see /debugmemory) to MemoryStatsCSVFile once per N seconds.");
+CONFIG(std::string, MemoryStatsCSVFile).defaultValue("memstats.csv").description("File (relative to the write-dir) that MemoryStatsCSVInterval rows are appended to.");
+
+
+CMemoryStats memoryStats;
+
+
+void CMemoryStats::Init()
+{
+	const int interval = configHandler->GetInt("MemoryStatsCSVInterval");
+
+	lastSampleTime = spring_gettime();
+	lastWriteTime = lastSampleTime;
+	csvInterval = spring_secs(interval);
+
+	if (interval <= 0)
+		return;
+
+	const std::string& fileName = dataDirsAccess.LocateFile(configHandler->GetString("MemoryStatsCSVFile"), FileQueryFlags::WRITE);
+
+	if ((csvFile = fopen(fileName.c_str(), "a")) == nullptr) {
+		LOG_L(L_WARNING, "[MemoryStats::%s] could not open \"%s\" for writing", __func__, fileName.c_str());
+		return;
+	}
+
+	if (ftell(csvFile) == 0)
+		fprintf(csvFile, "time,game_id,frame,subsystem,live_bytes,peak_bytes,reserved_bytes,allocs_per_sec,fragmentation\n");
+}
+
+void CMemoryStats::Kill()
+{
+	if (csvFile != nullptr)
+		fclose(csvFile);
+
+	csvFile = nullptr;
+
+	// peaks are per game
+	stats.clear();
+	gameID.clear();
+}
+
+void CMemoryStats::SetGameID(const unsigned char* id, unsigned int numBytes)
+{
+	char buf[3];
+
+	gameID.clear();
+
+	for (unsigned int i = 0; i < numBytes; i++) {
+		snprintf(buf, sizeof(buf), "%02x", id[i]);
+		gameID += buf;
+	}
+}
+
+
+void CMemoryStats::AddSubsystem(const std::string& name, SampleFunc func)
+{
+	const auto pred = [&](const Subsystem& s) { return (s.name == name); };
+	const auto iter = std::find_if(subsystems.begin(), subsystems.end(), pred);
+
+	if (iter != subsystems.end()) {
+		iter->func = std::move(func);
+		return;
+	}
+
+	subsystems.push_back({name, std::move(func)});
+}
+
+void CMemoryStats::RemoveSubsystem(const std::string& name)
+{
+	const auto pred = [&](const Subsystem& s) { return (s.name == name); };
+	const auto iter = std::find_if(subsystems.begin(), subsystems.end(), pred);
+
+	if (iter == subsystems.end())
+		return;
+
+	subsystems.erase(iter);
+}
+
+
+CMemoryStats::Stats& CMemoryStats::GetNode(const std::string& name)
+{
+	const auto pred = [](const Stats& s, const std::string& n) { return (s.name < n); };
+	const auto iter = std::lower_bound(stats.begin(), stats.end(), name, pred);
+
+	if (iter != stats.end() && iter->name == name)
+		return *iter;
+
+	Stats node = {name, 0, 0, 0, 0, 0.0f, 0.0f, unsigned(std::count(name.begin(), name.end(), '/')), false, false};
+	return *stats.insert(iter, std::move(node));
+}
+
+
+void CMemoryStats::Update(int frameNum)
+{
+	SampleSubsystems();
+
+	if (csvFile == nullptr)
+		return;
+	if ((lastSampleTime - lastWriteTime) < csvInterval)
+		return;
+
+	lastWriteTime = lastSampleTime;
+	WriteCSV(frameNum);
+}
+
+void CMemoryStats::SampleSubsystems()
+{
+	const spring_time now = spring_gettime();
+	const float dt = std::max((now - lastSampleTime).toSecsf(), 0.001f);
+
+	lastSampleTime = now;
+
+	std::vector<size_t> prevAllocs;
+	prevAllocs.reserve(stats.size() + subsystems.size() * 2);
+
+	// create missing nodes first, inserting shifts the others
+	for (const Subsystem& sub: subsystems) {
+		for (size_t pos = sub.name.find('/'); pos != std::string::npos; pos = sub.name.find('/', pos + 1)) {
+			GetNode(sub.name.substr(0, pos));
+		}
+
+		GetNode(sub.name);
+	}
+
+	for (Stats& node: stats) {
+		prevAllocs.push_back(node.numAllocs);
+
+		node.liveBytes = 0;
+		node.resvBytes = 0;
+		node.numAllocs = 0;
+		node.touched = false;
+	}
+
+	for (const Subsystem& sub: subsystems) {
+		Sample sample;
+		sub.func(sample);
+
+		// reserved memory can not be less than what is in use
+		sample.resvBytes = std::max(sample.resvBytes, sample.liveBytes);
+
+		for (size_t pos = 0; pos != std::string::npos; pos = sub.name.find('/', pos + 1)) {
+			Stats& node = GetNode((pos == 0)? sub.name: sub.name.substr(0, pos));
+
+			node.liveBytes += sample.liveBytes;
+			node.resvBytes += sample.resvBytes;
+			node.numAllocs += sample.numAllocs;
+			node.touched = true;
+		}
+	}
+
+	for (size_t i = 0; i < stats.size(); i++) {
+		Stats& node = stats[i];
+
+		if (!node.touched)
+			continue;
+
+		// counters may be reset by their owner, treat that as a restart from zero
+		const size_t allocDelta = node.numAllocs - prevAllocs[i] * (node.numAllocs >= prevAllocs[i]);
+
+		node.peakBytes = std::max(node.peakBytes, node.liveBytes);
+		node.allocRate = (allocDelta / dt) * node.sampled;
+		node.fragmentation = (node.resvBytes > 0)? (1.0f - node.liveBytes / float(node.resvBytes)): 0.0f;
+		node.sampled = true;
+	}
+
+	// drop nodes whose subsystems have been removed
+	stats.erase(std::remove_if(stats.begin(), stats.end(), [](const Stats& s) { return (!s.touched); }), stats.end());
+}
+
+
+void CMemoryStats::WriteCSV(int frameNum)
+{
+	const float time = lastSampleTime.toSecsf();
+
+	for (const Stats& node: stats) {
+		fprintf(csvFile, "%.1f,%s,%d,%s," _STPF_ "," _STPF_ "," _STPF_ ",%.1f,%.3f\n", time, gameID.c_str(), frameNum, node.name.c_str(), node.liveBytes, node.peakBytes, node.resvBytes, node.allocRate, node.fragmentation);
+	}
+
+	fflush(csvFile);
+}
+
+void CMemoryStats::LogStats(const std::string& prefix) const
+{
+	LOG("[MemoryStats::%s] %u subsystems (KB)", __func__, unsigned(subsystems.size()));
+	LOG("\t%-36s %10s %10s %10s %10s %6s", "subsystem", "live", "peak", "reserved", "allocs/s", "frag");
+
+	for (const Stats& node: stats) {
+		if (node.name.compare(0, prefix.size(), prefix) != 0)
+			continue;
+
+		// indent children below their parent
+		const std::string label = std::string(node.depth * 2, ' ') + node.name.substr(node.name.rfind('/') + 1);
+
+		LOG(
+			"\t%-36s %10.1f %10.1f %10.1f %10.1f %5.1f%%",
+			label.c_str(),
+			node.liveBytes / 1024.0f,
+			node.peakBytes / 1024.0f,
+			node.resvBytes / 1024.0f,
+			node.allocRate,
+			node.fragmentation * 100.0f
+		);
+	}
+}
@@ -0,0 +1,109 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "System/Misc/SpringTime.h"
+
+/**
+ * @brief Per-subsystem memory accounting
+ *
+ * Subsystems (memory pools, large container owners, ...) register a sampling
+ * callback under a '/'-separated name such as "Sim/Units"; every parent node
+ * ("Sim") reports the sum of its children. Callbacks are only polled by
+ * Update (once per second, see CGame::AddTimedJobs) so allocation paths
+ * carry no extra cost, at the price of short-lived peaks going unobserved.
+ *
+ * Not thread-safe, registration and sampling happen on the main thread.
+ */
+class CMemoryStats
+{
+public:
+	struct Sample {
+		/// bytes currently in use
+		size_t liveBytes = 0;
+		/// bytes held by the subsystem, including free pages awaiting reuse
+		size_t resvBytes = 0;
+		/// allocations made since an arbitrary point in time, 0 if not tracked
+		size_t numAllocs = 0;
+	};
+
+	struct Stats {
+		std::string name;
+
+		size_t liveBytes;
+		size_t peakBytes;
+		size_t resvBytes;
+		size_t numAllocs;
+
+		/// allocations per second between the last two samples
+		float allocRate;
+		/// fraction of reserved memory not currently in use
+		float fragmentation;
+
+		/// number of '/' separators in name, 0 for top-level nodes
+		unsigned int depth;
+
+		// internal bookkeeping
+		bool sampled;
+		bool touched;
+	};
+
+	typedef std::function<void(Sample&)> SampleFunc;
+
+public:
+	template<typename P> static void SamplePool(const P& pool, Sample& s) {
+		s.liveBytes += (pool.alloc_size() - pool.freed_size());
+		s.resvBytes += pool.alloc_size();
+		s.numAllocs += pool.alloc_count();
+	}
+
+	void Init();
+	void Kill();
+
+	void AddSubsystem(const std::string& name, SampleFunc func);
+	void RemoveSubsystem(const std::string& name);
+
+	/// tags the CSV rows, so files shared by several games can be told apart
+	void SetGameID(const unsigned char* id, unsigned int numBytes);
+
+	/// polls all subsystems, and appends a CSV row per node if due
+	void Update(int frameNum);
+	void SampleSubsystems();
+
+	void LogStats(const std::string& prefix) const;
+
+	/// sorted by name, parents precede their children
+	const std::vector<Stats>& GetStats() const { return stats; }
+
+private:
+	Stats& GetNode(const std::string& name);
+
+	void WriteCSV(int frameNum);
+
+private:
+	struct Subsystem {
+		std::string name;
+		SampleFunc func;
+	};
+
+	std::vector<Subsystem> subsystems;
+	std::vector<Stats> stats;
+
+	spring_time lastSampleTime;
+	spring_time lastWriteTime;
+	spring_time csvInterval;
+
+	std::string gameID;
+
+	FILE* csvFile = nullptr;
+};
+
+extern CMemoryStats memoryStats;
+
+#endif // MEMORY_STATS_H
@@ -0,0 +1,87 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _LATENCY_HISTOGRAM_H
+#define _LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <string>
+
+#include "System/Misc/SpringTime.h"
+#include "System/SpringFormat.h"
+
+namespace netcode
+{
+
+/**
+ * @brief Histogram of time intervals with power-of-two microsecond buckets
+ * Bucket i counts samples in [2^(i-1), 2^i) us, bucket 0 those below 1us and
+ * the last bucket everything from ~0.5s upwards. Percentiles are reported as
+ * the upper bound of the bucket they fall into, so they are conservative.
+ */
+class LatencyHistogram
+{
+public:
+	static constexpr unsigned int NUM_BUCKETS = 21;
+
+	void AddSample(spring_time t) {
+		const int64_t us = std::max(t.toMicroSecsi(), int64_t(0));
+
+		unsigned int i = 0;
+
+		while (i < (NUM_BUCKETS - 1) && (int64_t(1) << i) <= us)
+			i++;
+
+		buckets[i] += 1;
+		numSamples += 1;
+		sumMicroSecs += us;
+		maxMicroSecs = std::max(maxMicroSecs, us);
+	}
+
+	void Reset() { *this = {}; }
+
+	uint64_t GetCount() const { return numSamples; }
+	uint64_t GetBucketCount(unsigned int i) const { return buckets[i]; }
+
+	/// @return upper bound (in microseconds) of the bucket containing the p-th percentile, p in [0, 1]
+	int64_t GetPercentile(float p) const {
+		const uint64_t rank = std::max(uint64_t(numSamples * p + 0.5f), uint64_t(1));
+
+		uint64_t sum = 0;
+
+		for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+			if ((sum += buckets[i]) >= rank)
+				return std::min(int64_t(1) << i, maxMicroSecs);
+		}
+
+		return maxMicroSecs;
+	}
+
+	std::string ToString() const {
+		if (numSamples == 0)
+			return "no samples";
+
+		return spring::format(
+			"n=%" PRIu64 " avg=%.3fms p50<=%.3fms p90<=%.3fms p99<=%.3fms max=%.3fms",
+			numSamples,
+			sumMicroSecs * 0.001f / numSamples,
+			GetPercentile(0.50f) * 0.001f,
+			GetPercentile(0.90f) * 0.001f,
+			GetPercentile(0.99f) * 0.001f,
+			maxMicroSecs * 0.001f
+		);
+	}
+
+private:
+	std::array<uint64_t, NUM_BUCKETS> buckets = {};
+
+	uint64_t numSamples = 0;
+
+	int64_t sumMicroSecs = 0;
+	int64_t maxMicroSecs = 0;
+};
+
+}
+
+#endif // _LATENCY_HISTOGRAM_H
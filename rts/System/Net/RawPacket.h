@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 
+#include "System/Misc/SpringTime.h"
 #include "System/SafeVector.h"
 
 namespace netcode
@@ -67,6 +68,7 @@ public:
 		length = p.length;
 		p.length = 0;
 
+		recvTime = p.recvTime;
 		return *this;
 	}
 
@@ -128,6 +130,9 @@ public:
 
 	uint32_t pos = 0;
 	uint32_t length = 0;
+
+	/// arrival time of the datagram that completed this message, if received from a socket
+	spring_time recvTime = spring_notime;
 };
 
 } // namespace netcode
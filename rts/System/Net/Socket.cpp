@@ -4,6 +4,12 @@
 
 #include "lib/streflop/streflop_cond.h"
 
+#ifdef __linux__
+	#include <sys/ioctl.h>
+	#include <sys/time.h>
+	#include <linux/sockios.h>
+#endif
+
 #include "System/Log/ILog.h"
 #include "System/StringUtil.h"
 
@@ -97,5 +103,27 @@ asio::ip::address GetAnyAddress(const bool IPv6)
 }
 
 
+spring_time GetLastRecvTime(asio::ip::udp::socket& socket)
+{
+	const spring_time curTime = spring_gettime();
+
+#if defined(__linux__) && defined(SIOCGSTAMP)
+	timeval recvStamp;
+	timeval curStamp;
+
+	// the first call enables timestamping and fails, fall back to curTime
+	if (ioctl(socket.native_handle(), SIOCGSTAMP, &recvStamp) != 0 || gettimeofday(&curStamp, nullptr) != 0)
+		return curTime;
+
+	const std::int64_t age = (curStamp.tv_sec - recvStamp.tv_sec) * std::int64_t(1000000) + (curStamp.tv_usec - recvStamp.tv_usec);
+
+	// both stamps are wall-clock time; ignore them if it jumped in between
+	if (age >= 0 && age < std::int64_t(1000000))
+		return (curTime - spring_time::fromMicroSecs(age));
+#endif
+
+	return curTime;
+}
+
 } // namespace netcode
 
@@ -7,6 +7,8 @@
 #include <asio/ip/udp.hpp>
 #include <asio/ip/tcp.hpp>
 
+#include "System/Misc/SpringTime.h"
+
 
 namespace netcode
 {
@@ -45,6 +47,13 @@ asio::ip::udp::resolver::iterator WrapResolve(
 
 asio::ip::address GetAnyAddress(const bool IPv6);
 
+/**
+ * Returns when the datagram last read from socket arrived. Uses the kernel's
+ * receive timestamp where available (Linux), so time a datagram spent in the
+ * socket buffer before being read is included; otherwise the current time.
+ */
+spring_time GetLastRecvTime(asio::ip::udp::socket& socket);
+
 } // namespace netcode
 
 #endif // SOCKET_H
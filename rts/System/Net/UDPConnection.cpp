@@ -3,6 +3,7 @@
 #include "UDPConnection.h"
 
 #include <cinttypes>
+#include <cstring>
 
 
 #include "Socket.h"
@@ -15,6 +16,7 @@
 #include "System/Log/ILog.h"
 #include "System/SpringFormat.h"
 #include "System/SafeUtil.h"
+#include "System/Threading/SpringThreading.h"
 
 #ifndef UNIT_TEST
 CONFIG(bool, UDPConnectionLogDebugMessages).defaultValue(false);
@@ -96,8 +98,8 @@ public:
 		pos += sizeof(t);
 	}
 
-	void Unpack(std::vector<std::uint8_t>& t, unsigned unpackLength) {
-		std::copy(data + pos, data + pos + unpackLength, std::back_inserter(t));
+	void Unpack(std::uint8_t* t, unsigned unpackLength) {
+		std::memcpy(t, data + pos, unpackLength);
 		pos += unpackLength;
 	}
 
@@ -129,19 +131,90 @@ public:
 		std::copy(_data.begin(), _data.end(), std::back_inserter(data));
 	}
 
+	void Pack(const std::uint8_t* _data, unsigned packLength) {
+		data.insert(data.end(), _data, _data + packLength);
+	}
+
 private:
 	std::vector<std::uint8_t>& data;
 };
 
 
 
+/**
+ * @brief Allocator recycling the storage of allocate_shared'ed chunks
+ * Object and control-block share one allocation, so a chunk costs no heap
+ * traffic once the free-list is warm. The list is shared by all threads
+ * (server and client connections may live on different ones); it is never
+ * destroyed since chunks can outlive static objects.
+ */
+template<typename T> class ChunkAllocator
+{
+public:
+	typedef T value_type;
+
+	ChunkAllocator() = default;
+	template<typename U> ChunkAllocator(const ChunkAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		if (n == 1) {
+			FreeList& fl = GetFreeList();
+			std::lock_guard<spring::spinlock> lock(fl.mutex);
+
+			if (!fl.blocks.empty()) {
+				void* p = fl.blocks.back();
+				fl.blocks.pop_back();
+				return (static_cast<T*>(p));
+			}
+		}
+
+		return (static_cast<T*>(::operator new(n * sizeof(T))));
+	}
+
+	void deallocate(T* p, size_t n) {
+		if (n == 1) {
+			FreeList& fl = GetFreeList();
+			std::lock_guard<spring::spinlock> lock(fl.mutex);
+
+			if (fl.blocks.size() < maxFreeBlocks) {
+				fl.blocks.push_back(p);
+				return;
+			}
+		}
+
+		::operator delete(p);
+	}
+
+	template<typename U> bool operator == (const ChunkAllocator<U>&) const { return true; }
+	template<typename U> bool operator != (const ChunkAllocator<U>&) const { return false; }
+
+private:
+	static constexpr size_t maxFreeBlocks = 8192;
+
+	struct FreeList {
+		spring::spinlock mutex;
+		std::vector<void*> blocks;
+	};
+
+	// one list per rebound type, i.e. per block-size
+	static FreeList& GetFreeList() {
+		static FreeList* fl = new FreeList();
+		return *fl;
+	}
+};
+
+
+ChunkPtr Chunk::Create() {
+	return (std::allocate_shared<Chunk>(ChunkAllocator<Chunk>()));
+}
+
 void Chunk::UpdateChecksum(CRC& crc) const {
 
 	crc << chunkNumber;
 	crc << (unsigned int)chunkSize;
 
-	if (!data.empty()) {
-		crc.Update(&data[0], data.size());
+	if (chunkSize > 0) {
+		crc.Update(&data[0], chunkSize);
 	}
 }
 
@@ -171,15 +244,15 @@ Packet::Packet(const unsigned char* data, unsigned length)
 	chunks.reserve(buf.Remaining() / Chunk::headerSize);
 
 	while (buf.Remaining() > Chunk::headerSize) {
-		ChunkPtr temp(new Chunk);
+		ChunkPtr temp = Chunk::Create();
 		buf.Unpack(temp->chunkNumber);
 		buf.Unpack(temp->chunkSize);
 
 		// defective, ignore
-		if (buf.Remaining() < temp->chunkSize)
+		if (buf.Remaining() < temp->chunkSize || temp->chunkSize > Chunk::maxSize)
 			break;
 
-		buf.Unpack(temp->data, temp->chunkSize);
+		buf.Unpack(&temp->data[0], temp->chunkSize);
 		chunks.push_back(temp);
 	}
 }
@@ -224,7 +297,7 @@ void Packet::Serialize(std::vector<std::uint8_t>& data)
 	for (auto ci = chunks.begin(); ci != chunks.end(); ++ci) {
 		buf.Pack((*ci)->chunkNumber);
 		buf.Pack((*ci)->chunkSize);
-		buf.Pack((*ci)->data);
+		buf.Pack(&(*ci)->data[0], (*ci)->chunkSize);
 	}
 }
 
@@ -460,6 +533,7 @@ void UDPConnection::Update()
 				continue;
 
 			Packet data(&recvBuffer[0], bytesReceived);
+			data.recvTime = GetLastRecvTime(*mySocket);
 
 			if (IsUsingAddress(udpEndPoint))
 				ProcessRawPacket(data);
@@ -479,7 +553,7 @@ void UDPConnection::UpdateWaitingPackets()
 {
 	const auto beg = waitingPackets.begin();
 	const auto end = waitingPackets.end();
-	const auto pos = std::remove_if(beg, end, [](const std::pair<int, RawPacket>& p) { return ((p.second).length == 0); });
+	const auto pos = std::remove_if(beg, end, [](const std::pair<int, ChunkPtr>& p) { return (p.second == nullptr); });
 
 	// erase processed packets
 	waitingPackets.erase(pos, end);
@@ -600,7 +674,8 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			continue;
 		}
 
-		waitingPackets.emplace_back(c->chunkNumber, std::move(RawPacket(&c->data[0], c->data.size())));
+		// keep the chunk itself, its payload is only copied once it can be reassembled
+		waitingPackets.emplace_back(c->chunkNumber, c);
 		incomingChunkNums.insert(c->chunkNumber);
 	}
 
@@ -608,7 +683,7 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 	using P = decltype(waitingPackets)::value_type;
 
 	const auto cmpPred = [](const P& a, const P& b) { return (a.first < b.first); };
-	const auto binFind = [&](int cn) { return std::lower_bound(waitingPackets.begin(), waitingPackets.end(), P{cn, RawPacket{}}, cmpPred); };
+	const auto binFind = [&](int cn) { return std::lower_bound(waitingPackets.begin(), waitingPackets.end(), P{cn, nullptr}, cmpPred); };
 
 	std::sort(waitingPackets.begin(), waitingPackets.end(), cmpPred);
 
@@ -624,13 +699,13 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			fragmentBuffer.Delete();
 		}
 
-		std::copy(wpi->second.data, wpi->second.data + wpi->second.length, std::back_inserter(waitBuffer));
+		waitBuffer.insert(waitBuffer.end(), wpi->second->data.begin(), wpi->second->data.begin() + wpi->second->chunkSize);
 
 		incomingChunkNums.erase(wpi->first);
 		// waitingPackets.erase(wpi);
 
 		// mark as processed
-		(wpi->second).Delete();
+		(wpi->second).reset();
 
 		// next expected chunk-number
 		lastInOrder++;
@@ -644,7 +719,11 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 
 			// this returns false for zero/invalid pktLength
 			if (ProtocolDef::GetInstance()->IsValidLength(pktLength, msgLength)) {
-				msgQueue.emplace_back(new RawPacket(bufp, pktLength));
+				RawPacket* msg = new RawPacket(bufp, pktLength);
+
+				msg->recvTime = incoming.recvTime;
+				msgQueue.emplace_back(msg);
+
 				std::shared_ptr<const RawPacket>& msgPacket = msgQueue.back();
 
 				#ifdef ENABLE_DEBUG_STATS
@@ -749,9 +828,15 @@ void UDPConnection::Flush(const bool forced)
 
 					if ((partialPacket = (numBytes != packet->length))) {
 						// partially transfered
-						packet.reset(new RawPacket(packet->data + numBytes, packet->length - numBytes));
+						RawPacket* remainder = new RawPacket(packet->data + numBytes, packet->length - numBytes);
+
+						remainder->recvTime = packet->recvTime;
+						packet.reset(remainder);
 					} else {
 						// full packet copied
+						if (relayLatency != nullptr && spring_istime(packet->recvTime) && packet->recvTime >= unmuteTime)
+							relayLatency->AddSample(curTime - packet->recvTime);
+
 						outgoingData.pop_front();
 					}
 				}
@@ -835,10 +920,10 @@ void UDPConnection::SetMTU(unsigned mtu2)
 void UDPConnection::CreateChunk(const unsigned char* data, const unsigned length, const int packetNum)
 {
 	assert((length > 0) && (length < 255));
-	ChunkPtr buf(new Chunk);
+	ChunkPtr buf = Chunk::Create();
 	buf->chunkNumber = packetNum;
 	buf->chunkSize = length;
-	std::copy(data, data + length, std::back_inserter(buf->data));
+	std::memcpy(&buf->data[0], data, length);
 	newChunks.push_back(buf);
 	lastChunkCreatedTime = spring_gettime();
 }
@@ -953,7 +1038,8 @@ void UDPConnection::SendIfNecessary(bool flushed)
 
 
 	while (((outgoing.GetAverage() <= globalConfig.linkOutgoingBandwidth) || (globalConfig.linkOutgoingBandwidth <= 0))) {
-		Packet buf(lastInOrder, nak);
+		Packet& buf = sendPacket;
+		buf.Reset(lastInOrder, nak);
 
 		if (nak > 0) {
 			buf.naks.resize(nak);
@@ -1028,6 +1114,9 @@ void UDPConnection::SendIfNecessary(bool flushed)
 
 		SendPacket(buf);
 
+		// do not hold on to the chunks, acks release them
+		buf.chunks.clear();
+
 		if (!sent || (maxResend == 0 && newChunks.empty()))
 			break;
 	}
@@ -4,10 +4,12 @@
 #define _UDP_CONNECTION_H
 
 #include <asio/ip/udp.hpp>
+#include <array>
 #include <memory>
 #include <deque>
 
 #include "Connection.h"
+#include "LatencyHistogram.h"
 #include "System/Misc/SpringTime.h"
 #include "System/UnorderedSet.hpp"
 
@@ -26,18 +28,24 @@ namespace netcode {
 #define PACKET_MAX_LATENCY 1250               // in [milliseconds] maximum latency
 #define ENABLE_DEBUG_STATS
 
+class Chunk;
+typedef std::shared_ptr<Chunk> ChunkPtr;
+
 class Chunk
 {
 public:
-	unsigned GetSize() const { return (data.size() + headerSize); }
+	/// chunks are recycled through a free-list, use this instead of new
+	static ChunkPtr Create();
+
+	unsigned GetSize() const { return (chunkSize + headerSize); }
 	void UpdateChecksum(CRC& crc) const;
 	static constexpr unsigned maxSize = 254;
 	static constexpr unsigned headerSize = 5;
 	std::int32_t chunkNumber;
 	std::uint8_t chunkSize;
-	std::vector<std::uint8_t> data;
+	/// payload, only the first chunkSize bytes are valid
+	std::array<std::uint8_t, maxSize> data;
 };
-typedef std::shared_ptr<Chunk> ChunkPtr;
 
 
 class Packet
@@ -46,8 +54,17 @@ public:
 	static constexpr unsigned headerSize = 6;
 	Packet(const unsigned char* data, unsigned length);
 	Packet(int _lastCont, int _nakType) {
+		Reset(_lastCont, _nakType);
+	}
+
+	/// reinitialize for sending, keeps the capacity of naks and chunks
+	void Reset(int _lastCont, int _nakType) {
 		lastContinuous = _lastCont;
 		nakType = _nakType;
+		checksum = 0;
+
+		naks.clear();
+		chunks.clear();
 	}
 
 	unsigned GetSize() const;
@@ -64,6 +81,9 @@ public:
 
 	std::vector<std::uint8_t> naks;
 	std::vector<ChunkPtr> chunks;
+
+	/// when the datagram was received (only set for incoming packets)
+	spring_time recvTime;
 };
 
 
@@ -128,10 +148,19 @@ public:
 	bool UseMinLossFactor() const { return (netLossFactor == MIN_LOSS_FACTOR); }
 
 	/// Connections are stealth by default, this allow them to send data
-	void Unmute() override { muted = false; }
+	void Unmute() override { muted = false; unmuteTime = spring_gettime(); }
 	void Close(bool flush) override;
 	void SetLossFactor(int factor) override;
 
+	/**
+	 * @brief record relay latencies into histogram
+	 * Every outgoing message that was received from a socket adds the time
+	 * between its receipt and the flush that sent its last byte, unless it
+	 * was received before this connection was unmuted (i.e. was replayed
+	 * from a cache rather than relayed).
+	 */
+	void SetRelayLatency(std::shared_ptr<LatencyHistogram> histogram) { relayLatency = std::move(histogram); }
+
 	const asio::ip::udp::endpoint& GetEndpoint() const { return addr; }
 
 private:
@@ -174,6 +203,9 @@ private:
 	/// maximum size of packets to send
 	unsigned int mtu;
 
+	/// when Unmute was last called
+	spring_time unmuteTime;
+
 	bool muted;
 	bool closed;
 	bool resend;
@@ -185,8 +217,8 @@ private:
 
 	/// outgoing stuff (pure data without header) waiting to be sent
 	std::deque< std::shared_ptr<const RawPacket> > outgoingData;
-	/// packets we have received but not yet read
-	std::vector< std::pair<int, RawPacket> > waitingPackets;
+	/// chunks we have received but not yet read, nullptr once processed
+	std::vector< std::pair<int, ChunkPtr> > waitingPackets;
 	spring::unordered_set<int> incomingChunkNums;
 
 
@@ -202,6 +234,9 @@ private:
 	/// complete packets we received but did not yet consume
 	std::deque< std::shared_ptr<const RawPacket> > msgQueue;
 
+	/// reused by SendIfNecessary
+	Packet sendPacket{-1, 0};
+
 	std::vector<std::uint8_t> sendBuffer;
 	std::vector<std::uint8_t> recvBuffer;
 	std::vector<std::uint8_t> waitBuffer;
@@ -224,6 +259,8 @@ private:
 
 	RawPacket fragmentBuffer;
 
+	std::shared_ptr<LatencyHistogram> relayLatency;
+
 	// Traffic statistics and stuff
 	#ifdef ENABLE_DEBUG_STATS
 	float sumDeltaFramePacketRecvTime;
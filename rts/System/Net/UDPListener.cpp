@@ -7,11 +7,15 @@
 #endif
 #include "System/Misc/NonCopyable.h"
 
+#include <algorithm>
 #include <memory>
 #include <asio.hpp>
 #include <cinttypes>
 #include <queue>
 
+#ifndef _WIN32
+	#include <sys/select.h>
+#endif
 
 #include "ProtocolDef.h"
 #include "UDPConnection.h"
@@ -25,7 +29,9 @@ namespace netcode
 {
 using namespace asio;
 
-UDPListener::UDPListener(int port, const std::string& ip): acceptNewConnections(false)
+UDPListener::UDPListener(int port, const std::string& ip)
+	: acceptNewConnections(false)
+	, relayLatency(std::make_shared<LatencyHistogram>())
 {
 	// resets socket on any exception
 	const std::string err = TryBindSocket(port, socket, ip);
@@ -135,6 +141,7 @@ void UDPListener::Update() {
 			continue;
 
 		Packet data(&recvBuffer[0], bytesReceived);
+		data.recvTime = GetLastRecvTime(*socket);
 
 		if (ci != connMap.end()) {
 			ci->second.lock()->ProcessRawPacket(data);
@@ -185,10 +192,41 @@ void UDPListener::Update() {
 	}
 }
 
+bool UDPListener::Wait(spring_time timeout) const {
+	if (socket->available() > 0)
+		return true;
+
+	const int64_t us = std::max(timeout.toMicroSecsi(), int64_t(0));
+	const auto fd = socket->native_handle();
+
+	timeval tv;
+	tv.tv_sec = us / 1000000;
+	tv.tv_usec = us % 1000000;
+
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(fd, &readSet);
+
+	// first argument is ignored on Windows
+	return (select(int(fd) + 1, &readSet, nullptr, nullptr, &tv) > 0);
+}
+
+void UDPListener::FlushConnections() {
+	for (const auto& p: connMap) {
+		const std::shared_ptr<UDPConnection> conn = p.second.lock();
+
+		if (conn == nullptr)
+			continue;
+
+		conn->Flush(false);
+	}
+}
+
 
 std::shared_ptr<UDPConnection> UDPListener::SpawnConnection(const std::string& ip, const unsigned port)
 {
 	std::shared_ptr<UDPConnection> newConn(new UDPConnection(socket, ip::udp::endpoint(WrapIP(ip), port)));
+	newConn->SetRelayLatency(relayLatency);
 	connMap[newConn->GetEndpoint()] = newConn;
 	return newConn;
 }
@@ -197,6 +235,7 @@ std::shared_ptr<UDPConnection> UDPListener::AcceptConnection()
 {
 	std::shared_ptr<UDPConnection> newConn = waiting.front();
 	waiting.pop();
+	newConn->SetRelayLatency(relayLatency);
 	connMap[newConn->GetEndpoint()] = newConn;
 	return newConn;
 }
@@ -3,7 +3,9 @@
 #ifndef _UDP_LISTENER_H
 #define _UDP_LISTENER_H
 
+#include "LatencyHistogram.h"
 #include "System/Misc/NonCopyable.h"
+#include "System/Misc/SpringTime.h"
 #include <memory>
 #include <asio/ip/udp.hpp>
 #include <map>
@@ -55,6 +57,21 @@ public:
 	 */
 	void Update();
 
+	/**
+	 * @brief Block until the socket has data to read or timeout expires
+	 * Lets a caller sleep only as long as nothing arrives, instead of a fixed
+	 * interval between Update calls.
+	 * @return true if data is available
+	 */
+	bool Wait(spring_time timeout) const;
+
+	/**
+	 * @brief Flush all connections
+	 * Sends what was queued since the last Update without waiting for the
+	 * next one; unforced, so the per-connection rate limits still apply.
+	 */
+	void FlushConnections();
+
 	/**
 	 * Set if we are accepting new connections
 	 * or drop all data from unconnected addresses.
@@ -75,6 +92,9 @@ public:
 	void RejectConnection() { waiting.pop(); }
 	void UpdateConnections(); // Updates connections when the endpoint has been reconnected
 
+	/// time from receiving a message until a connection flushed its relay, over all connections
+	LatencyHistogram& GetRelayLatency() { return *relayLatency; }
+
 private:
 	/**
 	 * @brief Do we accept packets from unknown sources?
@@ -92,6 +112,9 @@ private:
 	std::map< std::string, size_t> dropMap;
 
 	std::queue< std::shared_ptr<UDPConnection> > waiting;
+
+	/// shared with every spawned or accepted connection
+	std::shared_ptr<LatencyHistogram> relayLatency;
 };
 
 }
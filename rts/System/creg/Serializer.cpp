@@ -18,7 +18,6 @@
 #include <fstream>
 #include <cassert>
 #include <stdexcept>
-#include <map>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -26,7 +25,6 @@
 
 using namespace creg;
 using std::string;
-using std::map;
 using std::vector;
 
 LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_CREG_SERIALIZER)
@@ -103,6 +101,9 @@ template<typename T>
 void WriteVarSizeUInt(std::ostream* stream, T val)
 {
 	std::uint64_t v = val;
+	// at most 10 groups of 7 bits, written with a single call
+	unsigned char buf[10];
+	unsigned int len = 0;
 	do {
 		unsigned char a = v & 0x7F;
 		v >>= 7;
@@ -110,8 +111,10 @@ void WriteVarSizeUInt(std::ostream* stream, T val)
 		if (v > 0)
 			a |= 0x80;
 
-		stream->write((char*)&a, sizeof(char));
+		buf[len++] = a;
 	} while (v > 0);
+
+	stream->write((char*)&buf[0], len);
 }
 
 //-------------------------------------------------------------------------
@@ -129,24 +132,48 @@ bool COutputStreamSerializer::IsWriting()
 
 COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	std::vector<ObjectRef*>& refs = ptrToId[inst];
-	for (auto& obj: refs) {
+	const auto it = ptrToId.find(inst);
+
+	if (it == ptrToId.end())
+		return nullptr;
+
+	for (ObjectRef* obj = it->second; obj != nullptr; obj = obj->nextRef) {
 		if (obj->isThisObject(inst, objClass, isEmbedded))
 			return obj;
 	}
 	return nullptr;
 }
 
-void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* objr)
+COutputStreamSerializer::ObjectRef* COutputStreamSerializer::AddObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	const unsigned objstart = stream->tellp();
+	objects.emplace_back(inst, objects.size(), isEmbedded, objClass);
 
-	if (c->base())
-		SerializeObject(c->base(), ptr, objr);
+	ObjectRef* obj = &objects.back();
+	ObjectRef*& head = ptrToId[inst];
+
+	// keep the first registered reference first, as the former per-address list did
+	if (head != nullptr) {
+		ObjectRef* tail = head;
 
-	ObjectMemberGroup omg;
-	omg.membersClass = c;
-	omg.size = 0;
+		while (tail->nextRef != nullptr)
+			tail = tail->nextRef;
+
+		tail->nextRef = obj;
+	} else {
+		head = obj;
+	}
+
+	return obj;
+}
+
+void COutputStreamSerializer::SerializeObject(Class* c, void* ptr)
+{
+	const bool logDebug = LOG_IS_ENABLED_S(LOG_SECTION_CREG_SERIALIZER, L_DEBUG);
+	const bool countSizes = LOG_IS_ENABLED(L_DEBUG);
+	const unsigned objstart = countSizes? unsigned(stream->tellp()): 0;
+
+	if (c->base())
+		SerializeObject(c->base(), ptr);
 
 	for (uint a = 0; a < c->members.size(); a++)
 	{
@@ -154,34 +181,25 @@ void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* ob
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		ObjectMember om;
-		om.member = m;
-		om.memberId = a;
 		void* memberAddr = ((char*)ptr) + m->offset;
+
+		if (!logDebug) {
+			m->type->Serialize(this, memberAddr);
+			continue;
+		}
+
 		unsigned mstart = stream->tellp();
 		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s", c->name, m->name, m->type->GetName().c_str());
 		m->type->Serialize(this, memberAddr);
 		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s size:%d", c->name, m->name, m->type->GetName().c_str(), om.size);
+		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s size:%d", c->name, m->name, m->type->GetName().c_str(), int(mend - mstart));
 	}
 
-
-	if (c->HasSerialize()) {
-		ObjectMember om;
-		om.member = nullptr;
-		om.memberId = -1;
-		unsigned mstart = stream->tellp();
+	if (c->HasSerialize())
 		c->CallSerializeProc(ptr, this);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-	}
 
-	objr->memberGroups.push_back(omg);
+	if (!countSizes)
+		return;
 
 	const unsigned objend = stream->tellp();
 	const int sz = objend - objstart;
@@ -194,18 +212,14 @@ void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* o
 	// register the object, and mark it as embedded if a pointer was already referencing it
 	ObjectRef* obj = FindObjectRef(inst, objClass, true);
 	if (!obj) {
-		objects.emplace_back(inst, objects.size(), true, objClass);
-		obj = &objects.back();
-		ptrToId[inst].push_back(obj);
+		obj = AddObjectRef(inst, objClass, true);
 	} else if (obj->isEmbedded) {
 		throw std::string("Reserialization of embedded object (") + objClass->name + ")";
+	} else if (!obj->isPending) {
+		throw std::string("Object pointer was serialized (") + objClass->name + ")";
 	} else {
-		std::vector<ObjectRef*>::iterator it = std::find(pendingObjects.begin(), pendingObjects.end(), obj);
-		if (it == pendingObjects.end()) {
-			throw std::string("Object pointer was serialized (") + objClass->name + ")";
-		} else {
-			pendingObjects.erase(it);
-		}
+		// SavePackage skips it, the data is written here instead
+		obj->isPending = false;
 	}
 	obj->class_ = objClass;
 	obj->isEmbedded = true;
@@ -214,7 +228,7 @@ void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* o
 	WriteVarSizeUInt(stream, obj->id);
 
 	// write the object
-	SerializeObject(objClass, inst, obj);
+	SerializeObject(objClass, inst);
 }
 
 void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objClass)
@@ -224,9 +238,8 @@ void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objCla
 		int id;
 		ObjectRef* obj = FindObjectRef(*ptr, objClass, false);
 		if (!obj) {
-			objects.emplace_back(*ptr, objects.size(), false, objClass);
-			obj = &objects.back();
-			ptrToId[*ptr].push_back(obj);
+			obj = AddObjectRef(*ptr, objClass, false);
+			obj->isPending = true;
 			pendingObjects.push_back(obj);
 		}
 		id = obj->id;
@@ -284,44 +297,48 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	obj->classIndex = 0;
 
 	// Insert the first object that will provide references to everything
-	objects.emplace_back(rootObj, objects.size(), false, rootObjClass);
-	obj = &objects.back();
-	ptrToId[rootObj].push_back(obj);
+	obj = AddObjectRef(rootObj, rootObjClass, false);
+	obj->isPending = true;
 	pendingObjects.push_back(obj);
 
+	std::vector<ObjectRef*> po;
+
 	// Save until all the referenced objects have been stored
 	while (!pendingObjects.empty())
 	{
-		const std::vector<ObjectRef*> po = pendingObjects;
-		pendingObjects.clear();
+		po.clear();
+		po.swap(pendingObjects);
 
+		// objects embedded since they were queued have already been written;
+		// the others leave the pending state before any of them is written
+		po.erase(std::remove_if(po.begin(), po.end(), [](const ObjectRef* o) { return !o->isPending; }), po.end());
+
+		for (ObjectRef* obj: po) {
+			obj->isPending = false;
+		}
 		for (ObjectRef* obj: po) {
-			SerializeObject(obj->class_, obj->ptr, obj);
+			SerializeObject(obj->class_, obj->ptr);
 			//LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s size:%i", obj->class_->name.c_str(), sz);
 		}
 	}
 
-	// Collect a set of all used classes
-	std::map<creg::Class*, ClassRef> classMap;
-	std::vector<ClassRef*> classRefs;
+	// Collect a set of all used classes, indexed in order of first use
+	spring::unsynced_map<creg::Class*, int> classMap;
+	std::vector<ClassRef> classRefs;
 	for (ObjectRef& oRef: objects) {
 		if (oRef.ptr == nullptr)
 			continue;
 
 		creg::Class* c = oRef.class_;
 		while (c) {
-			std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(c);
-			if (cr == classMap.end()) {
-				ClassRef* pRef = &classMap[c];
-				pRef->index = classRefs.size();
-				pRef->class_ = c;
-				classRefs.push_back(pRef);
+			if (classMap.find(c) == classMap.end()) {
+				classMap[c] = classRefs.size();
+				classRefs.push_back({int(classRefs.size()), c});
 			}
 			c = c->base();
 		}
 
-		std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(oRef.class_);
-		oRef.classIndex = cr->second.index;
+		oRef.classIndex = classMap[oRef.class_];
 	}
 
 
@@ -340,9 +357,8 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	// Write the class references & calc their checksum
 	ph.numObjClassRefs = classRefs.size();
 	ph.objClassRefOffset = (int)stream->tellp();
-	for (auto& classRef: classRefs) {
-		Class* c = classRef->class_;
-		WriteZStr(*stream, c->name);
+	for (const ClassRef& classRef: classRefs) {
+		WriteZStr(*stream, classRef.class_->name);
 	};
 
 	// Write object info
@@ -359,9 +375,8 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 
 	// Calculate a checksum for metadata verification
 	ph.metadataChecksum = 0;
-	for (auto& classRef: classRefs) {
-		Class* c = classRef->class_;
-		c->CalculateChecksum(ph.metadataChecksum);
+	for (const ClassRef& classRef: classRefs) {
+		classRef.class_->CalculateChecksum(ph.metadataChecksum);
 	}
 
 	int endOffset = stream->tellp();
@@ -379,6 +394,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	pendingObjects.clear();
 	objects.clear();
 	classSizes.clear();
+	classCounts.clear();
 }
 
 //-------------------------------------------------------------------------
@@ -8,11 +8,13 @@
 
 #ifdef USING_CREG
 
-#include <map>
+#include <cstdint>
 #include <vector>
 #include <deque>
 #include <istream>
 
+#include "System/UnorderedMap.hpp"
+
 namespace creg {
 
 	/**
@@ -23,43 +25,27 @@ namespace creg {
 	class COutputStreamSerializer : public ISerializer
 	{
 	protected:
-		struct ObjectMember {
-			Class::Member* member;
-			int memberId;
-			int size;
-		};
-		struct ObjectMemberGroup {
-			Class* membersClass;
-			std::vector<COutputStreamSerializer::ObjectMember> members;
-			int size;
-		};
 		struct ObjectRef {
-			ObjectRef() {
-				ptr = 0;
-				id=0;
-				classIndex=0;
-				isEmbedded=false;
-				class_=0;
-			}
+			ObjectRef() = default;
 			ObjectRef(void* ptr, int id, bool isEmbedded, Class* class_) {
 				this->ptr = ptr;
-				this->id=id;
-				classIndex=0;
-				this->isEmbedded=isEmbedded;
-				this->class_=class_;
+				this->id = id;
+				this->isEmbedded = isEmbedded;
+				this->class_ = class_;
 			}
-			ObjectRef(const ObjectRef&src) :memberGroups(src.memberGroups){
-				ptr=src.ptr;
-				id=src.id;
-				classIndex=src.classIndex;
-				isEmbedded=src.isEmbedded;
-				class_=src.class_;
-			}
-			void* ptr;
-			int id, classIndex;
-			bool isEmbedded;
-			Class* class_;
-			std::vector<COutputStreamSerializer::ObjectMemberGroup> memberGroups;
+
+			void* ptr = nullptr;
+			// next reference to the same address (e.g. an object and its first embedded member)
+			ObjectRef* nextRef = nullptr;
+
+			int id = 0;
+			int classIndex = 0;
+
+			bool isEmbedded = false;
+			bool isPending = false;
+
+			Class* class_ = nullptr;
+
 			bool isThisObject(void* objPtr, Class* objClass, bool objEmbedded) const
 			{
 				if (ptr != objPtr) return false;
@@ -77,24 +63,37 @@ namespace creg {
 			}
 		};
 
+		struct PtrHash {
+			size_t operator () (const void* p) const {
+				// objects are aligned, mix the address so its low bits are not all equal
+				std::uint64_t x = reinterpret_cast<std::uintptr_t>(p);
+				x ^= (x >> 33); x *= 0xff51afd7ed558ccdull;
+				x ^= (x >> 33);
+				return x;
+			}
+		};
+
 		// Temporary class reference
 		struct ClassRef;
 
 		std::ostream* stream;
-		std::map<void*,std::vector<ObjectRef*> > ptrToId;
+		// address -> first reference; objects is the arena all ObjectRef's live in
+		spring::unsynced_map<void*, ObjectRef*, PtrHash> ptrToId;
 		std::deque<ObjectRef> objects;
-		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved
-		std::map<Class*, int> classSizes;
-		std::map<Class*, int> classCounts;
+		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved, unless embedded meanwhile
+		// only gathered when debug-logging is enabled
+		spring::unsynced_map<Class*, int> classSizes;
+		spring::unsynced_map<Class*, int> classCounts;
 
 		// Serialize all class names
 		void WriteObjectInfo();
 		// Helper for instance/ptr saving
 		void WriteObjectRef(void* inst, Class* cls, bool embedded);
 
+		ObjectRef* AddObjectRef(void* inst, Class* objClass, bool isEmbedded);
 		ObjectRef* FindObjectRef(void* inst, Class* objClass, bool isEmbedded);
 
-		void SerializeObject(Class* c, void* ptr, ObjectRef* objr);
+		void SerializeObject(Class* c, void* ptr);
 
 	public:
 		COutputStreamSerializer();
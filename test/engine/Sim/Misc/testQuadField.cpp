@@ -3,6 +3,8 @@
 #include "Sim/Misc/QuadField.h"
 #include "System/float3.h"
 #include "System/SpringMath.h"
+#include <chrono>
+#include <vector>
 #include <stdlib.h>
 #include <time.h>
 
@@ -99,3 +101,109 @@ TEST_CASE("QuadField")
 	INFO("Too little quads returned!");
 	CHECK_FALSE(fail);
 }
+
+
+
+// not a strict test; reports the throughput of radius- and ray-queries at
+// different quad sizes (as used by CQuadField::Resize) against the density
+// of point-objects spread over the map, where each query is charged for the
+// objects it would have to visit (as GetUnitsExact et al do)
+TEST_CASE("QuadFieldThroughput")
+{
+	srand(time(nullptr));
+
+	static constexpr int MAP_SQUARES = 512;
+	static constexpr int NUM_QUERIES = 20000;
+
+	static constexpr int   QUAD_SIZES[] = {CQuadField::BASE_QUAD_SIZE, CQuadField::BASE_QUAD_SIZE / 2, CQuadField::MIN_QUAD_SIZE};
+	static constexpr int   OBJ_COUNTS[] = {1000, 5000, 20000};
+	static constexpr float QRY_RADIUS   = 300.0f;
+
+	float3::maxxpos = MAP_SQUARES * SQUARE_SIZE - 1.0f;
+	float3::maxzpos = MAP_SQUARES * SQUARE_SIZE - 1.0f;
+
+	std::vector<float3> objPositions;
+	std::vector<float3> qryPositions(NUM_QUERIES);
+	std::vector<float3> qryDirections(NUM_QUERIES);
+	std::vector<int> quadObjCounts;
+
+	for (int n = 0; n < NUM_QUERIES; ++n) {
+		qryPositions[n] = float3(randf() * float3::maxxpos, 0.0f, randf() * float3::maxzpos);
+		qryDirections[n] = float3(randf() - 0.5f, 0.0f, randf() - 0.5f).SafeNormalize();
+	}
+
+	for (const int numObjects: OBJ_COUNTS) {
+		objPositions.clear();
+		objPositions.reserve(numObjects);
+
+		// half of the objects uniformly spread, half clumped in one corner
+		for (int n = 0; n < numObjects; ++n) {
+			const float spread = (n & 1)? 1.0f: 0.125f;
+			objPositions.emplace_back(randf() * float3::maxxpos * spread, 0.0f, randf() * float3::maxzpos * spread);
+		}
+
+		size_t prevNumQuads = 0;
+
+		for (const int quadSize: QUAD_SIZES) {
+			quadField.Kill();
+			quadField.Init(int2(MAP_SQUARES, MAP_SQUARES), quadSize);
+
+			quadObjCounts.clear();
+			quadObjCounts.resize(quadField.GetNumQuadsX() * quadField.GetNumQuadsZ(), 0);
+
+			for (const float3& pos: objPositions) {
+				const int qx = Clamp(int(pos.x / quadSize), 0, quadField.GetNumQuadsX() - 1);
+				const int qz = Clamp(int(pos.z / quadSize), 0, quadField.GetNumQuadsZ() - 1);
+				quadObjCounts[qz * quadField.GetNumQuadsX() + qx] += 1;
+			}
+
+			size_t numRadiusQuads = 0;
+			size_t numRadiusVisits = 0;
+			size_t numRayQuads = 0;
+			size_t numRayVisits = 0;
+
+			const auto t0 = std::chrono::high_resolution_clock::now();
+
+			for (int n = 0; n < NUM_QUERIES; ++n) {
+				QuadFieldQuery qfQuery;
+				quadField.GetQuads(qfQuery, qryPositions[n], QRY_RADIUS);
+
+				for (const int qi: *qfQuery.quads) {
+					numRadiusVisits += quadObjCounts[qi];
+				}
+
+				numRadiusQuads += qfQuery.quads->size();
+			}
+
+			const auto t1 = std::chrono::high_resolution_clock::now();
+
+			for (int n = 0; n < NUM_QUERIES; ++n) {
+				QuadFieldQuery qfQuery;
+				quadField.GetQuadsOnRay(qfQuery, qryPositions[n], qryDirections[n], QRY_RADIUS * 2.0f);
+
+				for (const int qi: *qfQuery.quads) {
+					numRayVisits += quadObjCounts[qi];
+				}
+
+				numRayQuads += qfQuery.quads->size();
+			}
+
+			const auto t2 = std::chrono::high_resolution_clock::now();
+
+			const float radiusTime = std::chrono::duration<float, std::micro>(t1 - t0).count();
+			const float rayTime = std::chrono::duration<float, std::micro>(t2 - t1).count();
+
+			printf("[QuadFieldThroughput] objects=%5d quadSize=%3d | GetQuads: %.3fus/query, %.1f quads, %.1f objects | GetQuadsOnRay: %.3fus/query, %.1f quads, %.1f objects\n",
+				numObjects, quadSize,
+				radiusTime / NUM_QUERIES, numRadiusQuads * 1.0f / NUM_QUERIES, numRadiusVisits * 1.0f / NUM_QUERIES,
+				rayTime / NUM_QUERIES, numRayQuads * 1.0f / NUM_QUERIES, numRayVisits * 1.0f / NUM_QUERIES
+			);
+
+			// finer quads can only ever cover the query area more tightly
+			CHECK(numRadiusQuads >= prevNumQuads);
+			prevNumQuads = numRadiusQuads;
+		}
+	}
+
+	quadField.Kill();
+}
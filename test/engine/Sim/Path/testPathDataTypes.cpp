@@ -0,0 +1,123 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Path/Default/PathDataTypes.h"
+
+#include <queue>
+#include <random>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+TEST_CASE("PathPriorityQueue")
+{
+	static PathNodeBuffer nodes;
+	static PathPriorityQueue queue;
+
+	std::priority_queue<PathNode*, std::vector<PathNode*>, lessCost> refQueue;
+	std::mt19937 rng(1234);
+
+	// few distinct costs, so that many nodes tie on fCost
+	std::uniform_int_distribution<int> costDist(0, 63);
+
+	unsigned int numNodes = 0;
+
+	for (int round = 0; round < 100; round++) {
+		for (int i = 0; i < 200 && numNodes < MAX_SEARCHED_NODES; i++) {
+			PathNode* node = nodes.GetNode(numNodes);
+
+			node->fCost = costDist(rng);
+			// unique gCost, otherwise the pop-order of full ties is unspecified
+			node->gCost = numNodes;
+			node->nodeNum = numNodes++;
+
+			queue.push(node);
+			refQueue.push(node);
+		}
+
+		for (int i = 0; i < 150 && !refQueue.empty(); i++) {
+			REQUIRE(!queue.empty());
+			REQUIRE(queue.size() == refQueue.size());
+			CHECK(queue.top() == refQueue.top());
+
+			queue.pop();
+			refQueue.pop();
+		}
+	}
+
+	while (!refQueue.empty()) {
+		CHECK(queue.top() == refQueue.top());
+
+		queue.pop();
+		refQueue.pop();
+	}
+
+	CHECK(queue.empty());
+
+	queue.push(nodes.GetNode(0));
+	queue.Clear();
+
+	CHECK(queue.empty());
+}
+
+
+TEST_CASE("PathNodeStateBuffer")
+{
+	// not a multiple of the tile-size
+	const int2 bufRes = {37, 21};
+
+	PathNodeStateBuffer buffer;
+	buffer.Resize(bufRes, bufRes);
+
+	CHECK(buffer.GetSize() == (bufRes.x * bufRes.y));
+
+	// states are padded to 5x3 whole tiles
+	std::vector<bool> usedStateIndices(5 * 3 * PathNodeStateBuffer::TILE_NODES, false);
+
+	// every node maps to a distinct state
+	for (int z = 0; z < bufRes.y; z++) {
+		for (int x = 0; x < bufRes.x; x++) {
+			const unsigned int nodeIdx = z * bufRes.x + x;
+			const unsigned int stateIdx = buffer.GetStateIdx(int2(x, z));
+
+			REQUIRE(stateIdx < usedStateIndices.size());
+			CHECK(!usedStateIndices[stateIdx]);
+			CHECK(buffer.GetStateIdx(nodeIdx) == stateIdx);
+
+			usedStateIndices[stateIdx] = true;
+		}
+	}
+
+	// the 2x2 neighborhood of an even node is contiguous
+	CHECK(buffer.GetStateIdx(int2(3, 2)) == (buffer.GetStateIdx(int2(2, 2)) + 1));
+	CHECK(buffer.GetStateIdx(int2(2, 3)) == (buffer.GetStateIdx(int2(2, 2)) + 2));
+	CHECK(buffer.GetStateIdx(int2(3, 3)) == (buffer.GetStateIdx(int2(2, 2)) + 3));
+
+	const unsigned int stateIdx = buffer.GetStateIdx(int2(5, 7));
+
+	buffer.StartSearch();
+	buffer.SetNodeCosts(stateIdx, 1.0f, 2.0f);
+	buffer.SetNodeMaskBits(stateIdx, PATHOPT_OPEN | PATHOPT_LEFT | PATHOPT_OBSOLETE);
+	buffer.ClearNodeMaskBits(stateIdx, PATHOPT_LEFT);
+
+	CHECK(buffer.GetNodeFCost(stateIdx) == 1.0f);
+	CHECK(buffer.GetNodeGCost(stateIdx) == 2.0f);
+	CHECK(buffer.GetNodeMask(stateIdx) == (PATHOPT_OPEN | PATHOPT_OBSOLETE));
+
+	// a new search sees cleared states, except for PATHOPT_OBSOLETE; this
+	// also has to hold when the generation wraps around to that of the write
+	for (int i = 0; i < 0x10000; i++) {
+		buffer.StartSearch();
+
+		if (i != 0 && i != 0xFFFE && i != 0xFFFF)
+			continue;
+
+		CHECK(buffer.GetNodeFCost(stateIdx) == PATHCOST_INFINITY);
+		CHECK(buffer.GetNodeGCost(stateIdx) == PATHCOST_INFINITY);
+		CHECK(buffer.GetNodeMask(stateIdx) == PATHOPT_OBSOLETE);
+	}
+
+	buffer.SetNodeMaskBits(stateIdx, PATHOPT_CLOSED);
+	CHECK(buffer.GetNodeMask(stateIdx) == (PATHOPT_CLOSED | PATHOPT_OBSOLETE));
+}
@@ -2,6 +2,7 @@
 
 #include "System/creg/creg_cond.h"
 #include "System/creg/Serializer.h"
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -78,6 +79,92 @@ CR_REG_METADATA(TestObj, (
 ));
 
 
+// nodes of a large synthetic object graph; every node links to a few others,
+// some of them not saved yet, and points at another node's embedded member
+struct GraphNode {
+	CR_DECLARE_STRUCT(GraphNode);
+
+	int id = 0;
+	float value = 0.0f;
+	std::vector<int> data;
+
+	GraphNode* links[3] = {nullptr, nullptr, nullptr};
+	EmbeddedObj* embeddedPtr = nullptr;
+	EmbeddedObj embedded;
+};
+
+CR_BIND(GraphNode, );
+CR_REG_METADATA(GraphNode, (
+	CR_MEMBER(id),
+	CR_MEMBER(value),
+	CR_MEMBER(data),
+	CR_MEMBER(links),
+	CR_MEMBER(embeddedPtr),
+	CR_MEMBER(embedded)
+));
+
+struct Graph {
+	CR_DECLARE_STRUCT(Graph);
+
+	~Graph() {
+		for (GraphNode* n: nodes) delete n;
+	}
+
+	std::vector<GraphNode*> nodes;
+};
+
+CR_BIND(Graph, );
+CR_REG_METADATA(Graph, CR_MEMBER(nodes));
+
+
+static Graph* makegraph(int numNodes)
+{
+	Graph* g = new Graph;
+	unsigned int seed = 0x2545F491u;
+
+	const auto rand = [&]() { return ((seed = seed * 1664525u + 1013904223u) >> 8); };
+
+	g->nodes.resize(numNodes);
+
+	for (int i = 0; i < numNodes; i++) {
+		g->nodes[i] = new GraphNode;
+		g->nodes[i]->id = i;
+		g->nodes[i]->value = i * 0.5f;
+		g->nodes[i]->data.resize(i % 8, i);
+		g->nodes[i]->embedded.value = -i;
+	}
+	for (GraphNode* n: g->nodes) {
+		for (GraphNode*& l: n->links) {
+			l = g->nodes[rand() % numNodes];
+		}
+		n->embeddedPtr = &g->nodes[rand() % numNodes]->embedded;
+	}
+
+	return g;
+}
+
+static bool test_graph(const Graph* org, const Graph* cpy)
+{
+	if (org->nodes.size() != cpy->nodes.size()) return false;
+
+	for (size_t i = 0; i < org->nodes.size(); i++) {
+		const GraphNode* a = org->nodes[i];
+		const GraphNode* b = cpy->nodes[i];
+
+		if (b->id != a->id || b->value != a->value || b->data != a->data) return false;
+		if (b->embedded.value != a->embedded.value) return false;
+
+		// compare links by node-id, the addresses differ
+		for (int j = 0; j < 3; j++) {
+			if (b->links[j]->id != a->links[j]->id) return false;
+		}
+		if (b->embeddedPtr->value != a->embeddedPtr->value) return false;
+	}
+
+	return true;
+}
+
+
 static void savetest(std::ostream* os)
 {
 	// root obj
@@ -173,3 +260,40 @@ TEST_CASE("CregLoadSave")
 
 	delete root;
 }
+
+
+TEST_CASE("CregLoadSaveLargeGraph")
+{
+	double saveTimes[2] = {0.0, 0.0};
+	double loadTimes[2] = {0.0, 0.0};
+
+	// times should grow (roughly) linearly with the number of objects
+	for (int k = 0; k < 2; k++) {
+		const int numNodes = 50000 << (k * 2);
+
+		Graph* org = makegraph(numNodes);
+		std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+
+		const auto t0 = std::chrono::steady_clock::now();
+
+		creg::COutputStreamSerializer os;
+		os.SavePackage(&ss, org, org->GetClass());
+
+		const auto t1 = std::chrono::steady_clock::now();
+
+		Graph* cpy = static_cast<Graph*>(loadtest(&ss));
+
+		const auto t2 = std::chrono::steady_clock::now();
+
+		saveTimes[k] = std::chrono::duration<double, std::milli>(t1 - t0).count();
+		loadTimes[k] = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+		INFO("graph with " << numNodes << " nodes");
+		CHECK(test_graph(org, cpy));
+
+		WARN("creg graph of " << numNodes << " nodes (" << ss.str().size() << " bytes): save " << saveTimes[k] << "ms, load " << loadTimes[k] << "ms");
+
+		delete cpy;
+		delete org;
+	}
+}
@@ -1,11 +1,31 @@
 
 #include "System/Net/UDPListener.h"
+#include "System/Net/UDPConnection.h"
+#include "System/Net/LatencyHistogram.h"
+#include "System/Net/RawPacket.h"
+#include "Net/Protocol/BaseNetProtocol.h"
 #include "System/Log/ILog.h"
 
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
 
 #define CATCH_CONFIG_MAIN
 #include "lib/catch.hpp"
 
+// connections time their traffic, the clock has to be running
+struct ClockInit {
+	ClockInit() {
+		spring_clock::PushTickRate(true);
+		spring_time::setstarttime(spring_time::gettime(true));
+	}
+	~ClockInit() { spring_clock::PopTickRate(); }
+};
+
+static ClockInit clockInit;
+
 class SocketTest {
 public:
 	SocketTest(){
@@ -89,3 +109,150 @@ TEST_CASE("TryBindSocket")
 	t.TestPort(-1, false);
 }
 
+
+
+// round-trips through a listener that either sleeps a fixed interval between
+// updates (the old server loop) or waits for socket activity; this is a
+// benchmark, only delivery is checked since timings depend on the machine
+static netcode::LatencyHistogram MeasureEchoLatency(int port, bool waitForEvents)
+{
+	constexpr int numPings = 100;
+
+	netcode::UDPListener listener(port, "127.0.0.1");
+	netcode::UDPConnection client(port + 1, "127.0.0.1", port);
+	netcode::LatencyHistogram histogram;
+
+	client.Unmute();
+
+	std::atomic<bool> quit{false};
+	std::thread server([&]() {
+		std::shared_ptr<netcode::UDPConnection> conn;
+
+		while (!quit) {
+			if (waitForEvents) {
+				listener.Wait(spring_msecs(30));
+			} else {
+				spring_msecs(5).sleep(true);
+			}
+
+			listener.Update();
+
+			if (listener.HasIncomingConnections())
+				(conn = listener.AcceptConnection())->Unmute();
+			if (conn == nullptr)
+				continue;
+
+			for (std::shared_ptr<const netcode::RawPacket> packet; (packet = conn->GetData()) != nullptr; ) {
+				conn->SendData(packet);
+			}
+
+			// bypass the chunk rate-limit, it would dominate the measurement
+			conn->Flush(true);
+		}
+	});
+
+	for (int i = 0; i < numPings; i++) {
+		const spring_time sendTime = spring_gettime();
+
+		client.SendData(CBaseNetProtocol::Get().SendKeyFrame(i));
+		client.Flush(true);
+
+		while ((spring_gettime() - sendTime) < spring_secs(1)) {
+			client.Update();
+
+			if (client.GetData() != nullptr) {
+				histogram.AddSample(spring_gettime() - sendTime);
+				break;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	quit = true;
+	server.join();
+	return histogram;
+}
+
+TEST_CASE("UDPListenerLatency")
+{
+	const netcode::LatencyHistogram pollHist = MeasureEchoLatency(11120, false);
+	const netcode::LatencyHistogram waitHist = MeasureEchoLatency(11130, true);
+
+	LOG("\nloopback echo latency");
+	LOG("\tpolling: %s", pollHist.ToString().c_str());
+	LOG("\twaiting: %s", waitHist.ToString().c_str());
+
+	CHECK(pollHist.GetCount() == 100);
+	CHECK(waitHist.GetCount() == 100);
+}
+
+
+// one listener broadcasting the same packets to many connections, as the
+// server does; reports throughput, only delivery is checked
+TEST_CASE("UDPConnectionThroughput")
+{
+	constexpr int port = 11140;
+	constexpr int numClients = 16;
+	constexpr int numPackets = 500;
+
+	netcode::UDPListener listener(port, "127.0.0.1");
+
+	std::vector<std::unique_ptr<netcode::UDPConnection>> clients;
+	std::vector<std::shared_ptr<netcode::UDPConnection>> conns;
+	std::vector<int> numReceived(numClients, 0);
+
+	for (int i = 0; i < numClients; i++) {
+		clients.emplace_back(new netcode::UDPConnection(port + 1 + i, "127.0.0.1", port));
+		clients.back()->Unmute();
+		clients.back()->SendData(CBaseNetProtocol::Get().SendKeyFrame(0));
+		clients.back()->Flush(true);
+	}
+
+	for (const spring_time t = spring_gettime(); conns.size() < numClients && (spring_gettime() - t) < spring_secs(5); ) {
+		listener.Update();
+
+		while (listener.HasIncomingConnections()) {
+			conns.push_back(listener.AcceptConnection());
+			conns.back()->Unmute();
+		}
+	}
+
+	REQUIRE(conns.size() == numClients);
+
+	// fills about half a chunk, so every packet is sent as a separate datagram
+	const std::shared_ptr<const netcode::RawPacket> packet = CBaseNetProtocol::Get().SendSystemMessage(0, std::string(120, 'x'));
+	const spring_time startTime = spring_gettime();
+
+	for (int n = 0, numPending = numClients * numPackets; numPending > 0 && (spring_gettime() - startTime) < spring_secs(10); ) {
+		if (n < numPackets) {
+			for (const auto& conn: conns) {
+				conn->SendData(packet);
+				conn->Flush(true);
+			}
+
+			n++;
+		}
+
+		listener.Update();
+
+		for (int i = 0; i < numClients; i++) {
+			clients[i]->Update();
+
+			while (clients[i]->GetData() != nullptr) {
+				numReceived[i] += 1;
+				numPending -= 1;
+			}
+		}
+	}
+
+	const float secs = (spring_gettime() - startTime).toSecsf();
+	const int numTotal = std::accumulate(numReceived.begin(), numReceived.end(), 0);
+
+	LOG("\nbroadcast throughput");
+	LOG("\t%d packets to %d connections in %.3fs (%.0f packets/s)", numPackets, numClients, secs, numTotal / std::max(secs, 0.001f));
+
+	for (int i = 0; i < numClients; i++) {
+		CHECK(numReceived[i] == numPackets);
+	}
+}